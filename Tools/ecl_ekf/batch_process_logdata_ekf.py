@@ -30,7 +30,8 @@ ulog_directory = args.directory_path
 print("\n"+"analysing the .ulg files in "+ulog_directory)
 
 # get all the ulog files found in the specified directory and in subdirectories
-ulog_files = glob.glob(os.path.join(ulog_directory, '**/*.ulg'), recursive=True)
+ulog_files = glob.glob(os.path.join(ulog_directory, '**/*.ulg'), recursive=True) + \
+             glob.glob(os.path.join(ulog_directory, '**/*.ulz'), recursive=True)
 
 # remove the files already analysed unless the overwrite flag was specified. A ulog file is consired to be analysed if
 # a corresponding .pdf file exists.'
@@ -8,6 +8,7 @@ import os, sys
 from pyulog import *
 
 from analyse_logdata_ekf import analyse_ekf
+from ulog_lz4 import load_ulog
 
 """
 Performs a health assessment on the ecl EKF navigation estimator data contained in a an ULog file
@@ -16,7 +17,7 @@ Outputs summary plots in a pdf file named <inputfilename>.pdf
 """
 
 parser = argparse.ArgumentParser(description='Analyse the estimator_status and ekf2_innovation message data')
-parser.add_argument('filename', metavar='file.ulg', help='ULog input file')
+parser.add_argument('filename', metavar='file.ulg', help='ULog input file (.ulg or compressed .ulz)')
 parser.add_argument('--no-plots', action='store_true',
                     help='Whether to only analyse and not plot the summaries for developers.')
 parser.add_argument('--check-level-thresholds', type=str, default=None,
@@ -35,7 +36,7 @@ def is_valid_directory(parser, arg):
 args = parser.parse_args()
 
 ## load the log and extract the necessary data for the analyses
-ulog = ULog(args.filename, None)
+ulog = load_ulog(args.filename, None)
 data = ulog.data_list
 
 # extract data from EKF status message
@@ -0,0 +1,139 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+
+"""
+Loader for compressed ULog files (.ulz), as written by the logger with SDLOG_COMPRESS=1.
+
+The container consists of an 8 byte magic followed by blocks of
+<uint16 raw_size><uint16 data_size><data>. If data_size equals raw_size, the block is
+stored uncompressed, otherwise it is an LZ4 block. Concatenating the decompressed
+blocks yields a regular ULog file (see src/modules/logger/messages.h).
+
+Can also be used standalone to convert a .ulz into a .ulg file:
+    ulog_lz4.py log001.ulz [log001.ulg]
+"""
+
+from __future__ import print_function
+
+import os
+import struct
+import sys
+import tempfile
+
+COMPRESSED_MAGIC = b'ULz4\x01\x12\x35\x01'
+BLOCK_HEADER = struct.Struct('<HH')
+BLOCK_MAX = 4096
+
+try:
+    import lz4.block as _lz4_block
+except ImportError:
+    _lz4_block = None
+
+
+def lz4_block_decompress(data, raw_size):
+    """ decompress a single LZ4 block (pure python fallback if the lz4 module is not installed) """
+    if _lz4_block is not None:
+        return _lz4_block.decompress(data, uncompressed_size=raw_size)
+
+    src = bytearray(data)
+    out = bytearray()
+    i = 0
+    n = len(src)
+    while i < n:
+        token = src[i]
+        i += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        out += src[i:i + length]
+        i += length
+        if i >= n:
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        if offset == 0 or offset > len(out):
+            raise ValueError('invalid LZ4 match offset')
+        length = token & 15
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        length += 4
+        start = len(out) - offset
+        if length <= offset:
+            out += out[start:start + length]
+        else:
+            # overlapping match: copy byte by byte
+            for k in range(length):
+                out.append(out[start + k])
+
+    if len(out) != raw_size:
+        raise ValueError('decompressed block has wrong size')
+    return bytes(out)
+
+
+def is_compressed(filename):
+    """ check whether a file is a compressed ULog container """
+    with open(filename, 'rb') as f:
+        return f.read(len(COMPRESSED_MAGIC)) == COMPRESSED_MAGIC
+
+
+def decompress(filename, output_filename):
+    """ decompress a .ulz file into a regular ULog file. A truncated last block is dropped. """
+    with open(filename, 'rb') as f_in, open(output_filename, 'wb') as f_out:
+        if f_in.read(len(COMPRESSED_MAGIC)) != COMPRESSED_MAGIC:
+            raise ValueError('{} is not a compressed ULog file'.format(filename))
+
+        while True:
+            header = f_in.read(BLOCK_HEADER.size)
+            if len(header) < BLOCK_HEADER.size:
+                break
+            raw_size, data_size = BLOCK_HEADER.unpack(header)
+            if raw_size > BLOCK_MAX or data_size > raw_size:
+                raise ValueError('invalid block header')
+            data = f_in.read(data_size)
+            if len(data) < data_size:
+                print('warning: {} is truncated'.format(filename))
+                break
+            if data_size == raw_size:
+                f_out.write(data)
+            else:
+                f_out.write(lz4_block_decompress(data, raw_size))
+
+
+def load_ulog(filename, message_name_filter_list=None):
+    """ load a ULog file with pyulog, transparently decompressing .ulz files """
+    from pyulog import ULog
+
+    if not is_compressed(filename):
+        return ULog(filename, message_name_filter_list)
+
+    fd, tmp_filename = tempfile.mkstemp(suffix='.ulg')
+    os.close(fd)
+    try:
+        decompress(filename, tmp_filename)
+        return ULog(tmp_filename, message_name_filter_list)
+    finally:
+        os.remove(tmp_filename)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('usage: {} <file.ulz> [<output.ulg>]'.format(sys.argv[0]))
+        sys.exit(1)
+
+    input_file = sys.argv[1]
+    if len(sys.argv) > 2:
+        output_file = sys.argv[2]
+    else:
+        output_file = os.path.splitext(input_file)[0] + '.ulg'
+
+    decompress(input_file, output_file)
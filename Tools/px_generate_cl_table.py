@@ -0,0 +1,128 @@
+#!/usr/bin/env python
+############################################################################
+#
+#   Copyright (C) 2019 PX4 Development Team. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in
+#    the documentation and/or other materials provided with the
+#    distribution.
+# 3. Neither the name PX4 nor the names of its contributors may be
+#    used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+# FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+# COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+# BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+# OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+# AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+# ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+############################################################################
+
+"""
+Lift curve table generator
+
+Converts the identified CL(alpha) curves in
+src/modules/vtol_att_control/CL_SYSID/CL_<n>.txt into the binary table that is
+loaded (memory-mapped) by the tailsitter at startup. Curve <n> of the table is
+selected with the parameter SYS_IDENT_NUM.
+
+Each text file contains the lift coefficient on a uniform angle of attack grid,
+starting at --alpha-min with a spacing of --alpha-step degrees.
+
+Binary layout (little endian):
+
+    char     magic[4]       "CLTB"
+    uint16   version        1
+    uint16   num_curves
+    uint16   num_points     points per curve
+    uint16   reserved       0
+    float32  alpha_min      angle of attack of the first point [deg]
+    float32  alpha_step     grid spacing [deg]
+    uint32   crc32          CRC32 of the curve data (no pre/post inversion)
+    float32  data[num_curves][num_points]
+
+Usage:
+    px_generate_cl_table.py -o ROMFS/px4fmu_common/aero/cl_sysid.bin \
+        src/modules/vtol_att_control/CL_SYSID/CL_*.txt
+"""
+
+from __future__ import print_function
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = b'CLTB'
+VERSION = 1
+
+
+def crc32(data):
+    """ CRC32 compatible with crc32part() (reflected 0xEDB88320, no inversion) """
+    crc = 0
+    for byte in bytearray(data):
+        crc ^= byte
+        for _ in range(8):
+            if crc & 1:
+                crc = (crc >> 1) ^ 0xEDB88320
+            else:
+                crc >>= 1
+    return crc
+
+
+def curve_index(file_name):
+    match = re.search(r'(\d+)\.txt$', file_name)
+    if match is None:
+        raise ValueError('cannot extract curve index from ' + file_name)
+    return int(match.group(1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the binary CL(alpha) table.')
+    parser.add_argument('-o', '--output', required=True, help='output binary file')
+    parser.add_argument('--alpha-min', type=float, default=0.0,
+                        help='angle of attack of the first point [deg]')
+    parser.add_argument('--alpha-step', type=float, default=1.0,
+                        help='angle of attack grid spacing [deg]')
+    parser.add_argument('curves', nargs='+', help='CL_<n>.txt input files')
+    args = parser.parse_args()
+
+    curves = []
+    for file_name in sorted(args.curves, key=curve_index):
+        with open(file_name, 'r') as f:
+            curves.append([float(v) for v in f.read().replace(',', ' ').split()])
+
+    num_points = len(curves[0])
+    for file_name, curve in zip(sorted(args.curves, key=curve_index), curves):
+        if len(curve) != num_points:
+            print('{:}: expected {:} points, got {:}'.format(file_name, num_points, len(curve)),
+                  file=sys.stderr)
+            return 1
+
+    data = b''.join(struct.pack('<{:}f'.format(num_points), *curve) for curve in curves)
+    header = struct.pack('<4sHHHHffI', MAGIC, VERSION, len(curves), num_points, 0,
+                         args.alpha_min, args.alpha_step, crc32(data))
+
+    with open(args.output, 'wb') as f:
+        f.write(header)
+        f.write(data)
+
+    print('wrote {:} curves with {:} points to {:}'.format(len(curves), num_points, args.output))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
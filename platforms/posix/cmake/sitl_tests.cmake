@@ -11,8 +11,10 @@ set(tests
 	conv
 	ctlmath
 	dataman
+	excitation
 	file2
 	float
+	frequency_response
 	hrt
 	hysteresis
 	int
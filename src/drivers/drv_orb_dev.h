@@ -76,4 +76,23 @@
 /** Check whether the topic is published, sets *(unsigned long *)arg to 1 if published, 0 otherwise */
 #define ORBIOCISPUBLISHED	_ORBIOC(17)
 
+/** Get the opaque subscriber handle of this file descriptor, used for batched access (uORB::SubscriptionGroup) */
+#define ORBIOCGSUBSCRIBER	_ORBIOC(18)
+
+/** Switch the topic to lockless single-writer mode. This must be done before the first publication. */
+#define ORBIOCSETSINGLEWRITER	_ORBIOC(19)
+
+/**
+ * Let the topic set bits in a word whenever it is published (and while this subscription has unread
+ * messages), so the subscriber can find updated topics without checking each of them.
+ * arg: pointer to a struct orb_update_flag, or 0 to unregister. Only one subscription per topic can
+ * register, and the registration is removed when the subscription is closed.
+ */
+#define ORBIOCSETUPDATEFLAG	_ORBIOC(20)
+
+struct orb_update_flag {
+	uint32_t *word;		/**< word to set the bits in (with an atomic or) */
+	uint32_t mask;		/**< bits to set */
+};
+
 #endif /* _DRV_UORB_H */
@@ -35,6 +35,9 @@
  * @file RingBuffer.h
  * @author Roman Bapst <bapstroman@gmail.com>
  * Template RingBuffer.
+ *
+ * StaticRingBuffer has the same interface with the storage for a fixed maximum number of samples inside the
+ * object, so that no heap memory is used, and finds samples by binary search of the timestamps.
  */
 
 #include <inttypes.h>
@@ -169,3 +172,171 @@ private:
 
 	bool _first_write{true};
 };
+
+template <typename data_type, uint8_t capacity>
+class StaticRingBuffer
+{
+public:
+	static_assert(capacity > 0, "capacity must be at least one sample");
+
+	StaticRingBuffer()
+	{
+		unallocate();
+	}
+
+	// no copy, assignment, move, move assignment
+	StaticRingBuffer(const StaticRingBuffer &) = delete;
+	StaticRingBuffer &operator=(const StaticRingBuffer &) = delete;
+	StaticRingBuffer(StaticRingBuffer &&) = delete;
+	StaticRingBuffer &operator=(StaticRingBuffer &&) = delete;
+
+	// use the first size elements of the storage, fails if size exceeds the capacity
+	bool allocate(uint8_t size)
+	{
+		if (size == 0 || size > capacity) {
+			return false;
+		}
+
+		_size = size;
+
+		_head = 0;
+		_tail = 0;
+
+		// set the time elements to zero so that bad data is not retrieved from the buffers
+		for (uint8_t index = 0; index < _size; index++) {
+			_buffer[index] = {};
+		}
+
+		_first_write = true;
+		_unordered_pushes = 0;
+
+		return true;
+	}
+
+	// return to the initial state of a single empty sample
+	void unallocate()
+	{
+		allocate(1);
+		data_type d = {};
+		push(d);
+	}
+
+	void push(const data_type &sample)
+	{
+		uint8_t head_new = _head;
+
+		if (!_first_write) {
+			head_new = (_head + 1) % _size;
+
+			// an older sample breaks the time order needed by the binary search until it is overwritten
+			if (sample.time_us < _buffer[_head].time_us) {
+				_unordered_pushes = _size;
+
+			} else if (_unordered_pushes > 0) {
+				_unordered_pushes--;
+			}
+		}
+
+		_buffer[head_new] = sample;
+		_head = head_new;
+
+		// move tail if we overwrite it
+		if (_head == _tail && !_first_write) {
+			_tail = (_tail + 1) % _size;
+
+		} else {
+			_first_write = false;
+		}
+	}
+
+	uint8_t get_length() const { return _size; }
+
+	data_type &operator[](const uint8_t index) { return _buffer[index]; }
+
+	const data_type &get_newest() { return _buffer[_head]; }
+	const data_type &get_oldest() { return _buffer[_tail]; }
+
+	uint8_t get_oldest_index() const { return _tail; }
+
+	// same result as RingBuffer::pop_first_older_than(), the newest sample which is not newer than timestamp and
+	// less than 0.1 sec older is returned and removed together with all older samples
+	bool pop_first_older_than(const uint64_t &timestamp, data_type *sample)
+	{
+		int index = (_unordered_pushes > 0) ? find_linear(timestamp) : find_binary(timestamp);
+
+		if (index < 0 || timestamp - _buffer[index].time_us >= (uint64_t)1e5) {
+			return false;
+		}
+
+		*sample = _buffer[index];
+
+		// Now we can set the tail to the item which comes after the one we removed
+		// since we don't want to have any older data in the buffer
+		if (index == _head) {
+			_tail = _head;
+			_first_write = true;
+
+		} else {
+			_tail = (index + 1) % _size;
+		}
+
+		_buffer[index].time_us = 0;
+
+		return true;
+	}
+
+	int get_total_size() { return sizeof(*this); }
+
+private:
+	// index of the newest sample between tail and head which is not newer than timestamp, -1 if there is none
+	int find_binary(uint64_t timestamp) const
+	{
+		// samples are in increasing time order from the tail to the head
+		const uint8_t count = (_head + _size - _tail) % _size + 1;
+		uint8_t low = 0;
+		uint8_t high = count;
+
+		// find the first sample newer than timestamp
+		while (low < high) {
+			const uint8_t mid = (low + high) / 2;
+
+			if (_buffer[(_tail + mid) % _size].time_us <= timestamp) {
+				low = mid + 1;
+
+			} else {
+				high = mid;
+			}
+		}
+
+		return (low == 0) ? -1 : (_tail + low - 1) % _size;
+	}
+
+	int find_linear(uint64_t timestamp) const
+	{
+		// start looking from newest observation data
+		for (uint8_t i = 0; i < _size; i++) {
+			int index = (_head - i);
+			index = index < 0 ? _size + index : index;
+
+			if (timestamp >= _buffer[index].time_us && timestamp - _buffer[index].time_us < (uint64_t)1e5) {
+				return index;
+			}
+
+			if (index == _tail) {
+				// we have reached the tail and haven't got a match
+				return -1;
+			}
+		}
+
+		return -1;
+	}
+
+	data_type _buffer[capacity] {};
+
+	uint8_t _head{0};
+	uint8_t _tail{0};
+	uint8_t _size{0};
+
+	bool _first_write{true};
+	uint8_t _unordered_pushes{0};	///< number of pushes until an out of order sample has been overwritten
+};
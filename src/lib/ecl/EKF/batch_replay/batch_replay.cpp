@@ -0,0 +1,298 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file batch_replay.cpp
+ *
+ * Replays many logs with many parameter sets through the estimator in parallel and writes
+ * a CSV summary with one row per log and parameter set.
+ *
+ * Each log is read once and replayed with all parameter sets before the next log is read,
+ * so memory use is bounded by the number of worker threads, not by the number of logs.
+ */
+
+#include "ekf_replay.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <getopt.h>
+
+using namespace ekf_replay;
+
+namespace
+{
+
+struct LogEntry {
+	const char *path{nullptr};
+	std::mutex mutex;
+	std::shared_ptr<LogData> data;
+	bool load_failed{false};
+	std::atomic<int> jobs_remaining{0};
+};
+
+struct Job {
+	Job(size_t log_index, size_t set_index) : log(log_index), set(set_index) {}
+
+	size_t log;
+	size_t set;
+	Summary summary;
+	bool ok{false};
+};
+
+void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-j threads] [-p param_sets] [-o summary.csv] [-t series_dir] [-r series_rate_hz] "
+		"log.ulg...\n"
+		" -j  number of worker threads, default: number of CPUs\n"
+		" -p  parameter sets file, lines \"[name]\" followed by \"EKF2_PARAM value\".\n"
+		"     Without this option each log is replayed once with its logged parameters\n"
+		" -o  summary output file, default: stdout\n"
+		" -t  directory for the estimator output of each replay, not written by default\n"
+		" -r  rate of the estimator output, default: 10 Hz\n", name);
+}
+
+std::string basename_without_extension(const char *path)
+{
+	std::string name(path);
+	const size_t slash = name.find_last_of('/');
+
+	if (slash != std::string::npos) {
+		name.erase(0, slash + 1);
+	}
+
+	const size_t dot = name.find_last_of('.');
+
+	if (dot != std::string::npos && dot > 0) {
+		name.erase(dot);
+	}
+
+	return name;
+}
+
+std::shared_ptr<LogData> acquire_log(LogEntry &entry)
+{
+	std::lock_guard<std::mutex> lock(entry.mutex);
+
+	if (!entry.data && !entry.load_failed) {
+		std::shared_ptr<LogData> data = std::make_shared<LogData>();
+
+		if (data->load(entry.path)) {
+			entry.data = data;
+
+		} else {
+			entry.load_failed = true;
+		}
+	}
+
+	return entry.data;
+}
+
+void release_log(LogEntry &entry)
+{
+	if (--entry.jobs_remaining == 0) {
+		// last replay of this log, free the sensor data. Running jobs keep their own reference.
+		std::lock_guard<std::mutex> lock(entry.mutex);
+		entry.data.reset();
+	}
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	unsigned num_threads = std::thread::hardware_concurrency();
+	const char *param_sets_path = nullptr;
+	const char *summary_path = nullptr;
+	const char *series_dir = nullptr;
+	float series_rate_hz = 10.0f;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "j:p:o:t:r:h")) != -1) {
+		switch (ch) {
+		case 'j':
+			num_threads = (unsigned)atoi(optarg);
+			break;
+
+		case 'p':
+			param_sets_path = optarg;
+			break;
+
+		case 'o':
+			summary_path = optarg;
+			break;
+
+		case 't':
+			series_dir = optarg;
+			break;
+
+		case 'r':
+			series_rate_hz = (float)atof(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc || series_rate_hz <= 0.0f) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<ParameterSet> sets;
+
+	if (param_sets_path != nullptr) {
+		if (!ParameterSet::load(param_sets_path, sets) || sets.empty()) {
+			fprintf(stderr, "no valid parameter sets in %s\n", param_sets_path);
+			return 1;
+		}
+
+	} else {
+		sets.push_back(ParameterSet{"logged", {}});
+	}
+
+	const size_t num_logs = argc - optind;
+	std::unique_ptr<LogEntry[]> logs(new LogEntry[num_logs]);
+	std::vector<Job> jobs;
+	jobs.reserve(num_logs * sets.size());
+
+	for (size_t log = 0; log < num_logs; log++) {
+		logs[log].path = argv[optind + log];
+		logs[log].jobs_remaining = (int)sets.size();
+
+		for (size_t set = 0; set < sets.size(); set++) {
+			jobs.emplace_back(log, set);
+		}
+	}
+
+	if (num_threads == 0) {
+		num_threads = 1;
+	}
+
+	if (num_threads > jobs.size()) {
+		num_threads = (unsigned)jobs.size();
+	}
+
+	const uint64_t series_interval_us = (uint64_t)(1e6f / series_rate_hz);
+	std::atomic<size_t> next_job{0};
+	const auto start = std::chrono::steady_clock::now();
+
+	auto worker = [&]() {
+		size_t index;
+
+		while ((index = next_job++) < jobs.size()) {
+			Job &job = jobs[index];
+			LogEntry &entry = logs[job.log];
+			std::shared_ptr<LogData> data = acquire_log(entry);
+
+			if (data) {
+				FILE *series = nullptr;
+
+				if (series_dir != nullptr) {
+					const std::string path = std::string(series_dir) + "/" + basename_without_extension(entry.path)
+								 + "_" + sets[job.set].name + ".csv";
+					series = fopen(path.c_str(), "w");
+
+					if (series == nullptr) {
+						fprintf(stderr, "cannot create %s\n", path.c_str());
+
+					} else {
+						print_series_header(series);
+					}
+				}
+
+				run(*data, sets[job.set], job.summary, series, series_interval_us);
+				job.ok = true;
+
+				if (series != nullptr) {
+					fclose(series);
+				}
+			}
+
+			data.reset();
+			release_log(entry);
+		}
+	};
+
+	std::vector<std::thread> threads;
+
+	for (unsigned i = 0; i < num_threads; i++) {
+		threads.emplace_back(worker);
+	}
+
+	for (std::thread &t : threads) {
+		t.join();
+	}
+
+	const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	FILE *out = stdout;
+
+	if (summary_path != nullptr) {
+		out = fopen(summary_path, "w");
+
+		if (out == nullptr) {
+			fprintf(stderr, "cannot create %s\n", summary_path);
+			return 1;
+		}
+	}
+
+	print_summary_header(out);
+
+	double replayed_s = 0.0;
+	unsigned failed = 0;
+
+	for (const Job &job : jobs) {
+		if (job.ok) {
+			print_summary(out, basename_without_extension(logs[job.log].path), sets[job.set].name, job.summary);
+			replayed_s += job.summary.log_duration_s;
+
+		} else {
+			failed++;
+		}
+	}
+
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	fprintf(stderr, "%zu replays (%u failed) on %u threads: %.0f s of flight in %.1f s\n", jobs.size(), failed,
+		num_threads, replayed_s, elapsed_s);
+
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,822 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ekf_replay.cpp
+ */
+
+#include "ekf_replay.h"
+#include "ulog_reader.h"
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace ekf_replay
+{
+
+// Parameters of the estimator, mapped to the same fields as in the ekf2 module
+struct FloatParameter {
+	const char *name;
+	float parameters::*field;
+};
+
+struct IntParameter {
+	const char *name;
+	int32_t parameters::*field;
+};
+
+struct VectorParameter {
+	const char *name;
+	Vector3f parameters::*field;
+	int index;
+};
+
+static const FloatParameter float_parameters[] = {
+	{"EKF2_MAG_DELAY", &parameters::mag_delay_ms},
+	{"EKF2_BARO_DELAY", &parameters::baro_delay_ms},
+	{"EKF2_GPS_DELAY", &parameters::gps_delay_ms},
+	{"EKF2_OF_DELAY", &parameters::flow_delay_ms},
+	{"EKF2_RNG_DELAY", &parameters::range_delay_ms},
+	{"EKF2_ASP_DELAY", &parameters::airspeed_delay_ms},
+	{"EKF2_EV_DELAY", &parameters::ev_delay_ms},
+	{"EKF2_AVEL_DELAY", &parameters::auxvel_delay_ms},
+	{"EKF2_GYR_NOISE", &parameters::gyro_noise},
+	{"EKF2_ACC_NOISE", &parameters::accel_noise},
+	{"EKF2_GYR_B_NOISE", &parameters::gyro_bias_p_noise},
+	{"EKF2_ACC_B_NOISE", &parameters::accel_bias_p_noise},
+	{"EKF2_MAG_E_NOISE", &parameters::mage_p_noise},
+	{"EKF2_MAG_B_NOISE", &parameters::magb_p_noise},
+	{"EKF2_WIND_NOISE", &parameters::wind_vel_p_noise},
+	{"EKF2_TERR_NOISE", &parameters::terrain_p_noise},
+	{"EKF2_TERR_GRAD", &parameters::terrain_gradient},
+	{"EKF2_GPS_V_NOISE", &parameters::gps_vel_noise},
+	{"EKF2_GPS_P_NOISE", &parameters::gps_pos_noise},
+	{"EKF2_NOAID_NOISE", &parameters::pos_noaid_noise},
+	{"EKF2_BARO_NOISE", &parameters::baro_noise},
+	{"EKF2_BARO_GATE", &parameters::baro_innov_gate},
+	{"EKF2_GPS_P_GATE", &parameters::posNE_innov_gate},
+	{"EKF2_GPS_V_GATE", &parameters::vel_innov_gate},
+	{"EKF2_TAS_GATE", &parameters::tas_innov_gate},
+	{"EKF2_HEAD_NOISE", &parameters::mag_heading_noise},
+	{"EKF2_MAG_NOISE", &parameters::mag_noise},
+	{"EKF2_EAS_NOISE", &parameters::eas_noise},
+	{"EKF2_BETA_GATE", &parameters::beta_innov_gate},
+	{"EKF2_BETA_NOISE", &parameters::beta_noise},
+	{"EKF2_MAG_DECL", &parameters::mag_declination_deg},
+	{"EKF2_HDG_GATE", &parameters::heading_innov_gate},
+	{"EKF2_MAG_GATE", &parameters::mag_innov_gate},
+	{"EKF2_MAG_ACCLIM", &parameters::mag_acc_gate},
+	{"EKF2_MAG_YAWLIM", &parameters::mag_yaw_rate_gate},
+	{"EKF2_REQ_EPH", &parameters::req_hacc},
+	{"EKF2_REQ_EPV", &parameters::req_vacc},
+	{"EKF2_REQ_SACC", &parameters::req_sacc},
+	{"EKF2_REQ_GDOP", &parameters::req_gdop},
+	{"EKF2_REQ_HDRIFT", &parameters::req_hdrift},
+	{"EKF2_REQ_VDRIFT", &parameters::req_vdrift},
+	{"EKF2_RNG_NOISE", &parameters::range_noise},
+	{"EKF2_RNG_SFE", &parameters::range_noise_scaler},
+	{"EKF2_RNG_GATE", &parameters::range_innov_gate},
+	{"EKF2_MIN_RNG", &parameters::rng_gnd_clearance},
+	{"EKF2_RNG_PITCH", &parameters::rng_sens_pitch},
+	{"EKF2_RNG_A_VMAX", &parameters::max_vel_for_range_aid},
+	{"EKF2_RNG_A_HMAX", &parameters::max_hagl_for_range_aid},
+	{"EKF2_RNG_A_IGATE", &parameters::range_aid_innov_gate},
+	{"EKF2_EV_GATE", &parameters::ev_innov_gate},
+	{"EKF2_OF_N_MIN", &parameters::flow_noise},
+	{"EKF2_OF_N_MAX", &parameters::flow_noise_qual_min},
+	{"EKF2_OF_GATE", &parameters::flow_innov_gate},
+	{"EKF2_TAU_VEL", &parameters::vel_Tau},
+	{"EKF2_TAU_POS", &parameters::pos_Tau},
+	{"EKF2_GBIAS_INIT", &parameters::switch_on_gyro_bias},
+	{"EKF2_ABIAS_INIT", &parameters::switch_on_accel_bias},
+	{"EKF2_ANGERR_INIT", &parameters::initial_tilt_err},
+	{"EKF2_ABL_LIM", &parameters::acc_bias_lim},
+	{"EKF2_ABL_ACCLIM", &parameters::acc_bias_learn_acc_lim},
+	{"EKF2_ABL_GYRLIM", &parameters::acc_bias_learn_gyr_lim},
+	{"EKF2_ABL_TAU", &parameters::acc_bias_learn_tc},
+	{"EKF2_DRAG_NOISE", &parameters::drag_noise},
+	{"EKF2_BCOEF_X", &parameters::bcoef_x},
+	{"EKF2_BCOEF_Y", &parameters::bcoef_y},
+	{"EKF2_MOVE_TEST", &parameters::is_moving_scaler},
+};
+
+static const IntParameter int_parameters[] = {
+	{"EKF2_MIN_OBS_DT", &parameters::sensor_interval_min_ms},
+	{"EKF2_DECL_TYPE", &parameters::mag_declination_source},
+	{"EKF2_MAG_TYPE", &parameters::mag_fusion_type},
+	{"EKF2_GPS_CHECK", &parameters::gps_check_mask},
+	{"EKF2_REQ_NSATS", &parameters::req_nsats},
+	{"EKF2_AID_MASK", &parameters::fusion_mode},
+	{"EKF2_HGT_MODE", &parameters::vdist_sensor_type},
+	{"EKF2_NOAID_TOUT", &parameters::valid_timeout_max},
+	{"EKF2_RNG_AID", &parameters::range_aid},
+	{"EKF2_OF_QMIN", &parameters::flow_qual_min},
+};
+
+static const VectorParameter vector_parameters[] = {
+	{"EKF2_IMU_POS_X", &parameters::imu_pos_body, 0},
+	{"EKF2_IMU_POS_Y", &parameters::imu_pos_body, 1},
+	{"EKF2_IMU_POS_Z", &parameters::imu_pos_body, 2},
+	{"EKF2_GPS_POS_X", &parameters::gps_pos_body, 0},
+	{"EKF2_GPS_POS_Y", &parameters::gps_pos_body, 1},
+	{"EKF2_GPS_POS_Z", &parameters::gps_pos_body, 2},
+	{"EKF2_RNG_POS_X", &parameters::rng_pos_body, 0},
+	{"EKF2_RNG_POS_Y", &parameters::rng_pos_body, 1},
+	{"EKF2_RNG_POS_Z", &parameters::rng_pos_body, 2},
+	{"EKF2_OF_POS_X", &parameters::flow_pos_body, 0},
+	{"EKF2_OF_POS_Y", &parameters::flow_pos_body, 1},
+	{"EKF2_OF_POS_Z", &parameters::flow_pos_body, 2},
+	{"EKF2_EV_POS_X", &parameters::ev_pos_body, 0},
+	{"EKF2_EV_POS_Y", &parameters::ev_pos_body, 1},
+	{"EKF2_EV_POS_Z", &parameters::ev_pos_body, 2},
+};
+
+// Parameters of the ekf2 module which are applied to the sensor data
+struct ModuleFloatParameter {
+	const char *name;
+	float ModuleParameters::*field;
+};
+
+static const ModuleFloatParameter module_float_parameters[] = {
+	{"EKF2_ARSP_THR", &ModuleParameters::airspeed_threshold},
+	{"EKF2_ASPD_MAX", &ModuleParameters::aspd_max},
+	{"EKF2_PCOEF_XP", &ModuleParameters::pcoef_xp},
+	{"EKF2_PCOEF_XN", &ModuleParameters::pcoef_xn},
+	{"EKF2_PCOEF_Y", &ModuleParameters::pcoef_y},
+	{"EKF2_PCOEF_Z", &ModuleParameters::pcoef_z},
+};
+
+static bool set_parameter(parameters &params, ModuleParameters &module_params, const std::string &name,
+			  float value)
+{
+	for (const FloatParameter &p : float_parameters) {
+		if (name == p.name) {
+			params.*p.field = value;
+			return true;
+		}
+	}
+
+	for (const IntParameter &p : int_parameters) {
+		if (name == p.name) {
+			params.*p.field = (int32_t)value;
+			return true;
+		}
+	}
+
+	for (const VectorParameter &p : vector_parameters) {
+		if (name == p.name) {
+			(params.*p.field)(p.index) = value;
+			return true;
+		}
+	}
+
+	if (name == "EKF2_FUSE_BETA") {
+		module_params.fuse_beta = (int32_t)value;
+		return true;
+	}
+
+	const char *mag_bias_names[] = {"EKF2_MAGBIAS_X", "EKF2_MAGBIAS_Y", "EKF2_MAGBIAS_Z"};
+
+	for (int i = 0; i < 3; i++) {
+		if (name == mag_bias_names[i]) {
+			module_params.mag_bias[i] = value;
+			return true;
+		}
+	}
+
+	for (const ModuleFloatParameter &p : module_float_parameters) {
+		if (name == p.name) {
+			module_params.*p.field = value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+float static_pressure_correction(const ModuleParameters &params, const Vector3f &vel_body_wind, float rho)
+{
+	// model position error sensitivity as a body fixed ellipse with different scale in the positive and
+	// negative X direction, the same expression as in the ekf2 module
+	const float max_airspeed_sq = params.aspd_max * params.aspd_max;
+	const float K_pstatic_coef_x = (vel_body_wind(0) >= 0.0f) ? params.pcoef_xp : params.pcoef_xn;
+
+	const float x_v2 = fminf(vel_body_wind(0) * vel_body_wind(0), max_airspeed_sq);
+	const float y_v2 = fminf(vel_body_wind(1) * vel_body_wind(1), max_airspeed_sq);
+	const float z_v2 = fminf(vel_body_wind(2) * vel_body_wind(2), max_airspeed_sq);
+
+	const float pstatic_err = 0.5f * rho *
+				  (K_pstatic_coef_x * x_v2) + (params.pcoef_y * y_v2) + (params.pcoef_z * z_v2);
+
+	// pressure error estimate to height, assuming sea level gravity
+	return pstatic_err / (rho * CONSTANTS_ONE_G);
+}
+
+static bool is_overridden(const ParameterSet &overrides, const std::string &name)
+{
+	for (const auto &value : overrides.values) {
+		if (value.first == name) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Collects the sensor topics of a log into LogData.
+ */
+class LogHandler : public ULogReader::Handler
+{
+public:
+	LogHandler(ULogReader &reader, LogData &log) : _reader(reader), _log(log) {}
+
+	void subscription(uint16_t msg_id, const std::string &topic, uint8_t multi_id) override
+	{
+		// only the first instance of each topic is used, as in the ekf2 module without GPS blending
+		if (multi_id != 0) {
+			return;
+		}
+
+		Topic t;
+		t.timestamp = _reader.field(topic, "timestamp");
+
+		if (topic == "sensor_combined") {
+			t.type = TopicType::SensorCombined;
+			t.fields[0] = _reader.field(topic, "gyro_integral_dt");
+			t.fields[1] = _reader.field(topic, "accelerometer_integral_dt");
+			add_vector(t, 2, topic, "gyro_rad");
+			add_vector(t, 5, topic, "accelerometer_m_s2");
+
+		} else if (topic == "vehicle_magnetometer") {
+			t.type = TopicType::Magnetometer;
+			add_vector(t, 0, topic, "magnetometer_ga");
+
+		} else if (topic == "vehicle_air_data") {
+			t.type = TopicType::AirData;
+			t.fields[0] = _reader.field(topic, "baro_alt_meter");
+			t.fields[1] = _reader.field(topic, "rho");
+
+		} else if (topic == "vehicle_gps_position") {
+			t.type = TopicType::Gps;
+			const char *names[] = {
+				"lat", "lon", "alt", "heading", "heading_offset", "fix_type", "eph", "epv", "s_variance_m_s",
+				"vel_m_s", "vel_n_m_s", "vel_e_m_s", "vel_d_m_s", "vel_ned_valid", "satellites_used"
+			};
+
+			for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+				t.fields[i] = _reader.field(topic, names[i]);
+			}
+
+		} else if (topic == "airspeed") {
+			t.type = TopicType::Airspeed;
+			t.fields[0] = _reader.field(topic, "true_airspeed_m_s");
+			t.fields[1] = _reader.field(topic, "indicated_airspeed_m_s");
+
+		} else if (topic == "vehicle_land_detected") {
+			t.type = TopicType::LandDetected;
+			t.fields[0] = _reader.field(topic, "landed");
+
+		} else if (topic == "vehicle_status") {
+			t.type = TopicType::Status;
+			t.fields[0] = _reader.field(topic, "is_rotary_wing");
+
+		} else {
+			return;
+		}
+
+		if (t.timestamp.valid()) {
+			_topics[msg_id] = t;
+		}
+	}
+
+	void data(uint16_t msg_id, const uint8_t *data, uint16_t size) override
+	{
+		auto it = _topics.find(msg_id);
+
+		if (it == _topics.end()) {
+			return;
+		}
+
+		const Topic &t = it->second;
+		const uint64_t timestamp = ULogReader::read<uint64_t>(data, size, t.timestamp);
+
+		if (timestamp == 0) {
+			return;
+		}
+
+		_last_time_us = timestamp;
+
+		switch (t.type) {
+		case TopicType::SensorCombined: {
+				ImuData imu;
+				imu.time_us = timestamp;
+				imu.gyro_dt_us = ULogReader::read<uint32_t>(data, size, t.fields[0]);
+				imu.accel_dt_us = ULogReader::read<uint32_t>(data, size, t.fields[1]);
+
+				for (int i = 0; i < 3; i++) {
+					imu.gyro_rad[i] = ULogReader::read<float>(data, size, t.fields[2 + i], NAN);
+					imu.accel_m_s2[i] = ULogReader::read<float>(data, size, t.fields[5 + i], NAN);
+				}
+
+				if (imu.gyro_dt_us > 0 && imu.accel_dt_us > 0) {
+					_log.imu.push_back(imu);
+				}
+
+				break;
+			}
+
+		case TopicType::Magnetometer: {
+				MagData mag;
+				mag.time_us = timestamp;
+
+				for (int i = 0; i < 3; i++) {
+					mag.mag_ga[i] = ULogReader::read<float>(data, size, t.fields[i], NAN);
+				}
+
+				_log.mag.push_back(mag);
+				break;
+			}
+
+		case TopicType::AirData: {
+				BaroData baro;
+				baro.time_us = timestamp;
+				baro.alt_m = ULogReader::read<float>(data, size, t.fields[0], NAN);
+				baro.rho = ULogReader::read<float>(data, size, t.fields[1], CONSTANTS_AIR_DENSITY_SEA_LEVEL_15C);
+				_log.baro.push_back(baro);
+				break;
+			}
+
+		case TopicType::Gps: {
+				gps_message gps{};
+				gps.time_usec = timestamp;
+				gps.lat = ULogReader::read<int32_t>(data, size, t.fields[0]);
+				gps.lon = ULogReader::read<int32_t>(data, size, t.fields[1]);
+				gps.alt = ULogReader::read<int32_t>(data, size, t.fields[2]);
+				gps.yaw = ULogReader::read<float>(data, size, t.fields[3], NAN);
+				gps.yaw_offset = ULogReader::read<float>(data, size, t.fields[4], NAN);
+				gps.fix_type = ULogReader::read<uint8_t>(data, size, t.fields[5]);
+				gps.eph = ULogReader::read<float>(data, size, t.fields[6]);
+				gps.epv = ULogReader::read<float>(data, size, t.fields[7]);
+				gps.sacc = ULogReader::read<float>(data, size, t.fields[8]);
+				gps.vel_m_s = ULogReader::read<float>(data, size, t.fields[9]);
+				gps.vel_ned[0] = ULogReader::read<float>(data, size, t.fields[10]);
+				gps.vel_ned[1] = ULogReader::read<float>(data, size, t.fields[11]);
+				gps.vel_ned[2] = ULogReader::read<float>(data, size, t.fields[12]);
+				gps.vel_ned_valid = ULogReader::read<uint8_t>(data, size, t.fields[13]) != 0;
+				gps.nsats = ULogReader::read<uint8_t>(data, size, t.fields[14]);
+				gps.gdop = 0.0f;
+				_log.gps.push_back(gps);
+				break;
+			}
+
+		case TopicType::Airspeed: {
+				AirspeedData airspeed;
+				airspeed.time_us = timestamp;
+				airspeed.true_airspeed_m_s = ULogReader::read<float>(data, size, t.fields[0]);
+				airspeed.indicated_airspeed_m_s = ULogReader::read<float>(data, size, t.fields[1]);
+				_log.airspeed.push_back(airspeed);
+				break;
+			}
+
+		case TopicType::LandDetected:
+			_log.landed.push_back({timestamp, ULogReader::read<uint8_t>(data, size, t.fields[0], 1) != 0});
+			break;
+
+		case TopicType::Status:
+			_log.rotary_wing.push_back({timestamp, ULogReader::read<uint8_t>(data, size, t.fields[0], 1) != 0});
+			break;
+		}
+	}
+
+	void parameter(const std::string &name, float value, bool is_int) override
+	{
+		parameters params;
+		ModuleParameters module_params;
+
+		// only keep the parameters used by the replay
+		if (set_parameter(params, module_params, name, value)) {
+			_log.parameters.push_back({_last_time_us, name, value});
+		}
+	}
+
+private:
+	enum class TopicType {
+		SensorCombined,
+		Magnetometer,
+		AirData,
+		Gps,
+		Airspeed,
+		LandDetected,
+		Status
+	};
+
+	struct Topic {
+		TopicType type{TopicType::SensorCombined};
+		ULogReader::Field timestamp;
+		ULogReader::Field fields[16];
+	};
+
+	void add_vector(Topic &t, int index, const std::string &topic, const char *name)
+	{
+		for (int i = 0; i < 3; i++) {
+			t.fields[index + i] = _reader.field(topic, std::string(name) + "[" + std::to_string(i) + "]");
+		}
+	}
+
+	ULogReader &_reader;
+	LogData &_log;
+	std::map<uint16_t, Topic> _topics;
+	uint64_t _last_time_us{0};
+};
+
+bool LogData::load(const char *log_path)
+{
+	path = log_path;
+
+	ULogReader reader;
+
+	if (!reader.load(log_path)) {
+		fprintf(stderr, "%s: not a ULog file\n", log_path);
+		return false;
+	}
+
+	LogHandler handler(reader, *this);
+
+	if (!reader.parse(handler)) {
+		fprintf(stderr, "%s: log is truncated, replaying %zu IMU samples\n", log_path, imu.size());
+	}
+
+	if (imu.empty()) {
+		fprintf(stderr, "%s: no sensor_combined data\n", log_path);
+		return false;
+	}
+
+	return true;
+}
+
+bool ParameterSet::load(const char *path, std::vector<ParameterSet> &sets)
+{
+	FILE *f = fopen(path, "r");
+
+	if (f == nullptr) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+
+	char line[256];
+	int line_number = 0;
+	bool ret = true;
+
+	while (fgets(line, sizeof(line), f) != nullptr) {
+		line_number++;
+
+		char name[128];
+		float value;
+
+		if (sscanf(line, " [%127[^]]]", name) == 1) {
+			sets.push_back(ParameterSet{name, {}});
+
+		} else if (sscanf(line, " %127s %f", name, &value) == 2 && name[0] != '#') {
+			parameters params;
+			ModuleParameters module_params;
+
+			if (sets.empty() || !set_parameter(params, module_params, name, value)) {
+				fprintf(stderr, "%s:%i: unknown parameter or missing [set] line\n", path, line_number);
+				ret = false;
+				break;
+			}
+
+			sets.back().values.emplace_back(name, value);
+		}
+	}
+
+	fclose(f);
+	return ret;
+}
+
+SensorFeed::SensorFeed(const LogData &log, Ekf &ekf, const ParameterSet &overrides) :
+	_log(log),
+	_ekf(ekf),
+	_overrides(overrides)
+{
+	// logged values first, replaced by the overrides
+	while (_param_index < _log.parameters.size() && _log.parameters[_param_index].time_us == 0) {
+		const ParameterData &p = _log.parameters[_param_index++];
+		set_parameter(*_ekf.getParamHandle(), _module_params, p.name, p.value);
+	}
+
+	for (const auto &value : _overrides.values) {
+		set_parameter(*_ekf.getParamHandle(), _module_params, value.first, value.second);
+	}
+}
+
+bool SensorFeed::push_next()
+{
+	if (_imu_index >= _log.imu.size()) {
+		return false;
+	}
+
+	const ImuData &imu = _log.imu[_imu_index++];
+	const uint64_t now = imu.time_us;
+	_time_us = now;
+
+	// parameter changes in flight, unless overridden
+	while (_param_index < _log.parameters.size() && _log.parameters[_param_index].time_us <= now) {
+		const ParameterData &p = _log.parameters[_param_index++];
+
+		if (!is_overridden(_overrides, p.name)) {
+			set_parameter(*_ekf.getParamHandle(), _module_params, p.name, p.value);
+		}
+	}
+
+	while (_rotary_wing_index < _log.rotary_wing.size() && _log.rotary_wing[_rotary_wing_index].time_us <= now) {
+		const bool is_rotary_wing = _log.rotary_wing[_rotary_wing_index++].value;
+		_ekf.set_fuse_beta_flag(!is_rotary_wing && (_module_params.fuse_beta == 1));
+		_ekf.set_is_fixed_wing(!is_rotary_wing);
+	}
+
+	while (_landed_index < _log.landed.size() && _log.landed[_landed_index].time_us <= now) {
+		_ekf.set_in_air_status(!_log.landed[_landed_index++].value);
+	}
+
+	float delta_ang[3];
+	float delta_vel[3];
+
+	for (int i = 0; i < 3; i++) {
+		delta_ang[i] = imu.gyro_rad[i] * imu.gyro_dt_us * 1e-6f;
+		delta_vel[i] = imu.accel_m_s2[i] * imu.accel_dt_us * 1e-6f;
+	}
+
+	_ekf.setIMUData(now, imu.gyro_dt_us, imu.accel_dt_us, delta_ang, delta_vel);
+
+	while (_mag_index < _log.mag.size() && _log.mag[_mag_index].time_us <= now) {
+		push_mag(_log.mag[_mag_index++]);
+	}
+
+	while (_baro_index < _log.baro.size() && _log.baro[_baro_index].time_us <= now) {
+		push_baro(_log.baro[_baro_index++]);
+	}
+
+	while (_gps_index < _log.gps.size() && _log.gps[_gps_index].time_usec <= now) {
+		gps_message gps = _log.gps[_gps_index++];
+		_ekf.setGpsData(gps.time_usec, &gps);
+	}
+
+	while (_airspeed_index < _log.airspeed.size() && _log.airspeed[_airspeed_index].time_us <= now) {
+		const AirspeedData &airspeed = _log.airspeed[_airspeed_index++];
+
+		if ((_module_params.airspeed_threshold > FLT_EPSILON)
+		    && (airspeed.true_airspeed_m_s > _module_params.airspeed_threshold)) {
+
+			const float eas2tas = airspeed.true_airspeed_m_s / airspeed.indicated_airspeed_m_s;
+			_ekf.setAirspeedData(airspeed.time_us, airspeed.true_airspeed_m_s, eas2tas);
+		}
+	}
+
+	return true;
+}
+
+void SensorFeed::push_mag(const MagData &mag)
+{
+	_mag_time_sum_ms += mag.time_us / 1000;
+	_mag_sample_count++;
+
+	for (int i = 0; i < 3; i++) {
+		_mag_data_sum[i] += mag.mag_ga[i];
+	}
+
+	const int32_t mag_time_ms = _mag_time_sum_ms / _mag_sample_count;
+
+	if ((mag_time_ms - _mag_time_ms_last_used) > _ekf.getParamHandle()->sensor_interval_min_ms) {
+		float mag_data_avg_ga[3];
+
+		for (int i = 0; i < 3; i++) {
+			// correct for learned bias offsets
+			mag_data_avg_ga[i] = _mag_data_sum[i] / _mag_sample_count - _module_params.mag_bias[i];
+			_mag_data_sum[i] = 0.0f;
+		}
+
+		_ekf.setMagData(1000 * (uint64_t)mag_time_ms, mag_data_avg_ga);
+
+		_mag_time_ms_last_used = mag_time_ms;
+		_mag_time_sum_ms = 0;
+		_mag_sample_count = 0;
+	}
+}
+
+void SensorFeed::push_baro(const BaroData &baro)
+{
+	_baro_time_sum_ms += baro.time_us / 1000;
+	_baro_sample_count++;
+	_baro_data_sum += baro.alt_m;
+	const uint32_t baro_time_ms = _baro_time_sum_ms / _baro_sample_count;
+
+	if (baro_time_ms - _baro_time_ms_last_used > (uint32_t)_ekf.getParamHandle()->sensor_interval_min_ms) {
+		// wind compensated velocity in the body frame from the current estimate
+		Quatf q;
+		_ekf.copy_quaternion(q.data());
+		float vel[3];
+		_ekf.get_velocity(vel);
+		float wind[2];
+		_ekf.get_wind_velocity(wind);
+		const Vector3f vel_body_wind = Dcmf(q.inversed()) * Vector3f(vel[0] - wind[0], vel[1] - wind[1], vel[2]);
+
+		const float baro_alt_avg = _baro_data_sum / _baro_sample_count
+					   + static_pressure_correction(_module_params, vel_body_wind, baro.rho);
+
+		_ekf.set_air_density(baro.rho);
+		_ekf.setBaroData(1000 * (uint64_t)baro_time_ms, baro_alt_avg);
+
+		_baro_time_ms_last_used = baro_time_ms;
+		_baro_time_sum_ms = 0;
+		_baro_sample_count = 0;
+		_baro_data_sum = 0.0f;
+	}
+}
+
+void run(const LogData &log, const ParameterSet &overrides, Summary &summary, FILE *series,
+	 uint64_t series_interval_us)
+{
+	const auto runtime_start = std::chrono::steady_clock::now();
+
+	Ekf ekf;
+	SensorFeed feed(log, ekf, overrides);
+
+	summary = Summary{};
+
+	const uint64_t time_start_us = log.imu.front().time_us;
+	uint64_t time_last_us = time_start_us;
+	uint64_t time_last_series_us = 0;
+	float test_ratio_sum[5] {};
+
+	while (feed.push_next()) {
+		const uint64_t now = feed.time_us();
+
+		summary.imu_samples++;
+
+		const float elapsed_s = (now - time_start_us) * 1e-6f;
+
+		if (ekf.inertial_dead_reckoning()) {
+			summary.dead_reckoning_s += (now - time_last_us) * 1e-6f;
+		}
+
+		time_last_us = now;
+
+		if (!ekf.update()) {
+			continue;
+		}
+
+		summary.updates++;
+
+		if (summary.time_tilt_align_s < 0.0f && ekf.attitude_valid()) {
+			summary.time_tilt_align_s = elapsed_s;
+		}
+
+		if (summary.time_gpos_valid_s < 0.0f && ekf.global_position_is_valid()) {
+			summary.time_gpos_valid_s = elapsed_s;
+		}
+
+		uint16_t innovation_status;
+		float ratio[5];
+		float hagl_ratio;
+		float beta_ratio;
+		ekf.get_innovation_test_status(&innovation_status, &ratio[0], &ratio[1], &ratio[2], &ratio[3], &ratio[4],
+					       &hagl_ratio, &beta_ratio);
+
+		for (int i = 0; i < 5; i++) {
+			if (std::isfinite(ratio[i])) {
+				test_ratio_sum[i] += ratio[i];
+				summary.test_ratio_max[i] = fmaxf(summary.test_ratio_max[i], ratio[i]);
+			}
+		}
+
+		innovation_fault_status_u rejected;
+		rejected.value = innovation_status;
+		summary.innovation_rejected[0] += (rejected.flags.reject_mag_x || rejected.flags.reject_mag_y
+						   || rejected.flags.reject_mag_z || rejected.flags.reject_yaw);
+		summary.innovation_rejected[1] += rejected.flags.reject_vel_NED;
+		summary.innovation_rejected[2] += rejected.flags.reject_pos_NE;
+		summary.innovation_rejected[3] += rejected.flags.reject_pos_D;
+		summary.innovation_rejected[4] += rejected.flags.reject_airspeed;
+
+		uint16_t fault_status;
+		ekf.get_filter_fault_status(&fault_status);
+		summary.fault_status |= fault_status;
+
+		if (series != nullptr && now - time_last_series_us >= series_interval_us) {
+			time_last_series_us = now;
+
+			float q[4];
+			float vel[3];
+			float pos[3];
+			float vel_pos_innov[6];
+			uint32_t control_mode;
+			ekf.copy_quaternion(q);
+			ekf.get_velocity(vel);
+			ekf.get_position(pos);
+			ekf.get_vel_pos_innov(vel_pos_innov);
+			ekf.get_control_mode(&control_mode);
+
+			fprintf(series, "%.4f,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+				"%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%u\n",
+				(double)elapsed_s, (double)q[0], (double)q[1], (double)q[2], (double)q[3],
+				(double)vel[0], (double)vel[1], (double)vel[2], (double)pos[0], (double)pos[1], (double)pos[2],
+				(double)vel_pos_innov[0], (double)vel_pos_innov[1], (double)vel_pos_innov[2],
+				(double)vel_pos_innov[3], (double)vel_pos_innov[4], (double)vel_pos_innov[5],
+				(double)ratio[0], (double)ratio[1], (double)ratio[2], (double)ratio[3], (double)ratio[4],
+				(unsigned)control_mode, (unsigned)fault_status);
+		}
+	}
+
+	for (int i = 0; i < 5; i++) {
+		summary.test_ratio_mean[i] = (summary.updates > 0) ? test_ratio_sum[i] / summary.updates : 0.0f;
+	}
+
+	Vector3f pos_var;
+	Vector3f vel_var;
+	ekf.get_pos_var(pos_var);
+	ekf.get_vel_var(vel_var);
+	summary.pos_var_max = fmaxf(fmaxf(pos_var(0), pos_var(1)), pos_var(2));
+	summary.vel_var_max = fmaxf(fmaxf(vel_var(0), vel_var(1)), vel_var(2));
+	ekf.get_position(summary.pos_final);
+	ekf.get_gyro_bias(summary.gyro_bias);
+	ekf.get_accel_bias(summary.accel_bias);
+
+	summary.log_duration_s = (log.imu.back().time_us - time_start_us) * 1e-6;
+	summary.runtime_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - runtime_start).count();
+}
+
+void print_series_header(FILE *out)
+{
+	fprintf(out, "time,q0,q1,q2,q3,vn,ve,vd,pn,pe,pd,innov_vn,innov_ve,innov_vd,innov_pn,innov_pe,innov_pd,"
+		"ratio_mag,ratio_vel,ratio_pos,ratio_hgt,ratio_tas,control_mode,fault_status\n");
+}
+
+void print_summary_header(FILE *out)
+{
+	fprintf(out, "log,set,duration_s,runtime_s,imu_samples,updates,tilt_align_s,gpos_valid_s,dead_reckoning_s,"
+		"ratio_mean_mag,ratio_mean_vel,ratio_mean_pos,ratio_mean_hgt,ratio_mean_tas,"
+		"ratio_max_mag,ratio_max_vel,ratio_max_pos,ratio_max_hgt,ratio_max_tas,"
+		"rejected_mag,rejected_vel,rejected_pos,rejected_hgt,rejected_tas,fault_status,"
+		"pos_var_max,vel_var_max,pn,pe,pd,gyro_bias_x,gyro_bias_y,gyro_bias_z,"
+		"accel_bias_x,accel_bias_y,accel_bias_z\n");
+}
+
+void print_summary(FILE *out, const std::string &log_name, const std::string &set_name, const Summary &s)
+{
+	fprintf(out, "%s,%s,%.1f,%.3f,%u,%u,%.2f,%.2f,%.1f,", log_name.c_str(), set_name.c_str(), s.log_duration_s,
+		s.runtime_s, s.imu_samples, s.updates, (double)s.time_tilt_align_s, (double)s.time_gpos_valid_s,
+		(double)s.dead_reckoning_s);
+
+	for (int i = 0; i < 5; i++) {
+		fprintf(out, "%.3f,", (double)s.test_ratio_mean[i]);
+	}
+
+	for (int i = 0; i < 5; i++) {
+		fprintf(out, "%.3f,", (double)s.test_ratio_max[i]);
+	}
+
+	for (int i = 0; i < 5; i++) {
+		fprintf(out, "%u,", s.innovation_rejected[i]);
+	}
+
+	fprintf(out, "%u,%.4f,%.4f,%.2f,%.2f,%.2f,%.5f,%.5f,%.5f,%.4f,%.4f,%.4f\n", (unsigned)s.fault_status,
+		(double)s.pos_var_max, (double)s.vel_var_max, (double)s.pos_final[0], (double)s.pos_final[1],
+		(double)s.pos_final[2], (double)s.gyro_bias[0], (double)s.gyro_bias[1], (double)s.gyro_bias[2],
+		(double)s.accel_bias[0], (double)s.accel_bias[1], (double)s.accel_bias[2]);
+}
+
+} // namespace ekf_replay
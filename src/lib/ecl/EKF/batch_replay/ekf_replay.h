@@ -0,0 +1,242 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ekf_replay.h
+ *
+ * Offline replay of logged sensor data through the estimator, without uORB or the ekf2 module.
+ * The sensor data of a log is extracted once and can then be replayed with any number of
+ * parameter sets, each replay using its own estimator instance.
+ */
+
+#pragma once
+
+#include <EKF/ekf.h>
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ekf_replay
+{
+
+struct ImuData {
+	uint64_t time_us;
+	uint32_t gyro_dt_us;
+	uint32_t accel_dt_us;
+	float gyro_rad[3];
+	float accel_m_s2[3];
+};
+
+struct MagData {
+	uint64_t time_us;
+	float mag_ga[3];
+};
+
+struct BaroData {
+	uint64_t time_us;
+	float alt_m;
+	float rho;
+};
+
+struct AirspeedData {
+	uint64_t time_us;
+	float true_airspeed_m_s;
+	float indicated_airspeed_m_s;
+};
+
+struct FlagData {
+	uint64_t time_us;
+	bool value;
+};
+
+struct ParameterData {
+	uint64_t time_us;	///< time of the last sample before the parameter was logged, 0 for initial values
+	std::string name;
+	float value;
+};
+
+/**
+ * Sensor data of one log, in the form consumed by the estimator.
+ */
+struct LogData {
+	std::string path;
+
+	std::vector<ImuData> imu;
+	std::vector<MagData> mag;
+	std::vector<BaroData> baro;
+	std::vector<gps_message> gps;
+	std::vector<AirspeedData> airspeed;
+	std::vector<FlagData> landed;
+	std::vector<FlagData> rotary_wing;
+	std::vector<ParameterData> parameters;
+
+	/**
+	 * Read the sensor topics of a ULog file.
+	 * @return false if the file cannot be read or contains no IMU data
+	 */
+	bool load(const char *log_path);
+};
+
+/**
+ * Named set of parameter values replacing the values logged in flight.
+ */
+struct ParameterSet {
+	std::string name;
+	std::vector<std::pair<std::string, float>> values;
+
+	/**
+	 * Read parameter sets from a text file. A line "[name]" starts a set, followed by lines of
+	 * "PARAM_NAME value". Empty lines and lines starting with '#' are ignored.
+	 * @return false if the file cannot be read or contains unknown parameters
+	 */
+	static bool load(const char *path, std::vector<ParameterSet> &sets);
+};
+
+/**
+ * Parameters used by the ekf2 module to decide which data is passed to the estimator.
+ */
+struct ModuleParameters {
+	float airspeed_threshold{0.0f};	///< EKF2_ARSP_THR, minimum airspeed used by the estimator (m/sec)
+	int32_t fuse_beta{0};		///< EKF2_FUSE_BETA, enables synthetic sideslip fusion for fixed wing flight
+	float mag_bias[3] {};		///< EKF2_MAGBIAS_X/Y/Z, learned magnetometer bias subtracted from the data
+	float aspd_max{20.0f};		///< EKF2_ASPD_MAX, airspeed limit of the static pressure correction
+	float pcoef_xp{0.0f};		///< EKF2_PCOEF_XP, static pressure error coefficient, positive X axis
+	float pcoef_xn{0.0f};		///< EKF2_PCOEF_XN, static pressure error coefficient, negative X axis
+	float pcoef_y{0.0f};		///< EKF2_PCOEF_Y, static pressure error coefficient, Y axis
+	float pcoef_z{0.0f};		///< EKF2_PCOEF_Z, static pressure error coefficient, Z axis
+};
+
+/**
+ * Baro height correction for the static pressure position error, as applied by the ekf2 module.
+ * @param vel_body_wind wind compensated velocity of the vehicle in the body frame (m/sec)
+ * @param rho air density (kg/m**3)
+ * @return correction added to the baro height (m)
+ */
+float static_pressure_correction(const ModuleParameters &params, const Vector3f &vel_body_wind, float rho);
+
+/**
+ * Pushes the data of a log to an estimator in time order, the same way as the ekf2 module does.
+ */
+class SensorFeed
+{
+public:
+	SensorFeed(const LogData &log, Ekf &ekf, const ParameterSet &overrides);
+
+	/**
+	 * Push the next IMU sample, preceded by the parameter and vehicle status changes and followed
+	 * by the other sensor data up to the time of the IMU sample.
+	 * @return false when all IMU samples have been pushed
+	 */
+	bool push_next();
+
+	uint64_t time_us() const { return _time_us; }
+
+private:
+	void push_mag(const MagData &mag);
+	void push_baro(const BaroData &baro);
+
+	const LogData &_log;
+	Ekf &_ekf;
+	const ParameterSet &_overrides;
+	ModuleParameters _module_params;
+
+	size_t _imu_index{0};
+	size_t _param_index{0};
+	size_t _mag_index{0};
+	size_t _baro_index{0};
+	size_t _gps_index{0};
+	size_t _airspeed_index{0};
+	size_t _landed_index{0};
+	size_t _rotary_wing_index{0};
+	uint64_t _time_us{0};
+
+	// sensor averaging over EKF2_MIN_OBS_DT
+	uint64_t _mag_time_sum_ms{0};
+	uint32_t _mag_sample_count{0};
+	float _mag_data_sum[3] {};
+	int32_t _mag_time_ms_last_used{0};
+	uint64_t _baro_time_sum_ms{0};
+	uint32_t _baro_sample_count{0};
+	float _baro_data_sum{0.0f};
+	uint32_t _baro_time_ms_last_used{0};
+};
+
+/**
+ * Statistics of one replay.
+ */
+struct Summary {
+	double log_duration_s{0.0};		///< time span of the replayed IMU data
+	double runtime_s{0.0};			///< wall clock time taken by the replay
+	uint32_t imu_samples{0};
+	uint32_t updates{0};			///< filter updates at the fusion time horizon
+	float time_tilt_align_s{-1.0f};		///< time from start to tilt alignment, -1 if never aligned
+	float time_gpos_valid_s{-1.0f};		///< time from start to a valid global position, -1 if never valid
+	float dead_reckoning_s{0.0f};		///< total time spent dead reckoning
+
+	// innovation test ratios: 0 magnetometer, 1 velocity, 2 horizontal position, 3 height, 4 airspeed
+	float test_ratio_mean[5] {};
+	float test_ratio_max[5] {};
+	uint32_t innovation_rejected[5] {};	///< number of updates on which the measurement was rejected
+
+	uint16_t fault_status{0};		///< filter fault flags raised at any time during the replay
+	float pos_var_max{0.0f};		///< largest position variance at the end of the replay (m**2)
+	float vel_var_max{0.0f};		///< largest velocity variance at the end of the replay ((m/sec)**2)
+	float pos_final[3] {};			///< position at the end of the replay (m)
+	float gyro_bias[3] {};			///< gyro bias estimate at the end of the replay (rad/sec)
+	float accel_bias[3] {};			///< accelerometer bias estimate at the end of the replay (m/sec**2)
+};
+
+/**
+ * Replay a log through a new estimator instance.
+ * @param log sensor data to replay
+ * @param overrides parameter values used instead of the logged values
+ * @param summary returns the replay statistics
+ * @param series if not null, the estimator output is written as CSV at series_interval_us
+ */
+void run(const LogData &log, const ParameterSet &overrides, Summary &summary,
+	 FILE *series = nullptr, uint64_t series_interval_us = 100000);
+
+/**
+ * Write the CSV header of the estimator output written by run().
+ */
+void print_series_header(FILE *out);
+
+/**
+ * Write the CSV header and rows of the replay summary.
+ */
+void print_summary_header(FILE *out);
+void print_summary(FILE *out, const std::string &log_name, const std::string &set_name, const Summary &summary);
+
+} // namespace ekf_replay
@@ -0,0 +1,342 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ulog_reader.cpp
+ */
+
+#include "ulog_reader.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+
+static constexpr uint8_t ULOG_MAGIC[] = {'U', 'L', 'o', 'g', 0x01, 0x12, 0x35};
+static constexpr size_t ULOG_HEADER_SIZE = 16;
+static constexpr size_t ULOG_MSG_HEADER_LEN = 3;
+
+// nested format definitions deeper than this are treated as corrupt
+static constexpr int MAX_NESTING = 8;
+
+struct PrimitiveType {
+	const char *name;
+	int size;
+	char type;
+	bool is_signed;
+};
+
+static const PrimitiveType primitive_types[] = {
+	{"int8_t", 1, 'b', true},
+	{"uint8_t", 1, 'b', false},
+	{"bool", 1, 'b', false},
+	{"char", 1, 'b', true},
+	{"int16_t", 2, 'h', true},
+	{"uint16_t", 2, 'h', false},
+	{"int32_t", 4, 'i', true},
+	{"uint32_t", 4, 'i', false},
+	{"float", 4, 'f', true},
+	{"int64_t", 8, 'q', true},
+	{"uint64_t", 8, 'q', false},
+	{"double", 8, 'd', true},
+};
+
+const PrimitiveType *find_primitive(const std::string &type)
+{
+	for (const PrimitiveType &p : primitive_types) {
+		if (type == p.name) {
+			return &p;
+		}
+	}
+
+	return nullptr;
+}
+
+} // namespace
+
+bool ULogReader::load(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+
+	if (f == nullptr) {
+		return false;
+	}
+
+	bool ret = false;
+
+	if (fseek(f, 0, SEEK_END) == 0) {
+		const long size = ftell(f);
+
+		if (size >= (long)ULOG_HEADER_SIZE && fseek(f, 0, SEEK_SET) == 0) {
+			_buffer.resize(size);
+			ret = fread(_buffer.data(), 1, size, f) == (size_t)size;
+		}
+	}
+
+	fclose(f);
+
+	if (!ret || memcmp(_buffer.data(), ULOG_MAGIC, sizeof(ULOG_MAGIC)) != 0) {
+		_buffer.clear();
+		return false;
+	}
+
+	memcpy(&_start_time, &_buffer[8], sizeof(_start_time));
+	return true;
+}
+
+bool ULogReader::parse(Handler &handler)
+{
+	size_t pos = ULOG_HEADER_SIZE;
+
+	while (pos + ULOG_MSG_HEADER_LEN <= _buffer.size()) {
+		uint16_t msg_size;
+		memcpy(&msg_size, &_buffer[pos], sizeof(msg_size));
+		const uint8_t msg_type = _buffer[pos + 2];
+		const uint8_t *msg = &_buffer[pos + ULOG_MSG_HEADER_LEN];
+
+		if (pos + ULOG_MSG_HEADER_LEN + msg_size > _buffer.size()) {
+			// truncated log, which is normal if logging stopped on power loss
+			return false;
+		}
+
+		pos += ULOG_MSG_HEADER_LEN + msg_size;
+
+		switch (msg_type) {
+		case 'F':
+			if (!parse_format((const char *)msg, msg_size)) {
+				return false;
+			}
+
+			break;
+
+		case 'A':
+			if (msg_size > 3) {
+				uint16_t msg_id;
+				memcpy(&msg_id, msg + 1, sizeof(msg_id));
+				handler.subscription(msg_id, std::string((const char *)msg + 3, msg_size - 3), msg[0]);
+			}
+
+			break;
+
+		case 'D':
+			if (msg_size > 2) {
+				uint16_t msg_id;
+				memcpy(&msg_id, msg, sizeof(msg_id));
+				handler.data(msg_id, msg + 2, msg_size - 2);
+			}
+
+			break;
+
+		case 'P':
+			if (!parse_parameter(msg, msg_size, handler)) {
+				return false;
+			}
+
+			break;
+
+		default:
+			// info, logging, sync, dropout and flag bits messages are not needed for replay
+			break;
+		}
+	}
+
+	return pos == _buffer.size();
+}
+
+bool ULogReader::parse_format(const char *format, uint16_t len)
+{
+	const std::string str(format, len);
+	const size_t colon = str.find(':');
+
+	if (colon == std::string::npos) {
+		return false;
+	}
+
+	std::vector<FormatField> &fields = _formats[str.substr(0, colon)];
+	fields.clear();
+
+	size_t start = colon + 1;
+
+	while (start < str.size()) {
+		size_t end = str.find(';', start);
+
+		if (end == std::string::npos) {
+			end = str.size();
+		}
+
+		const std::string field = str.substr(start, end - start);
+		start = end + 1;
+
+		const size_t space = field.find(' ');
+
+		if (space == std::string::npos) {
+			continue;
+		}
+
+		FormatField f;
+		f.type = field.substr(0, space);
+		f.name = field.substr(space + 1);
+		f.array_size = 0;
+
+		const size_t bracket = f.type.find('[');
+
+		if (bracket != std::string::npos) {
+			f.array_size = atoi(f.type.c_str() + bracket + 1);
+			f.type.erase(bracket);
+		}
+
+		fields.push_back(f);
+	}
+
+	return true;
+}
+
+bool ULogReader::parse_parameter(const uint8_t *msg, uint16_t len, Handler &handler)
+{
+	if (len < 1 || msg[0] + 1 > len) {
+		return false;
+	}
+
+	// key is "<type> <name>", followed by the value
+	const std::string key((const char *)msg + 1, msg[0]);
+	const uint8_t *value = msg + 1 + msg[0];
+	const int value_len = len - 1 - msg[0];
+	const size_t space = key.find(' ');
+
+	if (space == std::string::npos) {
+		return false;
+	}
+
+	const std::string type = key.substr(0, space);
+	const std::string name = key.substr(space + 1);
+
+	if (type == "int32_t" && value_len >= 4) {
+		handler.parameter(name, (float)get<int32_t>(value), true);
+
+	} else if (type == "float" && value_len >= 4) {
+		handler.parameter(name, get<float>(value), false);
+	}
+
+	return true;
+}
+
+int ULogReader::type_size(const std::string &type, int depth)
+{
+	const PrimitiveType *primitive = find_primitive(type);
+
+	if (primitive != nullptr) {
+		return primitive->size;
+	}
+
+	auto format = _formats.find(type);
+
+	if (format == _formats.end() || depth > MAX_NESTING) {
+		return -1;
+	}
+
+	int size = 0;
+
+	for (const FormatField &f : format->second) {
+		const int field_size = type_size(f.type, depth + 1);
+
+		if (field_size < 0) {
+			return -1;
+		}
+
+		size += field_size * (f.array_size > 0 ? f.array_size : 1);
+	}
+
+	return size;
+}
+
+ULogReader::Field ULogReader::field(const std::string &topic, const std::string &name)
+{
+	return find_field(topic, name, 0, 0);
+}
+
+ULogReader::Field ULogReader::find_field(const std::string &type, const std::string &name, int base, int depth)
+{
+	auto format = _formats.find(type);
+
+	if (format == _formats.end() || depth > MAX_NESTING) {
+		return Field{};
+	}
+
+	// split "name[index].child"
+	const size_t dot = name.find('.');
+	std::string head = name.substr(0, dot);
+	const std::string tail = (dot == std::string::npos) ? std::string() : name.substr(dot + 1);
+	int index = 0;
+
+	const size_t bracket = head.find('[');
+
+	if (bracket != std::string::npos) {
+		index = atoi(head.c_str() + bracket + 1);
+		head.erase(bracket);
+	}
+
+	int offset = base;
+
+	for (const FormatField &f : format->second) {
+		const int element_size = type_size(f.type, depth + 1);
+
+		if (element_size < 0) {
+			return Field{};
+		}
+
+		if (f.name == head) {
+			if (index < 0 || index >= (f.array_size > 0 ? f.array_size : 1)) {
+				return Field{};
+			}
+
+			offset += index * element_size;
+
+			const PrimitiveType *primitive = find_primitive(f.type);
+
+			if (primitive == nullptr) {
+				return tail.empty() ? Field{} : find_field(f.type, tail, offset, depth + 1);
+			}
+
+			Field result;
+			result.offset = offset;
+			result.type = primitive->type;
+			result.is_signed = primitive->is_signed;
+			return tail.empty() ? result : Field{};
+		}
+
+		offset += element_size * (f.array_size > 0 ? f.array_size : 1);
+	}
+
+	return Field{};
+}
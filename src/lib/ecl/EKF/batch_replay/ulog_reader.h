@@ -0,0 +1,166 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ulog_reader.h
+ *
+ * Minimal reader for the ULog file format, used to extract sensor topics for offline replay.
+ * The whole file is loaded into memory and parsed sequentially, field offsets of the logged
+ * topics are resolved by name from the format definitions.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+class ULogReader
+{
+public:
+	/**
+	 * Callbacks for the messages of a log, called in file order.
+	 */
+	class Handler
+	{
+	public:
+		virtual ~Handler() = default;
+
+		/**
+		 * A topic has been subscribed with the given message ID.
+		 * The format of the topic can be queried with ULogReader::field().
+		 */
+		virtual void subscription(uint16_t msg_id, const std::string &topic, uint8_t multi_id) {}
+
+		/**
+		 * A data message has been read. data points to the serialised topic, starting with the timestamp.
+		 */
+		virtual void data(uint16_t msg_id, const uint8_t *data, uint16_t size) {}
+
+		/**
+		 * A parameter value has been read, either from the definitions section or a change in flight.
+		 * Integer parameters are converted to float.
+		 */
+		virtual void parameter(const std::string &name, float value, bool is_int) {}
+	};
+
+	/**
+	 * Location of a field within a serialised topic.
+	 */
+	struct Field {
+		int offset{-1};		///< byte offset from the start of the topic, -1 if the field does not exist
+		char type{0};		///< 'f' float, 'd' double, 'b' 8 bit, 'h' 16 bit, 'i' 32 bit, 'q' 64 bit integer
+		bool is_signed{false};
+
+		bool valid() const { return offset >= 0; }
+	};
+
+	/**
+	 * Load a file into memory and check the header.
+	 * @return false if the file cannot be read or is not a ULog file
+	 */
+	bool load(const char *path);
+
+	/**
+	 * Parse all messages and pass them to handler.
+	 * @return false if the file is truncated or corrupt. Messages up to the error have been handled.
+	 */
+	bool parse(Handler &handler);
+
+	/**
+	 * Get the location of a field of a topic. Nested fields are addressed as "parent.child",
+	 * array elements as "name[index]".
+	 */
+	Field field(const std::string &topic, const std::string &name);
+
+	uint64_t start_time() const { return _start_time; }
+
+	/**
+	 * Read a numeric field of a serialised topic, converted to T. Returns fallback if the
+	 * field does not exist or is outside of the data.
+	 */
+	template<typename T>
+	static T read(const uint8_t *data, uint16_t size, const Field &f, T fallback = T())
+	{
+		if (!f.valid()) {
+			return fallback;
+		}
+
+		const uint8_t *p = data + f.offset;
+
+		switch (f.type) {
+		case 'f': return fits(f, size, 4) ? (T)get<float>(p) : fallback;
+
+		case 'd': return fits(f, size, 8) ? (T)get<double>(p) : fallback;
+
+		case 'b': return fits(f, size, 1) ? (f.is_signed ? (T)get<int8_t>(p) : (T)get<uint8_t>(p)) : fallback;
+
+		case 'h': return fits(f, size, 2) ? (f.is_signed ? (T)get<int16_t>(p) : (T)get<uint16_t>(p)) : fallback;
+
+		case 'i': return fits(f, size, 4) ? (f.is_signed ? (T)get<int32_t>(p) : (T)get<uint32_t>(p)) : fallback;
+
+		case 'q': return fits(f, size, 8) ? (f.is_signed ? (T)get<int64_t>(p) : (T)get<uint64_t>(p)) : fallback;
+
+		default: return fallback;
+		}
+	}
+
+private:
+	static bool fits(const Field &f, uint16_t size, int field_size) { return f.offset + field_size <= size; }
+
+	template<typename T>
+	static T get(const uint8_t *p)
+	{
+		T value;
+		memcpy(&value, p, sizeof(T));
+		return value;
+	}
+
+	struct FormatField {
+		std::string type;	///< type name without the array suffix
+		std::string name;
+		int array_size;		///< 0 if not an array
+	};
+
+	bool parse_format(const char *format, uint16_t len);
+	bool parse_parameter(const uint8_t *msg, uint16_t len, Handler &handler);
+	int type_size(const std::string &type, int depth = 0);
+	Field find_field(const std::string &type, const std::string &name, int base, int depth);
+
+	std::vector<uint8_t> _buffer;
+	uint64_t _start_time{0};
+
+	std::map<std::string, std::vector<FormatField>> _formats;
+};
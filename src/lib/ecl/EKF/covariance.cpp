@@ -128,28 +128,6 @@ void Ekf::get_vel_var(Vector3f &vel_var)
 
 void Ekf::predictCovariance()
 {
-	// assign intermediate state variables
-	float q0 = _state.quat_nominal(0);
-	float q1 = _state.quat_nominal(1);
-	float q2 = _state.quat_nominal(2);
-	float q3 = _state.quat_nominal(3);
-
-	float dax = _imu_sample_delayed.delta_ang(0);
-	float day = _imu_sample_delayed.delta_ang(1);
-	float daz = _imu_sample_delayed.delta_ang(2);
-
-	float dvx = _imu_sample_delayed.delta_vel(0);
-	float dvy = _imu_sample_delayed.delta_vel(1);
-	float dvz = _imu_sample_delayed.delta_vel(2);
-
-	float dax_b = _state.gyro_bias(0);
-	float day_b = _state.gyro_bias(1);
-	float daz_b = _state.gyro_bias(2);
-
-	float dvx_b = _state.accel_bias(0);
-	float dvy_b = _state.accel_bias(1);
-	float dvz_b = _state.accel_bias(2);
-
 	float dt = math::constrain(_imu_sample_delayed.delta_ang_dt, 0.5f * FILTER_UPDATE_PERIOD_S, 2.0f * FILTER_UPDATE_PERIOD_S);
 	float dt_inv = 1.0f / dt;
 
@@ -265,9 +243,50 @@ void Ekf::predictCovariance()
 	dvxVar = dvyVar = dvzVar = sq(dt * accel_noise);
 
 	// predict the covariance
+	float SF[21];
+	float SPP[11];
+	calculateCovariancePredictionTerms(SF, SPP);
+
+	const float d_ang_var[3] = {daxVar, dayVar, dazVar};
+	const float d_vel_var[3] = {dvxVar, dvyVar, dvzVar};
+
+#if defined(ECL_EKF_STRUCTURED_COVARIANCE_PREDICTION)
+	predictCovarianceStructured(SF, SPP, dt, d_ang_var, d_vel_var, process_noise);
+#else
+	predictCovarianceGenerated(SF, SPP, dt, d_ang_var, d_vel_var, process_noise);
+#endif
+
+	// fix gross errors in the covariance matrix and ensure rows and
+	// columns for un-used states are zero
+	fixCovarianceErrors();
+
+}
+
+void Ekf::calculateCovariancePredictionTerms(float (&SF)[21], float (&SPP)[11]) const
+{
+	// assign intermediate state variables
+	float q0 = _state.quat_nominal(0);
+	float q1 = _state.quat_nominal(1);
+	float q2 = _state.quat_nominal(2);
+	float q3 = _state.quat_nominal(3);
+
+	float dax = _imu_sample_delayed.delta_ang(0);
+	float day = _imu_sample_delayed.delta_ang(1);
+	float daz = _imu_sample_delayed.delta_ang(2);
+
+	float dvx = _imu_sample_delayed.delta_vel(0);
+	float dvy = _imu_sample_delayed.delta_vel(1);
+	float dvz = _imu_sample_delayed.delta_vel(2);
+
+	float dax_b = _state.gyro_bias(0);
+	float day_b = _state.gyro_bias(1);
+	float daz_b = _state.gyro_bias(2);
+
+	float dvx_b = _state.accel_bias(0);
+	float dvy_b = _state.accel_bias(1);
+	float dvz_b = _state.accel_bias(2);
 
 	// intermediate calculations
-	float SF[21];
 	SF[0] = dvz - dvz_b;
 	SF[1] = dvy - dvy_b;
 	SF[2] = dvx - dvx_b;
@@ -290,6 +309,35 @@ void Ekf::predictCovariance()
 	SF[19] = sq(q1);
 	SF[20] = sq(q0);
 
+	SPP[0] = SF[12] + SF[13] - 2*q2*SF[2];
+	SPP[1] = SF[17] - SF[18] - SF[19] + SF[20];
+	SPP[2] = SF[17] - SF[18] + SF[19] - SF[20];
+	SPP[3] = SF[17] + SF[18] - SF[19] - SF[20];
+	SPP[4] = 2*q0*q2 - 2*q1*q3;
+	SPP[5] = 2*q0*q1 - 2*q2*q3;
+	SPP[6] = 2*q0*q3 - 2*q1*q2;
+	SPP[7] = 2*q0*q1 + 2*q2*q3;
+	SPP[8] = 2*q0*q3 + 2*q1*q2;
+	SPP[9] = 2*q0*q2 + 2*q1*q3;
+	SPP[10] = SF[16];
+}
+
+void Ekf::predictCovarianceGenerated(const float (&SF)[21], const float (&SPP)[11], float dt,
+				     const float (&d_ang_var)[3], const float (&d_vel_var)[3],
+				     const float (&process_noise)[_k_num_states])
+{
+	const float q0 = _state.quat_nominal(0);
+	const float q1 = _state.quat_nominal(1);
+	const float q2 = _state.quat_nominal(2);
+	const float q3 = _state.quat_nominal(3);
+
+	const float daxVar = d_ang_var[0];
+	const float dayVar = d_ang_var[1];
+	const float dazVar = d_ang_var[2];
+	const float dvxVar = d_vel_var[0];
+	const float dvyVar = d_vel_var[1];
+	const float dvzVar = d_vel_var[2];
+
 	float SG[8];
 	SG[0] = q0/2;
 	SG[1] = sq(q3);
@@ -313,19 +361,6 @@ void Ekf::predictCovariance()
 	SQ[9] = sq(SG[0]);
 	SQ[10] = sq(q1);
 
-	float SPP[11] = {};
-	SPP[0] = SF[12] + SF[13] - 2*q2*SF[2];
-	SPP[1] = SF[17] - SF[18] - SF[19] + SF[20];
-	SPP[2] = SF[17] - SF[18] + SF[19] - SF[20];
-	SPP[3] = SF[17] + SF[18] - SF[19] - SF[20];
-	SPP[4] = 2*q0*q2 - 2*q1*q3;
-	SPP[5] = 2*q0*q1 - 2*q2*q3;
-	SPP[6] = 2*q0*q3 - 2*q1*q2;
-	SPP[7] = 2*q0*q1 + 2*q2*q3;
-	SPP[8] = 2*q0*q3 + 2*q1*q2;
-	SPP[9] = 2*q0*q2 + 2*q1*q3;
-	SPP[10] = SF[16];
-
 	// covariance update
 	float nextP[24][24];
 
@@ -697,11 +732,148 @@ void Ekf::predictCovariance()
 	for (unsigned i = 0; i < _k_num_states; i++) {
 		P[i][i] = nextP[i][i];
 	}
+}
 
-	// fix gross errors in the covariance matrix and ensure rows and
-	// columns for un-used states are zero
-	fixCovarianceErrors();
+void Ekf::predictCovarianceStructured(const float (&SF)[21], const float (&SPP)[11], float dt,
+				      const float (&d_ang_var)[3], const float (&d_vel_var)[3],
+				      const float (&process_noise)[_k_num_states])
+{
+	const float q0 = _state.quat_nominal(0);
+
+	// The state transition matrix F is identity apart from rows 0..9, which hold the derivatives of the
+	// quaternion wrt quaternion and delta angle bias, of the velocity wrt quaternion and delta velocity bias,
+	// and of the position wrt velocity.
+	const float F_qq[4][4] = {
+		{1.0f, SF[9], SF[11], SF[10]},
+		{SF[8], 1.0f, SF[7], SF[11]},
+		{SF[6], SF[10], 1.0f, SF[8]},
+		{SF[7], SF[6], SF[9], 1.0f}
+	};
+
+	const float F_qb[4][3] = {
+		{SF[14], SF[15], SPP[10]},
+		{-0.5f * q0, SPP[10], -SF[15]},
+		{-SPP[10], -0.5f * q0, SF[14]},
+		{SF[15], -SF[14], -0.5f * q0}
+	};
+
+	const float F_vq[3][4] = {
+		{SF[5], SF[3], SPP[0], -SF[4]},
+		{SF[4], -SPP[0], SF[3], SF[5]},
+		{SPP[0], SF[4], -SF[5], SF[3]}
+	};
+
+	const float F_vb[3][3] = {
+		{SPP[3], SPP[6], -SPP[9]},
+		{-SPP[8], SPP[2], SPP[5]},
+		{SPP[4], -SPP[7], -SPP[1]}
+	};
+
+	// A = F * P for rows 0..9, built from whole rows of P so that the inner loops run over contiguous memory.
+	// The other rows of F * P are the rows of P.
+	float A[10][_k_num_states];
+
+	for (unsigned row = 0; row < 4; row++) {
+		const float *f = F_qq[row];
+		const float *g = F_qb[row];
+
+		for (unsigned col = 0; col < _k_num_states; col++) {
+			A[row][col] = f[0] * P[0][col] + f[1] * P[1][col] + f[2] * P[2][col] + f[3] * P[3][col]
+				      + g[0] * P[10][col] + g[1] * P[11][col] + g[2] * P[12][col];
+		}
+	}
+
+	for (unsigned row = 0; row < 3; row++) {
+		const float *f = F_vq[row];
+		const float *g = F_vb[row];
+
+		for (unsigned col = 0; col < _k_num_states; col++) {
+			A[4 + row][col] = P[4 + row][col] + f[0] * P[0][col] + f[1] * P[1][col] + f[2] * P[2][col]
+					  + f[3] * P[3][col] + g[0] * P[13][col] + g[1] * P[14][col] + g[2] * P[15][col];
+		}
+	}
+
+	for (unsigned row = 0; row < 3; row++) {
+		for (unsigned col = 0; col < _k_num_states; col++) {
+			A[7 + row][col] = P[7 + row][col] + dt * P[4 + row][col];
+		}
+	}
+
+	// stop position covariance growth if our total position variance reaches 100m
+	// this can happen if we lose gps for some time
+	const bool hold_position = (P[7][7] + P[8][8]) > 1e4f;
+
+	// P = A * F^T + Q, upper triangle mirrored into the lower one. F is identity on the states after 9, so only the
+	// kinematic block needs the product; the IMU noise enters through the same columns of F as the IMU biases.
+	for (unsigned row = 0; row < 10; row++) {
+		if (hold_position && (row == 7 || row == 8)) {
+			continue;
+		}
+
+		const float *a = A[row];
+
+		for (unsigned col = row; col < 10; col++) {
+			if (hold_position && (col == 7 || col == 8)) {
+				continue;
+			}
+
+			float value;
+
+			if (col < 4) {
+				value = F_qq[col][0] * a[0] + F_qq[col][1] * a[1] + F_qq[col][2] * a[2] + F_qq[col][3] * a[3]
+					+ F_qb[col][0] * a[10] + F_qb[col][1] * a[11] + F_qb[col][2] * a[12];
+
+				if (row < 4) {
+					value += F_qb[row][0] * d_ang_var[0] * F_qb[col][0] + F_qb[row][1] * d_ang_var[1] * F_qb[col][1]
+						 + F_qb[row][2] * d_ang_var[2] * F_qb[col][2];
+				}
+
+			} else if (col < 7) {
+				const unsigned i = col - 4;
+				value = a[col] + F_vq[i][0] * a[0] + F_vq[i][1] * a[1] + F_vq[i][2] * a[2] + F_vq[i][3] * a[3]
+					+ F_vb[i][0] * a[13] + F_vb[i][1] * a[14] + F_vb[i][2] * a[15];
+
+				if (row >= 4) {
+					const unsigned j = row - 4;
+					value += F_vb[j][0] * d_vel_var[0] * F_vb[i][0] + F_vb[j][1] * d_vel_var[1] * F_vb[i][1]
+						 + F_vb[j][2] * d_vel_var[2] * F_vb[i][2];
+				}
 
+			} else {
+				value = a[col] + dt * a[col - 3];
+			}
+
+			P[row][col] = P[col][row] = value;
+		}
+
+		for (unsigned col = 10; col < _k_num_states; col++) {
+			P[row][col] = P[col][row] = a[col];
+		}
+	}
+
+	// add process noise that is not from the IMU
+	for (unsigned i = 10; i <= 12; i++) {
+		P[i][i] += process_noise[i];
+	}
+
+	// delta velocity bias, magnetic field and wind states which are not estimated are zeroed by fixCovarianceErrors()
+	if (!(_params.fusion_mode & MASK_INHIBIT_ACC_BIAS) && !_accel_bias_inhibit) {
+		for (unsigned i = 13; i <= 15; i++) {
+			P[i][i] += process_noise[i];
+		}
+	}
+
+	if (_control_status.flags.mag_3D) {
+		for (unsigned i = 16; i <= 21; i++) {
+			P[i][i] += process_noise[i];
+		}
+	}
+
+	if (_control_status.flags.wind) {
+		for (unsigned i = 22; i <= 23; i++) {
+			P[i][i] += process_noise[i];
+		}
+	}
 }
 
 void Ekf::fixCovarianceErrors()
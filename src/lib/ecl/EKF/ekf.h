@@ -248,6 +248,12 @@ public:
 
 private:
 
+	// host side microbenchmark, covariance prediction and sparse fusion checks, see tests/benchmark,
+	// tests/covariance and tests/sparse_fusion
+	friend class EkfBenchmark;
+	friend class EkfCovarianceTest;
+	friend class EkfSparseFusionTest;
+
 	static constexpr uint8_t _k_num_states{24};		///< number of EKF states
 
 	struct {
@@ -476,6 +482,19 @@ private:
 	// predict ekf covariance
 	void predictCovariance();
 
+	// calculate the intermediate terms of the covariance prediction from the state and the delayed IMU sample
+	void calculateCovariancePredictionTerms(float (&SF)[21], float (&SPP)[11]) const;
+
+	// predict ekf covariance as F * P * F^T + Q from the generated expressions
+	void predictCovarianceGenerated(const float (&SF)[21], const float (&SPP)[11], float dt,
+					const float (&d_ang_var)[3], const float (&d_vel_var)[3],
+					const float (&process_noise)[_k_num_states]);
+
+	// predict ekf covariance as F * P * F^T + Q using the sparsity of F, updating the upper triangle of P in place
+	void predictCovarianceStructured(const float (&SF)[21], const float (&SPP)[11], float dt,
+					 const float (&d_ang_var)[3], const float (&d_vel_var)[3],
+					 const float (&process_noise)[_k_num_states]);
+
 	// ekf sequential fusion of magnetometer measurements
 	void fuseMag();
 
@@ -566,6 +585,16 @@ private:
 	// and a scalar innovation value
 	void fuse(float *K, float innovation);
 
+	// innovation variance H * P * H^T without the observation noise, for a sparse observation Jacobian H
+	template<typename Observation>
+	float sparseInnovationVariance(const Observation &H) const;
+
+	// sequential fusion of a scalar observation with a sparse observation Jacobian H, see sparse_fusion.h
+	// the states below first_state are not corrected
+	// returns false without applying the correction if it would result in a negative variance
+	template<typename Observation>
+	bool fuseSparse(const Observation &H, float innov_var, float innovation, uint8_t first_state = 0);
+
 	// calculate the earth rotation vector from a given latitude
 	void calcEarthRateNED(Vector3f &omega, float lat_rad) const;
 
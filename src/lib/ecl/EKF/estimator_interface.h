@@ -504,19 +504,30 @@ protected:
 	uint64_t _time_last_move_detect_us{0};	// timestamp of last movement detection event in microseconds
 	bool _gps_drift_updated{false};	// true when _gps_drift_metrics has been updated and is ready for retrieval
 
+#if defined(ECL_EKF_STATIC_BUFFERS)
+	// buffer storage inside the object, large enough for sensor delays up to 300 msec (the EKF2_*_DELAY limit)
+	static constexpr uint8_t BUFFER_CAPACITY{(300 / FILTER_UPDATE_PERIOD_MS) + 1};
+
+	template<typename data_type>
+	using SampleBuffer = StaticRingBuffer<data_type, BUFFER_CAPACITY>;
+#else
+	template<typename data_type>
+	using SampleBuffer = RingBuffer<data_type>;
+#endif
+
 	// data buffer instances
-	RingBuffer<imuSample> _imu_buffer;
-	RingBuffer<gpsSample> _gps_buffer;
-	RingBuffer<magSample> _mag_buffer;
-	RingBuffer<baroSample> _baro_buffer;
-	RingBuffer<rangeSample> _range_buffer;
-	RingBuffer<airspeedSample> _airspeed_buffer;
-	RingBuffer<flowSample> 	_flow_buffer;
-	RingBuffer<extVisionSample> _ext_vision_buffer;
-	RingBuffer<outputSample> _output_buffer;
-	RingBuffer<outputVert> _output_vert_buffer;
-	RingBuffer<dragSample> _drag_buffer;
-	RingBuffer<auxVelSample> _auxvel_buffer;
+	SampleBuffer<imuSample> _imu_buffer;
+	SampleBuffer<gpsSample> _gps_buffer;
+	SampleBuffer<magSample> _mag_buffer;
+	SampleBuffer<baroSample> _baro_buffer;
+	SampleBuffer<rangeSample> _range_buffer;
+	SampleBuffer<airspeedSample> _airspeed_buffer;
+	SampleBuffer<flowSample> 	_flow_buffer;
+	SampleBuffer<extVisionSample> _ext_vision_buffer;
+	SampleBuffer<outputSample> _output_buffer;
+	SampleBuffer<outputVert> _output_vert_buffer;
+	SampleBuffer<dragSample> _drag_buffer;
+	SampleBuffer<auxVelSample> _auxvel_buffer;
 
 	// observation buffer final allocation failed
 	bool _gps_buffer_fail{false};
@@ -0,0 +1,145 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file sparse_fusion.h
+ * Sequential fusion of scalar observations with a sparse observation Jacobian.
+ *
+ * The Jacobian H of most observations only has a few non-zero elements, e.g. one for a
+ * velocity or position observation and five for true airspeed. The indices of these elements
+ * are template parameters of the observation type, so that the kernel loops only over them
+ * with a fixed trip count. H * P and P * H^T cost 24 * N operations instead of 24 * 24 * N,
+ * and the covariance update P = P - K * (H * P) is applied in place, without the 24x24 KHP
+ * matrix the generated code keeps on the stack.
+ */
+
+#pragma once
+
+#include "ekf.h"
+
+/**
+ * Non-zero elements of an observation Jacobian.
+ * @tparam Indices state indices of the non-zero elements, in increasing order
+ */
+template<uint8_t... Indices>
+struct SparseObservation {
+	static constexpr uint8_t size = sizeof...(Indices);
+	static constexpr uint8_t index[size] = {Indices...};
+
+	float value[size];	///< non-zero elements of H, in the order of index
+};
+
+template<uint8_t... Indices>
+constexpr uint8_t SparseObservation<Indices...>::index[];
+
+template<typename Observation>
+float Ekf::sparseInnovationVariance(const Observation &H) const
+{
+	float HPHt = 0.0f;
+
+	for (unsigned i = 0; i < Observation::size; i++) {
+		float PHt = 0.0f;
+
+		for (unsigned j = 0; j < Observation::size; j++) {
+			PHt += P[Observation::index[i]][Observation::index[j]] * H.value[j];
+		}
+
+		HPHt += H.value[i] * PHt;
+	}
+
+	return HPHt;
+}
+
+template<typename Observation>
+bool Ekf::fuseSparse(const Observation &H, float innov_var, float innovation, uint8_t first_state)
+{
+	// Kalman gain K = P * H^T / innov_var, zero for the states which must not be corrected
+	float Kfusion[_k_num_states] = {};
+
+	for (unsigned row = first_state; row < _k_num_states; row++) {
+		float PHt = 0.0f;
+
+		for (unsigned i = 0; i < Observation::size; i++) {
+			PHt += P[row][Observation::index[i]] * H.value[i];
+		}
+
+		Kfusion[row] = PHt / innov_var;
+	}
+
+	// H * P, a combination of the rows of P of the observed states
+	float HP[_k_num_states] = {};
+
+	for (unsigned i = 0; i < Observation::size; i++) {
+		const float *P_row = P[Observation::index[i]];
+
+		for (unsigned column = 0; column < _k_num_states; column++) {
+			HP[column] += H.value[i] * P_row[column];
+		}
+	}
+
+	// if the covariance correction will result in a negative variance, then
+	// the covariance marix is unhealthy and must be corrected
+	bool healthy = true;
+
+	for (unsigned i = 0; i < _k_num_states; i++) {
+		if (P[i][i] < Kfusion[i] * HP[i]) {
+			// zero rows and columns
+			zeroRows(P, i, i);
+			zeroCols(P, i, i);
+
+			healthy = false;
+		}
+	}
+
+	if (!healthy) {
+		return false;
+	}
+
+	// apply the covariance corrections P = P - K * (H * P), rows with zero gain are unchanged
+	for (unsigned row = first_state; row < _k_num_states; row++) {
+		float *P_row = P[row];
+		const float K = Kfusion[row];
+
+		for (unsigned column = 0; column < _k_num_states; column++) {
+			P_row[column] -= K * HP[column];
+		}
+	}
+
+	// correct the covariance marix for gross errors
+	fixCovarianceErrors();
+
+	// apply the state corrections
+	fuse(Kfusion, innovation);
+
+	return true;
+}
@@ -0,0 +1,402 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file batch_replay.cpp
+ *
+ * Tests of the batch replay on small ULog files written by the test itself: parsing of the header,
+ * format definitions and parameters, handling of truncated logs, and the corrections the sensor feed
+ * applies to the logged data before it is passed to the estimator.
+ */
+
+#include <EKF/ekf.h>
+#include <EKF/batch_replay/ekf_replay.h>
+#include <EKF/batch_replay/ulog_reader.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace ekf_replay;
+
+static constexpr uint16_t MSG_ID_IMU = 0;
+static constexpr uint16_t MSG_ID_MAG = 1;
+static constexpr uint16_t MSG_ID_BARO = 2;
+static constexpr uint16_t MSG_ID_NESTED = 3;
+
+static constexpr uint64_t IMU_INTERVAL_US = 4000;
+
+/**
+ * Builds a ULog file in memory.
+ */
+class FixtureLog
+{
+public:
+	FixtureLog()
+	{
+		const uint8_t header[] = {'U', 'L', 'o', 'g', 0x01, 0x12, 0x35, 0x01};
+		_data.insert(_data.end(), header, header + sizeof(header));
+		append_value((uint64_t)1000);
+	}
+
+	void format(const char *definition) { message('F', definition, strlen(definition)); }
+
+	void subscription(uint16_t msg_id, const char *topic)
+	{
+		std::vector<uint8_t> msg;
+		msg.push_back(0); // multi_id
+		msg.push_back(msg_id & 0xff);
+		msg.push_back(msg_id >> 8);
+		msg.insert(msg.end(), topic, topic + strlen(topic));
+		message('A', msg.data(), msg.size());
+	}
+
+	template<typename T>
+	void parameter(const char *type, const char *name, T value)
+	{
+		const std::string key = std::string(type) + " " + name;
+		std::vector<uint8_t> msg;
+		msg.push_back(key.size());
+		msg.insert(msg.end(), key.begin(), key.end());
+		msg.insert(msg.end(), (const uint8_t *)&value, (const uint8_t *)&value + sizeof(value));
+		message('P', msg.data(), msg.size());
+	}
+
+	void data(uint16_t msg_id, const void *payload, size_t size)
+	{
+		std::vector<uint8_t> msg;
+		msg.push_back(msg_id & 0xff);
+		msg.push_back(msg_id >> 8);
+		msg.insert(msg.end(), (const uint8_t *)payload, (const uint8_t *)payload + size);
+		message('D', msg.data(), msg.size());
+	}
+
+	/**
+	 * Write the log to a file.
+	 * @param truncate number of bytes cut off at the end
+	 */
+	void write(const char *path, size_t truncate = 0) const
+	{
+		FILE *f = fopen(path, "wb");
+		assert(f != nullptr);
+		assert(fwrite(_data.data(), 1, _data.size() - truncate, f) == _data.size() - truncate);
+		fclose(f);
+	}
+
+private:
+	template<typename T>
+	void append_value(T value)
+	{
+		_data.insert(_data.end(), (const uint8_t *)&value, (const uint8_t *)&value + sizeof(value));
+	}
+
+	void message(uint8_t type, const void *payload, size_t size)
+	{
+		append_value((uint16_t)size);
+		_data.push_back(type);
+		_data.insert(_data.end(), (const uint8_t *)payload, (const uint8_t *)payload + size);
+	}
+
+	std::vector<uint8_t> _data;
+};
+
+#pragma pack(push, 1)
+struct ImuPayload {
+	uint64_t timestamp;
+	float gyro_rad[3];
+	uint32_t gyro_integral_dt;
+	int32_t accelerometer_timestamp_relative;
+	float accelerometer_m_s2[3];
+	uint32_t accelerometer_integral_dt;
+};
+
+struct MagPayload {
+	uint64_t timestamp;
+	float magnetometer_ga[3];
+};
+
+struct BaroPayload {
+	uint64_t timestamp;
+	float baro_alt_meter;
+	float rho;
+};
+#pragma pack(pop)
+
+/**
+ * Vehicle at rest, IMU at 250 Hz, magnetometer and baro at 50 Hz.
+ * @param mag_offset added to the logged magnetometer data (Gauss)
+ * @param mag_bias logged EKF2_MAGBIAS_X/Y/Z value (Gauss)
+ */
+static FixtureLog make_log(unsigned num_imu, float mag_offset, float mag_bias)
+{
+	FixtureLog log;
+
+	log.format("sensor_combined:uint64_t timestamp;float[3] gyro_rad;uint32_t gyro_integral_dt;"
+		   "int32_t accelerometer_timestamp_relative;float[3] accelerometer_m_s2;"
+		   "uint32_t accelerometer_integral_dt;");
+	log.format("vehicle_magnetometer:uint64_t timestamp;float[3] magnetometer_ga;");
+	log.format("vehicle_air_data:uint64_t timestamp;float baro_alt_meter;float rho;");
+	log.format("test_inner:uint16_t a;float[2] b;");
+	log.format("test_outer:uint64_t timestamp;uint8_t x;test_inner[2] inner;");
+
+	log.parameter("int32_t", "EKF2_MIN_OBS_DT", (int32_t)20);
+	log.parameter("float", "EKF2_MAGBIAS_X", mag_bias);
+	log.parameter("float", "EKF2_MAGBIAS_Y", mag_bias);
+	log.parameter("float", "EKF2_MAGBIAS_Z", mag_bias);
+	log.parameter("float", "UNUSED_PARAM", 1.0f);
+
+	log.subscription(MSG_ID_IMU, "sensor_combined");
+	log.subscription(MSG_ID_MAG, "vehicle_magnetometer");
+	log.subscription(MSG_ID_BARO, "vehicle_air_data");
+	log.subscription(MSG_ID_NESTED, "test_outer");
+
+	uint64_t time_us = 1000000;
+
+	for (unsigned i = 0; i < num_imu; i++) {
+		time_us += IMU_INTERVAL_US;
+
+		if (i == num_imu / 2) {
+			// parameter change in flight
+			log.parameter("float", "EKF2_BARO_NOISE", 3.5f);
+		}
+
+		if (i % 5 == 0) {
+			MagPayload mag{time_us, {0.25f + mag_offset, mag_offset, 0.375f + mag_offset}};
+			log.data(MSG_ID_MAG, &mag, sizeof(mag));
+
+			BaroPayload baro{time_us, 120.0f, 1.225f};
+			log.data(MSG_ID_BARO, &baro, sizeof(baro));
+		}
+
+		ImuPayload imu{time_us, {0.001f, -0.002f, 0.0005f}, (uint32_t)IMU_INTERVAL_US, 0,
+			       {0.0f, 0.0f, -CONSTANTS_ONE_G}, (uint32_t)IMU_INTERVAL_US};
+		log.data(MSG_ID_IMU, &imu, sizeof(imu));
+	}
+
+	return log;
+}
+
+class ParameterRecorder : public ULogReader::Handler
+{
+public:
+	void parameter(const std::string &name, float value, bool is_int) override
+	{
+		names.push_back(name);
+		values.push_back(value);
+		ints.push_back(is_int);
+	}
+
+	void data(uint16_t msg_id, const uint8_t *data, uint16_t size) override { num_data++; }
+
+	std::vector<std::string> names;
+	std::vector<float> values;
+	std::vector<bool> ints;
+	unsigned num_data{0};
+};
+
+static const ParameterData *find_parameter(const LogData &log, const char *name)
+{
+	for (const ParameterData &p : log.parameters) {
+		if (p.name == name) {
+			return &p;
+		}
+	}
+
+	return nullptr;
+}
+
+static void test_definitions(const char *path)
+{
+	ULogReader reader;
+	assert(reader.load(path));
+	assert(reader.start_time() == 1000);
+
+	ParameterRecorder recorder;
+	assert(reader.parse(recorder));
+	assert(recorder.num_data == 100 + 2 * 20);
+
+	// all parameters are passed on, integers converted to float
+	assert(recorder.names.size() == 6);
+	assert(recorder.names[0] == "EKF2_MIN_OBS_DT" && recorder.ints[0] && recorder.values[0] == 20.0f);
+	assert(recorder.names[1] == "EKF2_MAGBIAS_X" && !recorder.ints[1] && recorder.values[1] == 0.0625f);
+	assert(recorder.names[5] == "EKF2_BARO_NOISE" && recorder.values[5] == 3.5f);
+
+	// fields after arrays
+	ULogReader::Field field = reader.field("sensor_combined", "accelerometer_m_s2[1]");
+	assert(field.offset == 32 && field.type == 'f');
+	field = reader.field("sensor_combined", "accelerometer_integral_dt");
+	assert(field.offset == 40 && field.type == 'i' && !field.is_signed);
+
+	// nested definitions
+	field = reader.field("test_outer", "inner[1].b[1]");
+	assert(field.offset == 8 + 1 + 10 + 2 + 4 && field.type == 'f');
+	field = reader.field("test_outer", "inner[0].a");
+	assert(field.offset == 9 && field.type == 'h');
+
+	// missing fields, array indices out of range and nested types without a field
+	assert(!reader.field("sensor_combined", "gyro_rad[3]").valid());
+	assert(!reader.field("sensor_combined", "missing").valid());
+	assert(!reader.field("test_outer", "inner[0]").valid());
+	assert(!reader.field("missing_topic", "timestamp").valid());
+
+	// a value outside of the data returns the fallback
+	const uint8_t data[4] = {};
+	field = reader.field("sensor_combined", "gyro_rad[0]");
+	assert(ULogReader::read<float>(data, sizeof(data), field, -1.0f) == -1.0f);
+
+	// the sensor data used by the replay, only the parameters it knows are kept
+	LogData log;
+	assert(log.load(path));
+	assert(log.imu.size() == 100);
+	assert(log.mag.size() == 20);
+	assert(log.baro.size() == 20);
+	assert(log.imu[1].time_us - log.imu[0].time_us == IMU_INTERVAL_US);
+	assert(log.imu[0].gyro_dt_us == IMU_INTERVAL_US);
+	assert(fabsf(log.imu[0].accel_m_s2[2] + CONSTANTS_ONE_G) < 1e-6f);
+	assert(log.baro[0].alt_m == 120.0f && log.baro[0].rho == 1.225f);
+
+	const ParameterData *mag_bias = find_parameter(log, "EKF2_MAGBIAS_X");
+	assert(mag_bias != nullptr && mag_bias->time_us == 0 && mag_bias->value == 0.0625f);
+	assert(find_parameter(log, "UNUSED_PARAM") == nullptr);
+
+	// parameter changes are applied after the last data logged before them
+	const ParameterData *baro_noise = find_parameter(log, "EKF2_BARO_NOISE");
+	assert(baro_noise != nullptr && baro_noise->time_us == log.imu[49].time_us);
+}
+
+static void test_truncated(const FixtureLog &fixture, const char *path)
+{
+	// the last IMU sample is cut off, everything before it is replayed
+	fixture.write(path, 5);
+
+	ULogReader reader;
+	assert(reader.load(path));
+	ParameterRecorder recorder;
+	assert(!reader.parse(recorder));
+	assert(recorder.num_data == 100 + 2 * 20 - 1);
+
+	LogData log;
+	assert(log.load(path));
+	assert(log.imu.size() == 99);
+
+	// no complete header
+	FixtureLog().write(path, 4);
+	assert(!LogData().load(path));
+
+	// not a ULog file
+	FILE *f = fopen(path, "wb");
+	assert(f != nullptr);
+	fputs("not a log file, but long enough for a header", f);
+	fclose(f);
+	assert(!LogData().load(path));
+
+	assert(!LogData().load("does_not_exist.ulg"));
+}
+
+static void test_static_pressure_correction()
+{
+	ModuleParameters params;
+	const float rho = 1.225f;
+
+	// no correction with the default coefficients
+	assert(static_pressure_correction(params, Vector3f(10.0f, 5.0f, 1.0f), rho) == 0.0f);
+
+	// the X coefficient depends on the direction, dynamic pressure 0.5 * rho * v**2
+	params.pcoef_xp = 0.2f;
+	params.pcoef_xn = -0.1f;
+	const float expected = 0.5f * rho * 0.2f * 100.0f / (rho * CONSTANTS_ONE_G);
+	assert(fabsf(static_pressure_correction(params, Vector3f(10.0f, 0.0f, 0.0f), rho) - expected) < 1e-6f);
+	assert(fabsf(static_pressure_correction(params, Vector3f(-10.0f, 0.0f, 0.0f), rho) + 0.5f * expected) < 1e-6f);
+
+	// the airspeed is limited by EKF2_ASPD_MAX
+	params.aspd_max = 5.0f;
+	assert(fabsf(static_pressure_correction(params, Vector3f(10.0f, 0.0f, 0.0f), rho) - 0.25f * expected) < 1e-6f);
+}
+
+static void test_mag_bias(const char *path)
+{
+	// magnetometer data with an offset which is corrected by the logged bias must give the same result as data
+	// without the offset. The values are exact in binary, so that the correction is exact.
+	make_log(3000, 0.0625f, 0.0625f).write(path);
+	LogData log_corrected;
+	assert(log_corrected.load(path));
+
+	make_log(3000, 0.0f, 0.0f).write(path);
+	LogData log_reference;
+	assert(log_reference.load(path));
+
+	make_log(3000, 0.0625f, 0.0f).write(path);
+	LogData log_offset;
+	assert(log_offset.load(path));
+
+	Summary corrected;
+	Summary reference;
+	Summary offset;
+	run(log_corrected, ParameterSet{}, corrected);
+	run(log_reference, ParameterSet{}, reference);
+	run(log_offset, ParameterSet{}, offset);
+
+	assert(reference.imu_samples == 3000);
+	assert(reference.updates > 0);
+	assert(reference.time_tilt_align_s >= 0.0f);
+
+	assert(corrected.updates == reference.updates);
+	assert(memcmp(corrected.test_ratio_mean, reference.test_ratio_mean, sizeof(reference.test_ratio_mean)) == 0);
+	assert(memcmp(corrected.pos_final, reference.pos_final, sizeof(reference.pos_final)) == 0);
+	assert(memcmp(corrected.gyro_bias, reference.gyro_bias, sizeof(reference.gyro_bias)) == 0);
+
+	// the offset is visible to the estimator without the bias correction
+	assert(memcmp(offset.test_ratio_mean, reference.test_ratio_mean, sizeof(reference.test_ratio_mean)) != 0
+	       || memcmp(offset.gyro_bias, reference.gyro_bias, sizeof(reference.gyro_bias)) != 0);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = "batch_replay_fixture.ulg";
+
+	const FixtureLog fixture = make_log(100, 0.0f, 0.0625f);
+	fixture.write(path);
+
+	test_definitions(path);
+	test_truncated(fixture, path);
+	test_static_pressure_correction();
+	test_mag_bias(path);
+
+	remove(path);
+	printf("batch replay tests passed\n");
+
+	return 0;
+}
@@ -0,0 +1,625 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file benchmark.cpp
+ *
+ * Microbenchmark of the filter update and of the prediction and fusion functions.
+ *
+ * The filter is first run on sensor data, either from a ULog file or synthetic data for a
+ * vehicle at rest, until it is aligned and fusing GPS. Each function is then called
+ * repeatedly from that state, restoring the states and covariances before each call so that
+ * every call takes the same code path. The cost of the restore is measured separately and
+ * subtracted. On Linux the instruction, cycle and cache miss counts are read from perf_event
+ * where the kernel allows it.
+ *
+ * Results can be stored as a baseline and later runs compared against it. Instruction counts
+ * are compared when available in both, as they are much less noisy than time.
+ */
+
+#include <EKF/ekf.h>
+#include <EKF/batch_replay/ekf_replay.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace ekf_replay;
+
+/**
+ * Hardware counters of the calling thread, counted in user space only.
+ */
+class PerfCounters
+{
+public:
+	enum Counter { INSTRUCTIONS = 0, CYCLES, CACHE_MISSES, NUM_COUNTERS };
+
+	PerfCounters()
+	{
+#if defined(__linux__)
+		const uint64_t configs[NUM_COUNTERS] = {PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+							PERF_COUNT_HW_CACHE_MISSES
+						       };
+
+		for (int i = 0; i < NUM_COUNTERS; i++) {
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = configs[i];
+			attr.disabled = (i == 0);
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP;
+
+			_fd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, (i == 0) ? -1 : _fd[0], 0);
+
+			if (_fd[i] < 0) {
+				// not supported, or not permitted by kernel.perf_event_paranoid
+				close_all();
+				return;
+			}
+		}
+
+#endif
+	}
+
+	~PerfCounters() { close_all(); }
+
+	bool available() const { return _fd[0] >= 0; }
+
+	void start()
+	{
+#if defined(__linux__)
+
+		if (available()) {
+			ioctl(_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+#endif
+	}
+
+	void stop()
+	{
+#if defined(__linux__)
+
+		if (available()) {
+			ioctl(_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+#endif
+	}
+
+	/**
+	 * Read and reset the counters.
+	 */
+	void read_reset(uint64_t (&values)[NUM_COUNTERS])
+	{
+		memset(values, 0, sizeof(values));
+#if defined(__linux__)
+
+		if (available()) {
+			uint64_t buffer[1 + NUM_COUNTERS];
+
+			const ssize_t len = read(_fd[0], buffer, sizeof(buffer));
+
+			if (len == (ssize_t)sizeof(buffer) && buffer[0] == NUM_COUNTERS) {
+				memcpy(values, &buffer[1], sizeof(values));
+			}
+
+			ioctl(_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		}
+
+#endif
+	}
+
+private:
+	void close_all()
+	{
+#if defined(__linux__)
+
+		for (int i = NUM_COUNTERS - 1; i >= 0; i--) {
+			if (_fd[i] >= 0) {
+				close(_fd[i]);
+				_fd[i] = -1;
+			}
+		}
+
+#endif
+	}
+
+	int _fd[NUM_COUNTERS] {-1, -1, -1};
+};
+
+struct Result {
+	std::string name;
+	double ns{0.0};			///< wall clock time per call (nsec)
+	double counts[PerfCounters::NUM_COUNTERS] {};	///< hardware counts per call
+	bool has_counts{false};
+};
+
+/**
+ * Calls the private functions of the filter, see the friend declaration in ekf.h.
+ */
+class EkfBenchmark
+{
+public:
+	EkfBenchmark(const LogData &log, PerfCounters &counters) :
+		_log(log),
+		_feed(log, _ekf, _no_overrides),
+		_counters(counters)
+	{}
+
+	/**
+	 * Run the filter on the first seconds of the data.
+	 * @return false if the data ended before the filter is fusing GPS
+	 */
+	bool warm_up(float seconds)
+	{
+		const uint64_t end_us = _log.imu.front().time_us + (uint64_t)(seconds * 1e6f);
+
+		while (_feed.time_us() < end_us && _feed.push_next()) {
+			_ekf.update();
+		}
+
+		filter_control_status_u control_status;
+		_ekf.get_control_mode(&control_status.value);
+
+		return control_status.flags.tilt_align && control_status.flags.gps;
+	}
+
+	/**
+	 * Time the complete filter update, continuing on the data after the warm up.
+	 */
+	Result update(int iterations)
+	{
+		Result result;
+		result.name = "update";
+
+		uint64_t total_ns = 0;
+		uint64_t counts[PerfCounters::NUM_COUNTERS];
+		_counters.read_reset(counts);
+		int calls = 0;
+
+		for (; calls < iterations && _feed.push_next(); calls++) {
+			const auto start = std::chrono::steady_clock::now();
+			_counters.start();
+			_ekf.update();
+			_counters.stop();
+			const auto end = std::chrono::steady_clock::now();
+			total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		}
+
+		_counters.read_reset(counts);
+
+		if (calls > 0) {
+			result.ns = (double)total_ns / calls;
+			set_counts(result, counts, calls);
+		}
+
+		return result;
+	}
+
+	/**
+	 * Time one function of the filter, called from the same state each time.
+	 */
+	template<typename Setup, typename Function>
+	Result kernel(const char *name, int iterations, Setup setup, Function function)
+	{
+		save();
+
+		uint64_t restore_counts[PerfCounters::NUM_COUNTERS];
+		const double restore_ns = measure(iterations, setup, [] {}, restore_counts);
+
+		uint64_t counts[PerfCounters::NUM_COUNTERS];
+		const double total_ns = measure(iterations, setup, function, counts);
+
+		restore();
+
+		Result result;
+		result.name = name;
+		result.ns = fmax(total_ns - restore_ns, 0.0) / iterations;
+
+		for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++) {
+			counts[i] = (counts[i] > restore_counts[i]) ? counts[i] - restore_counts[i] : 0;
+		}
+
+		set_counts(result, counts, iterations);
+		return result;
+	}
+
+	std::vector<Result> run_all(int iterations)
+	{
+		std::vector<Result> results;
+		Ekf &ekf = _ekf;
+
+		results.push_back(kernel("predictState", iterations, [] {}, [&ekf] { ekf.predictState(); }));
+
+		results.push_back(kernel("predictCovariance", iterations, [] {}, [&ekf] { ekf.predictCovariance(); }));
+
+		results.push_back(kernel("fuseMag", iterations, [&ekf] {
+			ekf._control_status.flags.mag_hdg = false;
+			ekf._control_status.flags.mag_3D = true;
+		}, [&ekf] { ekf.fuseMag(); }));
+
+		results.push_back(kernel("fuseHeading", iterations, [&ekf] {
+			ekf._control_status.flags.mag_hdg = true;
+			ekf._control_status.flags.mag_3D = false;
+		}, [&ekf] { ekf.fuseHeading(); }));
+
+		results.push_back(kernel("fuseVelPosHeight", iterations, [&ekf] {
+			ekf._fuse_hor_vel = true;
+			ekf._fuse_vert_vel = true;
+			ekf._fuse_pos = true;
+			ekf._fuse_height = true;
+		}, [&ekf] { ekf.fuseVelPosHeight(); }));
+
+		results.push_back(kernel("fuseAirspeed", iterations, [&ekf] {
+			ekf._state.vel(0) = 15.0f;
+			ekf._airspeed_sample_delayed.true_airspeed = 15.5f;
+			ekf._airspeed_sample_delayed.eas2tas = 1.0f;
+			ekf._is_wind_dead_reckoning = false;
+		}, [&ekf] { ekf.fuseAirspeed(); }));
+
+		results.push_back(kernel("fuseOptFlow", iterations, [&ekf] {
+			ekf._flow_sample_delayed.quality = 255;
+			ekf._flow_sample_delayed.dt = 0.1f;
+			ekf._flow_sample_delayed.gyroXYZ.setZero();
+			ekf._flowRadXYcomp(0) = 0.002f;
+			ekf._flowRadXYcomp(1) = -0.002f;
+			ekf._flow_max_rate = 2.5f;
+			ekf._terrain_vpos = ekf._state.pos(2) + 10.0f;
+		}, [&ekf] { ekf.fuseOptFlow(); }));
+
+		results.push_back(kernel("fuseDrag", iterations, [&ekf] {
+			ekf._drag_sample_delayed.accelXY(0) = 0.1f;
+			ekf._drag_sample_delayed.accelXY(1) = -0.1f;
+		}, [&ekf] { ekf.fuseDrag(); }));
+
+		results.push_back(update(iterations));
+
+		return results;
+	}
+
+private:
+	template<typename Setup, typename Function>
+	double measure(int iterations, Setup &setup, Function function, uint64_t (&counts)[PerfCounters::NUM_COUNTERS])
+	{
+		_counters.read_reset(counts);
+
+		const auto start = std::chrono::steady_clock::now();
+		_counters.start();
+
+		for (int i = 0; i < iterations; i++) {
+			restore();
+			setup();
+			function();
+		}
+
+		_counters.stop();
+		const auto end = std::chrono::steady_clock::now();
+
+		_counters.read_reset(counts);
+
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+
+	void save()
+	{
+		_saved_state = _ekf._state;
+		memcpy(_saved_P, _ekf.P, sizeof(_saved_P));
+		_saved_control_status = _ekf._control_status;
+		_saved_fault_status = _ekf._fault_status;
+	}
+
+	void restore()
+	{
+		_ekf._state = _saved_state;
+		memcpy(_ekf.P, _saved_P, sizeof(_saved_P));
+		_ekf._control_status = _saved_control_status;
+		_ekf._fault_status = _saved_fault_status;
+	}
+
+	void set_counts(Result &result, const uint64_t (&counts)[PerfCounters::NUM_COUNTERS], int calls)
+	{
+		result.has_counts = _counters.available();
+
+		for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++) {
+			result.counts[i] = (double)counts[i] / calls;
+		}
+	}
+
+	const LogData &_log;
+	const ParameterSet _no_overrides{};
+	Ekf _ekf;
+	SensorFeed _feed;
+	PerfCounters &_counters;
+
+	stateSample _saved_state{};
+	float _saved_P[24][24] {};
+	filter_control_status_u _saved_control_status{};
+	fault_status_u _saved_fault_status{};
+};
+
+/**
+ * Sensor data of a vehicle at rest with noise, GPS at 5 Hz, magnetometer and baro at 50 Hz, IMU at 250 Hz.
+ */
+static void create_synthetic_data(LogData &log, float seconds)
+{
+	std::mt19937 generator(1);
+	std::normal_distribution<float> noise(0.0f, 1.0f);
+
+	log.path = "synthetic";
+	const uint64_t start_us = 1000000;
+	const uint64_t end_us = start_us + (uint64_t)(seconds * 1e6f);
+	const uint32_t imu_dt_us = 4000;
+
+	for (uint64_t t = start_us; t < end_us; t += imu_dt_us) {
+		ImuData imu;
+		imu.time_us = t;
+		imu.gyro_dt_us = imu_dt_us;
+		imu.accel_dt_us = imu_dt_us;
+
+		for (int i = 0; i < 3; i++) {
+			imu.gyro_rad[i] = 0.002f + 0.01f * noise(generator);
+			imu.accel_m_s2[i] = 0.05f * noise(generator);
+		}
+
+		imu.accel_m_s2[2] -= CONSTANTS_ONE_G;
+		log.imu.push_back(imu);
+
+		if ((t - start_us) % 20000 == 0) {
+			MagData mag;
+			mag.time_us = t;
+			mag.mag_ga[0] = 0.2f + 0.002f * noise(generator);
+			mag.mag_ga[1] = 0.002f * noise(generator);
+			mag.mag_ga[2] = 0.4f + 0.002f * noise(generator);
+			log.mag.push_back(mag);
+			log.baro.push_back({t, 488.0f + 0.1f * noise(generator), CONSTANTS_AIR_DENSITY_SEA_LEVEL_15C});
+		}
+
+		if ((t - start_us) % 200000 == 0) {
+			gps_message gps{};
+			gps.time_usec = t;
+			gps.lat = 473977418 + (int32_t)(5.0f * noise(generator));
+			gps.lon = 85455939 + (int32_t)(5.0f * noise(generator));
+			gps.alt = 488000 + (int32_t)(100.0f * noise(generator));
+			gps.yaw = NAN;
+			gps.yaw_offset = NAN;
+			gps.fix_type = 3;
+			gps.eph = 0.8f;
+			gps.epv = 1.2f;
+			gps.sacc = 0.2f;
+			gps.vel_ned_valid = true;
+			gps.nsats = 12;
+			gps.gdop = 0.0f;
+
+			for (int i = 0; i < 3; i++) {
+				gps.vel_ned[i] = 0.05f * noise(generator);
+			}
+
+			log.gps.push_back(gps);
+		}
+	}
+
+	log.landed.push_back({start_us, true});
+}
+
+static bool load_baseline(const char *path, std::map<std::string, Result> &baseline)
+{
+	FILE *f = fopen(path, "r");
+
+	if (f == nullptr) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+
+	char line[256];
+	char name[64];
+	Result r;
+	int has_counts;
+
+	while (fgets(line, sizeof(line), f) != nullptr) {
+		if (line[0] != '#' && sscanf(line, "%63s %lf %d %lf %lf %lf", name, &r.ns, &has_counts, &r.counts[0],
+					     &r.counts[1], &r.counts[2]) == 6) {
+			r.name = name;
+			r.has_counts = has_counts != 0;
+			baseline[r.name] = r;
+		}
+	}
+
+	fclose(f);
+	return true;
+}
+
+static bool save_baseline(const char *path, const std::vector<Result> &results)
+{
+	FILE *f = fopen(path, "w");
+
+	if (f == nullptr) {
+		fprintf(stderr, "cannot create %s\n", path);
+		return false;
+	}
+
+	fprintf(f, "# name ns_per_call has_counts instructions cycles cache_misses\n");
+
+	for (const Result &r : results) {
+		fprintf(f, "%s %.1f %d %.1f %.1f %.2f\n", r.name.c_str(), r.ns, r.has_counts ? 1 : 0,
+			r.counts[0], r.counts[1], r.counts[2]);
+	}
+
+	fclose(f);
+	return true;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-l log.ulg] [-s warm_up_s] [-n iterations] [-b baseline] [-w baseline] "
+		"[-t time_tolerance] [-i instruction_tolerance]\n"
+		" -l  replay a ULog file instead of synthetic data\n"
+		" -s  seconds of data run before the benchmark, default: 30\n"
+		" -n  number of calls per function, default: 10000\n"
+		" -b  compare against a baseline file, fail on regressions\n"
+		" -w  write the results as a baseline file\n"
+		" -t  allowed relative increase of the time per call, default: 0.25\n"
+		" -i  allowed relative increase of the instructions per call, default: 0.02\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *log_path = nullptr;
+	const char *baseline_path = nullptr;
+	const char *write_path = nullptr;
+	float warm_up_s = 30.0f;
+	int iterations = 10000;
+	double time_tolerance = 0.25;
+	double instruction_tolerance = 0.02;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "l:s:n:b:w:t:i:h")) != -1) {
+		switch (ch) {
+		case 'l': log_path = optarg; break;
+
+		case 's': warm_up_s = (float)atof(optarg); break;
+
+		case 'n': iterations = atoi(optarg); break;
+
+		case 'b': baseline_path = optarg; break;
+
+		case 'w': write_path = optarg; break;
+
+		case 't': time_tolerance = atof(optarg); break;
+
+		case 'i': instruction_tolerance = atof(optarg); break;
+
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (iterations <= 0 || warm_up_s <= 0.0f) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	LogData log;
+
+	if (log_path != nullptr) {
+		if (!log.load(log_path)) {
+			return 1;
+		}
+
+		if (log.imu.empty()) {
+			fprintf(stderr, "%s: no IMU data\n", log_path);
+			return 1;
+		}
+
+	} else {
+		// enough data for the warm up and the update benchmark
+		create_synthetic_data(log, warm_up_s + iterations * 0.004f + 1.0f);
+	}
+
+	PerfCounters counters;
+	EkfBenchmark benchmark(log, counters);
+
+	if (!benchmark.warm_up(warm_up_s)) {
+		fprintf(stderr, "filter is not fusing GPS after %.1f s, results are not representative\n",
+			(double)warm_up_s);
+	}
+
+	const std::vector<Result> results = benchmark.run_all(iterations);
+
+	std::map<std::string, Result> baseline;
+
+	if (baseline_path != nullptr && !load_baseline(baseline_path, baseline)) {
+		return 1;
+	}
+
+	printf("%-20s %12s %14s %12s %14s %s\n", "function", "ns/call", "instructions", "cycles", "cache misses",
+	       baseline.empty() ? "" : "vs baseline");
+	int regressions = 0;
+
+	for (const Result &r : results) {
+		printf("%-20s %12.1f", r.name.c_str(), r.ns);
+
+		if (r.has_counts) {
+			printf(" %14.1f %12.1f %14.2f", r.counts[0], r.counts[1], r.counts[2]);
+
+		} else {
+			printf(" %14s %12s %14s", "-", "-", "-");
+		}
+
+		auto base = baseline.find(r.name);
+
+		if (base != baseline.end()) {
+			const Result &b = base->second;
+			const bool use_counts = r.has_counts && b.has_counts && b.counts[0] > 0.0;
+			const double reference = use_counts ? b.counts[0] : b.ns;
+			const double value = use_counts ? r.counts[0] : r.ns;
+			const double change = (reference > 0.0) ? value / reference - 1.0 : 0.0;
+			const bool regressed = change > (use_counts ? instruction_tolerance : time_tolerance);
+
+			printf(" %+6.1f%% %s%s", change * 100.0, use_counts ? "instructions" : "time",
+			       regressed ? " REGRESSION" : "");
+			regressions += regressed ? 1 : 0;
+		}
+
+		printf("\n");
+	}
+
+	if (!counters.available()) {
+		printf("hardware counters not available (perf_event_open failed)\n");
+	}
+
+	if (write_path != nullptr && !save_baseline(write_path, results)) {
+		return 1;
+	}
+
+	return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2018 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file covariance.cpp
+ *
+ * Checks that the structured covariance prediction matches the generated one element-wise for
+ * random states, IMU samples and covariance matrices, then runs the filter on synthetic sensor
+ * data, checks that the variances stay valid and reports the time taken per filter update.
+ * Build with and without ECL_EKF_STRUCTURED_COVARIANCE_PREDICTION to time the two
+ * covariance prediction implementations.
+ */
+
+#include <EKF/ekf.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+class EkfCovarianceTest
+{
+public:
+	/**
+	 * Set a random attitude, IMU sample, bias estimate and covariance matrix, run the generated and
+	 * the structured covariance prediction from the same inputs and compare the results.
+	 * @param hold_position true to exceed the horizontal position variance limit which stops the
+	 * position covariance growth
+	 * @return number of covariance elements which differ by more than the tolerance
+	 */
+	unsigned compare(Ekf &ekf, bool hold_position);
+
+private:
+	/** deterministic uniform noise in [min, max] */
+	float random(float min, float max)
+	{
+		_random_state = _random_state * 1664525u + 1013904223u;
+		return min + (max - min) * (float)(_random_state >> 8) / (float)(1 << 24);
+	}
+
+	uint32_t _random_state{1};
+};
+
+unsigned EkfCovarianceTest::compare(Ekf &ekf, bool hold_position)
+{
+	static constexpr unsigned n = Ekf::_k_num_states;
+
+	Quatf q(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f));
+	q.normalize();
+	ekf._state.quat_nominal = q;
+
+	for (unsigned i = 0; i < 3; i++) {
+		ekf._state.gyro_bias(i) = random(-1e-4f, 1e-4f);
+		ekf._state.accel_bias(i) = random(-1e-3f, 1e-3f);
+		ekf._imu_sample_delayed.delta_ang(i) = random(-0.01f, 0.01f);
+		ekf._imu_sample_delayed.delta_vel(i) = random(-0.1f, 0.1f);
+	}
+
+	// predict every state, the generated prediction leaves the rows of inactive states to fixCovarianceErrors()
+	ekf._params.fusion_mode &= ~MASK_INHIBIT_ACC_BIAS;
+	ekf._accel_bias_inhibit = false;
+	ekf._control_status.flags.mag_3D = true;
+	ekf._control_status.flags.wind = true;
+
+	// symmetric positive definite covariance P = L * L^T, scaled to the typical uncertainty of each state
+	float sigma[n];
+
+	for (unsigned i = 0; i < n; i++) {
+		if (i < 4) {
+			sigma[i] = 0.05f;
+
+		} else if (i < 7) {
+			sigma[i] = 0.5f;
+
+		} else if (i < 10) {
+			sigma[i] = (hold_position && i < 9) ? 100.0f : 2.0f;
+
+		} else if (i < 13) {
+			sigma[i] = 1e-4f;
+
+		} else if (i < 16) {
+			sigma[i] = 1e-3f;
+
+		} else if (i < 22) {
+			sigma[i] = 0.02f;
+
+		} else {
+			sigma[i] = 1.0f;
+		}
+	}
+
+	float L[n][n] = {};
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col <= row; col++) {
+			L[row][col] = sigma[row] * random(-1.0f, 1.0f);
+		}
+	}
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			float value = 0.0f;
+
+			for (unsigned k = 0; k < n; k++) {
+				value += L[row][k] * L[col][k];
+			}
+
+			ekf.P[row][col] = value;
+		}
+	}
+
+	// same inputs as Ekf::predictCovariance(), the IMU noise is not part of the process noise
+	const float dt = random(0.5f, 2.0f) * FILTER_UPDATE_PERIOD_S;
+	const float d_ang_var[3] = {sq(dt * 0.015f), sq(dt * 0.015f), sq(dt * 0.015f)};
+	const float d_vel_var[3] = {sq(dt * 0.35f), sq(dt * 0.35f), sq(dt * 0.35f)};
+	float process_noise[n] = {};
+
+	for (unsigned i = 10; i < n; i++) {
+		process_noise[i] = sq(sigma[i] * random(0.0f, 0.01f));
+	}
+
+	float SF[21];
+	float SPP[11];
+	ekf.calculateCovariancePredictionTerms(SF, SPP);
+
+	float P_prior[n][n];
+	memcpy(P_prior, ekf.P, sizeof(P_prior));
+
+	ekf.predictCovarianceGenerated(SF, SPP, dt, d_ang_var, d_vel_var, process_noise);
+	float P_generated[n][n];
+	memcpy(P_generated, ekf.P, sizeof(P_generated));
+
+	memcpy(ekf.P, P_prior, sizeof(P_prior));
+	ekf.predictCovarianceStructured(SF, SPP, dt, d_ang_var, d_vel_var, process_noise);
+
+	// both sum the same products in a different order, so compare relative to the size of the correlated variances
+	unsigned num_errors = 0;
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			const float expected = P_generated[row][col];
+			const float actual = ekf.P[row][col];
+			const float tolerance = 1e-5f * sqrtf(fabsf(P_generated[row][row] * P_generated[col][col]));
+
+			if (!std::isfinite(actual) || fabsf(actual - expected) > tolerance) {
+				if (num_errors < 10) {
+					printf("P[%u][%u]: structured %.9e generated %.9e\n", row, col,
+					       (double)actual, (double)expected);
+				}
+
+				num_errors++;
+			}
+		}
+	}
+
+	return num_errors;
+}
+
+int main(int argc, char *argv[])
+{
+	Ekf *ekf = new Ekf();
+	EkfCovarianceTest test;
+
+	for (unsigned i = 0; i < 200; i++) {
+		const bool hold_position = (i % 4 == 3);
+		const unsigned num_errors = test.compare(*ekf, hold_position);
+
+		if (num_errors > 0) {
+			printf("structured covariance prediction differs in %u elements (case %u%s)\n", num_errors, i,
+			       hold_position ? ", position held" : "");
+			delete ekf;
+			return 1;
+		}
+	}
+
+	delete ekf;
+	ekf = new Ekf();
+
+	const uint64_t imu_sample_period = 4000;	// 250 Hz
+	uint64_t time_usec = 1000;
+	ekf->init(time_usec);
+
+	// level and stationary, with a small gyro offset so that the bias states are exercised
+	float delta_ang[3] = {0.001f * 0.004f, -0.002f * 0.004f, 0.0005f * 0.004f};
+	float delta_vel[3] = {0.0f, 0.0f, -CONSTANTS_ONE_G * 0.004f};
+	float mag[3] = {0.2f, 0.0f, 0.4f};
+	float baro = 120.0f;
+
+	gps_message gps = {};
+	gps.lat = 40 * 1e7;
+	gps.lon = 5 * 1e7;
+	gps.alt = 200 * 1e3;
+	gps.yaw = NAN;
+	gps.fix_type = 3;
+	gps.eph = 0.5f;
+	gps.epv = 0.8f;
+	gps.sacc = 0.2f;
+	gps.vel_ned_valid = true;
+	gps.nsats = 16;
+	gps.gdop = 0.9f;
+
+	// one minute of flight
+	const unsigned num_samples = 60 * 250;
+	unsigned num_updates = 0;
+	std::chrono::nanoseconds update_time{0};
+
+	for (unsigned i = 0; i < num_samples; i++) {
+		time_usec += imu_sample_period;
+
+		ekf->setIMUData(time_usec, imu_sample_period, imu_sample_period, delta_ang, delta_vel);
+
+		if (i % 5 == 0) {
+			ekf->setMagData(time_usec, mag);
+			ekf->setBaroData(time_usec, baro);
+		}
+
+		if (i % 50 == 0) {
+			gps.time_usec = time_usec;
+			ekf->setGpsData(time_usec, &gps);
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
+		if (ekf->update()) {
+			update_time += std::chrono::steady_clock::now() - start;
+			num_updates++;
+		}
+	}
+
+	float variances[24];
+	ekf->get_covariances(variances);
+	delete ekf;
+
+	for (unsigned i = 0; i < 24; i++) {
+		if (!std::isfinite(variances[i]) || variances[i] < 0.0f) {
+			printf("invalid variance of state %u: %.6e\n", i, (double)variances[i]);
+			return 1;
+		}
+	}
+
+	if (num_updates == 0) {
+		printf("the filter did not run\n");
+		return 1;
+	}
+
+#if defined(ECL_EKF_STRUCTURED_COVARIANCE_PREDICTION)
+	const char *prediction = "structured";
+#else
+	const char *prediction = "generated";
+#endif
+
+	printf("%u filter updates (%s covariance prediction): %.2f us/update\n", num_updates, prediction,
+	       (double)update_time.count() / num_updates * 1e-3);
+
+	return 0;
+}
@@ -41,6 +41,7 @@
 
 #include <stdint.h>
 #include <cassert>
+#include <random>
 #include <EKF/RingBuffer.h>
 
 struct sample {
@@ -48,7 +49,8 @@ struct sample {
 	float data[3];
 };
 
-int main(int argc, char *argv[])
+template <typename Buffer>
+static void test_buffer()
 {
 	sample x;
 	x.time_us = 1000000;
@@ -64,7 +66,7 @@ int main(int argc, char *argv[])
 
 	// Test1: false buffer allocation
 	bool initialised = false;
-	RingBuffer<sample> buffer;
+	Buffer buffer;
 
 	//initialised = buffer.allocate(-1);
 	//assert(initialised == false);
@@ -116,5 +118,59 @@ int main(int argc, char *argv[])
 	assert(buffer.pop_first_older_than(z.time_us + 100, &pop) == true);
 	assert(pop.time_us == z.time_us);
 
+}
+
+// compare the static buffer against the heap buffer for random pushes, including samples out of time order
+static void test_static_equivalence()
+{
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<int> action(0, 9);
+	std::uniform_int_distribution<int> step_us(0, 40000);
+
+	RingBuffer<sample> reference;
+	StaticRingBuffer<sample, 20> buffer;
+
+	for (int length = 1; length <= 20; length++) {
+		bool initialised = reference.allocate(length);
+		initialised = buffer.allocate(length) && initialised;
+		assert(initialised);
+
+		uint64_t time_us = 1000000;
+
+		for (int i = 0; i < 2000; i++) {
+			const int a = action(generator);
+
+			if (a < 6) {
+				// mostly increasing time, occasionally going back
+				time_us = (a == 0) ? time_us - step_us(generator) : time_us + step_us(generator);
+				sample s = {time_us, {(float)i, 0.0f, 0.0f}};
+				reference.push(s);
+				buffer.push(s);
+
+			} else {
+				const uint64_t timestamp = time_us - step_us(generator) * 3;
+				sample expected = {};
+				sample popped = {};
+				const bool found = reference.pop_first_older_than(timestamp, &expected);
+				assert(buffer.pop_first_older_than(timestamp, &popped) == found);
+				assert(expected.time_us == popped.time_us && expected.data[0] == popped.data[0]);
+			}
+
+			assert(reference.get_oldest_index() == buffer.get_oldest_index());
+			assert(reference.get_newest().time_us == buffer.get_newest().time_us);
+		}
+	}
+
+	// sizes beyond the capacity are refused
+	assert(!buffer.allocate(21));
+	assert(!buffer.allocate(0));
+}
+
+int main(int argc, char *argv[])
+{
+	test_buffer<RingBuffer<sample>>();
+	test_buffer<StaticRingBuffer<sample, 10>>();
+	test_static_equivalence();
+
 	return 0;
 }
@@ -0,0 +1,336 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2018 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file sparse_fusion.cpp
+ *
+ * Checks that the fusion of a scalar observation with a sparse Jacobian (Ekf::fuseSparse()) gives the
+ * same covariance matrix and states as the dense fusion P = P - K * H * P for random symmetric positive
+ * definite covariance matrices, observations and innovations.
+ */
+
+#include <EKF/ekf.h>
+#include <EKF/sparse_fusion.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+class EkfSparseFusionTest
+{
+public:
+	/**
+	 * Set a random state and covariance matrix, fuse one observation with the sparse and with the
+	 * dense implementation from the same inputs and compare the results.
+	 * @param H non-zero elements of the observation Jacobian, random values are assigned
+	 * @param first_state first state which is corrected by the observation
+	 * @return number of covariance elements and states which differ by more than the tolerance
+	 */
+	template<typename Observation>
+	unsigned compare(Ekf &ekf, Observation &H, uint8_t first_state);
+
+private:
+	static constexpr unsigned n = 24;
+
+	/** deterministic uniform noise in [min, max] */
+	float random(float min, float max)
+	{
+		_random_state = _random_state * 1664525u + 1013904223u;
+		return min + (max - min) * (float)(_random_state >> 8) / (float)(1 << 24);
+	}
+
+	static void getStates(const Ekf &ekf, float (&x)[n]);
+
+	uint32_t _random_state{1};
+};
+
+void EkfSparseFusionTest::getStates(const Ekf &ekf, float (&x)[n])
+{
+	for (unsigned i = 0; i < 4; i++) {
+		x[i] = ekf._state.quat_nominal(i);
+	}
+
+	for (unsigned i = 0; i < 3; i++) {
+		x[i + 4] = ekf._state.vel(i);
+		x[i + 7] = ekf._state.pos(i);
+		x[i + 10] = ekf._state.gyro_bias(i);
+		x[i + 13] = ekf._state.accel_bias(i);
+		x[i + 16] = ekf._state.mag_I(i);
+		x[i + 19] = ekf._state.mag_B(i);
+	}
+
+	x[22] = ekf._state.wind_vel(0);
+	x[23] = ekf._state.wind_vel(1);
+}
+
+template<typename Observation>
+unsigned EkfSparseFusionTest::compare(Ekf &ekf, Observation &H, uint8_t first_state)
+{
+	Quatf q(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f));
+	q.normalize();
+	ekf._state.quat_nominal = q;
+
+	for (unsigned i = 0; i < 3; i++) {
+		ekf._state.vel(i) = random(-10.0f, 10.0f);
+		ekf._state.pos(i) = random(-100.0f, 100.0f);
+		ekf._state.gyro_bias(i) = random(-1e-4f, 1e-4f);
+		ekf._state.accel_bias(i) = random(-1e-3f, 1e-3f);
+		ekf._state.mag_I(i) = random(-0.5f, 0.5f);
+		ekf._state.mag_B(i) = random(-0.05f, 0.05f);
+	}
+
+	ekf._state.wind_vel(0) = random(-5.0f, 5.0f);
+	ekf._state.wind_vel(1) = random(-5.0f, 5.0f);
+
+	// correct every state, so that fixCovarianceErrors() does not zero the rows of inactive states
+	ekf._params.fusion_mode &= ~MASK_INHIBIT_ACC_BIAS;
+	ekf._accel_bias_inhibit = false;
+	ekf._control_status.flags.mag_3D = true;
+	ekf._control_status.flags.wind = true;
+
+	// symmetric positive definite covariance P = L * L^T, scaled to the typical uncertainty of each state
+	float sigma[n];
+
+	for (unsigned i = 0; i < n; i++) {
+		if (i < 4) {
+			sigma[i] = 0.05f;
+
+		} else if (i < 10) {
+			sigma[i] = 1.0f;
+
+		} else if (i < 13) {
+			sigma[i] = 1e-4f;
+
+		} else if (i < 16) {
+			sigma[i] = 1e-3f;
+
+		} else if (i < 22) {
+			sigma[i] = 0.02f;
+
+		} else {
+			sigma[i] = 1.0f;
+		}
+	}
+
+	float L[n][n] = {};
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col <= row; col++) {
+			L[row][col] = sigma[row] * random(-1.0f, 1.0f);
+		}
+	}
+
+	float P_prior[n][n];
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			float value = 0.0f;
+
+			for (unsigned k = 0; k < n; k++) {
+				value += L[row][k] * L[col][k];
+			}
+
+			P_prior[row][col] = value;
+		}
+	}
+
+	// dense observation Jacobian
+	float H_dense[n] = {};
+
+	for (unsigned i = 0; i < Observation::size; i++) {
+		H.value[i] = random(-2.0f, 2.0f);
+		H_dense[Observation::index[i]] = H.value[i];
+	}
+
+	stateSample state_prior = ekf._state;
+
+	// innovation variance H * P * H^T + R
+	float HPHt = 0.0f;
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			HPHt += H_dense[row] * P_prior[row][col] * H_dense[col];
+		}
+	}
+
+	memcpy(ekf.P, P_prior, sizeof(P_prior));
+	unsigned num_errors = 0;
+
+	const float sparse_HPHt = ekf.sparseInnovationVariance(H);
+
+	if (fabsf(sparse_HPHt - HPHt) > 1e-5f * HPHt) {
+		printf("innovation variance: sparse %.9e dense %.9e\n", (double)sparse_HPHt, (double)HPHt);
+		num_errors++;
+	}
+
+	const float innov_var = HPHt + random(0.01f, 1.0f);
+	const float innovation = random(-1.0f, 1.0f) * sqrtf(innov_var);
+
+	const bool sparse_healthy = ekf.fuseSparse(H, innov_var, innovation, first_state);
+	float P_sparse[n][n];
+	memcpy(P_sparse, ekf.P, sizeof(P_sparse));
+	float x_sparse[n];
+	getStates(ekf, x_sparse);
+
+	// dense fusion, as done by the generated code: K = P * H^T / innov_var, P = P - K * (H * P)
+	memcpy(ekf.P, P_prior, sizeof(P_prior));
+	ekf._state = state_prior;
+
+	float Kfusion[n] = {};
+
+	for (unsigned row = first_state; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			Kfusion[row] += P_prior[row][col] * H_dense[col];
+		}
+
+		Kfusion[row] /= innov_var;
+	}
+
+	float KHP[n][n];
+	bool dense_healthy = true;
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			float HP = 0.0f;
+
+			for (unsigned k = 0; k < n; k++) {
+				HP += H_dense[k] * P_prior[k][col];
+			}
+
+			KHP[row][col] = Kfusion[row] * HP;
+		}
+
+		if (P_prior[row][row] < KHP[row][row]) {
+			dense_healthy = false;
+		}
+	}
+
+	if (!sparse_healthy || !dense_healthy) {
+		printf("covariance unhealthy: sparse %d dense %d\n", sparse_healthy, dense_healthy);
+		return num_errors + 1;
+	}
+
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			ekf.P[row][col] -= KHP[row][col];
+		}
+	}
+
+	ekf.fixCovarianceErrors();
+	ekf.fuse(Kfusion, innovation);
+
+	float x_dense[n];
+	getStates(ekf, x_dense);
+
+	// both sum the same products in a different order, so compare relative to the size of the prior variances
+	for (unsigned row = 0; row < n; row++) {
+		for (unsigned col = 0; col < n; col++) {
+			const float expected = ekf.P[row][col];
+			const float actual = P_sparse[row][col];
+			const float tolerance = 1e-5f * sqrtf(P_prior[row][row] * P_prior[col][col]);
+
+			if (!std::isfinite(actual) || fabsf(actual - expected) > tolerance) {
+				if (num_errors < 10) {
+					printf("P[%u][%u]: sparse %.9e dense %.9e\n", row, col,
+					       (double)actual, (double)expected);
+				}
+
+				num_errors++;
+			}
+		}
+
+		const float tolerance = 1e-5f * (fabsf(x_dense[row]) + sqrtf(P_prior[row][row]));
+
+		if (!std::isfinite(x_sparse[row]) || fabsf(x_sparse[row] - x_dense[row]) > tolerance) {
+			if (num_errors < 10) {
+				printf("state %u: sparse %.9e dense %.9e\n", row,
+				       (double)x_sparse[row], (double)x_dense[row]);
+			}
+
+			num_errors++;
+		}
+	}
+
+	return num_errors;
+}
+
+int main(int argc, char *argv[])
+{
+	Ekf *ekf = new Ekf();
+	EkfSparseFusionTest test;
+
+	// the observations fused with fuseSparse(): true airspeed, optionally only correcting the wind states,
+	// and the velocity and position components
+	SparseObservation<4, 5, 6, 22, 23> H_TAS;
+	SparseObservation<5> H_vel;
+	SparseObservation<9> H_pos;
+
+	for (unsigned i = 0; i < 2000; i++) {
+		unsigned num_errors = 0;
+		const char *observation = nullptr;
+
+		switch (i % 4) {
+		case 0:
+			observation = "airspeed";
+			num_errors = test.compare(*ekf, H_TAS, 0);
+			break;
+
+		case 1:
+			observation = "airspeed, wind states only";
+			num_errors = test.compare(*ekf, H_TAS, 22);
+			break;
+
+		case 2:
+			observation = "velocity";
+			num_errors = test.compare(*ekf, H_vel, 0);
+			break;
+
+		default:
+			observation = "position";
+			num_errors = test.compare(*ekf, H_pos, 0);
+			break;
+		}
+
+		if (num_errors > 0) {
+			printf("sparse fusion differs from the dense fusion in %u elements (case %u, %s)\n",
+			       num_errors, i, observation);
+			delete ekf;
+			return 1;
+		}
+	}
+
+	delete ekf;
+	printf("sparse fusion matches the dense fusion\n");
+
+	return 0;
+}
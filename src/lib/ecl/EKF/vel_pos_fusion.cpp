@@ -42,6 +42,7 @@
  */
 
 #include "ekf.h"
+#include "sparse_fusion.h"
 #include <ecl.h>
 #include <mathlib/mathlib.h>
 
@@ -51,7 +52,6 @@ void Ekf::fuseVelPosHeight()
 	bool innov_check_pass_map[6] = {}; // true when innovations consistency checks pass for [VN,VE,VD,PN,PE,PD] observations
 	float R[6] = {}; // observation variances for [VN,VE,VD,PN,PE,PD]
 	float gate_size[6] = {}; // innovation consistency check gate sizes for [VN,VE,VD,PN,PE,PD] observations
-	float Kfusion[24] = {}; // Kalman gain vector for any single observation - sequential fusion is used
 	float innovation[6]; // local copy of innovations for  [VN,VE,VD,PN,PE,PD]
 	memcpy(innovation, _vel_pos_innov, sizeof(_vel_pos_innov));
 
@@ -227,92 +227,41 @@ void Ekf::fuseVelPosHeight()
 			continue;
 		}
 
-		unsigned state_index = obs_index + 4;	// we start with vx and this is the 4. state
-
-		// calculate kalman gain K = PHS, where S = 1/innovation variance
-		for (int row = 0; row < _k_num_states; row++) {
-			Kfusion[row] = P[row][state_index] / _vel_pos_innov_var[obs_index];
-		}
-
-		// update covarinace matrix via Pnew = (I - KH)P
-		float KHP[_k_num_states][_k_num_states];
-
-		for (unsigned row = 0; row < _k_num_states; row++) {
-			for (unsigned column = 0; column < _k_num_states; column++) {
-				KHP[row][column] = Kfusion[row] * P[state_index][column];
-			}
-		}
-
-		// if the covariance correction will result in a negative variance, then
-		// the covariance marix is unhealthy and must be corrected
-		bool healthy = true;
-
-		for (int i = 0; i < _k_num_states; i++) {
-			if (P[i][i] < KHP[i][i]) {
-				// zero rows and columns
-				zeroRows(P, i, i);
-				zeroCols(P, i, i);
-
-				//flag as unhealthy
-				healthy = false;
-
-				// update individual measurement health status
-				if (obs_index == 0) {
-					_fault_status.flags.bad_vel_N = true;
-
-				} else if (obs_index == 1) {
-					_fault_status.flags.bad_vel_E = true;
-
-				} else if (obs_index == 2) {
-					_fault_status.flags.bad_vel_D = true;
-
-				} else if (obs_index == 3) {
-					_fault_status.flags.bad_pos_N = true;
-
-				} else if (obs_index == 4) {
-					_fault_status.flags.bad_pos_E = true;
-
-				} else if (obs_index == 5) {
-					_fault_status.flags.bad_pos_D = true;
-				}
-
-			} else {
-				// update individual measurement health status
-				if (obs_index == 0) {
-					_fault_status.flags.bad_vel_N = false;
-
-				} else if (obs_index == 1) {
-					_fault_status.flags.bad_vel_E = false;
-
-				} else if (obs_index == 2) {
-					_fault_status.flags.bad_vel_D = false;
-
-				} else if (obs_index == 3) {
-					_fault_status.flags.bad_pos_N = false;
-
-				} else if (obs_index == 4) {
-					_fault_status.flags.bad_pos_E = false;
-
-				} else if (obs_index == 5) {
-					_fault_status.flags.bad_pos_D = false;
-				}
-			}
-		}
-
-		// only apply covariance and state corrrections if healthy
-		if (healthy) {
-			// apply the covariance corrections
-			for (unsigned row = 0; row < _k_num_states; row++) {
-				for (unsigned column = 0; column < _k_num_states; column++) {
-					P[row][column] = P[row][column] - KHP[row][column];
-				}
-			}
-
-			// correct the covariance marix for gross errors
-			fixCovarianceErrors();
-
-			// apply the state corrections
-			fuse(Kfusion, innovation[obs_index]);
+		// the observation Jacobian is one for the observed state, we start with vx and this is the 4. state
+		const float innov_var = _vel_pos_innov_var[obs_index];
+		const float innov = innovation[obs_index];
+		bool healthy = false;
+
+		switch (obs_index) {
+		case 0:
+			healthy = fuseSparse(SparseObservation<4> {{1.0f}}, innov_var, innov);
+			_fault_status.flags.bad_vel_N = !healthy;
+			break;
+
+		case 1:
+			healthy = fuseSparse(SparseObservation<5> {{1.0f}}, innov_var, innov);
+			_fault_status.flags.bad_vel_E = !healthy;
+			break;
+
+		case 2:
+			healthy = fuseSparse(SparseObservation<6> {{1.0f}}, innov_var, innov);
+			_fault_status.flags.bad_vel_D = !healthy;
+			break;
+
+		case 3:
+			healthy = fuseSparse(SparseObservation<7> {{1.0f}}, innov_var, innov);
+			_fault_status.flags.bad_pos_N = !healthy;
+			break;
+
+		case 4:
+			healthy = fuseSparse(SparseObservation<8> {{1.0f}}, innov_var, innov);
+			_fault_status.flags.bad_pos_E = !healthy;
+			break;
+
+		case 5:
+			healthy = fuseSparse(SparseObservation<9> {{1.0f}}, innov_var, innov);
+			_fault_status.flags.bad_pos_D = !healthy;
+			break;
 		}
 	}
 }
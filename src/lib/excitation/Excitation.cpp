@@ -0,0 +1,311 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file Excitation.cpp
+ */
+
+#include "Excitation.hpp"
+
+#include <errno.h>
+#include <math.h>
+#include <px4_defines.h>
+
+namespace excitation
+{
+
+static constexpr int SINE_TABLE_BITS = 8;
+static constexpr int SINE_TABLE_SIZE = 1 << SINE_TABLE_BITS;
+static constexpr int SINE_FRACTION_BITS = 32 - SINE_TABLE_BITS;
+
+// exponential chirp shape: f(t) = f_min + C1 * (f_max - f_min) * (exp(C2 * t / T) - 1)
+static constexpr float EXP_CHIRP_C1 = 0.0187f;
+static constexpr float EXP_CHIRP_C2 = 4.f;
+
+/** the exponential chirp growth is recomputed every this many samples to bound the rounding error */
+static constexpr uint32_t EXP_CHIRP_RESYNC = 32;
+
+static constexpr float PHASE_SCALE = 4294967296.f; ///< 2^32, a full period of the phase accumulator
+
+/** one period of sin(), plus the first value repeated for the interpolation */
+static const float sine_table[SINE_TABLE_SIZE + 1] = {
+	0.f, 0.02454123f, 0.04906767f, 0.07356456f, 0.09801714f, 0.12241068f, 0.14673047f, 0.17096189f,
+	0.19509032f, 0.21910124f, 0.24298018f, 0.26671276f, 0.29028468f, 0.31368174f, 0.33688985f, 0.35989504f,
+	0.38268343f, 0.40524131f, 0.42755509f, 0.44961133f, 0.47139674f, 0.49289819f, 0.51410274f, 0.53499762f,
+	0.55557023f, 0.57580819f, 0.59569930f, 0.61523159f, 0.63439328f, 0.65317284f, 0.67155895f, 0.68954054f,
+	0.70710678f, 0.72424708f, 0.74095113f, 0.75720885f, 0.77301045f, 0.78834643f, 0.80320753f, 0.81758481f,
+	0.83146961f, 0.84485357f, 0.85772861f, 0.87008699f, 0.88192126f, 0.89322430f, 0.90398929f, 0.91420976f,
+	0.92387953f, 0.93299280f, 0.94154407f, 0.94952818f, 0.95694034f, 0.96377607f, 0.97003125f, 0.97570213f,
+	0.98078528f, 0.98527764f, 0.98917651f, 0.99247953f, 0.99518473f, 0.99729046f, 0.99879546f, 0.99969882f,
+	1.00000000f, 0.99969882f, 0.99879546f, 0.99729046f, 0.99518473f, 0.99247953f, 0.98917651f, 0.98527764f,
+	0.98078528f, 0.97570213f, 0.97003125f, 0.96377607f, 0.95694034f, 0.94952818f, 0.94154407f, 0.93299280f,
+	0.92387953f, 0.91420976f, 0.90398929f, 0.89322430f, 0.88192126f, 0.87008699f, 0.85772861f, 0.84485357f,
+	0.83146961f, 0.81758481f, 0.80320753f, 0.78834643f, 0.77301045f, 0.75720885f, 0.74095113f, 0.72424708f,
+	0.70710678f, 0.68954054f, 0.67155895f, 0.65317284f, 0.63439328f, 0.61523159f, 0.59569930f, 0.57580819f,
+	0.55557023f, 0.53499762f, 0.51410274f, 0.49289819f, 0.47139674f, 0.44961133f, 0.42755509f, 0.40524131f,
+	0.38268343f, 0.35989504f, 0.33688985f, 0.31368174f, 0.29028468f, 0.26671276f, 0.24298018f, 0.21910124f,
+	0.19509032f, 0.17096189f, 0.14673047f, 0.12241068f, 0.09801714f, 0.07356456f, 0.04906767f, 0.02454123f,
+	0.f, -0.02454123f, -0.04906767f, -0.07356456f, -0.09801714f, -0.12241068f, -0.14673047f, -0.17096189f,
+	-0.19509032f, -0.21910124f, -0.24298018f, -0.26671276f, -0.29028468f, -0.31368174f, -0.33688985f, -0.35989504f,
+	-0.38268343f, -0.40524131f, -0.42755509f, -0.44961133f, -0.47139674f, -0.49289819f, -0.51410274f, -0.53499762f,
+	-0.55557023f, -0.57580819f, -0.59569930f, -0.61523159f, -0.63439328f, -0.65317284f, -0.67155895f, -0.68954054f,
+	-0.70710678f, -0.72424708f, -0.74095113f, -0.75720885f, -0.77301045f, -0.78834643f, -0.80320753f, -0.81758481f,
+	-0.83146961f, -0.84485357f, -0.85772861f, -0.87008699f, -0.88192126f, -0.89322430f, -0.90398929f, -0.91420976f,
+	-0.92387953f, -0.93299280f, -0.94154407f, -0.94952818f, -0.95694034f, -0.96377607f, -0.97003125f, -0.97570213f,
+	-0.98078528f, -0.98527764f, -0.98917651f, -0.99247953f, -0.99518473f, -0.99729046f, -0.99879546f, -0.99969882f,
+	-1.00000000f, -0.99969882f, -0.99879546f, -0.99729046f, -0.99518473f, -0.99247953f, -0.98917651f, -0.98527764f,
+	-0.98078528f, -0.97570213f, -0.97003125f, -0.96377607f, -0.95694034f, -0.94952818f, -0.94154407f, -0.93299280f,
+	-0.92387953f, -0.91420976f, -0.90398929f, -0.89322430f, -0.88192126f, -0.87008699f, -0.85772861f, -0.84485357f,
+	-0.83146961f, -0.81758481f, -0.80320753f, -0.78834643f, -0.77301045f, -0.75720885f, -0.74095113f, -0.72424708f,
+	-0.70710678f, -0.68954054f, -0.67155895f, -0.65317284f, -0.63439328f, -0.61523159f, -0.59569930f, -0.57580819f,
+	-0.55557023f, -0.53499762f, -0.51410274f, -0.49289819f, -0.47139674f, -0.44961133f, -0.42755509f, -0.40524131f,
+	-0.38268343f, -0.35989504f, -0.33688985f, -0.31368174f, -0.29028468f, -0.26671276f, -0.24298018f, -0.21910124f,
+	-0.19509032f, -0.17096189f, -0.14673047f, -0.12241068f, -0.09801714f, -0.07356456f, -0.04906767f, -0.02454123f,
+	0.f,
+};
+
+float Generator::sine(uint32_t phase)
+{
+	const uint32_t index = phase >> SINE_FRACTION_BITS;
+	const float fraction = (float)(phase & ((1u << SINE_FRACTION_BITS) - 1)) * (1.f / (1u << SINE_FRACTION_BITS));
+	return sine_table[index] + fraction * (sine_table[index + 1] - sine_table[index]);
+}
+
+int Generator::configure(const Config &config)
+{
+	_config = config;
+	_valid = false;
+	_num_samples = 0;
+	_num_sines = 0;
+
+	if (!(config.sample_rate > 0.f) || !PX4_ISFINITE(config.amplitude) || config.type < Type::Sine
+	    || config.type >= Type::Count) {
+		return -EINVAL;
+	}
+
+	const float fs = config.sample_rate;
+	const float f_limit = MAX_FREQUENCY_RATIO * fs;
+	const float f_min = fminf(config.f_min, f_limit);
+	const float f_max = fminf(config.f_max, f_limit);
+
+	_hz_to_increment = PHASE_SCALE / fs;
+
+	if (config.duration > 0.f) {
+		_num_samples = (uint32_t)(config.duration * fs + 0.5f);
+	}
+
+	switch (config.type) {
+	case Type::Sine:
+		if (!(f_min > 0.f)) {
+			return -EINVAL;
+		}
+
+		_increment = phase_increment(f_min);
+		break;
+
+	case Type::LinearChirp:
+	case Type::ExponentialChirp: {
+			if (!(f_min > 0.f) || !(f_max >= f_min) || _num_samples == 0) {
+				return -EINVAL;
+			}
+
+			const float increment_min = phase_increment(f_min);
+			const float increment_max = phase_increment(f_max);
+
+			_increment_step = (increment_max - increment_min) / (float)_num_samples;
+
+			_increment_scale = EXP_CHIRP_C1 * (increment_max - increment_min);
+			_increment_offset = increment_min - _increment_scale;
+			_growth_exponent = EXP_CHIRP_C2 / (float)_num_samples;
+			_growth = expf(_growth_exponent);
+
+			if (config.type == Type::LinearChirp) {
+				_increment_offset = increment_min;
+			}
+
+			_increment = increment_min;
+		}
+		break;
+
+	case Type::Multisine: {
+			if (!(f_min > 0.f) || !(f_max >= f_min)) {
+				return -EINVAL;
+			}
+
+			// log-spaced frequencies. With a finite duration, they are snapped to an integer
+			// number of periods so that the signal is periodic over the experiment.
+			const float ratio = (f_max > f_min) ? powf(f_max / f_min, 1.f / (MAX_SINES - 1)) : 1.f;
+			float frequency = f_min;
+			float last_frequency = 0.f;
+
+			for (int i = 0; i < MAX_SINES; ++i, frequency *= ratio) {
+				float f = frequency;
+
+				if (config.duration > 0.f) {
+					f = fmaxf(roundf(f * config.duration), 1.f) / config.duration;
+				}
+
+				if (f <= last_frequency || f > f_limit) {
+					continue;
+				}
+
+				_sine_increment[_num_sines++] = (uint32_t)phase_increment(f);
+				last_frequency = f;
+			}
+
+			if (_num_sines == 0) {
+				return -EINVAL;
+			}
+
+			_sine_amplitude = config.amplitude / sqrtf((float)_num_sines);
+		}
+		break;
+
+	case Type::Doublet:
+	case Type::Sequence3211:
+		_pulse_samples = (uint32_t)(config.pulse_width * fs + 0.5f);
+
+		if (_pulse_samples == 0) {
+			return -EINVAL;
+		}
+
+		_num_samples = _pulse_samples * (config.type == Type::Doublet ? 2 : 7);
+		break;
+
+	case Type::Count:
+		return -EINVAL;
+	}
+
+	_valid = true;
+	reset();
+	return 0;
+}
+
+void Generator::reset()
+{
+	_sample = 0;
+	_phase = 0;
+	_growth_state = 1.f;
+
+	for (int i = 0; i < _num_sines; ++i) {
+		// Schroeder phases keep the crest factor of the sum low
+		float phase = -(float)(i * (i + 1)) / (2.f * _num_sines);
+		phase -= floorf(phase);
+		_sine_phase[i] = (uint32_t)(int64_t)(phase * PHASE_SCALE);
+	}
+}
+
+float Generator::next()
+{
+	if (!_valid || finished()) {
+		return 0.f;
+	}
+
+	float out = 0.f;
+
+	switch (_config.type) {
+	case Type::LinearChirp:
+		_increment = _increment_offset + _increment_step * (float)_sample;
+
+	// FALLTHROUGH
+	case Type::Sine:
+		out = _config.amplitude * sine(_phase);
+		_phase += (uint32_t)_increment;
+		break;
+
+	case Type::ExponentialChirp:
+		if (_sample % EXP_CHIRP_RESYNC == 0) {
+			_growth_state = expf(_growth_exponent * (float)_sample);
+		}
+
+		_increment = _increment_offset + _increment_scale * _growth_state;
+		_growth_state *= _growth;
+
+		out = _config.amplitude * sine(_phase);
+		_phase += (uint32_t)_increment;
+		break;
+
+	case Type::Multisine:
+		for (int i = 0; i < _num_sines; ++i) {
+			out += sine(_sine_phase[i]);
+			_sine_phase[i] += _sine_increment[i];
+		}
+
+		out *= _sine_amplitude;
+		break;
+
+	case Type::Doublet:
+		out = (_sample < _pulse_samples) ? _config.amplitude : -_config.amplitude;
+		break;
+
+	case Type::Sequence3211: {
+			const uint32_t pulse = _sample / _pulse_samples;
+			// pulse index 0..6: + + + - - + -
+			out = (pulse < 3 || pulse == 5) ? _config.amplitude : -_config.amplitude;
+		}
+		break;
+
+	case Type::Count:
+		break;
+	}
+
+	++_sample;
+	return out;
+}
+
+void Generator::generate(float *out, int num_samples)
+{
+	for (int i = 0; i < num_samples; ++i) {
+		out[i] = next();
+	}
+}
+
+float Generator::frequency() const
+{
+	if (!_valid) {
+		return 0.f;
+	}
+
+	switch (_config.type) {
+	case Type::Sine:
+	case Type::LinearChirp:
+	case Type::ExponentialChirp:
+		return _increment / _hz_to_increment;
+
+	default:
+		return 0.f;
+	}
+}
+
+} // namespace excitation
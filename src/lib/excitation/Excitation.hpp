@@ -0,0 +1,146 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file Excitation.hpp
+ *
+ * Excitation signals for system identification experiments: sine, linear and
+ * exponential chirp, multisine, doublet and 3-2-1-1.
+ *
+ * The signals are generated for a fixed sample rate. The instantaneous
+ * frequency is updated by a recurrence and the phase is kept in a 32 bit
+ * accumulator (wrapping at 2pi), so a sample costs a few multiply-adds and a
+ * sine table lookup instead of a powf()/sinf() evaluation of the absolute time.
+ * Since the phase never grows, there is also no loss of precision for long
+ * sweeps.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace excitation
+{
+
+enum class Type : int32_t {
+	Sine = 0,		///< constant frequency at f_min
+	LinearChirp,		///< frequency increases linearly from f_min to f_max
+	ExponentialChirp,	///< frequency increases exponentially from f_min to f_max (more time at low frequencies)
+	Multisine,		///< sum of MAX_SINES log-spaced sines in [f_min, f_max], Schroeder phases
+	Doublet,		///< +amplitude, -amplitude, one pulse width each
+	Sequence3211,		///< +, -, +, - pulses of 3, 2, 1, 1 pulse widths
+
+	Count
+};
+
+struct Config {
+	Type type{Type::Sine};
+	float amplitude{0.f};
+	float f_min{1.f};		///< [Hz]
+	float f_max{10.f};		///< [Hz]
+	float duration{10.f};		///< [s] chirp/multisine length, 0 for unlimited sine and multisine
+	float pulse_width{0.5f};	///< [s] doublet/3-2-1-1 base pulse width
+	float sample_rate{250.f};	///< [Hz]
+};
+
+class Generator
+{
+public:
+	static constexpr int MAX_SINES = 8;
+
+	/** frequencies are limited to this fraction of the sample rate to avoid aliasing */
+	static constexpr float MAX_FREQUENCY_RATIO = 0.4f;
+
+	Generator() = default;
+	~Generator() = default;
+
+	/**
+	 * Set up a signal and reset it to the start. Not real-time critical (uses expf/powf).
+	 * Frequencies above MAX_FREQUENCY_RATIO * sample_rate are clamped.
+	 * @return 0 on success, -EINVAL on invalid configuration (the generator then outputs 0)
+	 */
+	int configure(const Config &config);
+
+	/** restart the signal */
+	void reset();
+
+	/** get the next sample */
+	float next();
+
+	/** precompute a block of samples */
+	void generate(float *out, int num_samples);
+
+	/** true once the configured duration has elapsed, the output is then 0 */
+	bool finished() const { return _num_samples > 0 && _sample >= _num_samples; }
+
+	/** instantaneous frequency of a chirp or sine [Hz] */
+	float frequency() const;
+
+	const Config &config() const { return _config; }
+
+private:
+	static float sine(uint32_t phase);
+
+	/** convert a frequency to a phase increment per sample */
+	float phase_increment(float frequency) const { return frequency * _hz_to_increment; }
+
+	Config _config{};
+	bool _valid{false};
+
+	uint32_t _sample{0};
+	uint32_t _num_samples{0};	///< 0: unlimited
+
+	float _hz_to_increment{0.f};
+
+	// sine / chirps
+	uint32_t _phase{0};
+	float _increment{0.f};		///< current phase increment
+	float _increment_offset{0.f};	///< exponential chirp: increment = offset + scale * growth^n
+	float _increment_scale{0.f};
+	float _growth{1.f};		///< exponential chirp: per sample growth factor
+	float _growth_exponent{0.f};	///< log(_growth)
+	float _growth_state{1.f};
+	float _increment_step{0.f};	///< linear chirp: per sample increment change
+
+	// multisine
+	int _num_sines{0};
+	uint32_t _sine_phase[MAX_SINES] {};
+	uint32_t _sine_increment[MAX_SINES] {};
+	float _sine_amplitude{0.f};
+
+	// pulse sequences
+	uint32_t _pulse_samples{0};
+};
+
+} // namespace excitation
@@ -0,0 +1,207 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file FrequencyResponse.cpp
+ */
+
+#include "FrequencyResponse.hpp"
+
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <px4_defines.h>
+
+namespace frequency_response
+{
+
+int Estimator::configure(const Config &config)
+{
+	_num_bins = 0;
+
+	if (!PX4_ISFINITE(config.sample_rate) || config.sample_rate <= 0.f
+	    || config.num_bins < 1 || config.num_bins > MAX_BINS
+	    || !(config.cycles >= 1.f) || !(config.forgetting > 0.f && config.forgetting <= 1.f)) {
+		return -EINVAL;
+	}
+
+	const float f_limit = MAX_FREQUENCY_RATIO * config.sample_rate;
+	const float f_min = fminf(config.f_min, f_limit);
+	const float f_max = fminf(config.f_max, f_limit);
+
+	if (!(f_min > 0.f) || !(f_max >= f_min)) {
+		return -EINVAL;
+	}
+
+	_config = config;
+
+	const float ratio = config.num_bins > 1 ? powf(f_max / f_min, 1.f / (config.num_bins - 1)) : 1.f;
+	float frequency = f_min;
+
+	for (int i = 0; i < config.num_bins; i++) {
+		Bin &bin = _bins[i];
+
+		// integer number of periods per block, so the block DFT has no leakage at the bin frequency
+		float block_length = roundf(config.cycles * config.sample_rate / frequency);
+
+		if (block_length > UINT16_MAX) {
+			block_length = UINT16_MAX;
+		}
+
+		bin.block_length = (uint16_t)block_length;
+		bin.frequency = config.cycles * config.sample_rate / block_length;
+
+		const float w = 2.f * M_PI_F * bin.frequency / config.sample_rate;
+		bin.step_re = cosf(w);
+		bin.step_im = -sinf(w);
+
+		const float w_window = 2.f * M_PI_F / block_length;
+		bin.window_step_re = cosf(w_window);
+		bin.window_step_im = sinf(w_window);
+
+		frequency *= ratio;
+	}
+
+	_num_bins = config.num_bins;
+	reset();
+
+	return 0;
+}
+
+void Estimator::reset()
+{
+	for (int i = 0; i < _num_bins; i++) {
+		Bin &bin = _bins[i];
+		bin.s_uu = 0.f;
+		bin.s_yy = 0.f;
+		bin.s_uy_re = 0.f;
+		bin.s_uy_im = 0.f;
+		bin.weight = 0.f;
+		bin.blocks = 0;
+		reset_block(bin);
+	}
+}
+
+void Estimator::reset_block(Bin &bin)
+{
+	// the phasor is restarted at each block: the cross spectrum only depends on the relative phase
+	// of input and output, and this bounds the rounding error of the phasor recurrence
+	bin.phasor_re = 1.f;
+	bin.phasor_im = 0.f;
+	bin.window_re = 1.f;
+	bin.window_im = 0.f;
+	bin.u_re = 0.f;
+	bin.u_im = 0.f;
+	bin.y_re = 0.f;
+	bin.y_im = 0.f;
+	bin.sample = 0;
+}
+
+void Estimator::update(float input, float output)
+{
+	if (!PX4_ISFINITE(input) || !PX4_ISFINITE(output)) {
+		return;
+	}
+
+	for (int i = 0; i < _num_bins; i++) {
+		Bin &bin = _bins[i];
+
+		const float window = 0.5f - 0.5f * bin.window_re;
+		bin.u_re += window * input * bin.phasor_re;
+		bin.u_im += window * input * bin.phasor_im;
+		bin.y_re += window * output * bin.phasor_re;
+		bin.y_im += window * output * bin.phasor_im;
+
+		const float re = bin.phasor_re * bin.step_re - bin.phasor_im * bin.step_im;
+		bin.phasor_im = bin.phasor_re * bin.step_im + bin.phasor_im * bin.step_re;
+		bin.phasor_re = re;
+
+		const float window_re = bin.window_re * bin.window_step_re - bin.window_im * bin.window_step_im;
+		bin.window_im = bin.window_re * bin.window_step_im + bin.window_im * bin.window_step_re;
+		bin.window_re = window_re;
+
+		if (++bin.sample >= bin.block_length) {
+			// normalize to the amplitude of the sinusoid at the bin frequency (the Hann window sums to block_length / 2)
+			const float scale = 4.f / bin.block_length;
+			const float u_re = bin.u_re * scale;
+			const float u_im = bin.u_im * scale;
+			const float y_re = bin.y_re * scale;
+			const float y_im = bin.y_im * scale;
+
+			const float forgetting = _config.forgetting;
+			bin.s_uu = forgetting * bin.s_uu + u_re * u_re + u_im * u_im;
+			bin.s_yy = forgetting * bin.s_yy + y_re * y_re + y_im * y_im;
+			// conj(U) * Y
+			bin.s_uy_re = forgetting * bin.s_uy_re + u_re * y_re + u_im * y_im;
+			bin.s_uy_im = forgetting * bin.s_uy_im + u_re * y_im - u_im * y_re;
+			bin.weight = forgetting * bin.weight + 1.f;
+
+			if (bin.blocks < UINT16_MAX) {
+				bin.blocks++;
+			}
+
+			reset_block(bin);
+		}
+	}
+}
+
+bool Estimator::get(int bin_index, Result &result) const
+{
+	if (bin_index < 0 || bin_index >= _num_bins) {
+		return false;
+	}
+
+	const Bin &bin = _bins[bin_index];
+	result.frequency = bin.frequency;
+	result.blocks = bin.blocks;
+
+	if (bin.blocks == 0) {
+		result.gain = 0.f;
+		result.phase = 0.f;
+		result.coherence = 0.f;
+		result.input_power = 0.f;
+		return false;
+	}
+
+	const float cross_sq = bin.s_uy_re * bin.s_uy_re + bin.s_uy_im * bin.s_uy_im;
+
+	result.gain = bin.s_uu > FLT_EPSILON ? sqrtf(cross_sq) / bin.s_uu : 0.f;
+	result.phase = atan2f(bin.s_uy_im, bin.s_uy_re);
+	result.coherence = (bin.s_uu > FLT_EPSILON && bin.s_yy > FLT_EPSILON) ? cross_sq / (bin.s_uu * bin.s_yy) : 0.f;
+	result.input_power = bin.s_uu / bin.weight;
+
+	return true;
+}
+
+} // namespace frequency_response
@@ -0,0 +1,146 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file FrequencyResponse.hpp
+ *
+ * Streaming frequency response estimator for system identification experiments.
+ *
+ * A bank of single bin DFTs (Goertzel style demodulation with a rotating
+ * phasor) runs on the excitation input and the measured output. Each bin
+ * integrates over a Hann windowed block of an integer number of periods of
+ * its frequency and, at the end of each block, accumulates the auto and cross
+ * spectra (Welch averaging). The window keeps the leakage from the other
+ * frequencies of a sweep low. From these the transfer function estimate
+ * H = S_uy / S_uu and the magnitude squared coherence
+ * |S_uy|^2 / (S_uu * S_yy) are computed.
+ *
+ * An update costs a few multiply-adds per bin and needs no buffering, so it
+ * can run inside the control loop at the full rate.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace frequency_response
+{
+
+struct Config {
+	float f_min{1.f};		///< [Hz] lowest bin frequency
+	float f_max{10.f};		///< [Hz] highest bin frequency
+	int num_bins{16};		///< log-spaced bins in [f_min, f_max], 1 for a single bin at f_min
+	float cycles{8.f};		///< DFT block length in periods of the bin frequency
+	float forgetting{1.f};		///< spectra are scaled by this at each block, 1 to average over the whole experiment
+	float sample_rate{250.f};	///< [Hz]
+};
+
+struct Result {
+	float frequency;	///< [Hz]
+	float gain;		///< |H|, output per unit input
+	float phase;		///< [rad] in [-pi, pi]
+	float coherence;	///< magnitude squared coherence, 0..1
+	float input_power;	///< averaged input auto spectrum (per block), indicates how well the bin was excited
+	uint16_t blocks;	///< number of completed DFT blocks
+};
+
+class Estimator
+{
+public:
+	static constexpr int MAX_BINS = 16;
+
+	/** bin frequencies are limited to this fraction of the sample rate */
+	static constexpr float MAX_FREQUENCY_RATIO = 0.4f;
+
+	Estimator() = default;
+	~Estimator() = default;
+
+	/**
+	 * Set up the bins and reset the estimate. Not real-time critical.
+	 * The bin frequencies are adjusted so that a block contains an integer number of samples.
+	 * @return 0 on success, -EINVAL on invalid configuration (update() is then a no-op)
+	 */
+	int configure(const Config &config);
+
+	/** clear the accumulated spectra */
+	void reset();
+
+	/**
+	 * Add a sample.
+	 * @param input excitation signal
+	 * @param output measured response
+	 */
+	void update(float input, float output);
+
+	int num_bins() const { return _num_bins; }
+
+	/**
+	 * Get the current estimate of a bin.
+	 * @return false if the bin does not exist or has no completed block yet (the frequency is set for any existing bin)
+	 */
+	bool get(int bin, Result &result) const;
+
+private:
+	struct Bin {
+		float frequency;
+		float step_re;		///< phasor rotation per sample, e^(-j*w)
+		float step_im;
+		float phasor_re;	///< current phasor, e^(-j*w*n)
+		float phasor_im;
+		float window_step_re;	///< Hann window phasor, one rotation per block
+		float window_step_im;
+		float window_re;
+		float window_im;
+		float u_re;		///< DFT of the current block
+		float u_im;
+		float y_re;
+		float y_im;
+		float s_uu;		///< averaged spectra
+		float s_yy;
+		float s_uy_re;
+		float s_uy_im;
+		float weight;		///< sum of the forgetting factor weights, to normalize input_power
+		uint16_t block_length;
+		uint16_t sample;
+		uint16_t blocks;
+	};
+
+	void reset_block(Bin &bin);
+
+	Config _config{};
+	Bin _bins[MAX_BINS] {};
+	int _num_bins{0};
+};
+
+} // namespace frequency_response
@@ -0,0 +1,272 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file lz4.cpp
+ *
+ * LZ4 block format, see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+ */
+
+#include "lz4.h"
+
+#include <string.h>
+
+namespace lz4
+{
+
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5; ///< the last 5 bytes of a block are always literals
+static constexpr size_t MF_LIMIT = 12; ///< the last match must start at least 12 bytes before the end
+static constexpr int SKIP_TRIGGER = 6; ///< increase the search step after 2^SKIP_TRIGGER misses
+
+static inline uint32_t read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+/** write a length continuation (the part exceeding the 4 bit token field) */
+static inline uint8_t *write_length(uint8_t *op, size_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+
+	*op++ = (uint8_t)len;
+	return op;
+}
+
+/** worst-case number of bytes needed to store a sequence */
+static inline size_t sequence_bound(size_t literal_len, size_t match_len)
+{
+	return 1 + literal_len / 255 + 1 + literal_len + 2 + match_len / 255 + 1;
+}
+
+static inline uint8_t *write_literals(uint8_t *op, const uint8_t *literals, size_t literal_len, uint8_t *token)
+{
+	if (literal_len >= 15) {
+		*token = 15 << 4;
+		op = write_length(op, literal_len - 15);
+
+	} else {
+		*token = (uint8_t)(literal_len << 4);
+	}
+
+	memcpy(op, literals, literal_len);
+	return op + literal_len;
+}
+
+int compress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity, uint16_t *hash_table)
+{
+	if (src_size > MAX_INPUT_SIZE) {
+		return -1;
+	}
+
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	const uint8_t *const iend = src + src_size;
+	uint8_t *op = dst;
+	uint8_t *const oend = dst + dst_capacity;
+
+	if (src_size > MF_LIMIT) {
+		const uint8_t *const mf_limit = iend - MF_LIMIT;
+		const uint8_t *const match_limit = iend - LAST_LITERALS;
+		unsigned search_count = 1 << SKIP_TRIGGER;
+
+		// stale or zero entries are fine: every candidate is verified before use
+		memset(hash_table, 0, HASH_TABLE_SIZE * sizeof(uint16_t));
+		hash_table[hash(read32(ip))] = 0;
+		++ip;
+
+		while (ip <= mf_limit) {
+			const uint32_t sequence = read32(ip);
+			const uint32_t h = hash(sequence);
+			const uint8_t *ref = src + hash_table[h];
+			hash_table[h] = (uint16_t)(ip - src);
+
+			if (ref >= ip || read32(ref) != sequence) {
+				ip += search_count++ >> SKIP_TRIGGER;
+				continue;
+			}
+
+			search_count = 1 << SKIP_TRIGGER;
+
+			// extend backwards into the pending literals
+			while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+				--ip;
+				--ref;
+			}
+
+			// extend forwards
+			const uint8_t *match_end = ip + MIN_MATCH;
+			const uint8_t *ref_end = ref + MIN_MATCH;
+
+			while (match_end < match_limit && *match_end == *ref_end) {
+				++match_end;
+				++ref_end;
+			}
+
+			const size_t literal_len = ip - anchor;
+			const size_t match_len = match_end - ip - MIN_MATCH;
+
+			if ((size_t)(oend - op) < sequence_bound(literal_len, match_len)) {
+				return -1;
+			}
+
+			uint8_t *token = op++;
+			op = write_literals(op, anchor, literal_len, token);
+
+			const uint16_t offset = (uint16_t)(ip - ref);
+			*op++ = (uint8_t)(offset & 0xff);
+			*op++ = (uint8_t)(offset >> 8);
+
+			if (match_len >= 15) {
+				*token |= 15;
+				op = write_length(op, match_len - 15);
+
+			} else {
+				*token |= (uint8_t)match_len;
+			}
+
+			ip = match_end;
+			anchor = ip;
+
+			// index a position inside the match to improve the ratio on repetitive data
+			if (ip - 2 > src) {
+				hash_table[hash(read32(ip - 2))] = (uint16_t)(ip - 2 - src);
+			}
+		}
+	}
+
+	// the remainder is emitted as a literal-only sequence
+	const size_t literal_len = iend - anchor;
+
+	if ((size_t)(oend - op) < 1 + literal_len / 255 + 1 + literal_len) {
+		return -1;
+	}
+
+	uint8_t *token = op++;
+	op = write_literals(op, anchor, literal_len, token);
+
+	return (int)(op - dst);
+}
+
+/** read a length continuation. @return false if the input ended prematurely */
+static inline bool read_length(const uint8_t *&ip, const uint8_t *iend, size_t &len)
+{
+	uint8_t b;
+
+	do {
+		if (ip >= iend) {
+			return false;
+		}
+
+		b = *ip++;
+		len += b;
+	} while (b == 255);
+
+	return true;
+}
+
+int decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity)
+{
+	const uint8_t *ip = src;
+	const uint8_t *const iend = src + src_size;
+	uint8_t *op = dst;
+	uint8_t *const oend = dst + dst_capacity;
+
+	while (ip < iend) {
+		const uint8_t token = *ip++;
+
+		size_t len = token >> 4;
+
+		if (len == 15 && !read_length(ip, iend, len)) {
+			return -1;
+		}
+
+		if (len > (size_t)(iend - ip) || len > (size_t)(oend - op)) {
+			return -1;
+		}
+
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		if (ip == iend) {
+			// the last sequence has no match part
+			break;
+		}
+
+		if (iend - ip < 2) {
+			return -1;
+		}
+
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > (size_t)(op - dst)) {
+			return -1;
+		}
+
+		len = token & 15;
+
+		if (len == 15 && !read_length(ip, iend, len)) {
+			return -1;
+		}
+
+		len += MIN_MATCH;
+
+		if (len > (size_t)(oend - op)) {
+			return -1;
+		}
+
+		// byte-wise copy, the match may overlap with the output
+		const uint8_t *match = op - offset;
+
+		while (len--) {
+			*op++ = *match++;
+		}
+	}
+
+	return (int)(op - dst);
+}
+
+} // namespace lz4
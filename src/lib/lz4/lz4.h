@@ -0,0 +1,86 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file lz4.h
+ *
+ * Small, dependency-free encoder and decoder for the LZ4 block format.
+ * The output is compatible with the reference implementation (LZ4_decompress_safe()),
+ * so logs can be decompressed with any standard LZ4 block decoder.
+ *
+ * The encoder is intended for small blocks (a few kB) and uses a caller-provided
+ * hash table, so it does not allocate and does not need a large stack.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace lz4
+{
+
+static constexpr int HASH_LOG = 10;
+static constexpr size_t HASH_TABLE_SIZE = 1 << HASH_LOG; ///< number of hash table entries (uint16_t)
+
+/** maximum input size of a single compress() call (match offsets are stored in the hash table as uint16) */
+static constexpr size_t MAX_INPUT_SIZE = 0xffff;
+
+/**
+ * Worst-case compressed size for an input of @p size bytes
+ */
+static constexpr size_t compress_bound(size_t size) { return size + size / 255 + 16; }
+
+/**
+ * Compress a block.
+ * @param src input data
+ * @param src_size input size, at most MAX_INPUT_SIZE
+ * @param dst output buffer
+ * @param dst_capacity size of dst. If at least compress_bound(src_size), compression cannot fail.
+ * @param hash_table scratch memory with HASH_TABLE_SIZE entries
+ * @return compressed size, or -1 if the output does not fit into dst
+ */
+int compress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity, uint16_t *hash_table);
+
+/**
+ * Decompress a block. All reads and writes are bounds-checked, so this is safe to use on corrupt input.
+ * @param src compressed data
+ * @param src_size size of the compressed block
+ * @param dst output buffer
+ * @param dst_capacity size of dst
+ * @return decompressed size, or -1 on malformed input or if dst is too small
+ */
+int decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity);
+
+} // namespace lz4
@@ -42,6 +42,7 @@
  */
 
 #include <px4_config.h>
+#include <px4_atomic.h>
 #include <px4_defines.h>
 #include <px4_module.h>
 #include <px4_posix.h>
@@ -67,6 +68,11 @@
 #include <nuttx/progmem.h>
 #endif
 
+#if defined(__PX4_POSIX)
+#include <px4_time.h>
+#include <sys/mman.h>
+#endif
+
 
 __BEGIN_DECLS
 __EXPORT int dataman_main(int argc, char *argv[]);
@@ -76,6 +82,9 @@ __END_DECLS
 static ssize_t _file_write(dm_item_t item, unsigned index, dm_persitence_t persistence, const void *buf,
 			   size_t count);
 static ssize_t _file_read(dm_item_t item, unsigned index, void *buf, size_t count);
+static ssize_t _file_write_range(dm_item_t item, unsigned index, unsigned count, dm_persitence_t persistence,
+				 const void *buf, size_t item_size);
+static ssize_t _file_read_range(dm_item_t item, unsigned index, unsigned count, void *buf, size_t item_size);
 static int  _file_clear(dm_item_t item);
 static int  _file_restart(dm_reset_reason reason);
 static int _file_initialize(unsigned max_offset);
@@ -104,9 +113,30 @@ static void _ram_flash_shutdown();
 static int _ram_flash_wait(px4_sem_t *sem);
 #endif
 
+#if defined(__PX4_POSIX)
+/* Private memory-mapped file based Operations */
+#define MMAP_FLUSH_TIMEOUT_USEC 1000000 /* maximum delay from a modification until it is synced to the file */
+
+static ssize_t _mmap_write(dm_item_t item, unsigned index, dm_persitence_t persistence, const void *buf,
+			   size_t count);
+static ssize_t _mmap_read(dm_item_t item, unsigned index, void *buf, size_t count);
+static ssize_t _mmap_write_range(dm_item_t item, unsigned index, unsigned count, dm_persitence_t persistence,
+				 const void *buf, size_t item_size);
+static ssize_t _mmap_read_range(dm_item_t item, unsigned index, unsigned count, void *buf, size_t item_size);
+static int  _mmap_clear(dm_item_t item);
+static int  _mmap_restart(dm_reset_reason reason);
+static int _mmap_initialize(unsigned max_offset);
+static void _mmap_shutdown();
+static int _mmap_wait(px4_sem_t *sem);
+#endif
+
 typedef struct dm_operations_t {
 	ssize_t (*write)(dm_item_t item, unsigned index, dm_persitence_t persistence, const void *buf, size_t count);
 	ssize_t (*read)(dm_item_t item, unsigned index, void *buf, size_t count);
+	/* optional, nullptr if the backend handles ranges item by item */
+	ssize_t (*write_range)(dm_item_t item, unsigned index, unsigned count, dm_persitence_t persistence,
+			       const void *buf, size_t item_size);
+	ssize_t (*read_range)(dm_item_t item, unsigned index, unsigned count, void *buf, size_t item_size);
 	int (*clear)(dm_item_t item);
 	int (*restart)(dm_reset_reason reason);
 	int (*initialize)(unsigned max_offset);
@@ -117,6 +147,8 @@ typedef struct dm_operations_t {
 static constexpr dm_operations_t dm_file_operations = {
 	.write   = _file_write,
 	.read    = _file_read,
+	.write_range = _file_write_range,
+	.read_range = _file_read_range,
 	.clear   = _file_clear,
 	.restart = _file_restart,
 	.initialize = _file_initialize,
@@ -127,6 +159,8 @@ static constexpr dm_operations_t dm_file_operations = {
 static constexpr dm_operations_t dm_ram_operations = {
 	.write   = _ram_write,
 	.read    = _ram_read,
+	.write_range = nullptr,
+	.read_range = nullptr,
 	.clear   = _ram_clear,
 	.restart = _ram_restart,
 	.initialize = _ram_initialize,
@@ -138,6 +172,8 @@ static constexpr dm_operations_t dm_ram_operations = {
 static constexpr dm_operations_t dm_ram_flash_operations = {
 	.write   = _ram_flash_write,
 	.read    = _ram_flash_read,
+	.write_range = nullptr,
+	.read_range = nullptr,
 	.clear   = _ram_flash_clear,
 	.restart = _ram_flash_restart,
 	.initialize = _ram_flash_initialize,
@@ -146,12 +182,27 @@ static constexpr dm_operations_t dm_ram_flash_operations = {
 };
 #endif
 
+#if defined(__PX4_POSIX)
+static constexpr dm_operations_t dm_mmap_operations = {
+	.write   = _mmap_write,
+	.read    = _mmap_read,
+	.write_range = _mmap_write_range,
+	.read_range = _mmap_read_range,
+	.clear   = _mmap_clear,
+	.restart = _mmap_restart,
+	.initialize = _mmap_initialize,
+	.shutdown = _mmap_shutdown,
+	.wait = _mmap_wait,
+};
+#endif
+
 static const dm_operations_t *g_dm_ops;
 
 static struct {
 	union {
 		struct {
 			int fd;
+			uint8_t *range_buffer; /* allocated on the first range request */
 		} file;
 		struct {
 			uint8_t *data;
@@ -164,6 +215,14 @@ static struct {
 			/* sync above with RAM backend */
 			hrt_abstime flush_timeout_usec;
 		} ram_flash;
+#endif
+#if defined(__PX4_POSIX)
+		struct {
+			uint8_t *data;
+			uint8_t *data_end;
+			/* sync above with RAM backend */
+			hrt_abstime flush_timeout_usec; /* time of the next msync, 0 if there are no pending changes */
+		} mmap;
 #endif
 	};
 	bool running;
@@ -175,6 +234,8 @@ typedef enum {
 	dm_read_func,
 	dm_clear_func,
 	dm_restart_func,
+	dm_write_range_func,
+	dm_read_range_func,
 	dm_number_of_funcs
 } dm_function_t;
 
@@ -199,6 +260,21 @@ typedef struct {
 			void *buf;
 			size_t count;
 		} read_params;
+		struct {
+			dm_item_t item;
+			unsigned index;
+			unsigned count;
+			dm_persitence_t persistence;
+			const void *buf;
+			size_t item_size;
+		} write_range_params;
+		struct {
+			dm_item_t item;
+			unsigned index;
+			unsigned count;
+			void *buf;
+			size_t item_size;
+		} read_range_params;
 		struct {
 			dm_item_t item;
 		} clear_params;
@@ -212,6 +288,17 @@ const size_t k_work_item_allocation_chunk_size = 8;
 
 /* Usage statistics */
 static unsigned g_func_counts[dm_number_of_funcs];
+static px4::atomic<unsigned> g_direct_read_count; /* reads served in the caller's context */
+
+/* number of writes and clears per item type, read without going through the work queue (@see dm_generation()) */
+static px4::atomic<unsigned> g_item_generation[DM_KEY_NUM_KEYS];
+
+static inline void item_modified(dm_item_t item)
+{
+	if (item < DM_KEY_NUM_KEYS) {
+		g_item_generation[item].fetch_add(1);
+	}
+}
 
 /* table of maximum number of instances for each item type */
 static const unsigned g_per_item_max_index[DM_KEY_NUM_KEYS] = {
@@ -226,6 +313,16 @@ static const unsigned g_per_item_max_index[DM_KEY_NUM_KEYS] = {
 
 #define DM_SECTOR_HDR_SIZE 4	/* data manager per item header overhead */
 
+/* Size of the file backend buffer for range requests, which are read and written in blocks of whole items */
+#if defined(MEMORY_CONSTRAINED_SYSTEM)
+#define DM_RANGE_BUFFER_SIZE 512
+#else
+#define DM_RANGE_BUFFER_SIZE 2048
+#endif
+
+static_assert(DM_RANGE_BUFFER_SIZE >= sizeof(struct mission_item_s) + DM_SECTOR_HDR_SIZE,
+	      "range buffer must hold at least one item");
+
 /* Table of the len of each item type */
 static constexpr size_t g_per_item_size[DM_KEY_NUM_KEYS] = {
 	sizeof(struct mission_save_point_s) + DM_SECTOR_HDR_SIZE,
@@ -259,6 +356,9 @@ static enum {
 	BACKEND_RAM,
 #if defined(FLASH_BASED_DATAMAN)
 	BACKEND_RAM_FLASH,
+#endif
+#if defined(__PX4_POSIX)
+	BACKEND_MMAP,
 #endif
 	BACKEND_LAST
 } backend = BACKEND_NONE;
@@ -441,6 +541,25 @@ calculate_offset(dm_item_t item, unsigned index)
 	return g_key_offsets[item] + (index * g_per_item_size[item]);
 }
 
+/* Make sure a range request is within the bounds of the item type */
+static int
+check_range(dm_item_t item, unsigned index, unsigned count, size_t item_size)
+{
+	if (item >= DM_KEY_NUM_KEYS) {
+		return -1;
+	}
+
+	if (index > g_per_item_max_index[item] || count > g_per_item_max_index[item] - index) {
+		return -1;
+	}
+
+	if (item_size > (g_per_item_size[item] - DM_SECTOR_HDR_SIZE)) {
+		return -E2BIG;
+	}
+
+	return 0;
+}
+
 /* Each data item is stored as follows
  *
  * byte 0: Length of user data item
@@ -541,6 +660,69 @@ _file_write(dm_item_t item, unsigned index, dm_persitence_t persistence, const v
 	return count - DM_SECTOR_HDR_SIZE;
 }
 
+static uint8_t *
+_file_range_buffer()
+{
+	if (dm_operations_data.file.range_buffer == nullptr) {
+		dm_operations_data.file.range_buffer = (uint8_t *)malloc(DM_RANGE_BUFFER_SIZE);
+	}
+
+	return dm_operations_data.file.range_buffer;
+}
+
+/* write a range of items to the data manager file, as many items at once as fit into the range buffer */
+static ssize_t
+_file_write_range(dm_item_t item, unsigned index, unsigned count, dm_persitence_t persistence, const void *buf,
+		  size_t item_size)
+{
+	uint8_t *buffer = _file_range_buffer();
+
+	if (buffer == nullptr) {
+		return -1;
+	}
+
+	const size_t stride = g_per_item_size[item];
+	const unsigned items_per_block = DM_RANGE_BUFFER_SIZE / stride;
+	const uint8_t *src = (const uint8_t *)buf;
+	unsigned written = 0;
+
+	while (written < count) {
+		const unsigned n = (count - written < items_per_block) ? count - written : items_per_block;
+
+		/* Prefix each item with length and persistence level, as _file_write() does */
+		for (unsigned i = 0; i < n; i++) {
+			uint8_t *entry = &buffer[i * stride];
+			entry[0] = item_size;
+			entry[1] = persistence;
+			entry[2] = 0;
+			entry[3] = 0;
+			memcpy(entry + DM_SECTOR_HDR_SIZE, src, item_size);
+			memset(entry + DM_SECTOR_HDR_SIZE + item_size, 0, stride - DM_SECTOR_HDR_SIZE - item_size);
+			src += item_size;
+		}
+
+		/* the unused space after the last item is not written */
+		const ssize_t len = (n - 1) * stride + DM_SECTOR_HDR_SIZE + item_size;
+		const int offset = calculate_offset(item, index + written);
+
+		if (lseek(dm_operations_data.file.fd, offset, SEEK_SET) != offset ||
+		    write(dm_operations_data.file.fd, buffer, len) != len) {
+			break;
+		}
+
+		written += n;
+	}
+
+	/* Make sure data is written to physical media, once for the whole range */
+	fsync(dm_operations_data.file.fd);
+
+	if (written == 0 && count > 0) {
+		return -1;
+	}
+
+	return written;
+}
+
 #if defined(FLASH_BASED_DATAMAN)
 static void
 _ram_flash_update_flush_timeout()
@@ -659,6 +841,53 @@ _file_read(dm_item_t item, unsigned index, void *buf, size_t count)
 	return buffer[0];
 }
 
+/* Retrieve a range of items from the data manager file, as many items at once as fit into the range buffer */
+static ssize_t
+_file_read_range(dm_item_t item, unsigned index, unsigned count, void *buf, size_t item_size)
+{
+	uint8_t *buffer = _file_range_buffer();
+
+	if (buffer == nullptr) {
+		return -1;
+	}
+
+	const size_t stride = g_per_item_size[item];
+	const unsigned items_per_block = DM_RANGE_BUFFER_SIZE / stride;
+	uint8_t *dst = (uint8_t *)buf;
+	unsigned read_count = 0;
+
+	while (read_count < count) {
+		const unsigned n = (count - read_count < items_per_block) ? count - read_count : items_per_block;
+		const int offset = calculate_offset(item, index + read_count);
+		ssize_t len = -1;
+
+		if (lseek(dm_operations_data.file.fd, offset, SEEK_SET) == offset) {
+			len = read(dm_operations_data.file.fd, buffer, n * stride);
+		}
+
+		/* Check for read error */
+		if (len < 0) {
+			return (read_count > 0) ? (ssize_t)read_count : -errno;
+		}
+
+		for (unsigned i = 0; i < n; i++) {
+			const uint8_t *entry = &buffer[i * stride];
+
+			/* Stop at the first item which is empty (or beyond the end of the file) or of a different size */
+			if ((size_t)len < i * stride + DM_SECTOR_HDR_SIZE + item_size || entry[0] != item_size) {
+				return read_count + i;
+			}
+
+			memcpy(dst, entry + DM_SECTOR_HDR_SIZE, item_size);
+			dst += item_size;
+		}
+
+		read_count += n;
+	}
+
+	return read_count;
+}
+
 #if defined(FLASH_BASED_DATAMAN)
 static ssize_t
 _ram_flash_read(dm_item_t item, unsigned index, void *buf, size_t count)
@@ -999,6 +1228,8 @@ static void
 _file_shutdown()
 {
 	close(dm_operations_data.file.fd);
+	free(dm_operations_data.file.range_buffer);
+	dm_operations_data.file.range_buffer = nullptr;
 	dm_operations_data.running = false;
 }
 
@@ -1079,6 +1310,289 @@ _ram_flash_wait(px4_sem_t *sem)
 }
 #endif
 
+#if defined(__PX4_POSIX)
+/*
+ * The memory-mapped backend maps the data manager file (same format as the file backend) and uses the RAM backend
+ * functions on the mapping. Reads are served directly in the caller's context, without going through the worker
+ * task, and modifications are synced to the file at most MMAP_FLUSH_TIMEOUT_USEC later, batching them.
+ * g_mmap_access_sem keeps single item accesses atomic between the readers and the worker task.
+ */
+static px4_sem_t g_mmap_access_sem;
+
+static void
+_mmap_schedule_flush()
+{
+	if (dm_operations_data.mmap.flush_timeout_usec == 0) {
+		dm_operations_data.mmap.flush_timeout_usec = hrt_absolute_time() + MMAP_FLUSH_TIMEOUT_USEC;
+	}
+}
+
+static void
+_mmap_flush()
+{
+	dm_operations_data.mmap.flush_timeout_usec = 0;
+
+	const size_t len = (dm_operations_data.mmap.data_end - dm_operations_data.mmap.data) + 1;
+
+	if (msync(dm_operations_data.mmap.data, len, MS_SYNC) != 0) {
+		PX4_WARN("msync failed (%i)", errno);
+	}
+}
+
+static ssize_t
+_mmap_write(dm_item_t item, unsigned index, dm_persitence_t persistence, const void *buf, size_t count)
+{
+	px4_sem_wait(&g_mmap_access_sem);
+	ssize_t ret = dm_ram_operations.write(item, index, persistence, buf, count);
+	px4_sem_post(&g_mmap_access_sem);
+
+	if (ret >= 0) {
+		_mmap_schedule_flush();
+	}
+
+	return ret;
+}
+
+static ssize_t
+_mmap_read(dm_item_t item, unsigned index, void *buf, size_t count)
+{
+	px4_sem_wait(&g_mmap_access_sem);
+	ssize_t ret = -1;
+
+	/* the mapping is gone after shutdown */
+	if (dm_operations_data.mmap.data) {
+		ret = dm_ram_operations.read(item, index, buf, count);
+	}
+
+	px4_sem_post(&g_mmap_access_sem);
+	return ret;
+}
+
+static ssize_t
+_mmap_write_range(dm_item_t item, unsigned index, unsigned count, dm_persitence_t persistence, const void *buf,
+		  size_t item_size)
+{
+	const uint8_t *src = (const uint8_t *)buf;
+	unsigned written = 0;
+
+	px4_sem_wait(&g_mmap_access_sem);
+
+	for (; written < count; written++) {
+		if (dm_ram_operations.write(item, index + written, persistence, src, item_size) != (ssize_t)item_size) {
+			break;
+		}
+
+		src += item_size;
+	}
+
+	px4_sem_post(&g_mmap_access_sem);
+
+	_mmap_schedule_flush();
+
+	if (written == 0 && count > 0) {
+		return -1;
+	}
+
+	return written;
+}
+
+static ssize_t
+_mmap_read_range(dm_item_t item, unsigned index, unsigned count, void *buf, size_t item_size)
+{
+	uint8_t *dst = (uint8_t *)buf;
+	ssize_t read_count = -1;
+
+	px4_sem_wait(&g_mmap_access_sem);
+
+	if (dm_operations_data.mmap.data) {
+		for (read_count = 0; read_count < (ssize_t)count; read_count++) {
+			if (dm_ram_operations.read(item, index + read_count, dst, item_size) != (ssize_t)item_size) {
+				break;
+			}
+
+			dst += item_size;
+		}
+	}
+
+	px4_sem_post(&g_mmap_access_sem);
+	return read_count;
+}
+
+static int
+_mmap_clear(dm_item_t item)
+{
+	px4_sem_wait(&g_mmap_access_sem);
+	int ret = dm_ram_operations.clear(item);
+	px4_sem_post(&g_mmap_access_sem);
+
+	_mmap_schedule_flush();
+	return ret;
+}
+
+static int
+_mmap_restart(dm_reset_reason reason)
+{
+	px4_sem_wait(&g_mmap_access_sem);
+	int ret = dm_ram_operations.restart(reason);
+	px4_sem_post(&g_mmap_access_sem);
+
+	_mmap_schedule_flush();
+	return ret;
+}
+
+static int
+_mmap_initialize(unsigned max_offset)
+{
+	px4_sem_init(&g_mmap_access_sem, 1, 1); /* Initially unlocked */
+
+	/* Open or create the data manager file, and make sure it covers all items (new space reads as empty items) */
+	int fd = open(k_data_manager_device_path, O_RDWR | O_CREAT | O_BINARY, PX4_O_MODE_666);
+
+	if (fd < 0) {
+		PX4_WARN("Could not open data manager file %s", k_data_manager_device_path);
+		px4_sem_post(&g_init_sema); /* Don't want to hang startup */
+		return -1;
+	}
+
+	void *data = MAP_FAILED;
+
+	if (ftruncate(fd, max_offset) == 0) {
+		data = mmap(nullptr, max_offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+
+	/* the mapping stays valid after closing the file */
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		PX4_WARN("Could not map data manager file %s (%i)", k_data_manager_device_path, errno);
+		px4_sem_post(&g_init_sema); /* Don't want to hang startup */
+		return -1;
+	}
+
+	dm_operations_data.mmap.data = (uint8_t *)data;
+	dm_operations_data.mmap.data_end = &dm_operations_data.mmap.data[max_offset - 1];
+	dm_operations_data.mmap.flush_timeout_usec = 0;
+
+	struct dataman_compat_s compat_state;
+	int ret = dm_ram_operations.read(DM_KEY_COMPAT, 0, &compat_state, sizeof(compat_state));
+
+	if (ret != sizeof(compat_state) || compat_state.key != DM_COMPAT_KEY) {
+		/* Not compatible: clear all items and write current compat info */
+		memset(dm_operations_data.mmap.data, 0, max_offset);
+
+		compat_state.key = DM_COMPAT_KEY;
+		ret = g_dm_ops->write(DM_KEY_COMPAT, 0, DM_PERSIST_POWER_ON_RESET, &compat_state, sizeof(compat_state));
+
+		if (ret != sizeof(compat_state)) {
+			PX4_ERR("Failed writing compat: %d", ret);
+		}
+	}
+
+	dm_operations_data.running = true;
+
+	return 0;
+}
+
+static void
+_mmap_shutdown()
+{
+	_mmap_flush();
+
+	px4_sem_wait(&g_mmap_access_sem);
+	munmap(dm_operations_data.mmap.data, (dm_operations_data.mmap.data_end - dm_operations_data.mmap.data) + 1);
+	dm_operations_data.mmap.data = nullptr;
+	dm_operations_data.running = false;
+	px4_sem_post(&g_mmap_access_sem);
+}
+
+static int
+_mmap_wait(px4_sem_t *sem)
+{
+	if (dm_operations_data.mmap.flush_timeout_usec == 0) {
+		px4_sem_wait(sem);
+		return 0;
+	}
+
+	const hrt_abstime now = hrt_absolute_time();
+
+	if (now >= dm_operations_data.mmap.flush_timeout_usec) {
+		_mmap_flush();
+		return 0;
+	}
+
+	/* wait for work until the pending changes need to be synced */
+	const uint64_t diff = dm_operations_data.mmap.flush_timeout_usec - now;
+	struct timespec abstime;
+	px4_clock_gettime(CLOCK_MONOTONIC, &abstime);
+	const uint64_t nsecs = abstime.tv_nsec + diff * 1000;
+	abstime.tv_sec += nsecs / 1000000000;
+	abstime.tv_nsec = nsecs % 1000000000;
+
+	px4_sem_timedwait(sem, &abstime);
+
+	if (hrt_absolute_time() >= dm_operations_data.mmap.flush_timeout_usec) {
+		_mmap_flush();
+	}
+
+	return 0;
+}
+#endif
+
+/* Write a range of items, item by item if the backend does not support range writes */
+static ssize_t
+_write_range(dm_item_t item, unsigned index, unsigned count, dm_persitence_t persistence, const void *buf,
+	     size_t item_size)
+{
+	int ret = check_range(item, index, count, item_size);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (g_dm_ops->write_range) {
+		return g_dm_ops->write_range(item, index, count, persistence, buf, item_size);
+	}
+
+	const uint8_t *src = (const uint8_t *)buf;
+
+	for (unsigned i = 0; i < count; i++) {
+		if (g_dm_ops->write(item, index + i, persistence, src, item_size) != (ssize_t)item_size) {
+			return (i > 0) ? (ssize_t)i : -1;
+		}
+
+		src += item_size;
+	}
+
+	return count;
+}
+
+/* Read a range of items, item by item if the backend does not support range reads */
+static ssize_t
+_read_range(dm_item_t item, unsigned index, unsigned count, void *buf, size_t item_size)
+{
+	int ret = check_range(item, index, count, item_size);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (g_dm_ops->read_range) {
+		return g_dm_ops->read_range(item, index, count, buf, item_size);
+	}
+
+	uint8_t *dst = (uint8_t *)buf;
+
+	for (unsigned i = 0; i < count; i++) {
+		if (g_dm_ops->read(item, index + i, dst, item_size) != (ssize_t)item_size) {
+			return i;
+		}
+
+		dst += item_size;
+	}
+
+	return count;
+}
+
 /** Write to the data manager file */
 __EXPORT ssize_t
 dm_write(dm_item_t item, unsigned index, dm_persitence_t persistence, const void *buf, size_t count)
@@ -1117,6 +1631,16 @@ dm_read(dm_item_t item, unsigned index, void *buf, size_t count)
 		return -1;
 	}
 
+#if defined(__PX4_POSIX)
+
+	/* The memory-mapped backend is read directly, without a round trip through the worker task */
+	if (backend == BACKEND_MMAP) {
+		g_direct_read_count.fetch_add(1);
+		return _mmap_read(item, index, buf, count);
+	}
+
+#endif
+
 	/* get a work item and queue up a read request */
 	if ((work = create_work_item()) == nullptr) {
 		return -1;
@@ -1132,6 +1656,72 @@ dm_read(dm_item_t item, unsigned index, void *buf, size_t count)
 	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
 }
 
+/** Write a range of items to the data manager file */
+__EXPORT ssize_t
+dm_write_range(dm_item_t item, unsigned index, unsigned count, dm_persitence_t persistence, const void *buf,
+	       size_t item_size)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if (!is_running() || g_task_should_exit) {
+		return -1;
+	}
+
+	/* get a work item and queue up a write request */
+	if ((work = create_work_item()) == nullptr) {
+		return -1;
+	}
+
+	work->func = dm_write_range_func;
+	work->write_range_params.item = item;
+	work->write_range_params.index = index;
+	work->write_range_params.count = count;
+	work->write_range_params.persistence = persistence;
+	work->write_range_params.buf = buf;
+	work->write_range_params.item_size = item_size;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
+}
+
+/** Retrieve a range of items from the data manager file */
+__EXPORT ssize_t
+dm_read_range(dm_item_t item, unsigned index, unsigned count, void *buf, size_t item_size)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if (!is_running() || g_task_should_exit) {
+		return -1;
+	}
+
+#if defined(__PX4_POSIX)
+
+	/* The memory-mapped backend is read directly, without a round trip through the worker task */
+	if (backend == BACKEND_MMAP) {
+		g_direct_read_count.fetch_add(1);
+		return _read_range(item, index, count, buf, item_size);
+	}
+
+#endif
+
+	/* get a work item and queue up a read request */
+	if ((work = create_work_item()) == nullptr) {
+		return -1;
+	}
+
+	work->func = dm_read_range_func;
+	work->read_range_params.item = item;
+	work->read_range_params.index = index;
+	work->read_range_params.count = count;
+	work->read_range_params.buf = buf;
+	work->read_range_params.item_size = item_size;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
+}
+
 /** Clear a data Item */
 __EXPORT int
 dm_clear(dm_item_t item)
@@ -1155,6 +1745,16 @@ dm_clear(dm_item_t item)
 	return enqueue_work_item_and_wait_for_result(work);
 }
 
+__EXPORT unsigned
+dm_generation(dm_item_t item)
+{
+	if (item >= DM_KEY_NUM_KEYS) {
+		return 0;
+	}
+
+	return g_item_generation[item].load();
+}
+
 __EXPORT int
 dm_lock(dm_item_t item)
 {
@@ -1268,6 +1868,12 @@ task_main(int argc, char *argv[])
 		g_dm_ops = &dm_ram_flash_operations;
 		break;
 #endif
+#if defined(__PX4_POSIX)
+
+	case BACKEND_MMAP:
+		g_dm_ops = &dm_mmap_operations;
+		break;
+#endif
 
 	default:
 		PX4_WARN("No valid backend set.");
@@ -1356,6 +1962,13 @@ task_main(int argc, char *argv[])
 			 restart_type_str, max_offset);
 		break;
 #endif
+#if defined(__PX4_POSIX)
+
+	case BACKEND_MMAP:
+		PX4_INFO("%s, data manager file '%s' (memory-mapped) size is %d bytes",
+			 restart_type_str, k_data_manager_device_path, max_offset);
+		break;
+#endif
 
 	default:
 		break;
@@ -1384,6 +1997,7 @@ task_main(int argc, char *argv[])
 					g_dm_ops->write(work->write_params.item, work->write_params.index, work->write_params.persistence,
 							work->write_params.buf,
 							work->write_params.count);
+				item_modified(work->write_params.item);
 				break;
 
 			case dm_read_func:
@@ -1392,14 +2006,37 @@ task_main(int argc, char *argv[])
 					g_dm_ops->read(work->read_params.item, work->read_params.index, work->read_params.buf, work->read_params.count);
 				break;
 
+			case dm_write_range_func:
+				g_func_counts[dm_write_range_func]++;
+				work->result =
+					_write_range(work->write_range_params.item, work->write_range_params.index,
+						     work->write_range_params.count, work->write_range_params.persistence,
+						     work->write_range_params.buf, work->write_range_params.item_size);
+				item_modified(work->write_range_params.item);
+				break;
+
+			case dm_read_range_func:
+				g_func_counts[dm_read_range_func]++;
+				work->result =
+					_read_range(work->read_range_params.item, work->read_range_params.index,
+						    work->read_range_params.count, work->read_range_params.buf,
+						    work->read_range_params.item_size);
+				break;
+
 			case dm_clear_func:
 				g_func_counts[dm_clear_func]++;
 				work->result = g_dm_ops->clear(work->clear_params.item);
+				item_modified(work->clear_params.item);
 				break;
 
 			case dm_restart_func:
 				g_func_counts[dm_restart_func]++;
 				work->result = g_dm_ops->restart(work->restart_params.reason);
+
+				for (int item = 0; item < (int)DM_KEY_NUM_KEYS; item++) {
+					item_modified((dm_item_t)item);
+				}
+
 				break;
 
 			default: /* should never happen */
@@ -1438,6 +2075,14 @@ end:
 	px4_sem_destroy(&g_sys_state_mutex_mission);
 	px4_sem_destroy(&g_sys_state_mutex_fence);
 
+#if defined(__PX4_POSIX)
+
+	if (g_dm_ops == &dm_mmap_operations) {
+		px4_sem_destroy(&g_mmap_access_sem);
+	}
+
+#endif
+
 	return 0;
 }
 
@@ -1472,6 +2117,9 @@ status()
 	/* display usage statistics */
 	PX4_INFO("Writes   %d", g_func_counts[dm_write_func]);
 	PX4_INFO("Reads    %d", g_func_counts[dm_read_func]);
+	PX4_INFO("Range writes %d", g_func_counts[dm_write_range_func]);
+	PX4_INFO("Range reads  %d", g_func_counts[dm_read_range_func]);
+	PX4_INFO("Direct reads %d", g_direct_read_count.load());
 	PX4_INFO("Clears   %d", g_func_counts[dm_clear_func]);
 	PX4_INFO("Restarts %d", g_func_counts[dm_restart_func]);
 	PX4_INFO("Max Q lengths work %d, free %d", g_work_q.max_size, g_free_q.max_size);
@@ -1494,6 +2142,8 @@ usage()
 Module to provide persistent storage for the rest of the system in form of a simple database through a C API.
 Multiple backends are supported:
 - a file (eg. on the SD card)
+- a memory-mapped file (POSIX only): reads are served without going through the dataman task, and changes are
+  synced to the file within a second
 - FLASH (if the board supports it)
 - FRAM
 - RAM (this is obviously not persistent)
@@ -1504,6 +2154,8 @@ Each type has a specific type and a fixed maximum amount of storage items, so th
 ### Implementation
 Reading and writing a single item is always atomic. If multiple items need to be read/modified atomically, there is
 an additional lock per item type via `dm_lock`.
+Consecutive items can be read and written in a single request with `dm_read_range` and `dm_write_range`. The file
+backend then accesses multiple items per file operation and syncs only once.
 
 **DM_KEY_FENCE_POINTS** and **DM_KEY_SAFE_POINTS** items: the first data element is a `mission_stats_entry_s` struct,
 which stores the number of items for these types. These items are always updated atomically in one transaction (from
@@ -1517,6 +2169,7 @@ check for geofence violations.
 	PRINT_MODULE_USAGE_PARAM_STRING('f', nullptr, "<file>", "Storage file", true);
 	PRINT_MODULE_USAGE_PARAM_FLAG('r', "Use RAM backend (NOT persistent)", true);
 	PRINT_MODULE_USAGE_PARAM_FLAG('i', "Use FLASH backend", true);
+	PRINT_MODULE_USAGE_PARAM_FLAG('m', "Memory-map the storage file (POSIX only), can be combined with -f", true);
 	PRINT_MODULE_USAGE_PARAM_COMMENT("The options -f, -r and -i are mutually exclusive. If nothing is specified, a file 'dataman' is used");
 
 	PRINT_MODULE_USAGE_COMMAND_DESCR("poweronrestart", "Restart dataman (on power on)");
@@ -1553,10 +2206,13 @@ dataman_main(int argc, char *argv[])
 		int ch;
 		int dmoptind = 1;
 		const char *dmoptarg = nullptr;
+#if defined(__PX4_POSIX)
+		bool use_mmap = false;
+#endif
 
 		/* jump over start and look at options first */
 
-		while ((ch = px4_getopt(argc, argv, "f:ri", &dmoptind, &dmoptarg)) != EOF) {
+		while ((ch = px4_getopt(argc, argv, "f:rim", &dmoptind, &dmoptarg)) != EOF) {
 			switch (ch) {
 			case 'f':
 				if (backend_check()) {
@@ -1594,6 +2250,15 @@ dataman_main(int argc, char *argv[])
 				return -1;
 #endif
 
+			case 'm':
+#if defined(__PX4_POSIX)
+				use_mmap = true;
+				break;
+#else
+				PX4_WARN("memory-mapped backend is not available");
+				return -1;
+#endif
+
 			//no break
 			default:
 				usage();
@@ -1606,6 +2271,20 @@ dataman_main(int argc, char *argv[])
 			k_data_manager_device_path = strdup(default_device_path);
 		}
 
+#if defined(__PX4_POSIX)
+
+		if (use_mmap) {
+			if (backend != BACKEND_FILE) {
+				PX4_WARN("-m requires a file backend");
+				usage();
+				return -1;
+			}
+
+			backend = BACKEND_MMAP;
+		}
+
+#endif
+
 		start();
 
 		if (!is_running()) {
@@ -125,6 +125,47 @@ dm_write(
 	size_t buflen			/* Length in bytes of data to retrieve */
 );
 
+/**
+ * Retrieve consecutive items of a type in a single request.
+ * Each item is read as by dm_read() with buflen item_size, into buffer[i * item_size].
+ * @return the number of items read, counted from index up to the first item which does not hold exactly
+ *         item_size bytes (an empty item, for example), or -1 on error (the range is out of bounds, ...)
+ */
+__EXPORT ssize_t
+dm_read_range(
+	dm_item_t item,			/* The item type to retrieve */
+	unsigned index,			/* The index of the first item */
+	unsigned count,			/* The number of items */
+	void *buffer,			/* Pointer to caller data buffer, holding count items */
+	size_t item_size		/* Length in bytes of each item */
+);
+
+/**
+ * Write consecutive items of a type in a single request. Each item is stored as by dm_write(), but the data is
+ * synced to the storage only once.
+ * @return the number of items written (less than count if writing failed part-way), or -1 on error
+ */
+__EXPORT ssize_t
+dm_write_range(
+	dm_item_t item,			/* The item type to store */
+	unsigned index,			/* The index of the first item */
+	unsigned count,			/* The number of items */
+	dm_persitence_t persistence,	/* The persistence level of the items */
+	const void *buffer,		/* Pointer to caller data buffer, holding count items */
+	size_t item_size		/* Length in bytes of each item */
+);
+
+/**
+ * Get the modification counter of an item type. It is incremented after each completed dm_write(),
+ * dm_write_range() and dm_clear() of the type (and on dm_restart()), and wraps around.
+ * This does not go through the data manager task, so it can be polled cheaply to detect changes before
+ * reading the data.
+ */
+__EXPORT unsigned
+dm_generation(
+	dm_item_t item			/* The item type */
+);
+
 /**
  * Lock all items of a type. Can be used for atomic updates of multiple items (single items are always updated
  * atomically).
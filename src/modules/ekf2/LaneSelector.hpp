@@ -0,0 +1,133 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file LaneSelector.hpp
+ *
+ * Selection of the estimator lane whose estimate ekf2 publishes.
+ *
+ * A failed lane is left immediately. A healthy lane is only replaced by a lane whose filtered innovation test
+ * ratio is lower by the hysteresis, and at most once per SWITCH_INTERVAL_MIN.
+ */
+
+#pragma once
+
+#include <float.h>
+#include <stdint.h>
+
+#include <drivers/drv_hrt.h>
+#include <px4_defines.h>
+
+using namespace time_literals;
+
+class LaneSelector
+{
+public:
+	static constexpr uint8_t MAX_LANES{3};				///< max number of estimator lanes
+	static constexpr hrt_abstime SWITCH_INTERVAL_MIN{10_s};	///< min time between switches to a better lane
+
+	/**
+	 * Update the health and the filtered test ratio of a lane.
+	 * @param lane index of the lane
+	 * @param test_ratio largest innovation test ratio of the current update, not finite if the lane did not update
+	 * @param healthy true when the lane is aligned, without faults and receiving IMU data
+	 */
+	void update(uint8_t lane, float test_ratio, bool healthy)
+	{
+		if (lane >= MAX_LANES) {
+			return;
+		}
+
+		if (PX4_ISFINITE(test_ratio)) {
+			_test_ratio_filt[lane] += 0.01f * (test_ratio - _test_ratio_filt[lane]);
+		}
+
+		_healthy[lane] = healthy;
+	}
+
+	/**
+	 * Select the lane to publish from the lanes updated since the last call.
+	 * @param num_lanes number of running lanes
+	 * @param now current time (uSec)
+	 * @param hysteresis test ratio improvement required to leave a healthy lane
+	 * @return index of the selected lane, which differs from the previous one after a switch
+	 */
+	uint8_t select(uint8_t num_lanes, hrt_abstime now, float hysteresis)
+	{
+		uint8_t best_lane = _selected;
+		float best_ratio = FLT_MAX;
+
+		for (uint8_t i = 0; (i < num_lanes) && (i < MAX_LANES); i++) {
+			if (_healthy[i] && _test_ratio_filt[i] < best_ratio) {
+				best_ratio = _test_ratio_filt[i];
+				best_lane = i;
+			}
+		}
+
+		if (best_lane == _selected) {
+			return _selected;
+		}
+
+		// leave a failed lane immediately, but require a clear and lasting improvement to leave a healthy one
+		const bool improved = (_test_ratio_filt[_selected] - best_ratio > hysteresis);
+
+		if (!_healthy[_selected] || (improved && (now - _switch_time > SWITCH_INTERVAL_MIN))) {
+
+			_selected = best_lane;
+			_switch_time = now;
+			_switch_count++;
+		}
+
+		return _selected;
+	}
+
+	/**
+	 * Forget the lane history and select the first lane.
+	 */
+	void reset()
+	{
+		*this = LaneSelector{};
+	}
+
+	uint8_t selected() const { return _selected; }
+	uint32_t switch_count() const { return _switch_count; }
+	bool healthy(uint8_t lane) const { return (lane < MAX_LANES) && _healthy[lane]; }
+	float test_ratio(uint8_t lane) const { return (lane < MAX_LANES) ? _test_ratio_filt[lane] : 0.0f; }
+
+private:
+	float _test_ratio_filt[MAX_LANES] {};	///< low pass filtered largest innovation test ratio
+	bool _healthy[MAX_LANES] {};		///< true when aligned, without faults and receiving IMU data
+	uint8_t _selected{0};			///< index of the lane whose estimate is published
+	hrt_abstime _switch_time{0};		///< time of the last lane switch (uSec)
+	uint32_t _switch_count{0};		///< number of lane switches since start
+};
@@ -39,11 +39,14 @@
  */
 
 #include <cfloat>
+#include <new>
 
 #include <drivers/drv_hrt.h>
+#include <lib/conversion/rotation.h>
 #include <lib/ecl/EKF/ekf.h>
 #include <lib/mathlib/mathlib.h>
 #include <lib/perf/perf_counter.h>
+#include <parameters/param.h>
 #include <px4_defines.h>
 #include <px4_module.h>
 #include <px4_module_params.h>
@@ -61,8 +64,12 @@
 #include <uORB/topics/landing_target_pose.h>
 #include <uORB/topics/optical_flow.h>
 #include <uORB/topics/parameter_update.h>
+#include <uORB/topics/sensor_accel.h>
 #include <uORB/topics/sensor_bias.h>
 #include <uORB/topics/sensor_combined.h>
+#include <uORB/topics/sensor_correction.h>
+#include <uORB/topics/sensor_gyro.h>
+#include <uORB/topics/sensor_mag.h>
 #include <uORB/topics/sensor_selection.h>
 #include <uORB/topics/vehicle_air_data.h>
 #include <uORB/topics/vehicle_attitude.h>
@@ -75,6 +82,8 @@
 #include <uORB/topics/vehicle_status.h>
 #include <uORB/topics/wind_estimate.h>
 
+#include "LaneSelector.hpp"
+
 // defines used to specify the mask position for use of different accuracy metrics in the GPS blending algorithm
 #define BLEND_MASK_USE_SPD_ACC      1
 #define BLEND_MASK_USE_HPOS_ACC     2
@@ -123,7 +132,7 @@ private:
 	void update_mag_bias(Param &mag_bias_param, int axis_index);
 	template<typename Param>
 	bool update_mag_decl(Param &mag_decl_param);
-	bool publish_attitude(const sensor_combined_s &sensors, const hrt_abstime &now);
+	bool publish_attitude(const hrt_abstime &now);
 	bool publish_wind_estimate(const hrt_abstime &timestamp);
 
 	const Vector3f get_vel_body_wind();
@@ -165,6 +174,86 @@ private:
 	 */
 	float filter_altitude_ellipsoid(float amsl_hgt);
 
+	/*
+	 * Create the estimators of the secondary lanes in a single block of memory. Their IMUs are bound by
+	 * lanes_assign_imus().
+	 */
+	void lanes_allocate(int num_lanes);
+
+	/*
+	 * Call f with the estimator of every running lane.
+	 */
+	template<typename F>
+	void lanes_for_each(F f)
+	{
+		for (uint8_t lane = 0; lane < _lane_count; lane++) {
+			f(*_lanes[lane].ekf);
+		}
+	}
+
+	/*
+	 * Destroy the estimators of the secondary lanes and release their memory.
+	 */
+	void lanes_free();
+
+	/*
+	 * Copy the parameters of the primary lane to the secondary lanes and update the board rotation.
+	 */
+	void lanes_update_params();
+
+	/*
+	 * Bind each secondary lane to its own gyro and accelerometer: enabled in the calibration of the sensors
+	 * module, not the voted sensor used by the primary lane and not used by another lane.
+	 * @return bit mask of the lanes whose IMU changed, they have to reset their IMU bias estimates
+	 */
+	uint8_t lanes_assign_imus(const sensor_selection_s &selection);
+
+	/*
+	 * Find the next IMU instance a secondary lane can use.
+	 * @param cal_name sensor name in the calibration parameters (CAL_<cal_name>x_ID), GYRO or ACC
+	 * @return uORB instance, starting the search at first_instance, or -1 if there is none
+	 */
+	template<typename T>
+	int find_lane_imu(const orb_metadata *meta, const char *cal_name, uint32_t voted_device_id, int first_instance);
+
+	/*
+	 * Push new IMU data of each secondary lane to its estimator and flag the lanes which received data.
+	 */
+	void lanes_update_imu(const hrt_abstime &now, bool (&imu_updated)[LaneSelector::MAX_LANES]);
+
+	/*
+	 * Push new data of the magnetometer of each secondary lane to its estimator, if enabled by EKF2_MULTI_MAG.
+	 */
+	void lanes_update_mag();
+
+	/*
+	 * Find the rotation from the magnetometer to the body frame in the calibration of the sensors module.
+	 * @return false if there is no enabled calibration for the device
+	 */
+	bool get_mag_rotation(uint32_t device_id, matrix::Dcmf &rotation);
+
+	/*
+	 * Update the health of all lanes and select the lane whose estimate is published.
+	 */
+	void lanes_select(const hrt_abstime &now);
+
+	/*
+	 * Publish the estimate of another lane. The difference between the two estimates is reported as a reset of
+	 * the attitude, position and velocity, so that consumers handle the switch like any other state reset.
+	 */
+	void lanes_switch(uint8_t old_lane, uint8_t new_lane);
+
+	// state of the reset counters and deltas of the published estimate across lane switches
+	struct LaneReset {
+		float delta[4] {};		///< state change caused by the last lane switch
+		uint8_t counter_offset{0};	///< added to the reset counter of the selected lane
+		uint8_t lane_counter{0};	///< reset counter of the selected lane when it was selected
+		bool active{false};		///< true once a lane switch happened
+	};
+
+	void update_lane_reset(LaneReset &reset, uint8_t counter_prev, uint8_t counter_new);
+	void apply_lane_reset(const LaneReset &reset, float *delta, uint8_t *counter, unsigned size);
+
 	bool 	_replay_mode = false;			///< true when we use replay data from a log
 
 	// time slip monitoring
@@ -174,15 +263,27 @@ private:
 
 	perf_counter_t _perf_update_data;
 	perf_counter_t _perf_ekf_update;
+	perf_counter_t _perf_lanes_update;
 
 	// Initialise time stamps used to send sensor data to the EKF and for logging
 	uint8_t _invalid_mag_id_count = 0;	///< number of times an invalid magnetomer device ID has been detected
 
 	// Used to down sample magnetometer data
-	float _mag_data_sum[3] = {};			///< summed magnetometer readings (Gauss)
-	uint64_t _mag_time_sum_ms = 0;		///< summed magnetoemter time stamps (mSec)
-	uint8_t _mag_sample_count = 0;		///< number of magnetometer measurements summed during downsampling
-	int32_t _mag_time_ms_last_used = 0;	///< time stamp of the last averaged magnetometer measurement sent to the EKF (mSec)
+	struct MagDownsample {
+		float data_sum[3] {};		///< summed magnetometer readings (Gauss)
+		uint64_t time_sum_ms{0};	///< summed magnetometer time stamps (mSec)
+		uint8_t sample_count{0};	///< number of magnetometer measurements summed during downsampling
+		int32_t time_ms_last_used{0};	///< time stamp of the last averaged magnetometer measurement sent to the EKF (mSec)
+	};
+
+	MagDownsample _mag_downsample{};	///< down sampling of the voted magnetometer data
+
+	/*
+	 * Add a magnetometer sample to the sum. Once the minimum sensor interval has passed since the last average was
+	 * used, return true with the average of the summed samples and restart the sum.
+	 */
+	bool downsample_mag(MagDownsample &mag, uint64_t timestamp, const float (&field_ga)[3], uint64_t &time_us,
+			    float (&field_avg_ga)[3]);
 
 	// Used to down sample barometer data
 	float _balt_data_sum = 0.0f;			///< summed pressure altitude readings (m)
@@ -289,6 +390,51 @@ private:
 
 	parameters *_params;	///< pointer to ekf parameter struct (located in _ekf class instance)
 
+	// Multi-lane estimation: lane 0 is _ekf, running on sensor_combined and the voted magnetometer. Lane N runs on
+	// an enabled IMU other than the voted one (see lanes_assign_imus()) and, if EKF2_MULTI_MAG is set, on
+	// magnetometer instance N. All other sensor data is shared.
+	struct EstimatorLane {
+		Ekf *ekf{nullptr};
+		int gyro_sub{-1};		///< gyro subscription, not used by the primary lane
+		int accel_sub{-1};		///< accelerometer subscription, not used by the primary lane
+		int gyro_instance{-1};		///< uORB instance of the gyro, -1 if the lane has none
+		int accel_instance{-1};		///< uORB instance of the accelerometer, -1 if the lane has none
+		float delta_ang[3] {};		///< gyro integral not yet pushed to the estimator, body frame (rad)
+		float delta_vel[3] {};		///< accel integral not yet pushed to the estimator, body frame (m/sec)
+		uint32_t delta_ang_dt{0};	///< integration period of delta_ang (uSec)
+		uint32_t delta_vel_dt{0};	///< integration period of delta_vel (uSec)
+		float gyro_rad[3] {};		///< latest angular rate in body frame (rad/sec)
+		float accel_m_s2[3] {};		///< latest specific force in body frame (m/sec**2)
+		hrt_abstime time_last_imu{0};	///< time the last IMU sample was pushed to the estimator (uSec)
+		int mag_sub{-1};		///< magnetometer subscription, only with EKF2_MULTI_MAG
+		uint32_t mag_device_id{0};	///< device id of the magnetometer, 0 until its calibration has been found
+		bool mag_own{false};		///< true when the lane uses its own magnetometer instead of the voted one
+		matrix::Dcmf mag_rotation;	///< rotation from the magnetometer to the body frame
+		MagDownsample mag_downsample{};	///< down sampling of the magnetometer data of the lane
+		bool updated{false};		///< true when the estimator has updated on the current iteration
+	};
+
+	EstimatorLane _lanes[LaneSelector::MAX_LANES] {};
+	uint8_t _lane_count{1};			///< number of running lanes
+	uint8_t *_lane_arena{nullptr};		///< memory holding the estimators of the secondary lanes
+	LaneSelector _lane_selector;		///< selects the lane whose estimate is published
+
+	int _sensor_correction_sub{-1};
+	sensor_correction_s _sensor_correction{};	///< thermal corrections of the secondary IMUs
+	matrix::Dcmf _board_rotation;			///< rotation from the IMU board frame to the body frame
+
+	LaneReset _quat_reset{};
+	LaneReset _posNE_reset{};
+	LaneReset _posD_reset{};
+	LaneReset _velNE_reset{};
+	LaneReset _velD_reset{};
+
+	static constexpr hrt_abstime LANE_IMU_TIMEOUT{100_ms};	///< lane is unhealthy without IMU data
+	static constexpr unsigned MAG_CAL_COUNT{4};		///< number of CAL_MAGx calibrations of the sensors module
+	static constexpr unsigned IMU_CAL_COUNT{3};		///< number of CAL_GYROx and CAL_ACCx calibrations
+	static constexpr int LANE_IMU_INSTANCES{3};		///< IMU instances with sensor_correction data
+	static constexpr hrt_abstime LANE_IMU_RETRY{1_s};	///< interval to look for an IMU for lanes without one
+
 	DEFINE_PARAMETERS(
 		(ParamExtInt<px4::params::EKF2_MIN_OBS_DT>)
 		_obs_dt_min_ms,	///< Maximum time delay of any sensor used to increase buffer length to handle large timing jitter (mSec)
@@ -498,7 +644,19 @@ private:
 
 		// Test used to determine if the vehicle is static or moving
 		(ParamExtFloat<px4::params::EKF2_MOVE_TEST>)
-		_is_moving_scaler	///< scaling applied to IMU data thresholds used to determine if the vehicle is static or moving.
+		_is_moving_scaler,	///< scaling applied to IMU data thresholds used to determine if the vehicle is static or moving.
+
+		// multi-lane estimation
+		(ParamInt<px4::params::EKF2_MULTI_IMU>) _multi_imu,	///< number of estimator lanes
+		(ParamInt<px4::params::EKF2_MULTI_MAG>) _multi_mag,	///< secondary lanes use their own magnetometer
+		(ParamFloat<px4::params::EKF2_SEL_HYST>)
+		_lane_sel_hysteresis,	///< test ratio improvement required to switch to a healthy lane
+
+		// board rotation applied to the IMUs of the secondary lanes
+		(ParamInt<px4::params::SENS_BOARD_ROT>) _board_rot,
+		(ParamFloat<px4::params::SENS_BOARD_X_OFF>) _board_offset_x,
+		(ParamFloat<px4::params::SENS_BOARD_Y_OFF>) _board_offset_y,
+		(ParamFloat<px4::params::SENS_BOARD_Z_OFF>) _board_offset_z
 
 	)
 
@@ -508,6 +666,7 @@ Ekf2::Ekf2():
 	ModuleParams(nullptr),
 	_perf_update_data(perf_alloc_once(PC_ELAPSED, "EKF2 data acquisition")),
 	_perf_ekf_update(perf_alloc_once(PC_ELAPSED, "EKF2 update")),
+	_perf_lanes_update(perf_alloc_once(PC_ELAPSED, "EKF2 secondary lanes update")),
 	_vehicle_local_position_pub(ORB_ID(vehicle_local_position)),
 	_vehicle_global_position_pub(ORB_ID(vehicle_global_position)),
 	_vehicle_odometry_pub(ORB_ID(vehicle_odometry)),
@@ -624,14 +783,19 @@ Ekf2::Ekf2():
 		_range_finder_subs[i] = orb_subscribe_multi(ORB_ID(distance_sensor), i);
 	}
 
+	_lanes[0].ekf = &_ekf;
+
 	// initialise parameter cache
 	updateParams();
 }
 
 Ekf2::~Ekf2()
 {
+	lanes_free();
+
 	perf_free(_perf_update_data);
 	perf_free(_perf_ekf_update);
+	perf_free(_perf_lanes_update);
 
 	orb_unsubscribe(_airdata_sub);
 	orb_unsubscribe(_airspeed_sub);
@@ -656,14 +820,32 @@ Ekf2::~Ekf2()
 
 int Ekf2::print_status()
 {
-	PX4_INFO("local position: %s", (_ekf.local_position_is_valid()) ? "valid" : "invalid");
-	PX4_INFO("global position: %s", (_ekf.global_position_is_valid()) ? "valid" : "invalid");
+	Ekf &ekf = *_lanes[_lane_selector.selected()].ekf;
+
+	PX4_INFO("local position: %s", (ekf.local_position_is_valid()) ? "valid" : "invalid");
+	PX4_INFO("global position: %s", (ekf.global_position_is_valid()) ? "valid" : "invalid");
 
 	PX4_INFO("time slip: %" PRId64 " us", _last_time_slip_us);
 
+	if (_lane_count > 1) {
+		PX4_INFO("lanes: %u, selected: %u, switches: %u, memory: %u bytes", _lane_count, _lane_selector.selected(),
+			 (unsigned)_lane_selector.switch_count(), (unsigned)((_lane_count - 1) * sizeof(Ekf)));
+
+		for (uint8_t lane = 0; lane < _lane_count; lane++) {
+			PX4_INFO("lane %u: %s, test ratio %.2f, gyro %d, accel %d, mag %s", lane,
+				 _lane_selector.healthy(lane) ? "healthy" : "unhealthy", (double)_lane_selector.test_ratio(lane),
+				 _lanes[lane].gyro_instance, _lanes[lane].accel_instance,
+				 _lanes[lane].mag_own ? "own" : "voted");
+		}
+	}
+
 	perf_print_counter(_perf_update_data);
 	perf_print_counter(_perf_ekf_update);
 
+	if (_lane_count > 1) {
+		perf_print_counter(_perf_lanes_update);
+	}
+
 	return 0;
 }
 
@@ -692,7 +874,7 @@ bool Ekf2::update_mag_decl(Param &mag_decl_param)
 	// update stored declination value
 	float declination_deg;
 
-	if (_ekf.get_mag_decl_deg(&declination_deg)) {
+	if (_lanes[_lane_selector.selected()].ekf->get_mag_decl_deg(&declination_deg)) {
 		mag_decl_param.set(declination_deg);
 		mag_decl_param.commit_no_notification();
 		return true;
@@ -703,7 +885,9 @@ bool Ekf2::update_mag_decl(Param &mag_decl_param)
 
 void Ekf2::run()
 {
-	bool imu_bias_reset_request = false;
+	uint8_t imu_bias_reset_lanes = 0;	// lanes which still have to reset their IMU bias estimates
+	hrt_abstime lanes_imu_assign_time = 0;	// last time the IMUs of the secondary lanes were assigned
+	bool lanes_imu_missing = false;		// a secondary lane has no IMU
 
 	px4_pollfd_struct_t fds[1] = {};
 	fds[0].fd = _sensors_sub;
@@ -717,6 +901,8 @@ void Ekf2::run()
 	vehicle_status_s vehicle_status = {};
 	sensor_selection_s sensor_selection = {};
 
+	lanes_allocate(_multi_imu.get());
+
 	while (!should_exit()) {
 		int ret = px4_poll(fds, sizeof(fds) / sizeof(fds[0]), 1000);
 
@@ -745,6 +931,7 @@ void Ekf2::run()
 			parameter_update_s update;
 			orb_copy(ORB_ID(parameter_update), _params_sub, &update);
 			updateParams();
+			lanes_update_params();
 		}
 
 		orb_copy(ORB_ID(sensor_combined), _sensors_sub, &sensors);
@@ -769,11 +956,13 @@ void Ekf2::run()
 
 		if (vehicle_status_updated) {
 			if (orb_copy(ORB_ID(vehicle_status), _status_sub, &vehicle_status) == PX4_OK) {
-				// only fuse synthetic sideslip measurements if conditions are met
-				_ekf.set_fuse_beta_flag(!vehicle_status.is_rotary_wing && (_fuseBeta.get() == 1));
+				lanes_for_each([&](Ekf & ekf) {
+					// only fuse synthetic sideslip measurements if conditions are met
+					ekf.set_fuse_beta_flag(!vehicle_status.is_rotary_wing && (_fuseBeta.get() == 1));
 
-				// let the EKF know if the vehicle motion is that of a fixed wing (forward flight only relative to wind)
-				_ekf.set_is_fixed_wing(!vehicle_status.is_rotary_wing);
+					// let the EKF know if the vehicle motion is that of a fixed wing (forward flight only relative to wind)
+					ekf.set_is_fixed_wing(!vehicle_status.is_rotary_wing);
+				});
 			}
 		}
 
@@ -781,28 +970,53 @@ void Ekf2::run()
 
 		orb_check(_sensor_selection_sub, &sensor_selection_updated);
 
+		// the calibration decides which IMUs the secondary lanes may use
+		bool lanes_imu_assign = params_updated;
+
 		// Always update sensor selction first time through if time stamp is non zero
 		if (sensor_selection_updated || (sensor_selection.timestamp == 0)) {
 			sensor_selection_s sensor_selection_prev = sensor_selection;
 
 			if (orb_copy(ORB_ID(sensor_selection), _sensor_selection_sub, &sensor_selection) == PX4_OK) {
 				if ((sensor_selection_prev.timestamp > 0) && (sensor_selection.timestamp > sensor_selection_prev.timestamp)) {
+					// the secondary lanes reset when lanes_assign_imus() moves them to another IMU
 					if (sensor_selection.accel_device_id != sensor_selection_prev.accel_device_id) {
 						PX4_WARN("accel id changed, resetting IMU bias");
-						imu_bias_reset_request = true;
+						imu_bias_reset_lanes |= 1;
 					}
 
 					if (sensor_selection.gyro_device_id != sensor_selection_prev.gyro_device_id) {
 						PX4_WARN("gyro id changed, resetting IMU bias");
-						imu_bias_reset_request = true;
+						imu_bias_reset_lanes |= 1;
 					}
 				}
+
+				lanes_imu_assign = true;
 			}
 		}
 
-		// attempt reset until successful
-		if (imu_bias_reset_request) {
-			imu_bias_reset_request = !_ekf.reset_imu_bias();
+		// retry lanes without an IMU, their sensor might not have published yet
+		if (lanes_imu_missing && hrt_elapsed_time(&lanes_imu_assign_time) > LANE_IMU_RETRY) {
+			lanes_imu_assign = true;
+		}
+
+		if (lanes_imu_assign && _lane_count > 1) {
+			imu_bias_reset_lanes |= lanes_assign_imus(sensor_selection);
+			lanes_imu_assign_time = hrt_absolute_time();
+			lanes_imu_missing = false;
+
+			for (uint8_t lane = 1; lane < _lane_count; lane++) {
+				if (_lanes[lane].gyro_sub < 0 || _lanes[lane].accel_sub < 0) {
+					lanes_imu_missing = true;
+				}
+			}
+		}
+
+		// attempt reset until successful on every lane
+		for (uint8_t lane = 0; lane < _lane_count; lane++) {
+			if ((imu_bias_reset_lanes & (1 << lane)) && _lanes[lane].ekf->reset_imu_bias()) {
+				imu_bias_reset_lanes &= ~(1 << lane);
+			}
 		}
 
 		// in replay mode we are getting the actual timestamp from the sensor topic
@@ -830,8 +1044,17 @@ void Ekf2::run()
 
 		_ekf.setIMUData(now, sensors.gyro_integral_dt, sensors.accelerometer_integral_dt, gyro_integral, accel_integral);
 
+		memcpy(_lanes[0].gyro_rad, sensors.gyro_rad, sizeof(_lanes[0].gyro_rad));
+		memcpy(_lanes[0].accel_m_s2, sensors.accelerometer_m_s2, sizeof(_lanes[0].accel_m_s2));
+		_lanes[0].time_last_imu = now;
+
+		// push imu and magnetometer data of the secondary lanes
+		bool imu_updated[LaneSelector::MAX_LANES] {};
+		lanes_update_imu(now, imu_updated);
+		lanes_update_mag();
+
 		// publish attitude immediately (uses quaternion from output predictor)
-		publish_attitude(sensors, now);
+		publish_attitude(now);
 
 		// read mag data
 		bool magnetometer_updated = false;
@@ -875,29 +1098,21 @@ void Ekf2::run()
 
 				// If the time last used by the EKF is less than specified, then accumulate the
 				// data and push the average when the specified interval is reached.
-				_mag_time_sum_ms += magnetometer.timestamp / 1000;
-				_mag_sample_count++;
-				_mag_data_sum[0] += magnetometer.magnetometer_ga[0];
-				_mag_data_sum[1] += magnetometer.magnetometer_ga[1];
-				_mag_data_sum[2] += magnetometer.magnetometer_ga[2];
-				int32_t mag_time_ms = _mag_time_sum_ms / _mag_sample_count;
-
-				if ((mag_time_ms - _mag_time_ms_last_used) > _params->sensor_interval_min_ms) {
-					const float mag_sample_count_inv = 1.0f / _mag_sample_count;
-					// calculate mean of measurements and correct for learned bias offsets
-					float mag_data_avg_ga[3] = {_mag_data_sum[0] *mag_sample_count_inv - _mag_bias_x.get(),
-								    _mag_data_sum[1] *mag_sample_count_inv - _mag_bias_y.get(),
-								    _mag_data_sum[2] *mag_sample_count_inv - _mag_bias_z.get()
-								   };
-
-					_ekf.setMagData(1000 * (uint64_t)mag_time_ms, mag_data_avg_ga);
-
-					_mag_time_ms_last_used = mag_time_ms;
-					_mag_time_sum_ms = 0;
-					_mag_sample_count = 0;
-					_mag_data_sum[0] = 0.0f;
-					_mag_data_sum[1] = 0.0f;
-					_mag_data_sum[2] = 0.0f;
+				uint64_t mag_time_us;
+				float mag_data_avg_ga[3];
+
+				if (downsample_mag(_mag_downsample, magnetometer.timestamp, magnetometer.magnetometer_ga, mag_time_us,
+						   mag_data_avg_ga)) {
+					// correct for learned bias offsets
+					mag_data_avg_ga[0] -= _mag_bias_x.get();
+					mag_data_avg_ga[1] -= _mag_bias_y.get();
+					mag_data_avg_ga[2] -= _mag_bias_z.get();
+
+					for (uint8_t lane = 0; lane < _lane_count; lane++) {
+						if (!_lanes[lane].mag_own) {
+							_lanes[lane].ekf->setMagData(mag_time_us, mag_data_avg_ga);
+						}
+					}
 				}
 
 				ekf2_timestamps.vehicle_magnetometer_timestamp_rel = (int16_t)((int64_t)magnetometer.timestamp / 100 -
@@ -924,7 +1139,7 @@ void Ekf2::run()
 					// take mean across sample period
 					float balt_data_avg = _balt_data_sum / (float)_balt_sample_count;
 
-					_ekf.set_air_density(airdata.rho);
+					lanes_for_each([&](Ekf & ekf) { ekf.set_air_density(airdata.rho); });
 
 					// calculate static pressure error = Pmeas - Ptruth
 					// model position error sensitivity as a body fixed ellipse with different scale in the positive and negtive X direction
@@ -951,7 +1166,9 @@ void Ekf2::run()
 					balt_data_avg += pstatic_err / (airdata.rho * CONSTANTS_ONE_G);
 
 					// push to estimator
-					_ekf.setBaroData(1000 * (uint64_t)balt_time_ms, balt_data_avg);
+					lanes_for_each([&](Ekf & ekf) {
+						ekf.setBaroData(1000 * (uint64_t)balt_time_ms, balt_data_avg);
+					});
 
 					_balt_time_ms_last_used = balt_time_ms;
 					_balt_time_sum_ms = 0;
@@ -1028,7 +1245,7 @@ void Ekf2::run()
 
 		if ((_gps_blend_mask.get() == 0) && gps1_updated) {
 			// When GPS blending is disabled we always use the first receiver instance
-			_ekf.setGpsData(_gps_state[0].time_usec, &_gps_state[0]);
+			lanes_for_each([&](Ekf & ekf) { ekf.setGpsData(_gps_state[0].time_usec, &_gps_state[0]); });
 
 		} else if ((_gps_blend_mask.get() > 0) && (gps1_updated || gps2_updated)) {
 			// blend dual receivers if available
@@ -1073,7 +1290,10 @@ void Ekf2::run()
 				}
 
 				// write selected GPS to EKF
-				_ekf.setGpsData(_gps_output[_gps_select_index].time_usec, &_gps_output[_gps_select_index]);
+				lanes_for_each([&](Ekf & ekf) {
+					ekf.setGpsData(_gps_output[_gps_select_index].time_usec,
+						&_gps_output[_gps_select_index]);
+				});
 
 				// log blended solution as a third GPS instance
 				ekf_gps_position_s gps;
@@ -1114,7 +1334,10 @@ void Ekf2::run()
 				if ((_arspFusionThreshold.get() > FLT_EPSILON) && (airspeed.true_airspeed_m_s > _arspFusionThreshold.get())) {
 
 					const float eas2tas = airspeed.true_airspeed_m_s / airspeed.indicated_airspeed_m_s;
-					_ekf.setAirspeedData(airspeed.timestamp, airspeed.true_airspeed_m_s, eas2tas);
+					lanes_for_each([&](Ekf & ekf) {
+						ekf.setAirspeedData(airspeed.timestamp, airspeed.true_airspeed_m_s,
+							eas2tas);
+					});
 				}
 
 				ekf2_timestamps.airspeed_timestamp_rel = (int16_t)((int64_t)airspeed.timestamp / 100 -
@@ -1142,12 +1365,16 @@ void Ekf2::run()
 				if (PX4_ISFINITE(optical_flow.pixel_flow_y_integral) &&
 				    PX4_ISFINITE(optical_flow.pixel_flow_x_integral)) {
 
-					_ekf.setOpticalFlowData(optical_flow.timestamp, &flow);
+					lanes_for_each([&](Ekf & ekf) {
+						ekf.setOpticalFlowData(optical_flow.timestamp, &flow);
+					});
 				}
 
 				// Save sensor limits reported by the optical flow sensor
-				_ekf.set_optical_flow_limits(optical_flow.max_flow_rate, optical_flow.min_ground_distance,
-							     optical_flow.max_ground_distance);
+				lanes_for_each([&](Ekf & ekf) {
+					ekf.set_optical_flow_limits(optical_flow.max_flow_rate, optical_flow.min_ground_distance,
+						optical_flow.max_ground_distance);
+				});
 
 				ekf2_timestamps.optical_flow_timestamp_rel = (int16_t)((int64_t)optical_flow.timestamp / 100 -
 						(int64_t)ekf2_timestamps.timestamp / 100);
@@ -1175,10 +1402,18 @@ void Ekf2::run()
 						}
 					}
 
-					if (range_finder_updated) { _ekf.setRangeData(range_finder.timestamp, range_finder.current_distance); }
+					if (range_finder_updated) {
+						lanes_for_each([&](Ekf & ekf) {
+							ekf.setRangeData(range_finder.timestamp,
+								range_finder.current_distance);
+						});
+					}
 
 					// Save sensor limits reported by the rangefinder
-					_ekf.set_rangefinder_limits(range_finder.min_distance, range_finder.max_distance);
+					lanes_for_each([&](Ekf & ekf) {
+						ekf.set_rangefinder_limits(range_finder.min_distance,
+							range_finder.max_distance);
+					});
 
 					ekf2_timestamps.distance_sensor_timestamp_rel = (int16_t)((int64_t)range_finder.timestamp / 100 -
 							(int64_t)ekf2_timestamps.timestamp / 100);
@@ -1238,7 +1473,7 @@ void Ekf2::run()
 			// only set data if all positions and orientation are valid
 			if (ev_data.posErr < ep_max_std_dev && ev_data.angErr < eo_max_std_dev) {
 				// use timestamp from external computer, clocks are synchronized when using MAVROS
-				_ekf.setExtVisionData(ev_odom.timestamp, &ev_data);
+				lanes_for_each([&](Ekf & ekf) { ekf.setExtVisionData(ev_odom.timestamp, &ev_data); });
 			}
 
 			ekf2_timestamps.visual_odometry_timestamp_rel = (int16_t)((int64_t)ev_odom.timestamp / 100 -
@@ -1250,7 +1485,9 @@ void Ekf2::run()
 
 		if (vehicle_land_detected_updated) {
 			if (orb_copy(ORB_ID(vehicle_land_detected), _vehicle_land_detected_sub, &vehicle_land_detected) == PX4_OK) {
-				_ekf.set_in_air_status(!vehicle_land_detected.landed);
+				lanes_for_each([&](Ekf & ekf) {
+					ekf.set_in_air_status(!vehicle_land_detected.landed);
+				});
 			}
 		}
 
@@ -1267,7 +1504,9 @@ void Ekf2::run()
 					// velocity of vehicle relative to target has opposite sign to target relative to vehicle
 					float velocity[2] = {-landing_target_pose.vx_rel, -landing_target_pose.vy_rel};
 					float variance[2] = {landing_target_pose.cov_vx_rel, landing_target_pose.cov_vy_rel};
-					_ekf.setAuxVelData(landing_target_pose.timestamp, velocity, variance);
+					lanes_for_each([&](Ekf & ekf) {
+						ekf.setAuxVelData(landing_target_pose.timestamp, velocity, variance);
+					});
 				}
 			}
 		}
@@ -1276,9 +1515,27 @@ void Ekf2::run()
 
 		// run the EKF update and output
 		perf_begin(_perf_ekf_update);
-		const bool updated = _ekf.update();
+		_lanes[0].updated = _ekf.update();
 		perf_end(_perf_ekf_update);
 
+		if (_lane_count > 1) {
+			perf_begin(_perf_lanes_update);
+
+			for (uint8_t lane = 1; lane < _lane_count; lane++) {
+				// the output predictor must only run on new IMU data
+				_lanes[lane].updated = imu_updated[lane] && _lanes[lane].ekf->update();
+			}
+
+			perf_end(_perf_lanes_update);
+
+			lanes_select(now);
+		}
+
+		// everything below is published from the selected lane
+		const EstimatorLane &selected_lane = _lanes[_lane_selector.selected()];
+		Ekf &ekf = *selected_lane.ekf;
+		const bool updated = selected_lane.updated;
+
 		// integrate time to monitor time slippage
 		if (_start_time_us == 0) {
 			_start_time_us = now;
@@ -1292,7 +1549,7 @@ void Ekf2::run()
 		if (updated) {
 
 			filter_control_status_u control_status;
-			_ekf.get_control_mode(&control_status.value);
+			ekf.get_control_mode(&control_status.value);
 
 			// only publish position after successful alignment
 			if (control_status.flags.tilt_align) {
@@ -1309,11 +1566,11 @@ void Ekf2::run()
 
 				// Position of body origin in local NED frame
 				float position[3];
-				_ekf.get_position(position);
+				ekf.get_position(position);
 				const float lpos_x_prev = lpos.x;
 				const float lpos_y_prev = lpos.y;
-				lpos.x = (_ekf.local_position_is_valid()) ? position[0] : 0.0f;
-				lpos.y = (_ekf.local_position_is_valid()) ? position[1] : 0.0f;
+				lpos.x = (ekf.local_position_is_valid()) ? position[0] : 0.0f;
+				lpos.y = (ekf.local_position_is_valid()) ? position[1] : 0.0f;
 				lpos.z = position[2];
 
 				// Vehicle odometry position
@@ -1323,7 +1580,7 @@ void Ekf2::run()
 
 				// Velocity of body origin in local NED frame (m/s)
 				float velocity[3];
-				_ekf.get_velocity(velocity);
+				ekf.get_velocity(velocity);
 				lpos.vx = velocity[0];
 				lpos.vy = velocity[1];
 				lpos.vz = velocity[2];
@@ -1334,19 +1591,19 @@ void Ekf2::run()
 				odom.vz = lpos.vz;
 
 				// vertical position time derivative (m/s)
-				_ekf.get_pos_d_deriv(&lpos.z_deriv);
+				ekf.get_pos_d_deriv(&lpos.z_deriv);
 
 				// Acceleration of body origin in local NED frame
 				float vel_deriv[3];
-				_ekf.get_vel_deriv_ned(vel_deriv);
+				ekf.get_vel_deriv_ned(vel_deriv);
 				lpos.ax = vel_deriv[0];
 				lpos.ay = vel_deriv[1];
 				lpos.az = vel_deriv[2];
 
 				// TODO: better status reporting
-				lpos.xy_valid = _ekf.local_position_is_valid() && !_preflt_horiz_fail;
+				lpos.xy_valid = ekf.local_position_is_valid() && !_preflt_horiz_fail;
 				lpos.z_valid = !_preflt_vert_fail;
-				lpos.v_xy_valid = _ekf.local_position_is_valid() && !_preflt_horiz_fail;
+				lpos.v_xy_valid = ekf.local_position_is_valid() && !_preflt_horiz_fail;
 				lpos.v_z_valid = !_preflt_vert_fail;
 
 				// Position of local NED origin in GPS / WGS84 frame
@@ -1354,7 +1611,7 @@ void Ekf2::run()
 				uint64_t origin_time;
 
 				// true if position (x,y,z) has a valid WGS-84 global reference (ref_lat, ref_lon, alt)
-				const bool ekf_origin_valid = _ekf.get_ekf_origin(&origin_time, &ekf_origin, &lpos.ref_alt);
+				const bool ekf_origin_valid = ekf.get_ekf_origin(&origin_time, &ekf_origin, &lpos.ref_alt);
 				lpos.xy_global = ekf_origin_valid;
 				lpos.z_global = ekf_origin_valid;
 
@@ -1366,7 +1623,7 @@ void Ekf2::run()
 
 				// The rotation of the tangent plane vs. geographical north
 				matrix::Quatf q;
-				_ekf.copy_quaternion(q.data());
+				ekf.copy_quaternion(q.data());
 
 				lpos.yaw = matrix::Eulerf(q).psi();
 
@@ -1375,15 +1632,15 @@ void Ekf2::run()
 
 				// Vehicle odometry angular rates
 				float gyro_bias[3];
-				_ekf.get_gyro_bias(gyro_bias);
-				odom.rollspeed = sensors.gyro_rad[0] - gyro_bias[0];
-				odom.pitchspeed = sensors.gyro_rad[1] - gyro_bias[1];
-				odom.yawspeed = sensors.gyro_rad[2] - gyro_bias[2];
+				ekf.get_gyro_bias(gyro_bias);
+				odom.rollspeed = selected_lane.gyro_rad[0] - gyro_bias[0];
+				odom.pitchspeed = selected_lane.gyro_rad[1] - gyro_bias[1];
+				odom.yawspeed = selected_lane.gyro_rad[2] - gyro_bias[2];
 
-				lpos.dist_bottom_valid = _ekf.get_terrain_valid();
+				lpos.dist_bottom_valid = ekf.get_terrain_valid();
 
 				float terrain_vpos;
-				_ekf.get_terrain_vert_pos(&terrain_vpos);
+				ekf.get_terrain_vert_pos(&terrain_vpos);
 				lpos.dist_bottom = terrain_vpos - lpos.z; // Distance to bottom surface (ground) in meters
 
 				// constrain the distance to ground to _rng_gnd_clearance
@@ -1393,17 +1650,23 @@ void Ekf2::run()
 
 				lpos.dist_bottom_rate = -lpos.vz; // Distance to bottom surface (ground) change rate
 
-				_ekf.get_ekf_lpos_accuracy(&lpos.eph, &lpos.epv);
-				_ekf.get_ekf_vel_accuracy(&lpos.evh, &lpos.evv);
+				ekf.get_ekf_lpos_accuracy(&lpos.eph, &lpos.epv);
+				ekf.get_ekf_vel_accuracy(&lpos.evh, &lpos.evv);
 
 				// get state reset information of position and velocity
-				_ekf.get_posD_reset(&lpos.delta_z, &lpos.z_reset_counter);
-				_ekf.get_velD_reset(&lpos.delta_vz, &lpos.vz_reset_counter);
-				_ekf.get_posNE_reset(&lpos.delta_xy[0], &lpos.xy_reset_counter);
-				_ekf.get_velNE_reset(&lpos.delta_vxy[0], &lpos.vxy_reset_counter);
+				ekf.get_posD_reset(&lpos.delta_z, &lpos.z_reset_counter);
+				ekf.get_velD_reset(&lpos.delta_vz, &lpos.vz_reset_counter);
+				ekf.get_posNE_reset(&lpos.delta_xy[0], &lpos.xy_reset_counter);
+				ekf.get_velNE_reset(&lpos.delta_vxy[0], &lpos.vxy_reset_counter);
+
+				// continue the reset counters across lane switches
+				apply_lane_reset(_posD_reset, &lpos.delta_z, &lpos.z_reset_counter, 1);
+				apply_lane_reset(_velD_reset, &lpos.delta_vz, &lpos.vz_reset_counter, 1);
+				apply_lane_reset(_posNE_reset, &lpos.delta_xy[0], &lpos.xy_reset_counter, 2);
+				apply_lane_reset(_velNE_reset, &lpos.delta_vxy[0], &lpos.vxy_reset_counter, 2);
 
 				// get control limit information
-				_ekf.get_ekf_ctrl_limits(&lpos.vxy_max, &lpos.vz_max, &lpos.hagl_min, &lpos.hagl_max);
+				ekf.get_ekf_ctrl_limits(&lpos.vxy_max, &lpos.vz_max, &lpos.hagl_min, &lpos.hagl_max);
 
 				// convert NaN to INFINITY
 				if (!PX4_ISFINITE(lpos.vxy_max)) {
@@ -1424,7 +1687,7 @@ void Ekf2::run()
 
 				// Get covariances to vehicle odometry
 				float covariances[24];
-				_ekf.get_covariances(covariances);
+				ekf.get_covariances(covariances);
 
 				// get the covariance matrix size
 				const size_t POS_URT_SIZE = sizeof(odom.pose_covariance) / sizeof(odom.pose_covariance[0]);
@@ -1459,7 +1722,7 @@ void Ekf2::run()
 				// publish vehicle odometry data
 				_vehicle_odometry_pub.update();
 
-				if (_ekf.global_position_is_valid() && !_preflt_fail) {
+				if (ekf.global_position_is_valid() && !_preflt_fail) {
 					// generate and publish global position data
 					vehicle_global_position_s &global_pos = _vehicle_global_position_pub.get();
 
@@ -1483,7 +1746,7 @@ void Ekf2::run()
 
 					global_pos.yaw = lpos.yaw; // Yaw in radians -PI..+PI.
 
-					_ekf.get_ekf_gpos_accuracy(&global_pos.eph, &global_pos.epv);
+					ekf.get_ekf_gpos_accuracy(&global_pos.eph, &global_pos.epv);
 
 					global_pos.terrain_alt_valid = lpos.dist_bottom_valid;
 
@@ -1494,7 +1757,7 @@ void Ekf2::run()
 						global_pos.terrain_alt = 0.0f; // Terrain altitude in m, WGS84
 					}
 
-					global_pos.dead_reckoning = _ekf.inertial_dead_reckoning(); // True if this position is estimated through dead-reckoning
+					global_pos.dead_reckoning = ekf.inertial_dead_reckoning(); // True if this position is estimated through dead-reckoning
 
 					_vehicle_global_position_pub.update();
 				}
@@ -1508,13 +1771,13 @@ void Ekf2::run()
 
 				// In-run bias estimates
 				float gyro_bias[3];
-				_ekf.get_gyro_bias(gyro_bias);
+				ekf.get_gyro_bias(gyro_bias);
 				bias.gyro_x_bias = gyro_bias[0];
 				bias.gyro_y_bias = gyro_bias[1];
 				bias.gyro_z_bias = gyro_bias[2];
 
 				float accel_bias[3];
-				_ekf.get_accel_bias(accel_bias);
+				ekf.get_accel_bias(accel_bias);
 				bias.accel_x_bias = accel_bias[0];
 				bias.accel_y_bias = accel_bias[1];
 				bias.accel_z_bias = accel_bias[2];
@@ -1524,9 +1787,9 @@ void Ekf2::run()
 				bias.mag_z_bias = _last_valid_mag_cal[2];
 
 				// TODO: remove from sensor_bias?
-				bias.accel_x = sensors.accelerometer_m_s2[0] - accel_bias[0];
-				bias.accel_y = sensors.accelerometer_m_s2[1] - accel_bias[1];
-				bias.accel_z = sensors.accelerometer_m_s2[2] - accel_bias[2];
+				bias.accel_x = selected_lane.accel_m_s2[0] - accel_bias[0];
+				bias.accel_y = selected_lane.accel_m_s2[1] - accel_bias[1];
+				bias.accel_z = selected_lane.accel_m_s2[2] - accel_bias[2];
 
 				if (_sensor_bias_pub == nullptr) {
 					_sensor_bias_pub = orb_advertise(ORB_ID(sensor_bias), &bias);
@@ -1539,24 +1802,24 @@ void Ekf2::run()
 			// publish estimator status
 			estimator_status_s status;
 			status.timestamp = now;
-			_ekf.get_state_delayed(status.states);
+			ekf.get_state_delayed(status.states);
 			status.n_states = 24;
-			_ekf.get_covariances(status.covariances);
-			_ekf.get_gps_check_status(&status.gps_check_fail_flags);
+			ekf.get_covariances(status.covariances);
+			ekf.get_gps_check_status(&status.gps_check_fail_flags);
 			// only report enabled GPS check failures (the param indexes are shifted by 1 bit, because they don't include
 			// the GPS Fix bit, which is always checked)
 			status.gps_check_fail_flags &= ((uint16_t)_params->gps_check_mask << 1) | 1;
 			status.control_mode_flags = control_status.value;
-			_ekf.get_filter_fault_status(&status.filter_fault_flags);
-			_ekf.get_innovation_test_status(&status.innovation_check_flags, &status.mag_test_ratio,
+			ekf.get_filter_fault_status(&status.filter_fault_flags);
+			ekf.get_innovation_test_status(&status.innovation_check_flags, &status.mag_test_ratio,
 							&status.vel_test_ratio, &status.pos_test_ratio,
 							&status.hgt_test_ratio, &status.tas_test_ratio,
 							&status.hagl_test_ratio, &status.beta_test_ratio);
 
 			status.pos_horiz_accuracy = _vehicle_local_position_pub.get().eph;
 			status.pos_vert_accuracy = _vehicle_local_position_pub.get().epv;
-			_ekf.get_ekf_soln_status(&status.solution_status_flags);
-			_ekf.get_imu_vibe_metrics(status.vibe);
+			ekf.get_ekf_soln_status(&status.solution_status_flags);
+			ekf.get_imu_vibe_metrics(status.vibe);
 			status.time_slip = _last_time_slip_us / 1e6f;
 			status.health_flags = 0.0f; // unused
 			status.timeout_flags = 0.0f; // unused
@@ -1573,7 +1836,7 @@ void Ekf2::run()
 			float gps_drift[3];
 			bool blocked;
 
-			if (_ekf.get_gps_drift_metrics(gps_drift, &blocked)) {
+			if (ekf.get_gps_drift_metrics(gps_drift, &blocked)) {
 				ekf_gps_drift_s drift_data;
 				drift_data.timestamp = now;
 				drift_data.hpos_drift_rate = gps_drift[0];
@@ -1616,8 +1879,9 @@ void Ekf2::run()
 					}
 				}
 
-				// Start checking mag bias estimates when we have accumulated sufficient calibration time
-				if (_total_cal_time_us > 120_s) {
+				// Start checking mag bias estimates when we have accumulated sufficient calibration time.
+				// The saved biases belong to the voted magnetometer, a lane with its own magnetometer learns another one.
+				if ((_total_cal_time_us > 120_s) && !selected_lane.mag_own) {
 					// we have sufficient accumulated valid flight time to form a reliable bias estimate
 					// check that the state variance for each axis is within a range indicating filter convergence
 					const float max_var_allowed = 100.0f * _mag_bias_saved_variance.get();
@@ -1668,26 +1932,26 @@ void Ekf2::run()
 				// publish estimator innovation data
 				ekf2_innovations_s innovations;
 				innovations.timestamp = now;
-				_ekf.get_vel_pos_innov(&innovations.vel_pos_innov[0]);
-				_ekf.get_aux_vel_innov(&innovations.aux_vel_innov[0]);
-				_ekf.get_mag_innov(&innovations.mag_innov[0]);
-				_ekf.get_heading_innov(&innovations.heading_innov);
-				_ekf.get_airspeed_innov(&innovations.airspeed_innov);
-				_ekf.get_beta_innov(&innovations.beta_innov);
-				_ekf.get_flow_innov(&innovations.flow_innov[0]);
-				_ekf.get_hagl_innov(&innovations.hagl_innov);
-				_ekf.get_drag_innov(&innovations.drag_innov[0]);
-
-				_ekf.get_vel_pos_innov_var(&innovations.vel_pos_innov_var[0]);
-				_ekf.get_mag_innov_var(&innovations.mag_innov_var[0]);
-				_ekf.get_heading_innov_var(&innovations.heading_innov_var);
-				_ekf.get_airspeed_innov_var(&innovations.airspeed_innov_var);
-				_ekf.get_beta_innov_var(&innovations.beta_innov_var);
-				_ekf.get_flow_innov_var(&innovations.flow_innov_var[0]);
-				_ekf.get_hagl_innov_var(&innovations.hagl_innov_var);
-				_ekf.get_drag_innov_var(&innovations.drag_innov_var[0]);
-
-				_ekf.get_output_tracking_error(&innovations.output_tracking_error[0]);
+				ekf.get_vel_pos_innov(&innovations.vel_pos_innov[0]);
+				ekf.get_aux_vel_innov(&innovations.aux_vel_innov[0]);
+				ekf.get_mag_innov(&innovations.mag_innov[0]);
+				ekf.get_heading_innov(&innovations.heading_innov);
+				ekf.get_airspeed_innov(&innovations.airspeed_innov);
+				ekf.get_beta_innov(&innovations.beta_innov);
+				ekf.get_flow_innov(&innovations.flow_innov[0]);
+				ekf.get_hagl_innov(&innovations.hagl_innov);
+				ekf.get_drag_innov(&innovations.drag_innov[0]);
+
+				ekf.get_vel_pos_innov_var(&innovations.vel_pos_innov_var[0]);
+				ekf.get_mag_innov_var(&innovations.mag_innov_var[0]);
+				ekf.get_heading_innov_var(&innovations.heading_innov_var);
+				ekf.get_airspeed_innov_var(&innovations.airspeed_innov_var);
+				ekf.get_beta_innov_var(&innovations.beta_innov_var);
+				ekf.get_flow_innov_var(&innovations.flow_innov_var[0]);
+				ekf.get_hagl_innov_var(&innovations.hagl_innov_var);
+				ekf.get_drag_innov_var(&innovations.drag_innov_var[0]);
+
+				ekf.get_output_tracking_error(&innovations.output_tracking_error[0]);
 
 				// calculate noise filtered velocity innovations which are used for pre-flight checking
 				if (vehicle_status.arming_state == vehicle_status_s::ARMING_STATE_STANDBY) {
@@ -1771,6 +2035,521 @@ void Ekf2::run()
 	}
 }
 
+void Ekf2::lanes_allocate(int num_lanes)
+{
+	num_lanes = constrain(num_lanes, 1, (int)LaneSelector::MAX_LANES);
+
+	if (num_lanes < 2) {
+		return;
+	}
+
+	// All secondary estimators are constructed in one block to avoid fragmenting the heap. Their sensor data
+	// buffers are part of the block when the EKF is built with ECL_EKF_STATIC_BUFFERS.
+	_lane_arena = new uint8_t[(num_lanes - 1) * sizeof(Ekf)];
+
+	if (_lane_arena == nullptr) {
+		PX4_ERR("alloc of %d estimator lanes failed", num_lanes);
+		return;
+	}
+
+	for (int i = 1; i < num_lanes; i++) {
+		_lanes[i].ekf = new (&_lane_arena[(i - 1) * sizeof(Ekf)]) Ekf();
+
+		if (_multi_mag.get() == 1) {
+			_lanes[i].mag_sub = orb_subscribe_multi(ORB_ID(sensor_mag), i);
+		}
+	}
+
+	_lane_count = num_lanes;
+	_sensor_correction_sub = orb_subscribe(ORB_ID(sensor_correction));
+
+	lanes_update_params();
+}
+
+void Ekf2::lanes_free()
+{
+	for (uint8_t i = 1; i < _lane_count; i++) {
+		_lanes[i].ekf->~Ekf();
+		_lanes[i].ekf = nullptr;
+
+		if (_lanes[i].gyro_sub >= 0) {
+			orb_unsubscribe(_lanes[i].gyro_sub);
+			_lanes[i].gyro_sub = -1;
+			_lanes[i].gyro_instance = -1;
+		}
+
+		if (_lanes[i].accel_sub >= 0) {
+			orb_unsubscribe(_lanes[i].accel_sub);
+			_lanes[i].accel_sub = -1;
+			_lanes[i].accel_instance = -1;
+		}
+
+		if (_lanes[i].mag_sub >= 0) {
+			orb_unsubscribe(_lanes[i].mag_sub);
+			_lanes[i].mag_sub = -1;
+		}
+	}
+
+	if (_sensor_correction_sub >= 0) {
+		orb_unsubscribe(_sensor_correction_sub);
+		_sensor_correction_sub = -1;
+	}
+
+	delete[] _lane_arena;
+	_lane_arena = nullptr;
+	_lane_count = 1;
+	_lane_selector.reset();
+}
+
+void Ekf2::lanes_update_params()
+{
+	for (uint8_t i = 1; i < _lane_count; i++) {
+		*_lanes[i].ekf->getParamHandle() = *_params;
+
+		// look up the magnetometer calibration again, the rotation might have changed
+		_lanes[i].mag_device_id = 0;
+	}
+
+	const matrix::Dcmf board_rotation_offset = matrix::Eulerf(
+				math::radians(_board_offset_x.get()),
+				math::radians(_board_offset_y.get()),
+				math::radians(_board_offset_z.get()));
+
+	_board_rotation = board_rotation_offset * get_rot_matrix((enum Rotation)_board_rot.get());
+}
+
+uint8_t Ekf2::lanes_assign_imus(const sensor_selection_s &selection)
+{
+	uint8_t changed = 0;
+	int gyro_instance = -1;
+	int accel_instance = -1;
+
+	for (uint8_t i = 1; i < _lane_count; i++) {
+		EstimatorLane &lane = _lanes[i];
+
+		// lanes take the usable instances in order, so that no two lanes share a sensor
+		gyro_instance = find_lane_imu<sensor_gyro_s>(ORB_ID(sensor_gyro), "GYRO", selection.gyro_device_id,
+				gyro_instance + 1);
+		accel_instance = find_lane_imu<sensor_accel_s>(ORB_ID(sensor_accel), "ACC", selection.accel_device_id,
+				 accel_instance + 1);
+
+		if (gyro_instance == lane.gyro_instance && accel_instance == lane.accel_instance) {
+			if (gyro_instance < 0 || accel_instance < 0) {
+				// no more instances for the remaining lanes
+				gyro_instance = accel_instance = LANE_IMU_INSTANCES;
+			}
+
+			continue;
+		}
+
+		if (lane.gyro_sub >= 0) {
+			orb_unsubscribe(lane.gyro_sub);
+		}
+
+		if (lane.accel_sub >= 0) {
+			orb_unsubscribe(lane.accel_sub);
+		}
+
+		// the bias estimates of a lane moved to another sensor do not apply anymore
+		if (lane.gyro_instance >= 0 || lane.accel_instance >= 0) {
+			changed |= 1 << i;
+		}
+
+		lane.gyro_instance = gyro_instance;
+		lane.accel_instance = accel_instance;
+		lane.gyro_sub = (gyro_instance >= 0) ? orb_subscribe_multi(ORB_ID(sensor_gyro), gyro_instance) : -1;
+		lane.accel_sub = (accel_instance >= 0) ? orb_subscribe_multi(ORB_ID(sensor_accel), accel_instance) : -1;
+
+		// drop the integrals of the previous sensors
+		memset(lane.delta_ang, 0, sizeof(lane.delta_ang));
+		memset(lane.delta_vel, 0, sizeof(lane.delta_vel));
+		lane.delta_ang_dt = 0;
+		lane.delta_vel_dt = 0;
+
+		if (gyro_instance >= 0 && accel_instance >= 0) {
+			PX4_INFO("lane %u uses gyro %d, accel %d", i, gyro_instance, accel_instance);
+
+		} else {
+			PX4_WARN("lane %u has no %s", i, (gyro_instance < 0) ? "gyro" : "accel");
+			gyro_instance = accel_instance = LANE_IMU_INSTANCES;
+		}
+	}
+
+	return changed;
+}
+
+template<typename T>
+int Ekf2::find_lane_imu(const orb_metadata *meta, const char *cal_name, uint32_t voted_device_id, int first_instance)
+{
+	char str[20];
+
+	for (int instance = first_instance; instance < LANE_IMU_INSTANCES; instance++) {
+		if (orb_exists(meta, instance) != PX4_OK) {
+			continue;
+		}
+
+		// the device id is only known once the instance has published
+		T data{};
+		const int sub = orb_subscribe_multi(meta, instance);
+		const bool published = (orb_copy(meta, sub, &data) == PX4_OK);
+		orb_unsubscribe(sub);
+
+		if (!published || data.device_id == 0 || data.device_id == voted_device_id) {
+			continue;
+		}
+
+		// only use IMUs the sensors module has calibrated and enabled
+		for (unsigned i = 0; i < IMU_CAL_COUNT; i++) {
+			int32_t cal_device_id = 0;
+			(void)sprintf(str, "CAL_%s%u_ID", cal_name, i);
+
+			if ((param_get(param_find(str), &cal_device_id) != PX4_OK)
+			    || ((uint32_t)cal_device_id != data.device_id)) {
+				continue;
+			}
+
+			int32_t enabled = 1;
+			(void)sprintf(str, "CAL_%s%u_EN", cal_name, i);
+			param_get(param_find(str), &enabled);
+
+			if (enabled == 1) {
+				return instance;
+			}
+
+			break;
+		}
+	}
+
+	return -1;
+}
+
+void Ekf2::lanes_update_imu(const hrt_abstime &now, bool (&imu_updated)[LaneSelector::MAX_LANES])
+{
+	if (_lane_count < 2) {
+		return;
+	}
+
+	bool correction_updated = false;
+	orb_check(_sensor_correction_sub, &correction_updated);
+
+	if (correction_updated) {
+		orb_copy(ORB_ID(sensor_correction), _sensor_correction_sub, &_sensor_correction);
+	}
+
+	// thermal corrections indexed by uORB instance, in the sensor frame
+	const float *gyro_offsets[] = {_sensor_correction.gyro_offset_0, _sensor_correction.gyro_offset_1,
+				       _sensor_correction.gyro_offset_2
+				      };
+	const float *gyro_scales[] = {_sensor_correction.gyro_scale_0, _sensor_correction.gyro_scale_1,
+				      _sensor_correction.gyro_scale_2
+				     };
+	const float *accel_offsets[] = {_sensor_correction.accel_offset_0, _sensor_correction.accel_offset_1,
+					_sensor_correction.accel_offset_2
+				       };
+	const float *accel_scales[] = {_sensor_correction.accel_scale_0, _sensor_correction.accel_scale_1,
+				       _sensor_correction.accel_scale_2
+				      };
+
+	for (uint8_t i = 1; i < _lane_count; i++) {
+		EstimatorLane &lane = _lanes[i];
+		bool updated = false;
+
+		if (lane.gyro_sub < 0 || lane.accel_sub < 0) {
+			continue;
+		}
+
+		// The gyro and accel publish independently. Their integrals are accumulated until both have data,
+		// so that no sample is lost when one of them publishes twice before the other.
+		orb_check(lane.gyro_sub, &updated);
+
+		if (updated) {
+			sensor_gyro_s gyro;
+
+			if ((orb_copy(ORB_ID(sensor_gyro), lane.gyro_sub, &gyro) == PX4_OK) && (gyro.integral_dt > 0)) {
+				// convert the integral to a rate, apply the thermal corrections and rotate to the body frame
+				const float dt_inv = 1.e6f / gyro.integral_dt;
+				Vector3f rate(gyro.x_integral, gyro.y_integral, gyro.z_integral);
+				rate *= dt_inv;
+
+				if (_sensor_correction.timestamp > 0) {
+					for (int axis = 0; axis < 3; axis++) {
+						rate(axis) = (rate(axis) - gyro_offsets[lane.gyro_instance][axis])
+							     * gyro_scales[lane.gyro_instance][axis];
+					}
+				}
+
+				rate = _board_rotation * rate;
+
+				const float dt = gyro.integral_dt / 1.e6f;
+
+				for (int axis = 0; axis < 3; axis++) {
+					lane.delta_ang[axis] += rate(axis) * dt;
+					lane.gyro_rad[axis] = rate(axis);
+				}
+
+				lane.delta_ang_dt += gyro.integral_dt;
+			}
+		}
+
+		orb_check(lane.accel_sub, &updated);
+
+		if (updated) {
+			sensor_accel_s accel;
+
+			if ((orb_copy(ORB_ID(sensor_accel), lane.accel_sub, &accel) == PX4_OK) && (accel.integral_dt > 0)) {
+				const float dt_inv = 1.e6f / accel.integral_dt;
+				Vector3f specific_force(accel.x_integral, accel.y_integral, accel.z_integral);
+				specific_force *= dt_inv;
+
+				if (_sensor_correction.timestamp > 0) {
+					for (int axis = 0; axis < 3; axis++) {
+						specific_force(axis) -= accel_offsets[lane.accel_instance][axis];
+						specific_force(axis) *= accel_scales[lane.accel_instance][axis];
+					}
+				}
+
+				specific_force = _board_rotation * specific_force;
+
+				const float dt = accel.integral_dt / 1.e6f;
+
+				for (int axis = 0; axis < 3; axis++) {
+					lane.delta_vel[axis] += specific_force(axis) * dt;
+					lane.accel_m_s2[axis] = specific_force(axis);
+				}
+
+				lane.delta_vel_dt += accel.integral_dt;
+			}
+		}
+
+		// the estimator expects paired delta angles and velocities
+		if (lane.delta_ang_dt == 0 || lane.delta_vel_dt == 0) {
+			continue;
+		}
+
+		lane.ekf->setIMUData(now, lane.delta_ang_dt, lane.delta_vel_dt, lane.delta_ang, lane.delta_vel);
+		lane.time_last_imu = now;
+		imu_updated[i] = true;
+
+		memset(lane.delta_ang, 0, sizeof(lane.delta_ang));
+		memset(lane.delta_vel, 0, sizeof(lane.delta_vel));
+		lane.delta_ang_dt = 0;
+		lane.delta_vel_dt = 0;
+	}
+}
+
+void Ekf2::lanes_update_mag()
+{
+	for (uint8_t i = 1; i < _lane_count; i++) {
+		EstimatorLane &lane = _lanes[i];
+
+		if (lane.mag_sub < 0) {
+			continue;
+		}
+
+		bool updated = false;
+		orb_check(lane.mag_sub, &updated);
+
+		if (!updated) {
+			continue;
+		}
+
+		sensor_mag_s mag;
+
+		if ((orb_copy(ORB_ID(sensor_mag), lane.mag_sub, &mag) != PX4_OK) || (mag.timestamp == 0)) {
+			continue;
+		}
+
+		// the sensors module owns the calibration, only use a magnetometer it has calibrated and enabled
+		if (mag.device_id != lane.mag_device_id) {
+			lane.mag_device_id = mag.device_id;
+			const bool mag_own = get_mag_rotation(mag.device_id, lane.mag_rotation);
+
+			if (mag_own != lane.mag_own) {
+				PX4_INFO("lane %u uses the %s magnetometer", i, mag_own ? "own" : "voted");
+				lane.mag_own = mag_own;
+				lane.mag_downsample = MagDownsample{};
+			}
+		}
+
+		if (!lane.mag_own) {
+			continue;
+		}
+
+		const Vector3f field = lane.mag_rotation * Vector3f(mag.x, mag.y, mag.z);
+		const float field_ga[3] = {field(0), field(1), field(2)};
+
+		uint64_t mag_time_us;
+		float mag_data_avg_ga[3];
+
+		if (downsample_mag(lane.mag_downsample, mag.timestamp, field_ga, mag_time_us, mag_data_avg_ga)) {
+			lane.ekf->setMagData(mag_time_us, mag_data_avg_ga);
+		}
+	}
+}
+
+bool Ekf2::get_mag_rotation(uint32_t device_id, matrix::Dcmf &rotation)
+{
+	char str[20];
+
+	for (unsigned i = 0; i < MAG_CAL_COUNT; i++) {
+		int32_t cal_device_id = 0;
+		(void)sprintf(str, "CAL_MAG%u_ID", i);
+
+		if ((param_get(param_find(str), &cal_device_id) != PX4_OK) || ((uint32_t)cal_device_id != device_id)) {
+			continue;
+		}
+
+		int32_t enabled = 1;
+		(void)sprintf(str, "CAL_MAG%u_EN", i);
+		param_get(param_find(str), &enabled);
+
+		if (enabled != 1) {
+			return false;
+		}
+
+		// external magnetometers have their own rotation, internal ones (-1) are mounted like the board
+		int32_t mag_rot = -1;
+		(void)sprintf(str, "CAL_MAG%u_ROT", i);
+		param_get(param_find(str), &mag_rot);
+
+		rotation = (mag_rot >= 0) ? get_rot_matrix((enum Rotation)mag_rot) : _board_rotation;
+		return true;
+	}
+
+	return false;
+}
+
+bool Ekf2::downsample_mag(MagDownsample &mag, uint64_t timestamp, const float (&field_ga)[3], uint64_t &time_us,
+			  float (&field_avg_ga)[3])
+{
+	mag.time_sum_ms += timestamp / 1000;
+	mag.sample_count++;
+	mag.data_sum[0] += field_ga[0];
+	mag.data_sum[1] += field_ga[1];
+	mag.data_sum[2] += field_ga[2];
+	const int32_t mag_time_ms = mag.time_sum_ms / mag.sample_count;
+
+	if ((mag_time_ms - mag.time_ms_last_used) <= _params->sensor_interval_min_ms) {
+		return false;
+	}
+
+	// calculate mean of measurements
+	const float mag_sample_count_inv = 1.0f / mag.sample_count;
+	field_avg_ga[0] = mag.data_sum[0] * mag_sample_count_inv;
+	field_avg_ga[1] = mag.data_sum[1] * mag_sample_count_inv;
+	field_avg_ga[2] = mag.data_sum[2] * mag_sample_count_inv;
+	time_us = 1000 * (uint64_t)mag_time_ms;
+
+	mag.time_ms_last_used = mag_time_ms;
+	mag.time_sum_ms = 0;
+	mag.sample_count = 0;
+	mag.data_sum[0] = 0.0f;
+	mag.data_sum[1] = 0.0f;
+	mag.data_sum[2] = 0.0f;
+
+	return true;
+}
+
+void Ekf2::lanes_select(const hrt_abstime &now)
+{
+	for (uint8_t i = 0; i < _lane_count; i++) {
+		const EstimatorLane &lane = _lanes[i];
+		float ratio = NAN;
+
+		if (lane.updated) {
+			uint16_t status;
+			float mag, vel, pos, hgt, tas, hagl, beta;
+			lane.ekf->get_innovation_test_status(&status, &mag, &vel, &pos, &hgt, &tas, &hagl, &beta);
+
+			// height above ground and sideslip are left out as they do not affect the navigation states
+			ratio = math::max(math::max(mag, vel), math::max(math::max(pos, hgt), tas));
+		}
+
+		uint16_t fault_status;
+		lane.ekf->get_filter_fault_status(&fault_status);
+
+		const bool healthy = lane.ekf->attitude_valid() && (fault_status == 0)
+				     && (now - lane.time_last_imu < LANE_IMU_TIMEOUT);
+
+		_lane_selector.update(i, ratio, healthy);
+	}
+
+	const uint8_t previous_lane = _lane_selector.selected();
+	const uint8_t selected_lane = _lane_selector.select(_lane_count, now, _lane_sel_hysteresis.get());
+
+	if (selected_lane != previous_lane) {
+		lanes_switch(previous_lane, selected_lane);
+	}
+}
+
+void Ekf2::lanes_switch(uint8_t old_lane, uint8_t new_lane)
+{
+	Ekf &from = *_lanes[old_lane].ekf;
+	Ekf &to = *_lanes[new_lane].ekf;
+
+	float delta[4];
+	uint8_t counter_from;
+	uint8_t counter_to;
+
+	// attitude change from the estimate of the old lane to the estimate of the new lane
+	const Quatf delta_q{from.calculate_quaternion().inversed() * to.calculate_quaternion()};
+	from.get_quat_reset(delta, &counter_from);
+	to.get_quat_reset(delta, &counter_to);
+	update_lane_reset(_quat_reset, counter_from, counter_to);
+	delta_q.copyTo(_quat_reset.delta);
+
+	float pos_from[3];
+	float pos_to[3];
+	float vel_from[3];
+	float vel_to[3];
+	from.get_position(pos_from);
+	to.get_position(pos_to);
+	from.get_velocity(vel_from);
+	to.get_velocity(vel_to);
+
+	from.get_posNE_reset(delta, &counter_from);
+	to.get_posNE_reset(delta, &counter_to);
+	update_lane_reset(_posNE_reset, counter_from, counter_to);
+	_posNE_reset.delta[0] = pos_to[0] - pos_from[0];
+	_posNE_reset.delta[1] = pos_to[1] - pos_from[1];
+
+	from.get_posD_reset(delta, &counter_from);
+	to.get_posD_reset(delta, &counter_to);
+	update_lane_reset(_posD_reset, counter_from, counter_to);
+	_posD_reset.delta[0] = pos_to[2] - pos_from[2];
+
+	from.get_velNE_reset(delta, &counter_from);
+	to.get_velNE_reset(delta, &counter_to);
+	update_lane_reset(_velNE_reset, counter_from, counter_to);
+	_velNE_reset.delta[0] = vel_to[0] - vel_from[0];
+	_velNE_reset.delta[1] = vel_to[1] - vel_from[1];
+
+	from.get_velD_reset(delta, &counter_from);
+	to.get_velD_reset(delta, &counter_to);
+	update_lane_reset(_velD_reset, counter_from, counter_to);
+	_velD_reset.delta[0] = vel_to[2] - vel_from[2];
+
+	PX4_WARN("switching to estimator lane %u", new_lane);
+}
+
+void Ekf2::update_lane_reset(LaneReset &reset, uint8_t counter_prev, uint8_t counter_new)
+{
+	// the published counter is the lane counter plus the offset, it has to increment once for the switch
+	reset.counter_offset = (uint8_t)(counter_prev + reset.counter_offset + 1 - counter_new);
+	reset.lane_counter = counter_new;
+	reset.active = true;
+}
+
+void Ekf2::apply_lane_reset(const LaneReset &reset, float *delta, uint8_t *counter, unsigned size)
+{
+	// while the lane has not reset itself since the switch, the last reset is the switch
+	if (reset.active && *counter == reset.lane_counter) {
+		memcpy(delta, reset.delta, size * sizeof(float));
+	}
+
+	*counter += reset.counter_offset;
+}
+
 int Ekf2::getRangeSubIndex(const int *subs)
 {
 	for (unsigned i = 0; i < ORB_MULTI_MAX_INSTANCES; i++) {
@@ -1792,24 +2571,28 @@ int Ekf2::getRangeSubIndex(const int *subs)
 	return -1;
 }
 
-bool Ekf2::publish_attitude(const sensor_combined_s &sensors, const hrt_abstime &now)
+bool Ekf2::publish_attitude(const hrt_abstime &now)
 {
-	if (_ekf.attitude_valid()) {
+	const EstimatorLane &lane = _lanes[_lane_selector.selected()];
+	Ekf &ekf = *lane.ekf;
+
+	if (ekf.attitude_valid()) {
 		// generate vehicle attitude quaternion data
 		vehicle_attitude_s att;
 		att.timestamp = now;
 
-		const Quatf q{_ekf.calculate_quaternion()};
+		const Quatf q{ekf.calculate_quaternion()};
 		q.copyTo(att.q);
 
-		_ekf.get_quat_reset(&att.delta_q_reset[0], &att.quat_reset_counter);
+		ekf.get_quat_reset(&att.delta_q_reset[0], &att.quat_reset_counter);
+		apply_lane_reset(_quat_reset, &att.delta_q_reset[0], &att.quat_reset_counter, 4);
 
 		// In-run bias estimates
 		float gyro_bias[3];
-		_ekf.get_gyro_bias(gyro_bias);
-		att.rollspeed = sensors.gyro_rad[0] - gyro_bias[0];
-		att.pitchspeed = sensors.gyro_rad[1] - gyro_bias[1];
-		att.yawspeed = sensors.gyro_rad[2] - gyro_bias[2];
+		ekf.get_gyro_bias(gyro_bias);
+		att.rollspeed = lane.gyro_rad[0] - gyro_bias[0];
+		att.pitchspeed = lane.gyro_rad[1] - gyro_bias[1];
+		att.yawspeed = lane.gyro_rad[2] - gyro_bias[2];
 
 		int instance;
 		orb_publish_auto(ORB_ID(vehicle_attitude), &_att_pub, &att, &instance, ORB_PRIO_HIGH);
@@ -1830,12 +2613,14 @@ bool Ekf2::publish_attitude(const sensor_combined_s &sensors, const hrt_abstime
 
 bool Ekf2::publish_wind_estimate(const hrt_abstime &timestamp)
 {
-	if (_ekf.get_wind_status()) {
+	Ekf &ekf = *_lanes[_lane_selector.selected()].ekf;
+
+	if (ekf.get_wind_status()) {
 		float velNE_wind[2];
-		_ekf.get_wind_velocity(velNE_wind);
+		ekf.get_wind_velocity(velNE_wind);
 
 		float wind_var[2];
-		_ekf.get_wind_velocity_var(wind_var);
+		ekf.get_wind_velocity_var(wind_var);
 
 		// Publish wind estimate
 		wind_estimate_s wind_estimate;
@@ -1857,18 +2642,19 @@ bool Ekf2::publish_wind_estimate(const hrt_abstime &timestamp)
 const Vector3f Ekf2::get_vel_body_wind()
 {
 	// Used to correct baro data for positional errors
+	Ekf &ekf = *_lanes[_lane_selector.selected()].ekf;
 
 	matrix::Quatf q;
-	_ekf.copy_quaternion(q.data());
+	ekf.copy_quaternion(q.data());
 	matrix::Dcmf R_to_body(q.inversed());
 
 	// Calculate wind-compensated velocity in body frame
 	// Velocity of body origin in local NED frame (m/s)
 	float velocity[3];
-	_ekf.get_velocity(velocity);
+	ekf.get_velocity(velocity);
 
 	float velNE_wind[2];
-	_ekf.get_wind_velocity(velNE_wind);
+	ekf.get_wind_velocity(velNE_wind);
 
 	Vector3f v_wind_comp = {velocity[0] - velNE_wind[0], velocity[1] - velNE_wind[1], velocity[2]};
 
@@ -2479,6 +3265,10 @@ Attitude and position estimator using an Extended Kalman Filter. It is used for
 
 The documentation can be found on the [tuning_the_ecl_ekf](https://dev.px4.io/en/tutorials/tuning_the_ecl_ekf.html) page.
 
+With EKF2_MULTI_IMU set to 2 or 3, additional estimator lanes run on the secondary IMUs in the same task and share
+all other sensor data. The attitude and position of the healthiest lane are published, a switch between lanes is
+reported as a state reset.
+
 ekf2 can be started in replay mode (`-r`): in this mode it does not access the system time, but only uses the
 timestamps from the sensor topics.
 
@@ -1316,3 +1316,46 @@ PARAM_DEFINE_FLOAT(EKF2_GPS_TAU, 10.0f);
  * @decimal 1
  */
 PARAM_DEFINE_FLOAT(EKF2_MOVE_TEST, 1.0f);
+
+/**
+ * Number of estimator lanes
+ *
+ * Runs an additional instance of the estimator for each IMU after the first one, all sharing the barometer,
+ * GPS and other aiding data. The first lane uses the IMU selected by the sensors module, lane N
+ * uses IMU instance N. The magnetometer is shared too, unless EKF2_MULTI_MAG is set. The published estimate is taken from the lane with the lowest innovation test ratios,
+ * switching away from a lane immediately if it reports a filter fault or its IMU data stops.
+ * Set to 0 or 1 to run a single estimator.
+ *
+ * @group EKF2
+ * @min 0
+ * @max 3
+ * @reboot_required true
+ */
+PARAM_DEFINE_INT32(EKF2_MULTI_IMU, 0);
+
+/**
+ * Lane selection test ratio hysteresis
+ *
+ * A healthy lane only replaces the selected one when its filtered innovation test ratio is lower by at least this
+ * amount. Only used when EKF2_MULTI_IMU is larger than 1.
+ *
+ * @group EKF2
+ * @min 0.0
+ * @max 1.0
+ * @decimal 2
+ */
+PARAM_DEFINE_FLOAT(EKF2_SEL_HYST, 0.3f);
+
+/**
+ * Magnetometer of each estimator lane
+ *
+ * If set, lane N uses magnetometer instance N instead of the magnetometer selected by the sensors module, once the
+ * sensors module has calibrated and enabled it. The first lane always uses the selected magnetometer, and the
+ * learned magnetometer biases are only saved while the published lane uses the selected magnetometer.
+ * Only used when EKF2_MULTI_IMU is larger than 1.
+ *
+ * @group EKF2
+ * @boolean
+ * @reboot_required true
+ */
+PARAM_DEFINE_INT32(EKF2_MULTI_MAG, 0);
@@ -123,10 +123,10 @@ bool LogWriter::is_started(LogType type, Backend query_backend) const
 	return false;
 }
 
-void LogWriter::start_log_file(LogType type, const char *filename)
+void LogWriter::start_log_file(LogType type, const char *filename, bool compress)
 {
 	if (_log_writer_file) {
-		_log_writer_file->start_log(type, filename);
+		_log_writer_file->start_log(type, filename, compress);
 	}
 }
 
@@ -65,7 +65,8 @@ public:
 	/** stop all running threads and wait for them to exit */
 	void thread_stop();
 
-	void start_log_file(LogType type, const char *filename);
+	/** @see LogWriterFile::start_log() */
+	void start_log_file(LogType type, const char *filename, bool compress = false);
 
 	void stop_log_file(LogType type);
 
@@ -36,6 +36,7 @@
 #include <fcntl.h>
 #include <string.h>
 
+#include <lz4/lz4.h>
 #include <mathlib/mathlib.h>
 #include <px4_posix.h>
 #ifdef __PX4_NUTTX
@@ -79,9 +80,10 @@ LogWriterFile::~LogWriterFile()
 	pthread_cond_destroy(&_cv);
 }
 
-void LogWriterFile::start_log(LogType type, const char *filename)
+void LogWriterFile::start_log(LogType type, const char *filename, bool compress)
 {
-	if (type == LogType::Full) {
+	// the crash log is appended as plain ULog data, so this is not possible for a compressed container
+	if (type == LogType::Full && !compress) {
 		// register the current file with the hardfault handler: if the system crashes,
 		// the hardfault handler will append the crash log to that file on the next reboot.
 		// Note that we don't deregister it when closing the log, so that crashes after disarming
@@ -93,7 +95,7 @@ void LogWriterFile::start_log(LogType type, const char *filename)
 		}
 	}
 
-	if (_buffers[(int)type].start_log(filename)) {
+	if (_buffers[(int)type].start_log(filename, compress)) {
 		PX4_INFO("Opened %s log file: %s", log_type_str(type), filename);
 		notify();
 	}
@@ -384,6 +386,9 @@ LogWriterFile::LogFileBuffer::~LogFileBuffer()
 	}
 
 	delete[] _buffer;
+	delete[] _compress_in;
+	delete[] _compress_out;
+	delete[] _compress_hash_table;
 
 	perf_free(_perf_write);
 	perf_free(_perf_fsync);
@@ -429,7 +434,7 @@ size_t LogWriterFile::LogFileBuffer::get_read_ptr(void **ptr, bool *is_part)
 	}
 }
 
-bool LogWriterFile::LogFileBuffer::start_log(const char *filename)
+bool LogWriterFile::LogFileBuffer::start_log(const char *filename, bool compress)
 {
 	_fd = ::open(filename, O_CREAT | O_WRONLY, PX4_O_MODE_666);
 
@@ -449,10 +454,44 @@ bool LogWriterFile::LogFileBuffer::start_log(const char *filename)
 		}
 	}
 
+	if (compress && _compress_in == nullptr) {
+		_compress_in = new uint8_t[ULOG_COMPRESSED_BLOCK_MAX];
+		_compress_out = new uint8_t[sizeof(ulog_compressed_block_s) + lz4::compress_bound(ULOG_COMPRESSED_BLOCK_MAX)];
+		_compress_hash_table = new uint16_t[lz4::HASH_TABLE_SIZE];
+
+		if (_compress_in == nullptr || _compress_out == nullptr || _compress_hash_table == nullptr) {
+			PX4_ERR("Can't create compression buffers");
+			delete[] _compress_in;
+			delete[] _compress_out;
+			delete[] _compress_hash_table;
+			_compress_in = _compress_out = nullptr;
+			_compress_hash_table = nullptr;
+			::close(_fd);
+			_fd = -1;
+			return false;
+		}
+	}
+
 	// Clear buffer and counters
 	_head = 0;
 	_count = 0;
 	_total_written = 0;
+	_file_written = 0;
+	_compress = compress;
+	_compress_in_count = 0;
+
+	if (_compress) {
+		const uint8_t magic[ULOG_COMPRESSED_MAGIC_LEN] = ULOG_COMPRESSED_MAGIC;
+
+		if (::write(_fd, magic, sizeof(magic)) != sizeof(magic)) {
+			PX4_ERR("Can't write log file header, errno: %d", errno);
+			::close(_fd);
+			_fd = -1;
+			return false;
+		}
+
+		_file_written = sizeof(magic);
+	}
 
 	_should_run = true;
 
@@ -466,10 +505,27 @@ void LogWriterFile::LogFileBuffer::fsync() const
 	perf_end(_perf_fsync);
 }
 
-ssize_t LogWriterFile::LogFileBuffer::write_to_file(const void *buffer, size_t size, bool call_fsync) const
+ssize_t LogWriterFile::LogFileBuffer::write_to_file(const void *buffer, size_t size, bool call_fsync)
 {
 	perf_begin(_perf_write);
-	ssize_t ret = ::write(_fd, buffer, size);
+	ssize_t ret;
+
+	if (_compress) {
+		ret = write_compressed((const uint8_t *)buffer, size);
+
+		// make sure everything up to here ends up in the file
+		if (call_fsync && ret >= 0 && flush_compressed() != 0) {
+			ret = -1;
+		}
+
+	} else {
+		ret = ::write(_fd, buffer, size);
+
+		if (ret > 0) {
+			_file_written += ret;
+		}
+	}
+
 	perf_end(_perf_write);
 
 	if (call_fsync) {
@@ -479,18 +535,93 @@ ssize_t LogWriterFile::LogFileBuffer::write_to_file(const void *buffer, size_t s
 	return ret;
 }
 
+ssize_t LogWriterFile::LogFileBuffer::write_compressed(const uint8_t *data, size_t size)
+{
+	size_t remaining = size;
+
+	while (remaining > 0) {
+		if (_compress_in_count == 0 && remaining >= ULOG_COMPRESSED_BLOCK_MAX) {
+			// full block: compress directly from the log buffer
+			if (write_block(data, ULOG_COMPRESSED_BLOCK_MAX) != 0) {
+				return -1;
+			}
+
+			data += ULOG_COMPRESSED_BLOCK_MAX;
+			remaining -= ULOG_COMPRESSED_BLOCK_MAX;
+			continue;
+		}
+
+		const size_t n = math::min(remaining, ULOG_COMPRESSED_BLOCK_MAX - _compress_in_count);
+		memcpy(_compress_in + _compress_in_count, data, n);
+		_compress_in_count += n;
+		data += n;
+		remaining -= n;
+
+		if (_compress_in_count == ULOG_COMPRESSED_BLOCK_MAX && flush_compressed() != 0) {
+			return -1;
+		}
+	}
+
+	return size;
+}
+
+int LogWriterFile::LogFileBuffer::flush_compressed()
+{
+	if (_compress_in_count == 0) {
+		return 0;
+	}
+
+	int ret = write_block(_compress_in, _compress_in_count);
+	_compress_in_count = 0;
+	return ret;
+}
+
+int LogWriterFile::LogFileBuffer::write_block(const uint8_t *data, size_t size)
+{
+	ulog_compressed_block_s header;
+	header.raw_size = size;
+	uint8_t *block_data = _compress_out + sizeof(header);
+
+	int compressed_size = lz4::compress(data, size, block_data, size - 1, _compress_hash_table);
+
+	if (compressed_size < 0) {
+		// not compressible: store it as-is
+		memcpy(block_data, data, size);
+		compressed_size = size;
+	}
+
+	header.data_size = compressed_size;
+	memcpy(_compress_out, &header, sizeof(header));
+
+	const size_t block_size = sizeof(header) + compressed_size;
+
+	if (::write(_fd, _compress_out, block_size) != (ssize_t)block_size) {
+		return -1;
+	}
+
+	_file_written += block_size;
+	return 0;
+}
+
 void LogWriterFile::LogFileBuffer::close_file()
 {
 	_head = 0;
 	_count = 0;
 
 	if (_fd >= 0) {
+		if (_compress && flush_compressed() != 0) {
+			PX4_WARN("writing last log block failed (%i)", errno);
+		}
+
 		int res = close(_fd);
 		_fd = -1;
 
 		if (res) {
 			PX4_WARN("closing log file failed (%i)", errno);
 
+		} else if (_compress) {
+			PX4_INFO("closed logfile, bytes written: %zu (compressed: %zu)", _total_written, _file_written);
+
 		} else {
 			PX4_INFO("closed logfile, bytes written: %zu", _total_written);
 		}
@@ -77,7 +77,12 @@ public:
 
 	void thread_stop();
 
-	void start_log(LogType type, const char *filename);
+	/**
+	 * open a log file and start writing
+	 * @param compress write an LZ4 block-compressed container (@see ULOG_COMPRESSED_MAGIC) instead of plain ULog.
+	 *                 Compression runs on the writer thread.
+	 */
+	void start_log(LogType type, const char *filename, bool compress = false);
 
 	void stop_log(LogType type);
 
@@ -156,7 +161,7 @@ private:
 
 		~LogFileBuffer();
 
-		bool start_log(const char *filename);
+		bool start_log(const char *filename, bool compress);
 
 		void close_file();
 
@@ -171,7 +176,7 @@ private:
 
 		int fd() const { return _fd; }
 
-		inline ssize_t write_to_file(const void *buffer, size_t size, bool call_fsync) const;
+		inline ssize_t write_to_file(const void *buffer, size_t size, bool call_fsync);
 
 		inline void fsync() const;
 
@@ -184,12 +189,36 @@ private:
 		bool _should_run = false;
 
 	private:
+		/**
+		 * compress (part of) the data and write it as container blocks. Data that does not fill
+		 * a complete block is kept in _compress_in.
+		 * @return size on success, -1 on error
+		 */
+		ssize_t write_compressed(const uint8_t *data, size_t size);
+
+		/**
+		 * compress and write a single block
+		 * @return 0 on success, -1 on error
+		 */
+		int write_block(const uint8_t *data, size_t size);
+
+		/** write out a partially filled block */
+		int flush_compressed();
+
 		const size_t _buffer_size;
 		int	_fd = -1;
 		uint8_t *_buffer = nullptr;
 		size_t _head = 0; ///< next position to write to
 		size_t _count = 0; ///< number of bytes in _buffer to be written
 		size_t _total_written = 0;
+
+		bool _compress = false;
+		uint8_t *_compress_in = nullptr; ///< raw data of the pending block
+		size_t _compress_in_count = 0;
+		uint8_t *_compress_out = nullptr; ///< block header + compressed data
+		uint16_t *_compress_hash_table = nullptr;
+		size_t _file_written = 0; ///< bytes written to the file (differs from _total_written when compressing)
+
 		perf_counter_t _perf_write;
 		perf_counter_t _perf_fsync;
 	};
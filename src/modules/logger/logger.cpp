@@ -52,6 +52,7 @@
 #include <uORB/topics/vehicle_command_ack.h>
 
 #include <drivers/drv_hrt.h>
+#include <drivers/drv_orb_dev.h>
 #include <px4_includes.h>
 #include <px4_getopt.h>
 #include <px4_log.h>
@@ -426,6 +427,7 @@ Logger::Logger(LogWriter::Backend backend, size_t buffer_size, uint32_t log_inte
 	_log_dirs_max = param_find("SDLOG_DIRS_MAX");
 	_sdlog_profile_handle = param_find("SDLOG_PROFILE");
 	_mission_log = param_find("SDLOG_MISSION");
+	_log_compress = param_find("SDLOG_COMPRESS");
 
 	if (poll_topic_name) {
 		const orb_metadata *const*topics = orb_get_topics();
@@ -492,6 +494,10 @@ LoggerSubscription* Logger::add_topic(const orb_metadata *topic)
 
 	if (_subscriptions.push_back(LoggerSubscription(fd, topic))) {
 		subscription = &_subscriptions[_subscriptions.size() - 1];
+
+		if (fd >= 0) {
+			register_update_flag(*subscription, 0);
+		}
 	} else {
 		PX4_WARN("logger: failed to add topic. Too many subscriptions");
 		if (fd >= 0) {
@@ -536,6 +542,8 @@ bool Logger::add_topic(const char *name, unsigned interval)
 	}
 
 	if (subscription) {
+		subscription->rate_limited = interval > 0;
+
 		if (subscription->fd[0] >= 0) {
 			orb_set_interval(subscription->fd[0], interval);
 		} else {
@@ -579,6 +587,56 @@ bool Logger::copy_if_updated_multi(int sub_idx, int multi_instance, void *buffer
 	return updated;
 }
 
+size_t Logger::log_topic_instance(int sub_idx, int multi_instance, bool try_to_subscribe, hrt_abstime loop_time)
+{
+	LoggerSubscription &sub = _subscriptions[sub_idx];
+	size_t written = 0;
+
+	/* each message consists of a header followed by an orb data object
+	 */
+	size_t msg_size = sizeof(ulog_message_data_header_s) + sub.metadata->o_size_no_padding;
+
+	/* if this topic has been updated, copy the new data into the message buffer
+	 * and write a message to the log
+	 */
+	if (copy_if_updated_multi(sub_idx, multi_instance, _msg_buffer + sizeof(ulog_message_data_header_s),
+				  try_to_subscribe)) {
+
+		uint16_t write_msg_size = static_cast<uint16_t>(msg_size - ULOG_MSG_HEADER_LEN);
+		//write one byte after another (necessary because of alignment)
+		_msg_buffer[0] = (uint8_t)write_msg_size;
+		_msg_buffer[1] = (uint8_t)(write_msg_size >> 8);
+		_msg_buffer[2] = static_cast<uint8_t>(ULogMessageType::DATA);
+		uint16_t write_msg_id = sub.msg_ids[multi_instance];
+		_msg_buffer[3] = (uint8_t)write_msg_id;
+		_msg_buffer[4] = (uint8_t)(write_msg_id >> 8);
+
+		//PX4_INFO("topic: %s, size = %zu, out_size = %zu", sub.metadata->o_name, sub.metadata->o_size, msg_size);
+
+		// full log
+		if (write_message(LogType::Full, _msg_buffer, msg_size)) {
+			written += msg_size;
+		}
+
+		// mission log
+		if (sub_idx < _num_mission_subs) {
+			if (_writer.is_started(LogType::Mission)) {
+				if (_mission_subscriptions[sub_idx].next_write_time < (loop_time / 100000)) {
+					unsigned delta_time = _mission_subscriptions[sub_idx].min_delta_ms;
+					if (delta_time > 0) {
+						_mission_subscriptions[sub_idx].next_write_time = (loop_time / 100000) + delta_time / 100;
+					}
+					if (write_message(LogType::Mission, _msg_buffer, msg_size)) {
+						written += msg_size;
+					}
+				}
+			}
+		}
+	}
+
+	return written;
+}
+
 bool Logger::try_to_subscribe_topic(LoggerSubscription &sub, int multi_instance)
 {
 	bool ret = false;
@@ -604,6 +662,7 @@ bool Logger::try_to_subscribe_topic(LoggerSubscription &sub, int multi_instance)
 			if (interval > 0) {
 				orb_set_interval(handle, interval);
 			}
+			register_update_flag(sub, multi_instance);
 			ret = true;
 		} else {
 			PX4_ERR("orb_subscribe_multi %s failed (%i)", sub.metadata->o_name, errno);
@@ -612,6 +671,18 @@ bool Logger::try_to_subscribe_topic(LoggerSubscription &sub, int multi_instance)
 	return ret;
 }
 
+void Logger::register_update_flag(const LoggerSubscription &sub, int multi_instance)
+{
+	const int bit = (&sub - &_subscriptions[0]) * ORB_MULTI_MAX_INSTANCES + multi_instance;
+	orb_update_flag flag{&_updated_topics[bit / 32], 1u << (bit % 32)};
+
+	if (px4_ioctl(sub.fd[multi_instance], ORBIOCSETUPDATEFLAG, (unsigned long)&flag) != PX4_OK) {
+		// another subscriber already registered: check the topic every time
+		PX4_DEBUG("%s: no update flag", sub.metadata->o_name);
+		_always_check_topics[bit / 32] |= flag.mask;
+	}
+}
+
 void Logger::add_default_topics()
 {
 	// Note: try to avoid setting the interval where possible, as it increases RAM usage
@@ -626,6 +697,7 @@ void Logger::add_default_topics()
 	//add_topic("distance_sensor", 100);
 	//add_topic("ekf2_innovations", 200);
 	add_topic("ekf_gps_drift",100);
+	add_topic("frequency_response");
 	//add_topic("esc_status", 250);
 	add_topic("estimator_status", 200);
 	add_topic("home_position",100);
@@ -1103,59 +1175,40 @@ void Logger::run()
 			/* wait for lock on log buffer */
 			_writer.lock();
 
-			int sub_idx = 0;
+			/* only visit the topics flagged as updated by uORB, plus the one we try to subscribe to */
+			const int num_words = (_subscriptions.size() * ORB_MULTI_MAX_INSTANCES + 31) / 32;
 
-			for (LoggerSubscription &sub : _subscriptions) {
-				/* each message consists of a header followed by an orb data object
-				 */
-				size_t msg_size = sizeof(ulog_message_data_header_s) + sub.metadata->o_size_no_padding;
+			for (int word = 0; word < num_words; ++word) {
+				uint32_t updated = __atomic_exchange_n(&_updated_topics[word], 0, __ATOMIC_RELAXED) | _always_check_topics[word];
 
-				/* if this topic has been updated, copy the new data into the message buffer
-				 * and write a message to the log
-				 */
-				for (int instance = 0; instance < ORB_MULTI_MAX_INSTANCES; instance++) {
-					if (copy_if_updated_multi(sub_idx, instance, _msg_buffer + sizeof(ulog_message_data_header_s),
-								  sub_idx == next_subscribe_topic_index)) {
+				if (next_subscribe_topic_index >= 0 && (next_subscribe_topic_index * ORB_MULTI_MAX_INSTANCES) / 32 == word) {
+					for (int instance = 0; instance < ORB_MULTI_MAX_INSTANCES; instance++) {
+						if (_subscriptions[next_subscribe_topic_index].fd[instance] < 0) {
+							updated |= 1u << ((next_subscribe_topic_index * ORB_MULTI_MAX_INSTANCES + instance) % 32);
+						}
+					}
+				}
 
-						uint16_t write_msg_size = static_cast<uint16_t>(msg_size - ULOG_MSG_HEADER_LEN);
-						//write one byte after another (necessary because of alignment)
-						_msg_buffer[0] = (uint8_t)write_msg_size;
-						_msg_buffer[1] = (uint8_t)(write_msg_size >> 8);
-						_msg_buffer[2] = static_cast<uint8_t>(ULogMessageType::DATA);
-						uint16_t write_msg_id = sub.msg_ids[instance];
-						_msg_buffer[3] = (uint8_t)write_msg_id;
-						_msg_buffer[4] = (uint8_t)(write_msg_id >> 8);
+				while (updated != 0) {
+					const int bit = __builtin_ctz(updated);
+					updated &= updated - 1;
 
-						//PX4_INFO("topic: %s, size = %zu, out_size = %zu", sub.metadata->o_name, sub.metadata->o_size, msg_size);
+					const int sub_idx = (word * 32 + bit) / ORB_MULTI_MAX_INSTANCES;
+					const int instance = (word * 32 + bit) % ORB_MULTI_MAX_INSTANCES;
 
-						// full log
-						if (write_message(LogType::Full, _msg_buffer, msg_size)) {
+					const size_t written = log_topic_instance(sub_idx, instance, sub_idx == next_subscribe_topic_index, loop_time);
 
+					if (written > 0) {
 #ifdef DBGPRINT
-							total_bytes += msg_size;
+						total_bytes += written;
 #endif /* DBGPRINT */
+						data_written = true;
 
-							data_written = true;
-						}
-
-						// mission log
-						if (sub_idx < _num_mission_subs) {
-							if (_writer.is_started(LogType::Mission)) {
-								if (_mission_subscriptions[sub_idx].next_write_time < (loop_time / 100000)) {
-									unsigned delta_time = _mission_subscriptions[sub_idx].min_delta_ms;
-									if (delta_time > 0) {
-										_mission_subscriptions[sub_idx].next_write_time = (loop_time / 100000) + delta_time / 100;
-									}
-									if (write_message(LogType::Mission, _msg_buffer, msg_size)) {
-										data_written = true;
-									}
-								}
-							}
-						}
+					} else if (_subscriptions[sub_idx].rate_limited && _subscriptions[sub_idx].fd[instance] >= 0) {
+						// the update might only become visible after the interval: check again next time
+						__atomic_fetch_or(&_updated_topics[word], 1u << bit, __ATOMIC_RELAXED);
 					}
 				}
-
-				++sub_idx;
 			}
 
 			//check for new logging message(s)
@@ -1481,7 +1534,7 @@ int Logger::create_log_dir(LogType type, tm *tt, char *log_dir, int log_dir_len)
 	return strlen(log_dir);
 }
 
-int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_size)
+int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_size, bool compressed)
 {
 	tm tt = {};
 	bool time_ok = false;
@@ -1503,6 +1556,8 @@ int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_si
 		replay_suffix = "_replayed";
 	}
 
+	const char *extension = compressed ? "ulz" : "ulg";
+
 	char *log_file_name = _file_name[(int)type].log_file_name;
 
 	if (time_ok) {
@@ -1513,7 +1568,8 @@ int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_si
 
 		char log_file_name_time[16] = "";
 		strftime(log_file_name_time, sizeof(log_file_name_time), "%H_%M_%S", &tt);
-		snprintf(log_file_name, sizeof(LogFileName::log_file_name), "%s%s.ulg", log_file_name_time, replay_suffix);
+		snprintf(log_file_name, sizeof(LogFileName::log_file_name), "%s%s.%s", log_file_name_time, replay_suffix,
+			 extension);
 		snprintf(file_name + n, file_name_size - n, "/%s", log_file_name);
 
 	} else {
@@ -1527,7 +1583,8 @@ int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_si
 		/* look for the next file that does not exist */
 		while (file_number <= MAX_NO_LOGFILE) {
 			/* format log file path: e.g. /fs/microsd/log/sess001/log001.ulg */
-			snprintf(log_file_name, sizeof(LogFileName::log_file_name), "log%03u%s.ulg", file_number, replay_suffix);
+			snprintf(log_file_name, sizeof(LogFileName::log_file_name), "log%03u%s.%s", file_number, replay_suffix,
+				 extension);
 			snprintf(file_name + n, file_name_size - n, "/%s", log_file_name);
 
 			if (!util::file_exist(file_name)) {
@@ -1563,9 +1620,16 @@ void Logger::start_log_file(LogType type)
 
 	PX4_INFO("Start file log (type: %s)", log_type_str(type));
 
+	// only the full log is compressed, the mission log is small and meant to be read directly
+	int32_t compress = 0;
+
+	if (type == LogType::Full && _log_compress != PARAM_INVALID) {
+		param_get(_log_compress, &compress);
+	}
+
 	char file_name[LOG_DIR_LEN] = "";
 
-	if (get_log_file_name(type, file_name, sizeof(file_name))) {
+	if (get_log_file_name(type, file_name, sizeof(file_name), compress != 0)) {
 		PX4_ERR("failed to get log file name");
 		return;
 	}
@@ -1575,7 +1639,7 @@ void Logger::start_log_file(LogType type)
 		mavlink_log_info(&_mavlink_log_pub, "[logger] file: %s", file_name);
 	}
 
-	_writer.start_log_file(type, file_name);
+	_writer.start_log_file(type, file_name, compress != 0);
 	_writer.select_write_backend(LogWriter::BackendFile);
 	_writer.set_need_reliable_transfer(true);
 	write_header(type);
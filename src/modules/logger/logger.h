@@ -84,6 +84,7 @@ struct LoggerSubscription {
 	/// not subscribed yet (-interval - 1)
 	const orb_metadata *metadata = nullptr;
 	uint8_t msg_ids[ORB_MULTI_MAX_INSTANCES];
+	bool rate_limited = false; ///< an interval is set, so an update might only become visible later
 
 	LoggerSubscription() {}
 
@@ -171,6 +172,7 @@ private:
 	};
 
 	static constexpr size_t 	MAX_TOPICS_NUM = 64; /**< Maximum number of logged topics */
+	static constexpr int		UPDATED_TOPICS_WORDS = (MAX_TOPICS_NUM * ORB_MULTI_MAX_INSTANCES + 31) / 32;
 	static constexpr int		MAX_MISSION_TOPICS_NUM = 5; /**< Maximum number of mission topics */
 	static constexpr unsigned	MAX_NO_LOGFILE = 999;	/**< Maximum number of log files */
 	static constexpr const char	*LOG_ROOT[(int)LogType::Count] = {
@@ -181,7 +183,7 @@ private:
 	struct LogFileName {
 		char log_dir[12];           ///< e.g. "2018-01-01" or "sess001"
 		int sess_dir_index{1};      ///< search starting index for 'sess<i>' directory name
-		char log_file_name[31];     ///< e.g. "log001.ulg" or "12_09_00_replayed.ulg"
+		char log_file_name[31];     ///< e.g. "log001.ulg", "log001.ulz" or "12_09_00_replayed.ulg"
 		bool has_log_dir{false};
 	};
 
@@ -221,8 +223,9 @@ private:
 
 	/**
 	 * Get log file name with directory (create it if necessary)
+	 * @param compressed use the extension of the compressed container (.ulz) instead of .ulg
 	 */
-	int get_log_file_name(LogType type, char *file_name, size_t file_name_size);
+	int get_log_file_name(LogType type, char *file_name, size_t file_name_size, bool compressed);
 
 	void start_log_file(LogType type);
 
@@ -287,6 +290,18 @@ private:
 
 	inline bool copy_if_updated_multi(int sub_idx, int multi_instance, void *buffer, bool try_to_subscribe);
 
+	/**
+	 * Let uORB flag updates of a subscribed topic instance in _updated_topics
+	 */
+	void register_update_flag(const LoggerSubscription &sub, int multi_instance);
+
+	/**
+	 * Visit and log a subscribed topic instance if it was updated (or try to subscribe to it).
+	 * Must be called with _writer.lock() held.
+	 * @return number of bytes written
+	 */
+	size_t log_topic_instance(int sub_idx, int multi_instance, bool try_to_subscribe, hrt_abstime loop_time);
+
 	/**
 	 * Check if a topic instance exists and subscribe to it
 	 * @return true when topic exists and subscription successful
@@ -381,6 +396,8 @@ private:
 	Array<LoggerSubscription, MAX_TOPICS_NUM>	_subscriptions; ///< all subscriptions for full & mission log (in front)
 	MissionSubscription 				_mission_subscriptions[MAX_MISSION_TOPICS_NUM]; ///< additional data for mission subscriptions
 	int						_num_mission_subs{0};
+	uint32_t					_updated_topics[UPDATED_TOPICS_WORDS] {}; ///< bit (sub_idx * ORB_MULTI_MAX_INSTANCES + instance) is set by uORB on publication
+	uint32_t					_always_check_topics[UPDATED_TOPICS_WORDS] {}; ///< topics without update flag
 
 	LogWriter					_writer;
 	uint32_t					_log_interval{0};
@@ -398,6 +415,7 @@ private:
 	param_t						_log_utc_offset{PARAM_INVALID};
 	param_t						_log_dirs_max{PARAM_INVALID};
 	param_t						_mission_log{PARAM_INVALID};
+	param_t						_log_compress{PARAM_INVALID};
 };
 
 } //namespace logger
@@ -153,4 +153,21 @@ struct ulog_message_flag_bits_s {
 	uint64_t appended_offsets[3]; ///< file offset(s) for appended data if ULOG_INCOMPAT_FLAG0_DATA_APPENDED_MASK is set
 };
 
+
+/*
+ * Compressed ULog container (.ulz): the file starts with ULOG_COMPRESSED_MAGIC, followed by a sequence of
+ * blocks, each one a ulog_compressed_block_s header and data_size bytes of data. Concatenating the
+ * decompressed blocks yields a regular ULog file.
+ * Blocks are independent LZ4 blocks (no dictionary across blocks), so a truncated file can be
+ * decompressed up to the last complete block.
+ */
+#define ULOG_COMPRESSED_MAGIC { 'U', 'L', 'z', '4', 0x01, 0x12, 0x35, 0x01 }
+#define ULOG_COMPRESSED_MAGIC_LEN 8
+#define ULOG_COMPRESSED_BLOCK_MAX 4096 ///< maximum raw (decompressed) size of a block
+
+struct ulog_compressed_block_s {
+	uint16_t raw_size; ///< decompressed size of the block, at most ULOG_COMPRESSED_BLOCK_MAX
+	uint16_t data_size; ///< size of the following data. If equal to raw_size, the data is stored uncompressed
+};
+
 #pragma pack(pop)
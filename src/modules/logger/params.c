@@ -87,6 +87,27 @@ PARAM_DEFINE_INT32(SDLOG_MODE, 0);
  */
 PARAM_DEFINE_INT32(SDLOG_MISSION, 1);
 
+/**
+ * Log file compression
+ *
+ * If enabled, the full log is written as LZ4 block-compressed container (.ulz)
+ * instead of plain ULog (.ulg). This reduces the amount of data written to the
+ * SD card, at the cost of CPU time on the log writer thread and about 10kB
+ * of additional RAM.
+ *
+ * Compressed logs need to be decompressed before they can be analyzed
+ * (e.g. with Tools/ecl_ekf/ulog_lz4.py). Crash logs are not appended to
+ * compressed logs. The mission log is never compressed.
+ *
+ * The setting is applied when a new log is started.
+ *
+ * @value 0 Disabled
+ * @value 1 LZ4 blocks
+ *
+ * @group SD Logging
+ */
+PARAM_DEFINE_INT32(SDLOG_COMPRESS, 0);
+
 /**
  * Logging topic profile (integer bitmask).
  *
@@ -42,6 +42,8 @@
 #include <errno.h>
 #include <cstring>
 
+#include <mathlib/mathlib.h>
+
 #include "mavlink_ftp.h"
 #include "mavlink_main.h"
 #include "mavlink_tests/mavlink_ftp_test.h"
@@ -51,12 +53,18 @@ constexpr const char MavlinkFTP::_root_dir[];
 MavlinkFTP::MavlinkFTP(Mavlink *mavlink) :
 	_mavlink(mavlink)
 {
-	// initialize session
-	_session_info.fd = -1;
+	// initialize sessions
+	for (SessionInfo &session : _session_info) {
+		session.fd = -1;
+	}
 }
 
 MavlinkFTP::~MavlinkFTP()
 {
+	for (SessionInfo &session : _session_info) {
+		_close_session(session);
+	}
+
 	if (_work_buffer1) {
 		delete[] _work_buffer1;
 	}
@@ -69,11 +77,48 @@ MavlinkFTP::~MavlinkFTP()
 unsigned
 MavlinkFTP::get_size()
 {
-	if (_session_info.stream_download) {
-		return MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+	for (const SessionInfo &session : _session_info) {
+		if (session.stream_download) {
+			return MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+		}
+	}
+
+	return 0;
+}
+
+MavlinkFTP::SessionInfo *
+MavlinkFTP::_get_session(uint8_t session)
+{
+	if (session >= kMaxSessions || _session_info[session].fd < 0) {
+		return nullptr;
+	}
 
-	} else {
-		return 0;
+	return &_session_info[session];
+}
+
+void
+MavlinkFTP::_close_session(SessionInfo &session)
+{
+	if (session.fd >= 0) {
+		::close(session.fd);
+		session.fd = -1;
+	}
+
+	session.stream_download = false;
+
+	if (session.read_ahead) {
+		delete[] session.read_ahead;
+		session.read_ahead = nullptr;
+	}
+
+	session.read_ahead_len = 0;
+}
+
+void
+MavlinkFTP::_invalidate_read_ahead()
+{
+	for (SessionInfo &session : _session_info) {
+		session.read_ahead_len = 0;
 	}
 }
 
@@ -501,7 +546,13 @@ MavlinkFTP::_workList(PayloadHeader *payload, bool list_hidden)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workOpen(PayloadHeader *payload, int oflag)
 {
-	if (_session_info.fd >= 0) {
+	uint8_t session_id = 0;
+
+	while (session_id < kMaxSessions && _session_info[session_id].fd >= 0) {
+		session_id++;
+	}
+
+	if (session_id >= kMaxSessions) {
 		PX4_ERR("FTP: Open failed - out of sessions\n");
 		return kErrNoSessionsAvailable;
 	}
@@ -535,11 +586,13 @@ MavlinkFTP::_workOpen(PayloadHeader *payload, int oflag)
 		return kErrFailErrno;
 	}
 
-	_session_info.fd = fd;
-	_session_info.file_size = fileSize;
-	_session_info.stream_download = false;
+	SessionInfo &session = _session_info[session_id];
+	session.fd = fd;
+	session.file_size = fileSize;
+	session.stream_download = false;
+	session.read_ahead_len = 0;
 
-	payload->session = 0;
+	payload->session = session_id;
 	payload->size = sizeof(uint32_t);
 	std::memcpy(payload->data, &fileSize, payload->size);
 
@@ -550,7 +603,9 @@ MavlinkFTP::_workOpen(PayloadHeader *payload, int oflag)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workRead(PayloadHeader *payload)
 {
-	if (payload->session != 0 || _session_info.fd < 0) {
+	SessionInfo *session = _get_session(payload->session);
+
+	if (session == nullptr) {
 		return kErrInvalidSession;
 	}
 
@@ -559,17 +614,17 @@ MavlinkFTP::_workRead(PayloadHeader *payload)
 #endif
 
 	// We have to test seek past EOF ourselves, lseek will allow seek past EOF
-	if (payload->offset >= _session_info.file_size) {
+	if (payload->offset >= session->file_size) {
 		PX4_ERR("request past EOF");
 		return kErrEOF;
 	}
 
-	if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
+	if (lseek(session->fd, payload->offset, SEEK_SET) < 0) {
 		PX4_ERR("seek fail");
 		return kErrFailErrno;
 	}
 
-	int bytes_read = ::read(_session_info.fd, &payload->data[0], kMaxDataLength);
+	int bytes_read = ::read(session->fd, &payload->data[0], kMaxDataLength);
 
 	if (bytes_read < 0) {
 		// Negative return indicates error other than eof
@@ -586,19 +641,28 @@ MavlinkFTP::_workRead(PayloadHeader *payload)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workBurst(PayloadHeader *payload, uint8_t target_system_id)
 {
-	if (payload->session != 0 && _session_info.fd < 0) {
+	SessionInfo *session = _get_session(payload->session);
+
+	if (session == nullptr) {
 		return kErrInvalidSession;
 	}
 
 #ifdef MAVLINK_FTP_DEBUG
 	PX4_INFO("FTP: burst offset:%d", payload->offset);
 #endif
+
+	// the read-ahead blocks are optional, without them every packet is read from the file
+	if (!session->read_ahead) {
+		session->read_ahead = new uint8_t[kReadAheadSize];
+		session->read_ahead_len = 0;
+	}
+
 	// Setup for streaming sends
-	_session_info.stream_download = true;
-	_session_info.stream_offset = payload->offset;
-	_session_info.stream_chunk_transmitted = 0;
-	_session_info.stream_seq_number = payload->seq_number + 1;
-	_session_info.stream_target_system_id = target_system_id;
+	session->stream_download = true;
+	session->stream_offset = payload->offset;
+	session->stream_chunk_transmitted = 0;
+	session->stream_seq_number = payload->seq_number + 1;
+	session->stream_target_system_id = target_system_id;
 
 	return kErrNone;
 }
@@ -607,17 +671,22 @@ MavlinkFTP::_workBurst(PayloadHeader *payload, uint8_t target_system_id)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workWrite(PayloadHeader *payload)
 {
-	if (payload->session != 0 && _session_info.fd < 0) {
+	SessionInfo *session = _get_session(payload->session);
+
+	if (session == nullptr) {
 		return kErrInvalidSession;
 	}
 
-	if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
+	// the read-ahead blocks no longer match the file content, also those of other sessions on the same file
+	_invalidate_read_ahead();
+
+	if (lseek(session->fd, payload->offset, SEEK_SET) < 0) {
 		// Unable to see to the specified location
 		PX4_ERR("seek fail");
 		return kErrFailErrno;
 	}
 
-	int bytes_written = ::write(_session_info.fd, &payload->data[0], payload->size);
+	int bytes_written = ::write(session->fd, &payload->data[0], payload->size);
 
 	if (bytes_written < 0) {
 		// Negative return indicates error other than eof
@@ -640,6 +709,8 @@ MavlinkFTP::_workRemoveFile(PayloadHeader *payload)
 	// ensure termination
 	_work_buffer1[_work_buffer1_len - 1] = '\0';
 
+	_invalidate_read_ahead();
+
 	if (unlink(_work_buffer1) == 0) {
 		payload->size = 0;
 		return kErrNone;
@@ -659,6 +730,8 @@ MavlinkFTP::_workTruncateFile(PayloadHeader *payload)
 	_work_buffer1[_work_buffer1_len - 1] = '\0';
 	payload->size = 0;
 
+	_invalidate_read_ahead();
+
 #ifdef __PX4_NUTTX
 
 	// emulate truncate(_work_buffer1, payload->offset) by
@@ -747,13 +820,13 @@ MavlinkFTP::_workTruncateFile(PayloadHeader *payload)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workTerminate(PayloadHeader *payload)
 {
-	if (payload->session != 0 || _session_info.fd < 0) {
+	SessionInfo *session = _get_session(payload->session);
+
+	if (session == nullptr) {
 		return kErrInvalidSession;
 	}
 
-	::close(_session_info.fd);
-	_session_info.fd = -1;
-	_session_info.stream_download = false;
+	_close_session(*session);
 
 	payload->size = 0;
 
@@ -764,10 +837,8 @@ MavlinkFTP::_workTerminate(PayloadHeader *payload)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workReset(PayloadHeader *payload)
 {
-	if (_session_info.fd != -1) {
-		::close(_session_info.fd);
-		_session_info.fd = -1;
-		_session_info.stream_download = false;
+	for (SessionInfo &session : _session_info) {
+		_close_session(session);
 	}
 
 	payload->size = 0;
@@ -796,6 +867,8 @@ MavlinkFTP::_workRename(PayloadHeader *payload)
 	strncpy(_work_buffer2 + _root_dir_len, ptr + oldpath_sz + 1, _work_buffer2_len - _root_dir_len);
 	_work_buffer2[_work_buffer2_len - 1] = '\0'; // ensure termination
 
+	_invalidate_read_ahead();
+
 	if (rename(_work_buffer1, _work_buffer2) == 0) {
 		payload->size = 0;
 		return kErrNone;
@@ -975,13 +1048,26 @@ void MavlinkFTP::send(const hrt_abstime t)
 	}
 
 	// Anything to stream?
-	if (!_session_info.stream_download) {
+	if (get_size() == 0) {
+		_last_stream_send = t;
 		return;
 	}
 
+	unsigned max_bytes_to_send = 0;
+
 #ifndef MAVLINK_FTP_UNIT_TEST
 	// Skip send if not enough room
-	unsigned max_bytes_to_send = _mavlink->get_free_tx_buf();
+	max_bytes_to_send = _mavlink->get_free_tx_buf();
+
+	if (_mavlink->get_protocol() != SERIAL) {
+		// Network links always report a full MTU as free. Throttle by a share of the link data rate since the
+		// last send instead, so that the streams keep the rest. Limit the catch-up after a pause of the caller
+		// to 100 ms, but always let one packet through eventually, also on slow links.
+		const uint64_t rate = _mavlink->get_data_rate() / kBurstRateShareDiv;
+		const uint64_t budget = rate * (t - _last_stream_send) / 1000000;
+		max_bytes_to_send = (unsigned)math::min(budget, math::max(rate / 10, (uint64_t)get_size()));
+	}
+
 #ifdef MAVLINK_FTP_DEBUG
 	PX4_INFO("MavlinkFTP::send max_bytes_to_send(%d) get_free_tx_buf(%d)", max_bytes_to_send, _mavlink->get_free_tx_buf());
 #endif
@@ -990,6 +1076,84 @@ void MavlinkFTP::send(const hrt_abstime t)
 		return;
 	}
 
+#endif
+
+	_last_stream_send = t;
+
+#ifndef MAVLINK_FTP_UNIT_TEST
+	_mavlink->begin_tx_batch();
+#endif
+
+	// serve the streaming sessions round-robin, so that none of them is starved
+	const uint8_t first_session = _stream_session_next;
+
+	for (uint8_t i = 0; i < kMaxSessions; i++) {
+		const uint8_t session_id = (first_session + i) % kMaxSessions;
+		SessionInfo &session = _session_info[session_id];
+
+		if (session.stream_download && _send_stream(session, session_id, max_bytes_to_send)) {
+			_stream_session_next = (session_id + 1) % kMaxSessions;
+		}
+	}
+
+#ifndef MAVLINK_FTP_UNIT_TEST
+	_mavlink->end_tx_batch();
+#endif
+}
+
+int
+MavlinkFTP::_read_stream_data(SessionInfo &session, uint8_t *data)
+{
+	const uint32_t offset = session.stream_offset;
+
+	if (!session.read_ahead) {
+		if (lseek(session.fd, offset, SEEK_SET) < 0) {
+			return -1;
+		}
+
+		return ::read(session.fd, data, kMaxDataLength);
+	}
+
+	if (offset < session.read_ahead_offset || offset >= session.read_ahead_offset + session.read_ahead_len) {
+		// outside of the read-ahead blocks: refill them from the stream offset with a single read
+		session.read_ahead_len = 0;
+
+		if (lseek(session.fd, offset, SEEK_SET) < 0) {
+			return -1;
+		}
+
+		int bytes_read = ::read(session.fd, session.read_ahead, kReadAheadSize);
+
+		if (bytes_read <= 0) {
+			return bytes_read;
+		}
+
+		session.read_ahead_offset = offset;
+		session.read_ahead_len = bytes_read;
+	}
+
+	const uint32_t block_offset = offset - session.read_ahead_offset;
+	int len = session.read_ahead_len - block_offset;
+
+	if (len > kMaxDataLength) {
+		len = kMaxDataLength;
+	}
+
+	memcpy(data, &session.read_ahead[block_offset], len);
+	return len;
+}
+
+bool
+MavlinkFTP::_send_stream(SessionInfo &session, uint8_t session_id, unsigned &max_bytes_to_send)
+{
+#ifndef MAVLINK_FTP_UNIT_TEST
+	const unsigned packet_size = MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+
+	// the budget may already be used up by the other sessions
+	if (max_bytes_to_send < packet_size) {
+		return false;
+	}
+
 #endif
 
 	// Send stream packets until buffer is full
@@ -1004,19 +1168,19 @@ void MavlinkFTP::send(const hrt_abstime t)
 		mavlink_file_transfer_protocol_t ftp_msg;
 		PayloadHeader *payload = reinterpret_cast<PayloadHeader *>(&ftp_msg.payload[0]);
 
-		payload->seq_number = _session_info.stream_seq_number;
-		payload->session = 0;
+		payload->seq_number = session.stream_seq_number;
+		payload->session = session_id;
 		payload->opcode = kRspAck;
 		payload->req_opcode = kCmdBurstReadFile;
-		payload->offset = _session_info.stream_offset;
-		_session_info.stream_seq_number++;
+		payload->offset = session.stream_offset;
+		session.stream_seq_number++;
 
 #ifdef MAVLINK_FTP_DEBUG
-		PX4_INFO("stream send: offset %d", _session_info.stream_offset);
+		PX4_INFO("stream send: session %d offset %d", session_id, session.stream_offset);
 #endif
 
 		// We have to test seek past EOF ourselves, lseek will allow seek past EOF
-		if (_session_info.stream_offset >= _session_info.file_size) {
+		if (session.stream_offset >= session.file_size) {
 			error_code = kErrEOF;
 #ifdef MAVLINK_FTP_DEBUG
 			PX4_INFO("stream download: sending Nak EOF");
@@ -1024,16 +1188,7 @@ void MavlinkFTP::send(const hrt_abstime t)
 		}
 
 		if (error_code == kErrNone) {
-			if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
-				error_code = kErrFailErrno;
-#ifdef MAVLINK_FTP_DEBUG
-				PX4_WARN("stream download: seek fail");
-#endif
-			}
-		}
-
-		if (error_code == kErrNone) {
-			int bytes_read = ::read(_session_info.fd, &payload->data[0], kMaxDataLength);
+			int bytes_read = _read_stream_data(session, &payload->data[0]);
 
 			if (bytes_read < 0) {
 				// Negative return indicates error other than eof
@@ -1044,8 +1199,8 @@ void MavlinkFTP::send(const hrt_abstime t)
 
 			} else {
 				payload->size = bytes_read;
-				_session_info.stream_offset += bytes_read;
-				_session_info.stream_chunk_transmitted += bytes_read;
+				session.stream_offset += bytes_read;
+				session.stream_chunk_transmitted += bytes_read;
 			}
 		}
 
@@ -1061,19 +1216,19 @@ void MavlinkFTP::send(const hrt_abstime t)
 				payload->data[1] = r_errno;
 			}
 
-			_session_info.stream_download = false;
+			session.stream_download = false;
 
 		} else {
 #ifndef MAVLINK_FTP_UNIT_TEST
 
-			if (max_bytes_to_send < (get_size() * 2)) {
+			if (max_bytes_to_send < (packet_size * 2)) {
 				more_data = false;
 
 				/* perform transfers in 35K chunks - this is determined empirical */
-				if (_session_info.stream_chunk_transmitted > 35000) {
+				if (session.stream_chunk_transmitted > 35000) {
 					payload->burst_complete = true;
-					_session_info.stream_download = false;
-					_session_info.stream_chunk_transmitted = 0;
+					session.stream_download = false;
+					session.stream_chunk_transmitted = 0;
 				}
 
 			} else {
@@ -1081,13 +1236,18 @@ void MavlinkFTP::send(const hrt_abstime t)
 				more_data = true;
 				payload->burst_complete = false;
 #ifndef MAVLINK_FTP_UNIT_TEST
-				max_bytes_to_send -= get_size();
 			}
 
 #endif
 		}
 
-		ftp_msg.target_system = _session_info.stream_target_system_id;
+#ifndef MAVLINK_FTP_UNIT_TEST
+		max_bytes_to_send -= math::min(max_bytes_to_send, packet_size);
+#endif
+
+		ftp_msg.target_system = session.stream_target_system_id;
 		_reply(&ftp_msg);
 	} while (more_data);
+
+	return true;
 }
@@ -146,6 +146,24 @@ private:
 	ErrorCode	_workRename(PayloadHeader *payload);
 	ErrorCode	_workCalcFileCRC32(PayloadHeader *payload);
 
+	struct SessionInfo;
+
+	/// @brief Returns the open session for a session id, nullptr if the id is invalid or not open
+	SessionInfo	*_get_session(uint8_t session);
+	void		_close_session(SessionInfo &session);
+
+	/// @brief Drops the read-ahead blocks of all sessions, for any write, truncate, remove or rename. Sessions
+	///	are not matched by file, NuttX provides no inode number to tell if two sessions share a file.
+	void		_invalidate_read_ahead();
+
+	/// @brief Sends the stream packets of a session while the link budget allows it
+	///	@return false if nothing was sent because the budget is used up
+	bool		_send_stream(SessionInfo &session, uint8_t session_id, unsigned &max_bytes_to_send);
+
+	/// @brief Reads the data at the stream offset of a session through its read-ahead blocks
+	///	@return number of bytes read, -1 on error (errno is set)
+	int		_read_stream_data(SessionInfo &session, uint8_t *data);
+
 	uint8_t _getServerSystemId(void);
 	uint8_t _getServerComponentId(void);
 	uint8_t _getServerChannel(void);
@@ -163,6 +181,25 @@ private:
 	/// @brief Maximum data size in RequestHeader::data
 	static const uint8_t	kMaxDataLength = MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN - sizeof(PayloadHeader);
 
+	/// @brief Number of concurrently open sessions (e.g. parameter, mission and log download of a GCS)
+#ifdef __PX4_NUTTX
+	static constexpr uint8_t kMaxSessions = 3;
+#else
+	static constexpr uint8_t kMaxSessions = 8;
+#endif
+
+	/// @brief Number of kMaxDataLength blocks read ahead from the file of a burst session with a single read()
+#ifdef __PX4_NUTTX
+	static constexpr int kReadAheadBlocks = 4;
+#else
+	static constexpr int kReadAheadBlocks = 64;
+#endif
+	static constexpr int kReadAheadSize = kReadAheadBlocks * kMaxDataLength;
+
+	/// @brief Burst reads on network links use at most 1/kBurstRateShareDiv of the link data rate, the rest is
+	///	left to the streams
+	static constexpr unsigned kBurstRateShareDiv = 2;
+
 	struct SessionInfo {
 		int		fd;
 		uint32_t	file_size;
@@ -171,8 +208,13 @@ private:
 		uint16_t	stream_seq_number;
 		uint8_t		stream_target_system_id;
 		unsigned	stream_chunk_transmitted;
+		uint8_t		*read_ahead;		///< read-ahead blocks, allocated on the first burst
+		uint32_t	read_ahead_offset;	///< file offset of read_ahead[0]
+		int		read_ahead_len;		///< number of valid bytes in read_ahead
 	};
-	struct SessionInfo _session_info {};	///< Session info, fd=-1 for no active session
+	struct SessionInfo _session_info[kMaxSessions] {};	///< Session info, fd=-1 for no active session
+	uint8_t _stream_session_next{0};			///< session to start streaming with on the next send()
+	hrt_abstime _last_stream_send{0};			///< time of the last stream send(), for the link budget
 
 	ReceiveMessageFunc_t	_utRcvMsgFunc{};	///< Unit test override for mavlink message sending
 	void			*_worker_data{nullptr};	///< Additional parameter to _utRcvMsgFunc;
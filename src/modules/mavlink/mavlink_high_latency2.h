@@ -180,6 +180,8 @@ protected:
 
 	void update_data();
 
+	bool has_update_data() const { return true; }
+
 	void update_airspeed();
 
 	void update_tecs_status();
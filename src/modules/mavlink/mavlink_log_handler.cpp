@@ -36,8 +36,10 @@
 
 #include "mavlink_log_handler.h"
 #include "mavlink_main.h"
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
 #define MOUNTPOINT PX4_STORAGEDIR
 
@@ -45,6 +47,13 @@ static const char *kLogRoot    = MOUNTPOINT "/log";
 static const char *kLogData    = MOUNTPOINT "/logdata.txt";
 static const char *kTmpData    = MOUNTPOINT "/$log$.txt";
 
+//-- Size of the read-ahead window used while sending log data
+#ifdef __PX4_NUTTX
+static const uint32_t kReadBufferSize = 2048;
+#else
+static const uint32_t kReadBufferSize = 32 * 1024;
+#endif
+
 #ifdef __PX4_NUTTX
 #define PX4LOG_REGULAR_FILE DTYPE_FILE
 #define PX4LOG_DIRECTORY    DTYPE_DIRECTORY
@@ -135,6 +144,9 @@ MavlinkLogHandler::send(const hrt_abstime /*t*/)
 #define MAX_BYTES_SEND 256 * 1024
 	size_t count = 0;
 
+	//-- Hand all packets of this call to the OS at once
+	_mavlink->begin_tx_batch();
+
 	//-- Log Entries
 	while (_pLogHandlerHelper && _pLogHandlerHelper->current_status == LogListHelper::LOG_HANDLER_LISTING
 	       && _mavlink->get_free_tx_buf() > get_size() && count < MAX_BYTES_SEND) {
@@ -146,6 +158,8 @@ MavlinkLogHandler::send(const hrt_abstime /*t*/)
 	       && _mavlink->get_free_tx_buf() > get_size() && count < MAX_BYTES_SEND) {
 		count += _log_send_data();
 	}
+
+	_mavlink->end_tx_batch();
 }
 
 //-------------------------------------------------------------------
@@ -207,6 +221,21 @@ MavlinkLogHandler::_log_request_data(const mavlink_message_t *msg)
 		return;
 	}
 
+	//-- A request continuing the window being sent is queued behind it (pipelined download)
+	if (_pLogHandlerHelper->current_status == LogListHelper::LOG_HANDLER_SENDING_DATA
+	    && _pLogHandlerHelper->current_log_index == request.id
+	    && request.ofs == _pLogHandlerHelper->current_log_data_offset
+	    + _pLogHandlerHelper->current_log_data_remaining) {
+		uint32_t available = 0;
+
+		if (request.ofs < _pLogHandlerHelper->current_log_size) {
+			available = _pLogHandlerHelper->current_log_size - request.ofs;
+		}
+
+		_pLogHandlerHelper->current_log_data_remaining += request.count < available ? request.count : available;
+		return;
+	}
+
 	//-- If we were sending log entries, stop it
 	_pLogHandlerHelper->current_status = LogListHelper::LOG_HANDLER_IDLE;
 
@@ -341,7 +370,11 @@ LogListHelper::LogListHelper()
 	, current_log_size(0)
 	, current_log_data_offset(0)
 	, current_log_data_remaining(0)
-	, current_log_filep(nullptr)
+	, current_log_fd(-1)
+	, _entries(nullptr)
+	, _read_buf(nullptr)
+	, _read_buf_offset(0)
+	, _read_buf_len(0)
 {
 	_init();
 }
@@ -349,6 +382,10 @@ LogListHelper::LogListHelper()
 //-------------------------------------------------------------------
 LogListHelper::~LogListHelper()
 {
+	close_for_transmit();
+	delete[] _read_buf;
+	delete[] _entries;
+
 	// Remove log data files (if any)
 	unlink(kLogData);
 	unlink(kTmpData);
@@ -357,6 +394,53 @@ LogListHelper::~LogListHelper()
 //-------------------------------------------------------------------
 bool
 LogListHelper::get_entry(int idx, uint32_t &size, uint32_t &date, char *filename, int filename_len)
+{
+	if (!_entries) {
+		return _get_entry_from_file(idx, size, date, filename, filename_len);
+	}
+
+	size = 0;
+	date = 0;
+
+	if (idx < 0 || idx >= log_count) {
+		return false;
+	}
+
+	size = _entries[idx].size;
+	date = _entries[idx].date;
+
+	if (!filename || filename_len <= 0) {
+		return true;
+	}
+
+	//-- Only the file name needs a look into the list file, right at the entry's line
+	bool result = false;
+	FILE *f = ::fopen(kLogData, "r");
+
+	if (f) {
+		char line[160];
+
+		if (fseek(f, _entries[idx].line_offset, SEEK_SET) == 0 && fgets(line, sizeof(line), f)) {
+			uint32_t line_date;
+			uint32_t line_size;
+			char file[160];
+
+			if (sscanf(line, "%u %u %s", &line_date, &line_size, file) == 3) {
+				strncpy(filename, file, filename_len);
+				filename[filename_len - 1] = 0; // ensure null-termination
+				result = true;
+			}
+		}
+
+		fclose(f);
+	}
+
+	return result;
+}
+
+//-------------------------------------------------------------------
+bool
+LogListHelper::_get_entry_from_file(int idx, uint32_t &size, uint32_t &date, char *filename, int filename_len)
 {
 	//-- Find log file in log list file created during init()
 	size = 0;
@@ -397,21 +481,36 @@ LogListHelper::get_entry(int idx, uint32_t &size, uint32_t &date, char *filename
 bool
 LogListHelper::open_for_transmit()
 {
-	if (current_log_filep) {
-		::fclose(current_log_filep);
-		current_log_filep = nullptr;
-	}
+	close_for_transmit();
 
-	current_log_filep = ::fopen(current_log_filename, "rb");
+	current_log_fd = ::open(current_log_filename, O_RDONLY);
 
-	if (!current_log_filep) {
+	if (current_log_fd < 0) {
 		PX4LOG_WARN("MavlinkLogHandler::open_for_transmit Could not open %s\n", current_log_filename);
 		return false;
 	}
 
+	//-- Without the read-ahead window the data is read packet by packet
+	if (!_read_buf) {
+		_read_buf = new uint8_t[kReadBufferSize];
+	}
+
 	return true;
 }
 
+//-------------------------------------------------------------------
+void
+LogListHelper::close_for_transmit()
+{
+	if (current_log_fd >= 0) {
+		::close(current_log_fd);
+		current_log_fd = -1;
+	}
+
+	_read_buf_offset = 0;
+	_read_buf_len = 0;
+}
+
 //-------------------------------------------------------------------
 size_t
 LogListHelper::get_log_data(uint8_t len, uint8_t *buffer)
@@ -420,21 +519,56 @@ LogListHelper::get_log_data(uint8_t len, uint8_t *buffer)
 		return 0;
 	}
 
-	if (!current_log_filep) {
+	if (current_log_fd < 0) {
 		PX4LOG_WARN("MavlinkLogHandler::get_log_data file not open %s\n", current_log_filename);
 		return 0;
 	}
 
-	long int offset = current_log_data_offset - ftell(current_log_filep);
+	if (!_read_buf) {
+		if (::lseek(current_log_fd, current_log_data_offset, SEEK_SET) < 0) {
+			return 0;
+		}
 
-	if (offset && fseek(current_log_filep, offset, SEEK_CUR)) {
-		fclose(current_log_filep);
-		current_log_filep = nullptr;
-		PX4LOG_WARN("MavlinkLogHandler::get_log_data Seek error in %s\n", current_log_filename);
-		return 0;
+		ssize_t ret = ::read(current_log_fd, buffer, len);
+		return ret > 0 ? ret : 0;
+	}
+
+	size_t result = 0;
+
+	while (result < len) {
+		const uint32_t offset = current_log_data_offset + result;
+
+		//-- Move the window if the data is not in it
+		if (offset < _read_buf_offset || offset >= _read_buf_offset + _read_buf_len) {
+			_read_buf_len = 0;
+
+			if (::lseek(current_log_fd, offset, SEEK_SET) < 0) {
+				close_for_transmit();
+				PX4LOG_WARN("MavlinkLogHandler::get_log_data Seek error in %s\n", current_log_filename);
+				break;
+			}
+
+			ssize_t ret = ::read(current_log_fd, _read_buf, kReadBufferSize);
+
+			if (ret <= 0) {
+				//-- End of file
+				break;
+			}
+
+			_read_buf_offset = offset;
+			_read_buf_len = ret;
+		}
+
+		size_t chunk = _read_buf_offset + _read_buf_len - offset;
+
+		if (chunk > len - result) {
+			chunk = len - result;
+		}
+
+		memcpy(&buffer[result], &_read_buf[offset - _read_buf_offset], chunk);
+		result += chunk;
 	}
 
-	size_t result = fread(buffer, 1, len, current_log_filep);
 	return result;
 }
 
@@ -494,7 +628,60 @@ LogListHelper::_init()
 	if (rename(kTmpData, kLogData)) {
 		PX4LOG_WARN("MavlinkLogHandler::init Error renaming %s\n", kTmpData);
 		log_count = 0;
+		return;
 	}
+
+	_build_index();
+}
+
+//-------------------------------------------------------------------
+void
+LogListHelper::_build_index()
+{
+	/*
+		Read the list file once and keep date, size and line position of
+		every entry, so listing does not need to re-read and parse the
+		file for each entry.
+	*/
+	if (log_count <= 0) {
+		return;
+	}
+
+	FILE *f = ::fopen(kLogData, "r");
+
+	if (!f) {
+		return;
+	}
+
+	_entries = new LogEntry[log_count];
+
+	if (_entries) {
+		char line[160];
+		int count = 0;
+		long line_offset = 0;
+
+		while (count < log_count && fgets(line, sizeof(line), f)) {
+			LogEntry &entry = _entries[count++];
+			entry.date = 0;
+			entry.size = 0;
+			entry.line_offset = line_offset;
+
+			if (sscanf(line, "%u %u", &entry.date, &entry.size) != 2) {
+				entry.date = 0;
+				entry.size = 0;
+			}
+
+			line_offset = ftell(f);
+		}
+
+		//-- Fall back to reading the file if it does not match what was scanned
+		if (count != log_count) {
+			delete[] _entries;
+			_entries = nullptr;
+		}
+	}
+
+	fclose(f);
 }
 
 //-------------------------------------------------------------------
@@ -560,7 +747,7 @@ bool
 LogListHelper::_get_log_time_size(const char *path, const char *file, time_t &date, uint32_t &size)
 {
 	if (file && file[0]) {
-		if (strstr(file, ".px4log") || strstr(file, ".ulg")) {
+		if (strstr(file, ".px4log") || strstr(file, ".ulg") || strstr(file, ".ulz")) {
 			// Always try to get file time first
 			if (stat_file(path, &date, &size)) {
 				// Try to prevent taking date if it's around 1970 (use the logic below instead)
@@ -60,6 +60,7 @@ public:
 
 	bool        get_entry(int idx, uint32_t &size, uint32_t &date, char *filename = 0, int filename_len = 0);
 	bool        open_for_transmit();
+	void        close_for_transmit();
 	size_t      get_log_data(uint8_t len, uint8_t *buffer);
 
 	enum {
@@ -77,14 +78,30 @@ public:
 	uint32_t    current_log_size;
 	uint32_t    current_log_data_offset;
 	uint32_t    current_log_data_remaining;
-	FILE       *current_log_filep;
+	int         current_log_fd;
 	char        current_log_filename[128];
 
 private:
+	// One entry of the in-memory log index, built from kLogData once after scanning
+	struct LogEntry {
+		uint32_t date;
+		uint32_t size;
+		uint32_t line_offset;   ///< position of the entry's line in kLogData
+	};
+
 	void        _init();
+	void        _build_index();
+	bool        _get_entry_from_file(int idx, uint32_t &size, uint32_t &date, char *filename, int filename_len);
 	bool        _get_session_date(const char *path, const char *dir, time_t &date);
 	void        _scan_logs(FILE *f, const char *dir, time_t &date);
 	bool        _get_log_time_size(const char *path, const char *file, time_t &date, uint32_t &size);
+
+	LogEntry   *_entries;           ///< cached index, nullptr if it could not be allocated
+
+	// Read-ahead window of the log being sent, holds [_read_buf_offset, _read_buf_offset + _read_buf_len)
+	uint8_t    *_read_buf;
+	uint32_t    _read_buf_offset;
+	uint32_t    _read_buf_len;
 };
 
 // MAVLink LOG_* Message Handler
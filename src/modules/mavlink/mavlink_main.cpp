@@ -76,6 +76,7 @@
 #include <systemlib/err.h>
 #include <perf/perf_counter.h>
 #include <systemlib/mavlink_log.h>
+#include <systemlib/mavlink_log_deferred.h>
 #include <lib/ecl/geo/geo.h>
 #include <dataman/dataman.h>
 #include <version/version.h>
@@ -257,6 +258,8 @@ Mavlink::Mavlink() :
 	_broadcast_address_found(false),
 	_broadcast_address_not_found_warned(false),
 	_broadcast_failed_warned(false),
+#endif
+#if !defined(__PX4_POSIX) && defined(CONFIG_NET)
 	_network_buf{},
 	_network_buf_len(0),
 #endif
@@ -745,6 +748,11 @@ int Mavlink::mavlink_open_uart(int baud, const char *uart_name, bool force_flow_
 		return _uart_fd;
 	}
 
+#if defined(__PX4_POSIX)
+	/* the transmit batch is written while holding _send_mutex, a full OS buffer must not block other threads */
+	fcntl(_uart_fd, F_SETFL, fcntl(_uart_fd, F_GETFL) | O_NONBLOCK);
+#endif
+
 	/* Try to set baud rate */
 	struct termios uart_config;
 	int termios_state;
@@ -875,6 +883,11 @@ Mavlink::get_free_tx_buf()
 		(void) ioctl(_uart_fd, FIONSPACE, (unsigned long)&buf_free);
 #endif
 
+#if defined(__PX4_POSIX)
+		/* bytes queued in the transmit batch are not in the OS buffer yet */
+		buf_free = math::max(buf_free - (int)_tx_batch.queued_bytes(), 0);
+#endif
+
 		if (_flow_control_mode == FLOW_CONTROL_AUTO && buf_free < FLOW_CONTROL_DISABLE_THRESHOLD) {
 			/* Disable hardware flow control in FLOW_CONTROL_AUTO mode:
 			 * if no successful write since a defined time
@@ -898,6 +911,10 @@ Mavlink::begin_send()
 	// must protect the network buffer so other calls from receive_thread do not
 	// mangle the message.
 	pthread_mutex_lock(&_send_mutex);
+
+#if defined(__PX4_POSIX)
+	_tx_batch.begin_packet(hrt_absolute_time());
+#endif
 }
 
 int
@@ -905,7 +922,18 @@ Mavlink::send_packet()
 {
 	int ret = -1;
 
-#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+#if defined(__PX4_POSIX)
+	_tx_batch.end_packet();
+
+	if (_tx_batch_users == 0 || _tx_batch.full() ||
+	    (!_tx_batch.empty() && hrt_absolute_time() > _tx_batch.first_time() + TX_BATCH_DEADLINE)) {
+		ret = flush_tx_batch();
+
+	} else {
+		ret = 0;
+	}
+
+#elif defined(CONFIG_NET)
 
 	/* Only send packets if there is something in the buffer. */
 	if (_network_buf_len == 0) {
@@ -915,41 +943,59 @@ Mavlink::send_packet()
 
 	if (get_protocol() == UDP) {
 
-#ifdef CONFIG_NET
-
 		if (_src_addr_initialized) {
-#endif
 			ret = sendto(_socket_fd, _network_buf, _network_buf_len, 0,
 				     (struct sockaddr *)&_src_addr, sizeof(_src_addr));
-#ifdef CONFIG_NET
 		}
 
+		if (udp_broadcast_required()) {
+			report_broadcast_result(sendto(_socket_fd, _network_buf, _network_buf_len, 0,
+						       (struct sockaddr *)&_bcast_addr, sizeof(_bcast_addr)));
+		}
+
+	} else if (get_protocol() == TCP) {
+		/* not implemented, but possible to do so */
+		PX4_ERR("TCP transport pending implementation");
+	}
+
+	_network_buf_len = 0;
 #endif
 
-		/* resend message via broadcast if no valid connection exists */
-		if ((_mode != MAVLINK_MODE_ONBOARD) && broadcast_enabled() &&
-		    (!get_client_source_initialized()
-		     || (hrt_elapsed_time(&_tstatus.heartbeat_time) > 3_s))) {
+	pthread_mutex_unlock(&_send_mutex);
+	return ret;
+}
 
-			if (!_broadcast_address_found) {
-				find_broadcast_address();
-			}
+#if defined(__PX4_POSIX)
+int
+Mavlink::flush_tx_batch()
+{
+	if (_tx_batch.empty()) {
+		return 0;
+	}
 
-			if (_broadcast_address_found && _network_buf_len > 0) {
+	int ret = -1;
 
-				int bret = sendto(_socket_fd, _network_buf, _network_buf_len, 0,
-						  (struct sockaddr *)&_bcast_addr, sizeof(_bcast_addr));
+	if (get_protocol() == SERIAL) {
+		/* the packets are stored back to back, so the whole batch is a single (non-blocking) write.
+		 * get_free_tx_buf() limits the batch to the free OS buffer, anything not written is dropped */
+		const unsigned len = _tx_batch.bytes();
+		ret = ::write(_uart_fd, _tx_batch.data(), len);
+
+		if (ret > 0) {
+			_last_write_success_time = _last_write_try_time;
+			count_txbytes(ret);
+		}
 
-				if (bret <= 0) {
-					if (!_broadcast_failed_warned) {
-						PX4_ERR("sending broadcast failed, errno: %d: %s", errno, strerror(errno));
-						_broadcast_failed_warned = true;
-					}
+		if (ret < (int)len) {
+			count_txerrbytes(len - math::max(ret, 0));
+		}
 
-				} else {
-					_broadcast_failed_warned = false;
-				}
-			}
+	} else if (get_protocol() == UDP) {
+		ret = _tx_batch.send_datagrams(_socket_fd, (struct sockaddr *)&_src_addr, sizeof(_src_addr));
+
+		if (udp_broadcast_required()) {
+			report_broadcast_result(_tx_batch.send_datagrams(_socket_fd, (struct sockaddr *)&_bcast_addr,
+						sizeof(_bcast_addr)));
 		}
 
 	} else if (get_protocol() == TCP) {
@@ -957,11 +1003,73 @@ Mavlink::send_packet()
 		PX4_ERR("TCP transport pending implementation");
 	}
 
-	_network_buf_len = 0;
+	_tx_batch.clear();
+	return ret;
+}
 #endif
 
+void
+Mavlink::begin_tx_batch()
+{
+#if defined(__PX4_POSIX)
+	pthread_mutex_lock(&_send_mutex);
+	_tx_batch_users++;
 	pthread_mutex_unlock(&_send_mutex);
-	return ret;
+#endif
+}
+
+void
+Mavlink::end_tx_batch()
+{
+#if defined(__PX4_POSIX)
+	pthread_mutex_lock(&_send_mutex);
+
+	if (_tx_batch_users > 0) {
+		_tx_batch_users--;
+	}
+
+	flush_tx_batch();
+	pthread_mutex_unlock(&_send_mutex);
+#endif
+}
+
+bool
+Mavlink::udp_broadcast_required()
+{
+#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+
+	/* resend message via broadcast if no valid connection exists */
+	if ((_mode != MAVLINK_MODE_ONBOARD) && broadcast_enabled() &&
+	    (!get_client_source_initialized()
+	     || (hrt_elapsed_time(&_tstatus.heartbeat_time) > 3_s))) {
+
+		if (!_broadcast_address_found) {
+			find_broadcast_address();
+		}
+
+		return _broadcast_address_found;
+	}
+
+#endif
+	return false;
+}
+
+void
+Mavlink::report_broadcast_result(int ret)
+{
+#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+
+	if (ret <= 0) {
+		if (!_broadcast_failed_warned) {
+			PX4_ERR("sending broadcast failed, errno: %d: %s", errno, strerror(errno));
+			_broadcast_failed_warned = true;
+		}
+
+	} else {
+		_broadcast_failed_warned = false;
+	}
+
+#endif
 }
 
 void
@@ -990,6 +1098,18 @@ Mavlink::send_bytes(const uint8_t *buf, unsigned packet_len)
 		}
 	}
 
+#if defined(__PX4_POSIX)
+
+	/* queue the bytes, serial bytes are accounted for once they are written by flush_tx_batch() */
+	if (!_tx_batch.append(buf, packet_len)) {
+		count_txerrbytes(packet_len);
+
+	} else if (get_protocol() != SERIAL) {
+		_last_write_success_time = _last_write_try_time;
+		count_txbytes(packet_len);
+	}
+
+#else
 	size_t ret = -1;
 
 	/* send message to UART */
@@ -997,7 +1117,7 @@ Mavlink::send_bytes(const uint8_t *buf, unsigned packet_len)
 		ret = ::write(_uart_fd, buf, packet_len);
 	}
 
-#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+#if defined(CONFIG_NET)
 
 	else {
 		if (_network_buf_len + packet_len < sizeof(_network_buf) / sizeof(_network_buf[0])) {
@@ -1017,6 +1137,8 @@ Mavlink::send_bytes(const uint8_t *buf, unsigned packet_len)
 		_last_write_success_time = _last_write_try_time;
 		count_txbytes(packet_len);
 	}
+
+#endif /* __PX4_POSIX */
 }
 
 void
@@ -1422,6 +1544,8 @@ Mavlink::configure_stream(const char *stream_name, const float rate)
 				delete stream;
 			}
 
+			_stream_schedule_invalid = true;
+
 			return OK;
 		}
 	}
@@ -1438,6 +1562,7 @@ Mavlink::configure_stream(const char *stream_name, const float rate)
 	if (stream != nullptr) {
 		stream->set_interval(interval);
 		LL_APPEND(_streams, stream);
+		_stream_schedule_invalid = true;
 
 		return OK;
 	}
@@ -1698,6 +1823,152 @@ Mavlink::update_rate_mult()
 	_rate_mult = math::constrain(_rate_mult, 0.05f, 1.0f);
 }
 
+void
+Mavlink::rebuild_stream_schedule()
+{
+	unsigned num_streams = 0;
+	int max_interval = 0;
+	MavlinkStream *stream;
+	LL_FOREACH(_streams, stream) {
+		num_streams++;
+
+		if (!stream->const_rate()) {
+			max_interval = math::max(max_interval, stream->get_interval());
+		}
+	}
+
+	if (num_streams > _stream_schedule_capacity) {
+		delete[] _stream_schedule;
+		_stream_schedule = new ScheduledStream[num_streams];
+		_stream_schedule_capacity = (_stream_schedule != nullptr) ? num_streams : 0;
+	}
+
+	_stream_schedule_size = 0;
+	_stream_schedule_rate_mult = _rate_mult;
+	_stream_schedule_max_interval = max_interval;
+	_stream_schedule_invalid = false;
+
+	if (num_streams == 0) {
+		return;
+	}
+
+	if (_stream_schedule == nullptr) {
+		PX4_ERR("stream schedule allocation failed");
+		_stream_schedule_invalid = true;
+		return;
+	}
+
+	LL_FOREACH(_streams, stream) {
+		_stream_schedule[_stream_schedule_size].send_time = stream->get_next_send_time();
+		_stream_schedule[_stream_schedule_size].stream = stream;
+		_stream_schedule_size++;
+	}
+
+	for (int i = (int)_stream_schedule_size / 2 - 1; i >= 0; i--) {
+		stream_schedule_sift_down(i);
+	}
+}
+
+void
+Mavlink::stream_schedule_sift_down(unsigned index)
+{
+	const ScheduledStream item = _stream_schedule[index];
+
+	while (2 * index + 1 < _stream_schedule_size) {
+		unsigned child = 2 * index + 1;
+
+		if (child + 1 < _stream_schedule_size
+		    && _stream_schedule[child + 1].send_time < _stream_schedule[child].send_time) {
+			child++;
+		}
+
+		if (item.send_time <= _stream_schedule[child].send_time) {
+			break;
+		}
+
+		_stream_schedule[index] = _stream_schedule[child];
+		index = child;
+	}
+
+	_stream_schedule[index] = item;
+}
+
+void
+Mavlink::update_streams(const hrt_abstime &t)
+{
+	/* the send times depend on the rate multiplier, reorder once it moved an interval by a main loop iteration */
+	const float interval_change = _stream_schedule_max_interval
+				      * fabsf(1.0f / _rate_mult - 1.0f / _stream_schedule_rate_mult);
+
+	if (_stream_schedule_invalid || (interval_change >= (float)_main_loop_delay)) {
+		rebuild_stream_schedule();
+	}
+
+	/* refill the transmit budget at the data rate, at most with the bytes of two main loop iterations */
+	const int64_t budget_max = math::max((int64_t)_datarate * 2 * _main_loop_delay / 1000000,
+					     (int64_t)MAVLINK_MAX_PACKET_LEN);
+
+	if (_tx_budget_time == 0) {
+		_tx_budget = budget_max;
+
+	} else {
+		const int64_t refill = (int64_t)_datarate * (int64_t)(t - _tx_budget_time) / 1000000;
+		_tx_budget = math::min(_tx_budget + refill, budget_max);
+	}
+
+	_tx_budget_time = t;
+
+	/* update the streams which are due in order of their send time while the link has capacity */
+	while (_stream_schedule_size > 0 && _stream_schedule[0].send_time <= t && _tx_budget > 0) {
+		MavlinkStream *stream = _stream_schedule[0].stream;
+
+		if (stream->update(t) == 0) {
+			_tx_budget -= stream->get_size_avg();
+		}
+
+		if (!_first_heartbeat_sent) {
+			if (_mode == MAVLINK_MODE_IRIDIUM) {
+				if (stream->get_id() == MAVLINK_MSG_ID_HIGH_LATENCY2) {
+					_first_heartbeat_sent = stream->first_message_sent();
+				}
+
+			} else {
+				if (stream->get_id() == MAVLINK_MSG_ID_HEARTBEAT) {
+					_first_heartbeat_sent = stream->first_message_sent();
+				}
+			}
+		}
+
+		/* streams which did not send, or need an update on every iteration, are checked on the next one */
+		hrt_abstime send_time = stream->get_next_send_time();
+
+		if (send_time <= t) {
+			send_time = t + _main_loop_delay;
+		}
+
+		_stream_schedule[0].send_time = send_time;
+		stream_schedule_sift_down(0);
+	}
+}
+
+unsigned
+Mavlink::get_main_loop_sleep() const
+{
+	if (_stream_schedule_size == 0 || _stream_schedule_invalid) {
+		return _main_loop_delay;
+	}
+
+	/* sleep until the next stream is due, or until the link has capacity again */
+	const hrt_abstime now = hrt_absolute_time();
+	int64_t sleep_us = (_stream_schedule[0].send_time > now) ? _stream_schedule[0].send_time - now : 0;
+
+	if (_tx_budget <= 0 && _datarate > 0) {
+		sleep_us = math::max(sleep_us, (1 - _tx_budget) * 1000000 / _datarate);
+	}
+
+	return math::constrain(sleep_us, (int64_t)MAVLINK_MIN_INTERVAL, (int64_t)_main_loop_delay);
+}
+
 void
 Mavlink::update_radio_status(const radio_status_s &radio_status)
 {
@@ -2279,11 +2550,14 @@ Mavlink::task_main(int argc, char *argv[])
 	MavlinkReceiver::receive_start(&_receive_thread, this);
 
 	while (!_task_should_exit) {
-		/* main loop */
-		px4_usleep(_main_loop_delay);
+		/* main loop, wake up when the next stream is due or after the main loop delay at the latest */
+		px4_usleep(get_main_loop_sleep());
 
 		perf_begin(_loop_perf);
 
+		/* collect everything sent during this iteration and write it out in one go at the end */
+		begin_tx_batch();
+
 		hrt_abstime t = hrt_absolute_time();
 
 		update_rate_mult();
@@ -2389,6 +2663,11 @@ Mavlink::task_main(int argc, char *argv[])
 			}
 		}
 
+		/* format and publish messages queued by time critical modules (done by the first instance only) */
+		if (_instance_id == 0) {
+			mavlink_log_deferred::drain(&_mavlink_log_pub);
+		}
+
 		struct mavlink_log_s mavlink_log;
 
 		if (mavlink_log_sub->update_if_changed(&mavlink_log)) {
@@ -2481,23 +2760,7 @@ Mavlink::task_main(int argc, char *argv[])
 		}
 
 		/* update streams */
-		MavlinkStream *stream;
-		LL_FOREACH(_streams, stream) {
-			stream->update(t);
-
-			if (!_first_heartbeat_sent) {
-				if (_mode == MAVLINK_MODE_IRIDIUM) {
-					if (stream->get_id() == MAVLINK_MSG_ID_HIGH_LATENCY2) {
-						_first_heartbeat_sent = stream->first_message_sent();
-					}
-
-				} else {
-					if (stream->get_id() == MAVLINK_MSG_ID_HEARTBEAT) {
-						_first_heartbeat_sent = stream->first_message_sent();
-					}
-				}
-			}
-		}
+		update_streams(t);
 
 		/* pass messages from other UARTs */
 		if (_forwarding_on) {
@@ -2547,6 +2810,8 @@ Mavlink::task_main(int argc, char *argv[])
 			}
 		}
 
+		end_tx_batch();
+
 		/* update TX/RX rates*/
 		if (t > _bytes_timestamp + 1000000) {
 			if (_bytes_timestamp != 0) {
@@ -2593,6 +2858,11 @@ Mavlink::task_main(int argc, char *argv[])
 
 	_streams = nullptr;
 
+	delete[] _stream_schedule;
+	_stream_schedule = nullptr;
+	_stream_schedule_size = 0;
+	_stream_schedule_capacity = 0;
+
 	/* delete subscriptions */
 	MavlinkOrbSubscription *sub_to_del = nullptr;
 	MavlinkOrbSubscription *sub_next = _subscriptions;
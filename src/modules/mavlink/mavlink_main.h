@@ -78,6 +78,10 @@
 #include "mavlink_shell.h"
 #include "mavlink_ulog.h"
 
+#if defined(__PX4_POSIX)
+#include "mavlink_tx_batch.h"
+#endif
+
 enum Protocol {
 	SERIAL = 0,
 	UDP,
@@ -310,10 +314,24 @@ public:
 	/**
 	 * Flush the transmit buffer and send one MAVLink packet
 	 *
-	 * @return the number of bytes sent or -1 in case of error
+	 * Inside a transmit batch (see begin_tx_batch()) the packet is queued and only sent once the
+	 * batch is full, its flush deadline expired or the batch is ended.
+	 *
+	 * @return the number of bytes sent, 0 if the packet was queued or -1 in case of error
 	 */
 	int             	send_packet();
 
+	/**
+	 * Start collecting the packets sent from now on, so they can be written with a single system call.
+	 * Batches of the main loop and the receiver thread may overlap, each end_tx_batch() flushes.
+	 */
+	void			begin_tx_batch();
+
+	/**
+	 * Send all packets collected since begin_tx_batch() and return to sending each packet immediately
+	 */
+	void			end_tx_batch();
+
 	/**
 	 * Resend message as is, don't change sequence number and CRC.
 	 */
@@ -546,6 +564,21 @@ private:
 	MavlinkOrbSubscription	*_subscriptions;
 	MavlinkStream		*_streams;
 
+	struct ScheduledStream {
+		hrt_abstime send_time;
+		MavlinkStream *stream;
+	};
+
+	ScheduledStream		*_stream_schedule{nullptr};	///< streams as binary min-heap of the send time
+	unsigned		_stream_schedule_size{0};
+	unsigned		_stream_schedule_capacity{0};
+	bool			_stream_schedule_invalid{true};	///< streams or intervals changed
+	float			_stream_schedule_rate_mult{1.0f};	///< rate multiplier used for the send times
+	int			_stream_schedule_max_interval{0};	///< longest rate scaled interval (us)
+
+	int64_t			_tx_budget{0};		///< bytes the streams may send, negative after a burst
+	hrt_abstime		_tx_budget_time{0};
+
 	MavlinkShell			*_mavlink_shell;
 	MavlinkULog			*_mavlink_ulog;
 	volatile bool			_mavlink_ulog_stop_requested;
@@ -604,6 +637,15 @@ private:
 	bool _broadcast_address_found;
 	bool _broadcast_address_not_found_warned;
 	bool _broadcast_failed_warned;
+#endif
+
+#if defined(__PX4_POSIX)
+	MavlinkTxBatch _tx_batch;
+	unsigned _tx_batch_users{0};	///< number of threads currently collecting packets into _tx_batch
+
+	/* packets of a batch are sent at the latest this long after the first one was queued */
+	static constexpr hrt_abstime TX_BATCH_DEADLINE = 1_ms;
+#elif defined(CONFIG_NET)
 	uint8_t _network_buf[MAVLINK_MAX_PACKET_LEN];
 	unsigned _network_buf_len;
 #endif
@@ -700,8 +742,43 @@ private:
 	 */
 	void update_rate_mult();
 
+	/**
+	 * Update the streams which are due, in order of their send time and within the link data rate.
+	 */
+	void update_streams(const hrt_abstime &t);
+
+	/**
+	 * Order all streams by the time they next send a message.
+	 */
+	void rebuild_stream_schedule();
+
+	void stream_schedule_sift_down(unsigned index);
+
+	/**
+	 * @return time until the next stream is due in microseconds (us), limited to the main loop delay
+	 */
+	unsigned get_main_loop_sleep() const;
+
 	void find_broadcast_address();
 
+	/**
+	 * Check if packets need to be resent via broadcast because no valid connection exists
+	 *
+	 * @return true if a broadcast address is available and should be used
+	 */
+	bool udp_broadcast_required();
+
+	void report_broadcast_result(int ret);
+
+#if defined(__PX4_POSIX)
+	/**
+	 * Write out all queued packets, must be called with _send_mutex held
+	 *
+	 * @return the number of bytes sent or -1 in case of error
+	 */
+	int flush_tx_batch();
+#endif
+
 	void init_udp();
 
 	/**
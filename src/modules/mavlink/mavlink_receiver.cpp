@@ -91,6 +91,7 @@
 #include <mathlib/mathlib.h>
 #include <conversion/rotation.h>
 #include <parameters/param.h>
+#include <perf/perf_counter.h>
 #include <systemlib/mavlink_log.h>
 #include <systemlib/err.h>
 
@@ -348,10 +349,6 @@ MavlinkReceiver::handle_message(mavlink_message_t *msg)
 		handle_message_debug_float_array(msg);
 		break;
 
-	default:
-		break;
-	}
-
 	/*
 	 * Only decode hil messages in HIL mode.
 	 *
@@ -362,36 +359,37 @@ MavlinkReceiver::handle_message(mavlink_message_t *msg)
 	 * Accept HIL GPS messages if use_hil_gps flag is true.
 	 * This allows to provide fake gps measurements to the system.
 	 */
-	if (_mavlink->get_hil_enabled()) {
-		switch (msg->msgid) {
-		case MAVLINK_MSG_ID_HIL_SENSOR:
+	case MAVLINK_MSG_ID_HIL_SENSOR:
+		if (_mavlink->get_hil_enabled()) {
 			handle_message_hil_sensor(msg);
-			break;
+		}
 
-		case MAVLINK_MSG_ID_HIL_STATE_QUATERNION:
+		break;
+
+	case MAVLINK_MSG_ID_HIL_STATE_QUATERNION:
+		if (_mavlink->get_hil_enabled()) {
 			handle_message_hil_state_quaternion(msg);
-			break;
+		}
 
-		case MAVLINK_MSG_ID_HIL_OPTICAL_FLOW:
-			handle_message_hil_optical_flow(msg);
-			break;
+		break;
 
-		default:
-			break;
+	case MAVLINK_MSG_ID_HIL_OPTICAL_FLOW:
+		if (_mavlink->get_hil_enabled()) {
+			handle_message_hil_optical_flow(msg);
 		}
-	}
 
+		break;
 
-	if (_mavlink->get_hil_enabled() || (_mavlink->get_use_hil_gps() && msg->sysid == mavlink_system.sysid)) {
-		switch (msg->msgid) {
-		case MAVLINK_MSG_ID_HIL_GPS:
+	case MAVLINK_MSG_ID_HIL_GPS:
+		if (_mavlink->get_hil_enabled() ||
+		    (_mavlink->get_use_hil_gps() && msg->sysid == mavlink_system.sysid)) {
 			handle_message_hil_gps(msg);
-			break;
-
-		default:
-			break;
 		}
 
+		break;
+
+	default:
+		break;
 	}
 
 	/* If we've received a valid message, mark the flag indicating so.
@@ -399,6 +397,101 @@ MavlinkReceiver::handle_message(mavlink_message_t *msg)
 	_mavlink->set_has_received_messages(true);
 }
 
+bool
+MavlinkReceiver::coalesce_message(const mavlink_message_t *msg)
+{
+#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+	/* high rate inputs of which only the newest sample is of interest */
+	static const uint32_t coalesced_ids[COALESCED_MESSAGE_TYPES] = {
+		MAVLINK_MSG_ID_ATT_POS_MOCAP,
+		MAVLINK_MSG_ID_VISION_POSITION_ESTIMATE,
+		MAVLINK_MSG_ID_ODOMETRY,
+		MAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED,
+		MAVLINK_MSG_ID_SET_ATTITUDE_TARGET,
+		MAVLINK_MSG_ID_HIL_SENSOR,
+		MAVLINK_MSG_ID_HIL_STATE_QUATERNION,
+	};
+
+	for (unsigned i = 0; i < COALESCED_MESSAGE_TYPES; i++) {
+		if (coalesced_ids[i] == msg->msgid) {
+			coalesced_message_s &slot = _coalesced[i];
+			const uint32_t key = coalesce_key(msg);
+
+			/* only a newer sample of the same stream supersedes a pending message */
+			if (slot.pending && slot.key != key) {
+				handle_message(&slot.msg);
+			}
+
+			slot.msg = *msg;
+			slot.key = key;
+			slot.seq = _coalesced_seq++;
+			slot.pending = true;
+			return true;
+		}
+	}
+
+#endif
+	return false;
+}
+
+void
+MavlinkReceiver::handle_coalesced_messages()
+{
+#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+
+	/* oldest first, e.g. the last of a position and an attitude setpoint has to win */
+	for (;;) {
+		coalesced_message_s *oldest = nullptr;
+
+		for (unsigned i = 0; i < COALESCED_MESSAGE_TYPES; i++) {
+			coalesced_message_s &slot = _coalesced[i];
+
+			if (slot.pending && (oldest == nullptr || (int32_t)(slot.seq - oldest->seq) < 0)) {
+				oldest = &slot;
+			}
+		}
+
+		if (oldest == nullptr) {
+			break;
+		}
+
+		oldest->pending = false;
+		handle_message(&oldest->msg);
+	}
+
+#endif
+}
+
+#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+uint32_t
+MavlinkReceiver::coalesce_key(const mavlink_message_t *msg)
+{
+	uint32_t key = ((uint32_t)msg->sysid << 24) | ((uint32_t)msg->compid << 16);
+
+	switch (msg->msgid) {
+	case MAVLINK_MSG_ID_ODOMETRY:
+		/* vision and mocap odometry are published to different topics */
+		key |= mavlink_msg_odometry_get_frame_id(msg);
+		break;
+
+	case MAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED:
+		key |= ((uint32_t)mavlink_msg_set_position_target_local_ned_get_target_system(msg) << 8)
+		       | mavlink_msg_set_position_target_local_ned_get_target_component(msg);
+		break;
+
+	case MAVLINK_MSG_ID_SET_ATTITUDE_TARGET:
+		key |= ((uint32_t)mavlink_msg_set_attitude_target_get_target_system(msg) << 8)
+		       | mavlink_msg_set_attitude_target_get_target_component(msg);
+		break;
+
+	default:
+		break;
+	}
+
+	return key;
+}
+#endif
+
 bool
 MavlinkReceiver::evaluate_target_ok(int command, int target_system, int target_component)
 {
@@ -2633,7 +2726,30 @@ MavlinkReceiver::receive_thread(void *arg)
 
 #if defined(CONFIG_NET) || defined(__PX4_POSIX)
 	struct sockaddr_in srcaddr = {};
-	socklen_t addrlen = sizeof(srcaddr);
+
+#if defined(__PX4_LINUX)
+	/* receive up to RECV_BATCH datagrams with one system call, each into its own part of buf */
+	static constexpr unsigned RECV_BATCH = 5;
+	static constexpr unsigned RECV_DATAGRAM_LEN = sizeof(buf) / RECV_BATCH;
+
+	struct iovec recv_iov[RECV_BATCH];
+	struct mmsghdr recv_msgs[RECV_BATCH];
+	struct sockaddr_in recv_addrs[RECV_BATCH];
+
+	memset(recv_msgs, 0, sizeof(recv_msgs));
+
+	for (unsigned i = 0; i < RECV_BATCH; i++) {
+		recv_iov[i].iov_base = &buf[i * RECV_DATAGRAM_LEN];
+		recv_iov[i].iov_len = RECV_DATAGRAM_LEN;
+		recv_msgs[i].msg_hdr.msg_name = &recv_addrs[i];
+		recv_msgs[i].msg_hdr.msg_iov = &recv_iov[i];
+		recv_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* datagrams larger than a slot are dropped, the parser cannot resynchronize within a cut message */
+	perf_counter_t recv_truncated_perf = perf_alloc(PC_COUNT, "mavlink_rx_trunc");
+
+#endif
 
 	if (_mavlink->get_protocol() == UDP || _mavlink->get_protocol() == TCP) {
 		// make sure mavlink app has booted before we start using the socket
@@ -2670,7 +2786,38 @@ MavlinkReceiver::receive_thread(void *arg)
 
 			if (_mavlink->get_protocol() == UDP) {
 				if (fds[0].revents & POLLIN) {
+#if defined(__PX4_LINUX)
+
+					for (unsigned i = 0; i < RECV_BATCH; i++) {
+						recv_msgs[i].msg_hdr.msg_namelen = sizeof(recv_addrs[i]);
+					}
+
+					int count = recvmmsg(_mavlink->get_socket_fd(), recv_msgs, RECV_BATCH,
+							     MSG_DONTWAIT, nullptr);
+					nread = -1;
+
+					if (count > 0) {
+						/* the parser works on a byte stream, join the datagrams */
+						nread = 0;
+
+						for (int i = 0; i < count; i++) {
+							if (recv_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+								perf_count(recv_truncated_perf);
+								continue;
+							}
+
+							const unsigned len = recv_msgs[i].msg_len;
+							memmove(&buf[nread], &buf[i * RECV_DATAGRAM_LEN], len);
+							nread += len;
+						}
+
+						srcaddr = recv_addrs[count - 1];
+					}
+
+#else
+					socklen_t addrlen = sizeof(srcaddr);
 					nread = recvfrom(_mavlink->get_socket_fd(), buf, sizeof(buf), 0, (struct sockaddr *)&srcaddr, &addrlen);
+#endif
 				}
 
 			} else {
@@ -2711,8 +2858,12 @@ MavlinkReceiver::receive_thread(void *arg)
 							_mavlink->set_proto_version(2);
 						}
 
-						/* handle generic messages and commands */
-						handle_message(&msg);
+						/* handle generic messages and commands, high rate inputs once per read */
+						if (!coalesce_message(&msg)) {
+							/* keep the order of the kept inputs relative to e.g. commands */
+							handle_coalesced_messages();
+							handle_message(&msg);
+						}
 
 						/* handle packet with mission manager */
 						_mission_manager.handle_message(&msg);
@@ -2737,6 +2888,8 @@ MavlinkReceiver::receive_thread(void *arg)
 					}
 				}
 
+				handle_coalesced_messages();
+
 				/* count received bytes (nread will be -1 on read error) */
 				if (nread > 0) {
 					_mavlink->count_rxbytes(nread);
@@ -2762,6 +2915,10 @@ MavlinkReceiver::receive_thread(void *arg)
 
 	}
 
+#if defined(__PX4_LINUX)
+	perf_free(recv_truncated_perf);
+#endif
+
 	return nullptr;
 }
 
@@ -120,6 +120,26 @@ private:
 
 	void acknowledge(uint8_t sysid, uint8_t compid, uint16_t command, uint8_t result);
 	void handle_message(mavlink_message_t *msg);
+
+	/**
+	 * Keep a high rate input message until the end of the current receive batch, so that only the
+	 * newest sample of each source is handled.
+	 *
+	 * @return true if the message was kept, false if it has to be handled right away
+	 */
+	bool coalesce_message(const mavlink_message_t *msg);
+
+	/**
+	 * Handle the messages kept by coalesce_message()
+	 */
+	void handle_coalesced_messages();
+
+	/**
+	 * Identify the stream of a coalesced message: its source and, where the handler depends on them, the
+	 * target and the frame. Only a newer message of the same stream supersedes a pending one.
+	 */
+	static uint32_t coalesce_key(const mavlink_message_t *msg);
+
 	void handle_message_command_long(mavlink_message_t *msg);
 	void handle_message_command_int(mavlink_message_t *msg);
 	/**
@@ -204,6 +224,22 @@ private:
 	MavlinkTimesync		_mavlink_timesync;
 
 	mavlink_status_t _status; ///< receiver status, used for mavlink_parse_char()
+
+#if defined(CONFIG_NET) || defined(__PX4_POSIX)
+	/* newest not yet handled message of each coalesced message type, see coalesce_message() */
+	static constexpr unsigned COALESCED_MESSAGE_TYPES = 7;
+
+	struct coalesced_message_s {
+		bool pending;
+		uint32_t key;	///< see coalesce_key()
+		uint32_t seq;	///< arrival order, the pending messages are handled in this order
+		mavlink_message_t msg;
+	};
+
+	coalesced_message_s _coalesced[COALESCED_MESSAGE_TYPES] {};
+	uint32_t _coalesced_seq{0};
+#endif
+
 	struct vehicle_attitude_s _att;
 	struct vehicle_local_position_s _hil_local_pos;
 	struct vehicle_land_detected_s _hil_land_detector;
@@ -84,11 +84,7 @@ MavlinkStream::update(const hrt_abstime &t)
 	}
 
 	int64_t dt = t - _last_sent;
-	int interval = (_interval > 0) ? _interval : 0;
-
-	if (!const_rate()) {
-		interval /= _mavlink->get_rate_mult();
-	}
+	int interval = get_scaled_interval();
 
 	// Send the message if it is due or
 	// if it will overrun the next scheduled send interval
@@ -100,7 +96,7 @@ MavlinkStream::update(const hrt_abstime &t)
 	// This method is not theoretically optimal but a suitable
 	// stopgap as it hits its deadlines well (0.5 Hz, 50 Hz and 250 Hz)
 
-	if (interval == 0 || (dt > (interval - (_mavlink->get_main_loop_delay() / 10) * 3))) {
+	if (interval == 0 || (dt > (interval - get_send_margin()))) {
 		// interval expired, send message
 
 		// If the interval is non-zero and dt is smaller than 1.5 times the interval
@@ -123,3 +119,36 @@ MavlinkStream::update(const hrt_abstime &t)
 
 	return -1;
 }
+
+int
+MavlinkStream::get_scaled_interval()
+{
+	int interval = (_interval > 0) ? _interval : 0;
+
+	if (!const_rate()) {
+		interval /= _mavlink->get_rate_mult();
+	}
+
+	return interval;
+}
+
+int
+MavlinkStream::get_send_margin() const
+{
+	return (_mavlink->get_main_loop_delay() / 10) * 3;
+}
+
+hrt_abstime
+MavlinkStream::get_next_send_time()
+{
+	const int interval = get_scaled_interval();
+
+	if (_last_sent == 0 || interval == 0 || has_update_data()) {
+		return 0;
+	}
+
+	const hrt_abstime next = _last_sent + interval - get_send_margin();
+
+	// never earlier than the previous message
+	return (next > _last_sent) ? next : _last_sent + 1;
+}
@@ -113,6 +113,13 @@ public:
 	 */
 	void reset_last_sent() { _last_sent = 0; }
 
+	/**
+	 * Get the earliest time at which update() will send a message
+	 *
+	 * @return the time in microseconds, 0 if update() needs to be called on every iteration
+	 */
+	hrt_abstime get_next_send_time();
+
 protected:
 	Mavlink      *const _mavlink;
 	int _interval{1000000};		///< if set to negative value = unlimited rate
@@ -127,11 +134,27 @@ protected:
 	 */
 	virtual void update_data() { }
 
+	/**
+	 * @return true if update_data() is implemented and therefore update() needs
+	 * to be called on every iteration of the mavlink module, not only when a message is due
+	 */
+	virtual bool has_update_data() const { return false; }
+
 	DEFINE_PARAMETERS(
 		(ParamBool<px4::params::MAV_ODOM_LP>) _send_odom_loopback
 	)
 
 private:
+	/**
+	 * @return the interval in microseconds (us) scaled by the rate multiplier, 0 if unlimited
+	 */
+	int get_scaled_interval();
+
+	/**
+	 * @return how much earlier than the interval a message may be sent in microseconds (us)
+	 */
+	int get_send_margin() const;
+
 	hrt_abstime _last_sent{0};
 	bool _first_message_sent{false};
 };
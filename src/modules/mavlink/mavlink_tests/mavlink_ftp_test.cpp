@@ -596,6 +596,328 @@ bool MavlinkFtpTest::_burst_test()
 	return true;
 }
 
+/// @brief Tests that all sessions can be open at the same time and are read independently.
+bool MavlinkFtpTest::_multiple_sessions_test()
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	const size_t				test_case_count = sizeof(_rgDownloadTestCases) /
+			sizeof(_rgDownloadTestCases[0]);
+	uint8_t					sessions[MavlinkFTP::kMaxSessions];
+
+	for (uint8_t i = 0; i < MavlinkFTP::kMaxSessions; i++) {
+		const char *file = _rgDownloadTestCases[i % test_case_count].file;
+
+		payload.opcode = MavlinkFTP::kCmdOpenFileRO;
+		payload.offset = 0;
+
+		bool success = _send_receive_msg(&payload,		// FTP payload header
+						 strlen(file) + 1,	// size in bytes of data
+						 (uint8_t *)file,	// Data to start into FTP message payload
+						 &reply);		// Payload inside FTP message response
+
+		if (!success) {
+			return false;
+		}
+
+		ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+
+		sessions[i] = reply->session;
+
+		for (uint8_t j = 0; j < i; j++) {
+			ut_assert("Session id returned twice", sessions[j] != sessions[i]);
+		}
+	}
+
+	// All sessions are in use now
+	const char *file = _rgDownloadTestCases[0].file;
+	payload.opcode = MavlinkFTP::kCmdOpenFileRO;
+	payload.offset = 0;
+
+	bool success = _send_receive_msg(&payload,		// FTP payload header
+					 strlen(file) + 1,	// size in bytes of data
+					 (uint8_t *)file,	// Data to start into FTP message payload
+					 &reply);		// Payload inside FTP message response
+
+	if (!success) {
+		return false;
+	}
+
+	ut_compare("Didn't get Nak back", reply->opcode, MavlinkFTP::kRspNak);
+	ut_compare("Incorrect payload size", reply->size, 1);
+	ut_compare("Incorrect error code", reply->data[0], MavlinkFTP::kErrNoSessionsAvailable);
+
+	// Read from the sessions in reverse order, each one has to return the start of its own file
+	for (int i = MavlinkFTP::kMaxSessions - 1; i >= 0; i--) {
+		const DownloadTestCase *test = &_rgDownloadTestCases[i % test_case_count];
+		uint8_t bytes[MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN];
+		int fd = ::open(test->file, O_RDONLY);
+		ut_assert("open failed", fd != -1);
+		int bytes_read = ::read(fd, bytes, sizeof(bytes));
+		::close(fd);
+		ut_compare("Test case data files are out of date", test->length, bytes_read);
+
+		payload.opcode = MavlinkFTP::kCmdReadFile;
+		payload.session = sessions[i];
+		payload.offset = 0;
+
+		success = _send_receive_msg(&payload,	// FTP payload header
+					    0,		// size in bytes of data
+					    nullptr,	// Data to start into FTP message payload
+					    &reply);	// Payload inside FTP message response
+
+		if (!success) {
+			return false;
+		}
+
+		uint32_t expected_bytes = test->singlePacketRead ? test->length : reply->size;
+		ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+		ut_compare("Payload size incorrect", reply->size, expected_bytes);
+		ut_compare("File contents differ", memcmp(reply->data, bytes, expected_bytes), 0);
+	}
+
+	for (uint8_t i = 0; i < MavlinkFTP::kMaxSessions; i++) {
+		payload.opcode = MavlinkFTP::kCmdTerminateSession;
+		payload.session = sessions[i];
+		payload.size = 0;
+
+		success = _send_receive_msg(&payload,	// FTP payload header
+					    0,		// size in bytes of data
+					    nullptr,	// Data to start into FTP message payload
+					    &reply);	// Payload inside FTP message response
+
+		if (!success) {
+			return false;
+		}
+
+		ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	}
+
+	return true;
+}
+
+/// @brief Measures the burst download throughput of a generated file and checks its content.
+bool MavlinkFtpTest::_burst_benchmark_test()
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	BenchmarkInfo				benchmark_info{};
+#ifdef __PX4_NUTTX
+	const uint32_t				file_size = 128 * 1024;
+#else
+	const uint32_t				file_size = 1024 * 1024;
+#endif
+
+	// Generate the file
+	ut_compare("mkdir failed", ::mkdir(_unittest_microsd_dir, S_IRWXU | S_IRWXG | S_IRWXO), 0);
+	int fd = ::open(_unittest_microsd_file, O_CREAT | O_EXCL | O_WRONLY, S_IRWXU | S_IRWXG | S_IRWXO);
+	ut_assert("open failed", fd != -1);
+
+	uint8_t block[256];
+
+	for (uint32_t offset = 0; offset < file_size; offset += sizeof(block)) {
+		for (uint32_t i = 0; i < sizeof(block); i++) {
+			block[i] = _benchmark_file_byte(offset + i);
+		}
+
+		if (::write(fd, block, sizeof(block)) != sizeof(block)) {
+			::close(fd);
+			ut_assert("write failed", false);
+		}
+	}
+
+	::close(fd);
+
+	payload.opcode = MavlinkFTP::kCmdOpenFileRO;
+	payload.offset = 0;
+
+	bool success = _send_receive_msg(&payload,			// FTP payload header
+					 strlen(_unittest_microsd_file) + 1,	// size in bytes of data
+					 (uint8_t *)_unittest_microsd_file,	// Data to start into FTP message payload
+					 &reply);			// Payload inside FTP message response
+
+	if (!success) {
+		return false;
+	}
+
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+
+	benchmark_info.ftp_test_class = this;
+	benchmark_info.file_size = file_size;
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_benchmark, &benchmark_info);
+
+	payload.opcode = MavlinkFTP::kCmdBurstReadFile;
+	payload.session = reply->session;
+	payload.offset = 0;
+
+	const hrt_abstime start = hrt_absolute_time();
+
+	mavlink_message_t msg;
+	_setup_ftp_msg(&payload, 0, nullptr, &msg);
+	_ftp_server->handle_message(&msg);
+
+	// In unit test mode a single send() streams the whole file
+	_ftp_server->send(start);
+
+	const hrt_abstime elapsed = hrt_elapsed_time(&start);
+
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_generic, this);
+
+	ut_assert("Burst not complete", benchmark_info.complete);
+	ut_compare("Incorrect number of bytes received", benchmark_info.bytes_received, file_size);
+
+	PX4_INFO("burst read %u bytes in %.3f ms: %.2f MB/s", (unsigned)file_size, (double)elapsed / 1e3,
+		 elapsed > 0 ? (double)file_size / (double)elapsed : 0.0);
+
+	payload.opcode = MavlinkFTP::kCmdTerminateSession;
+	payload.size = 0;
+
+	success = _send_receive_msg(&payload,	// FTP payload header
+				    0,		// size in bytes of data
+				    nullptr,	// Data to start into FTP message payload
+				    &reply);	// Payload inside FTP message response
+
+	if (!success) {
+		return false;
+	}
+
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+
+	return true;
+}
+
+/// @brief Tests that a burst does not return read-ahead data of a file written through another session.
+bool MavlinkFtpTest::_read_ahead_write_test()
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	BenchmarkInfo				benchmark_info{};
+	uint8_t					block[MavlinkFTP::kMaxDataLength];
+	const uint32_t				file_size = 3 * sizeof(block);
+
+	// Generate the file
+	ut_compare("mkdir failed", ::mkdir(_unittest_microsd_dir, S_IRWXU | S_IRWXG | S_IRWXO), 0);
+	int fd = ::open(_unittest_microsd_file, O_CREAT | O_EXCL | O_WRONLY, S_IRWXU | S_IRWXG | S_IRWXO);
+	ut_assert("open failed", fd != -1);
+
+	for (uint32_t offset = 0; offset < file_size; offset += sizeof(block)) {
+		for (uint32_t i = 0; i < sizeof(block); i++) {
+			block[i] = _benchmark_file_byte(offset + i);
+		}
+
+		if (::write(fd, block, sizeof(block)) != sizeof(block)) {
+			::close(fd);
+			ut_assert("write failed", false);
+		}
+	}
+
+	::close(fd);
+
+	// Open the file for reading and burst it, which loads the read-ahead blocks of the session
+	payload.opcode = MavlinkFTP::kCmdOpenFileRO;
+	payload.offset = 0;
+
+	bool success = _send_receive_msg(&payload,			// FTP payload header
+					 strlen(_unittest_microsd_file) + 1,	// size in bytes of data
+					 (uint8_t *)_unittest_microsd_file,	// Data to start into FTP message payload
+					 &reply);			// Payload inside FTP message response
+
+	if (!success) {
+		return false;
+	}
+
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	const uint8_t read_session = reply->session;
+
+	benchmark_info.ftp_test_class = this;
+	benchmark_info.file_size = file_size;
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_benchmark, &benchmark_info);
+
+	payload.opcode = MavlinkFTP::kCmdBurstReadFile;
+	payload.session = read_session;
+	payload.offset = 0;
+
+	mavlink_message_t msg;
+	_setup_ftp_msg(&payload, 0, nullptr, &msg);
+	_ftp_server->handle_message(&msg);
+	_ftp_server->send(hrt_absolute_time());
+
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_generic, this);
+
+	ut_assert("Burst not complete", benchmark_info.complete);
+	ut_compare("Incorrect number of bytes received", benchmark_info.bytes_received, file_size);
+
+	// Overwrite the file through a second session
+	payload.opcode = MavlinkFTP::kCmdOpenFileWO;
+	payload.offset = 0;
+
+	success = _send_receive_msg(&payload,				// FTP payload header
+				    strlen(_unittest_microsd_file) + 1,	// size in bytes of data
+				    (uint8_t *)_unittest_microsd_file,	// Data to start into FTP message payload
+				    &reply);				// Payload inside FTP message response
+
+	if (!success) {
+		return false;
+	}
+
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	ut_assert("Same session", reply->session != read_session);
+	const uint8_t write_session = reply->session;
+
+	for (uint32_t offset = 0; offset < file_size; offset += sizeof(block)) {
+		for (uint32_t i = 0; i < sizeof(block); i++) {
+			block[i] = _benchmark_file_byte(offset + i) ^ 0xff;
+		}
+
+		payload.opcode = MavlinkFTP::kCmdWriteFile;
+		payload.session = write_session;
+		payload.offset = offset;
+
+		success = _send_receive_msg(&payload, sizeof(block), block, &reply);
+
+		if (!success) {
+			return false;
+		}
+
+		ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	}
+
+	// A new burst of the first session has to return the new content
+	benchmark_info.bytes_received = 0;
+	benchmark_info.complete = false;
+	benchmark_info.content_xor = 0xff;
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_benchmark, &benchmark_info);
+
+	payload.opcode = MavlinkFTP::kCmdBurstReadFile;
+	payload.session = read_session;
+	payload.offset = 0;
+
+	_setup_ftp_msg(&payload, 0, nullptr, &msg);
+	_ftp_server->handle_message(&msg);
+	_ftp_server->send(hrt_absolute_time());
+
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_generic, this);
+
+	ut_assert("Burst not complete", benchmark_info.complete);
+	ut_compare("Incorrect number of bytes received", benchmark_info.bytes_received, file_size);
+
+	payload.opcode = MavlinkFTP::kCmdResetSessions;
+	payload.size = 0;
+
+	success = _send_receive_msg(&payload,	// FTP payload header
+				    0,		// size in bytes of data
+				    nullptr,	// Data to start into FTP message payload
+				    &reply);	// Payload inside FTP message response
+
+	if (!success) {
+		return false;
+	}
+
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+
+	return true;
+}
+
 /// @brief Tests for correct reponse to a Read command on an invalid session.
 bool MavlinkFtpTest::_read_badsession_test()
 {
@@ -873,6 +1195,42 @@ bool MavlinkFtpTest::_receive_message_handler_burst(const mavlink_file_transfer_
 	return true;
 }
 
+/// Static method used as callback from MavlinkFTP for the burst benchmark.
+void MavlinkFtpTest::receive_message_handler_benchmark(const mavlink_file_transfer_protocol_t *ftp_req,
+		void *worker_data)
+{
+	BenchmarkInfo *benchmark_info = (BenchmarkInfo *)worker_data;
+	benchmark_info->ftp_test_class->_receive_message_handler_benchmark(ftp_req, benchmark_info);
+}
+
+bool MavlinkFtpTest::_receive_message_handler_benchmark(const mavlink_file_transfer_protocol_t *ftp_msg,
+		BenchmarkInfo *benchmark_info)
+{
+	const MavlinkFTP::PayloadHeader *reply;
+
+	_decode_message(ftp_msg, &reply);
+
+	ut_assert("Packet after burst complete", !benchmark_info->complete);
+
+	if (reply->opcode == MavlinkFTP::kRspNak) {
+		ut_compare("Incorrect error code", reply->data[0], MavlinkFTP::kErrEOF);
+		benchmark_info->complete = true;
+		return true;
+	}
+
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	ut_compare("Offset incorrect", reply->offset, benchmark_info->bytes_received);
+
+	for (uint8_t i = 0; i < reply->size; i++) {
+		ut_compare("File contents differ", reply->data[i],
+			   _benchmark_file_byte(reply->offset + i) ^ benchmark_info->content_xor);
+	}
+
+	benchmark_info->bytes_received += reply->size;
+
+	return true;
+}
+
 /// @brief Decode and validate the incoming message
 bool MavlinkFtpTest::_decode_message(const mavlink_file_transfer_protocol_t	*ftp_msg,	///< Incoming FTP message
 				     const MavlinkFTP::PayloadHeader		**payload)	///< Payload inside FTP message response
@@ -963,6 +1321,9 @@ bool MavlinkFtpTest::run_tests()
 	ut_run_test(_read_test);
 	ut_run_test(_read_badsession_test);
 	ut_run_test(_burst_test);
+	ut_run_test(_multiple_sessions_test);
+	ut_run_test(_burst_benchmark_test);
+	ut_run_test(_read_ahead_write_test);
 	ut_run_test(_removedirectory_test);
 
 	// TODO FIX: Didn't get Nak back - (reply->opcode:128) (MavlinkFTP::kRspNak:129) (../../src/modules/mavlink/mavlink_tests/mavlink_ftp_test.cpp:730)
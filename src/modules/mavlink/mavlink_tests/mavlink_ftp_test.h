@@ -61,6 +61,18 @@ public:
 
 	static void receive_message_handler_burst(const mavlink_file_transfer_protocol_t *ftp_req, void *worker_data);
 
+	/// Worker data for burst benchmark handler
+	struct BenchmarkInfo {
+		MavlinkFtpTest		*ftp_test_class;
+		uint32_t		file_size;
+		uint32_t		bytes_received;
+		bool			complete;
+		uint8_t			content_xor;	///< file content is _benchmark_file_byte() ^ content_xor
+	};
+
+	static void receive_message_handler_benchmark(const mavlink_file_transfer_protocol_t *ftp_req,
+			void *worker_data);
+
 	static const uint8_t serverSystemId = 50;	///< System ID for server
 	static const uint8_t serverComponentId = 1;	///< Component ID for server
 	static const uint8_t serverChannel = 0;		///< Channel to send to
@@ -87,6 +99,9 @@ private:
 	bool _read_test(void);
 	bool _read_badsession_test(void);
 	bool _burst_test(void);
+	bool _multiple_sessions_test(void);
+	bool _burst_benchmark_test(void);
+	bool _read_ahead_write_test(void);
 	bool _removedirectory_test(void);
 	bool _createdirectory_test(void);
 	bool _removefile_test(void);
@@ -121,6 +136,11 @@ private:
 	};
 
 	bool _receive_message_handler_burst(const mavlink_file_transfer_protocol_t *ftp_req, BurstInfo *burst_info);
+	bool _receive_message_handler_benchmark(const mavlink_file_transfer_protocol_t *ftp_req,
+						BenchmarkInfo *benchmark_info);
+
+	/// Content of the generated benchmark file at a given offset
+	static uint8_t _benchmark_file_byte(uint32_t offset) { return (uint8_t)(offset * 7 + (offset >> 8)); }
 
 	MavlinkFTP	*_ftp_server;
 	uint16_t	_expected_seq_number;
@@ -39,9 +39,19 @@
 
 #include "mavlink_ftp_test.h"
 
+#if defined(__PX4_POSIX)
+#include "mavlink_tx_batch_test.h"
+#endif
+
 extern "C" __EXPORT int mavlink_tests_main(int argc, char *argv[]);
 
 int mavlink_tests_main(int argc, char *argv[])
 {
-	return mavlink_ftp_test() ? 0 : -1;
+	bool success = mavlink_ftp_test();
+
+#if defined(__PX4_POSIX)
+	success = mavlink_tx_batch_test() && success;
+#endif
+
+	return success ? 0 : -1;
 }
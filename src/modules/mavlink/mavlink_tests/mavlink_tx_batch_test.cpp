@@ -0,0 +1,305 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_tx_batch_test.cpp
+ * Tests for the MAVLink transmit batch and a throughput comparison of sending every
+ * packet with its own sendto() against handing whole batches to the OS, using a local UDP sink.
+ */
+
+#if defined(__PX4_POSIX)
+
+#include "mavlink_tx_batch_test.h"
+#include "../mavlink_tx_batch.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <drivers/drv_hrt.h>
+
+static constexpr unsigned BENCHMARK_PACKETS = 20000;
+
+/* a mix of small (heartbeat, attitude) and full size packets */
+static constexpr unsigned PACKET_SIZES[] = {21, 40, 52, 100, 280};
+
+static unsigned packet_size(unsigned i)
+{
+	return PACKET_SIZES[i % (sizeof(PACKET_SIZES) / sizeof(PACKET_SIZES[0]))];
+}
+
+static void fill_packet(uint8_t *buf, unsigned len, unsigned seq)
+{
+	for (unsigned i = 0; i < len; i++) {
+		buf[i] = (uint8_t)(seq + i);
+	}
+}
+
+void MavlinkTxBatchTest::_init()
+{
+	_sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	_send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	memset(&_sink_addr, 0, sizeof(_sink_addr));
+	_sink_addr.sin_family = AF_INET;
+	_sink_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	_sink_addr.sin_port = 0;
+
+	/* let the OS pick a free port */
+	socklen_t addr_len = sizeof(_sink_addr);
+
+	if (bind(_sink_fd, (struct sockaddr *)&_sink_addr, sizeof(_sink_addr)) < 0 ||
+	    getsockname(_sink_fd, (struct sockaddr *)&_sink_addr, &addr_len) < 0) {
+		PX4_ERR("failed to bind UDP sink");
+	}
+
+	int rcvbuf = 4 * 1024 * 1024;
+	setsockopt(_sink_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	struct timeval timeout {};
+	timeout.tv_usec = 100000;
+	setsockopt(_sink_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	_sink_stop = false;
+	_sink_packets = 0;
+	_sink_bytes = 0;
+}
+
+void MavlinkTxBatchTest::_cleanup()
+{
+	if (_sink_fd >= 0) {
+		close(_sink_fd);
+		_sink_fd = -1;
+	}
+
+	if (_send_fd >= 0) {
+		close(_send_fd);
+		_send_fd = -1;
+	}
+}
+
+void *MavlinkTxBatchTest::_sink_thread(void *arg)
+{
+	MavlinkTxBatchTest *test = (MavlinkTxBatchTest *)arg;
+	uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+
+	while (true) {
+		ssize_t ret = recv(test->_sink_fd, buf, sizeof(buf), 0);
+
+		if (ret > 0) {
+			test->_sink_packets++;
+			test->_sink_bytes += ret;
+
+		} else if (test->_sink_stop) {
+			break;
+		}
+	}
+
+	return nullptr;
+}
+
+/// @brief Tests packet boundaries, dropping of empty or oversized packets and the capacity limit
+bool MavlinkTxBatchTest::_packet_test()
+{
+	MavlinkTxBatch *batch = new MavlinkTxBatch();
+	uint8_t buf[MAVLINK_MAX_PACKET_LEN + 1];
+	fill_packet(buf, sizeof(buf), 0);
+
+	ut_assert_true(batch->empty());
+
+	/* a packet assembled from header, payload and checksum */
+	batch->begin_packet(1000);
+	ut_assert_true(batch->append(buf, 10));
+	ut_assert_true(batch->append(&buf[10], 20));
+	ut_assert_true(batch->append(&buf[30], 2));
+	batch->end_packet();
+
+	ut_compare("count", batch->count(), 1);
+	ut_compare("length", batch->packet_len(0), 32);
+	ut_assert_true(memcmp(batch->packet(0), buf, 32) == 0);
+	ut_assert_true(batch->first_time() == 1000);
+
+	/* empty packets are not committed */
+	batch->begin_packet(2000);
+	batch->end_packet();
+	ut_compare("count after empty packet", batch->count(), 1);
+
+	/* an oversized packet is dropped as a whole */
+	batch->begin_packet(3000);
+	ut_assert_true(batch->append(buf, 100));
+	ut_assert_false(batch->append(buf, MAVLINK_MAX_PACKET_LEN));
+	batch->end_packet();
+	ut_compare("count after oversized packet", batch->count(), 1);
+	ut_compare("bytes after oversized packet", batch->bytes(), 32);
+
+	/* fill up, the packet after the last one fitting is rejected */
+	for (unsigned i = 1; i < MavlinkTxBatch::MAX_PACKETS; i++) {
+		batch->begin_packet(4000 + i);
+		ut_assert_true(batch->append(buf, MAVLINK_MAX_PACKET_LEN));
+		batch->end_packet();
+	}
+
+	ut_assert_true(batch->full());
+	ut_assert_true(batch->first_time() == 1000);
+
+	batch->begin_packet(5000);
+	ut_assert_false(batch->append(buf, 1));
+	batch->end_packet();
+	ut_compare("count when full", batch->count(), MavlinkTxBatch::MAX_PACKETS);
+	ut_compare("bytes when full", batch->bytes(),
+		   32 + (MavlinkTxBatch::MAX_PACKETS - 1) * MAVLINK_MAX_PACKET_LEN);
+
+	batch->clear();
+	ut_assert_true(batch->empty());
+	ut_compare("bytes after clear", batch->bytes(), 0);
+
+	delete batch;
+	return true;
+}
+
+/// @brief Tests that every packet of a batch arrives as its own datagram, in order
+bool MavlinkTxBatchTest::_udp_sink_test()
+{
+	MavlinkTxBatch *batch = new MavlinkTxBatch();
+	uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+	unsigned total = 0;
+
+	for (unsigned i = 0; i < MavlinkTxBatch::MAX_PACKETS; i++) {
+		fill_packet(buf, packet_size(i), i);
+		batch->begin_packet(i);
+		ut_assert_true(batch->append(buf, packet_size(i)));
+		batch->end_packet();
+		total += packet_size(i);
+	}
+
+	int ret = batch->send_datagrams(_send_fd, (struct sockaddr *)&_sink_addr, sizeof(_sink_addr));
+	ut_compare("bytes sent", ret, total);
+
+	for (unsigned i = 0; i < MavlinkTxBatch::MAX_PACKETS; i++) {
+		uint8_t expected[MAVLINK_MAX_PACKET_LEN];
+		fill_packet(expected, packet_size(i), i);
+
+		ssize_t len = recv(_sink_fd, buf, sizeof(buf), 0);
+		ut_compare("datagram length", len, packet_size(i));
+		ut_assert_true(memcmp(buf, expected, packet_size(i)) == 0);
+	}
+
+	delete batch;
+	return true;
+}
+
+/// @brief Compares the time to send the same packets per packet and batched. This does not fail on
+/// a slow result, it only checks that everything was sent.
+bool MavlinkTxBatchTest::_throughput_benchmark()
+{
+	MavlinkTxBatch *batch = new MavlinkTxBatch();
+	uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+	fill_packet(buf, sizeof(buf), 0);
+
+	unsigned total = 0;
+
+	for (unsigned i = 0; i < BENCHMARK_PACKETS; i++) {
+		total += packet_size(i);
+	}
+
+	pthread_t sink;
+	ut_assert_true(pthread_create(&sink, nullptr, &MavlinkTxBatchTest::_sink_thread, this) == 0);
+
+	/* one sendto() per packet, as every packet was sent before */
+	unsigned single_bytes = 0;
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < BENCHMARK_PACKETS; i++) {
+		ssize_t ret = sendto(_send_fd, buf, packet_size(i), 0, (struct sockaddr *)&_sink_addr, sizeof(_sink_addr));
+
+		if (ret > 0) {
+			single_bytes += ret;
+		}
+	}
+
+	const hrt_abstime single_time = hrt_elapsed_time(&start);
+
+	/* batches of MAX_PACKETS packets */
+	unsigned batch_bytes = 0;
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < BENCHMARK_PACKETS; i++) {
+		batch->begin_packet(start);
+		batch->append(buf, packet_size(i));
+		batch->end_packet();
+
+		if (batch->full() || i == BENCHMARK_PACKETS - 1) {
+			int ret = batch->send_datagrams(_send_fd, (struct sockaddr *)&_sink_addr, sizeof(_sink_addr));
+
+			if (ret > 0) {
+				batch_bytes += ret;
+			}
+
+			batch->clear();
+		}
+	}
+
+	const hrt_abstime batch_time = hrt_elapsed_time(&start);
+
+	px4_usleep(100000);
+	_sink_stop = true;
+	pthread_join(sink, nullptr);
+
+	PX4_INFO("%u packets, %u bytes per run", BENCHMARK_PACKETS, total);
+	PX4_INFO("per packet: %8.3f ms, %8.1f kpackets/s, %6.1f MB/s", (double)(single_time / 1e3),
+		 (double)(BENCHMARK_PACKETS * 1e3 / single_time), (double)(total / (double)single_time));
+	PX4_INFO("batched:    %8.3f ms, %8.1f kpackets/s, %6.1f MB/s", (double)(batch_time / 1e3),
+		 (double)(BENCHMARK_PACKETS * 1e3 / batch_time), (double)(total / (double)batch_time));
+	PX4_INFO("sink received %u of %u packets", _sink_packets, 2 * BENCHMARK_PACKETS);
+
+	ut_compare("per packet bytes sent", single_bytes, total);
+	ut_compare("batched bytes sent", batch_bytes, total);
+
+	delete batch;
+	return true;
+}
+
+bool MavlinkTxBatchTest::run_tests()
+{
+	ut_run_test(_packet_test);
+	ut_run_test(_udp_sink_test);
+	ut_run_test(_throughput_benchmark);
+
+	return (_tests_failed == 0);
+}
+
+ut_declare_test(mavlink_tx_batch_test, MavlinkTxBatchTest)
+
+#endif /* __PX4_POSIX */
@@ -0,0 +1,74 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_tx_batch_test.h
+ * Tests and UDP throughput benchmark for the MAVLink transmit batch.
+ */
+
+#pragma once
+
+#include <unit_test.h>
+
+#include <netinet/in.h>
+#include <pthread.h>
+
+class MavlinkTxBatchTest : public UnitTest
+{
+public:
+	MavlinkTxBatchTest() = default;
+	virtual ~MavlinkTxBatchTest() = default;
+
+	virtual bool run_tests(void);
+
+private:
+	virtual void _init(void);
+	virtual void _cleanup(void);
+
+	bool _packet_test(void);
+	bool _udp_sink_test(void);
+	bool _throughput_benchmark(void);
+
+	/// Drains the sink socket until _sink_stop is set
+	static void *_sink_thread(void *arg);
+
+	int _sink_fd{-1};			///< local UDP sink the packets are sent to
+	int _send_fd{-1};
+	struct sockaddr_in _sink_addr {};
+
+	volatile bool _sink_stop{false};
+	unsigned _sink_packets{0};		///< read after the sink thread is joined
+	unsigned _sink_bytes{0};
+};
+
+bool mavlink_tx_batch_test(void);
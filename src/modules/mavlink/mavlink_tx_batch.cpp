@@ -0,0 +1,153 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_tx_batch.cpp
+ * Transmit batch implementation.
+ */
+
+#if defined(__PX4_POSIX)
+
+#include "mavlink_tx_batch.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+
+void
+MavlinkTxBatch::begin_packet(const hrt_abstime &t)
+{
+	_write_pos = _offset[_count];
+	_packet_open = true;
+	_packet_failed = full();
+	_packet_time = t;
+}
+
+bool
+MavlinkTxBatch::append(const uint8_t *buf, unsigned len)
+{
+	if (!_packet_open || _packet_failed || (_write_pos - _offset[_count]) + len > MAVLINK_MAX_PACKET_LEN) {
+		_packet_failed = true;
+		return false;
+	}
+
+	memcpy(&_buf[_write_pos], buf, len);
+	_write_pos += len;
+	return true;
+}
+
+void
+MavlinkTxBatch::end_packet()
+{
+	if (_packet_open && !_packet_failed && _write_pos > _offset[_count]) {
+		if (_count == 0) {
+			_first_time = _packet_time;
+		}
+
+		_count++;
+		_offset[_count] = _write_pos;
+	}
+
+	_write_pos = _offset[_count];
+	_packet_open = false;
+	_packet_failed = false;
+}
+
+int
+MavlinkTxBatch::send_datagrams(int fd, const struct sockaddr *addr, socklen_t addr_len)
+{
+	int sent_bytes = 0;
+	unsigned sent = 0;
+
+#if defined(__PX4_LINUX)
+	struct iovec iov[MAX_PACKETS];
+	struct mmsghdr msgs[MAX_PACKETS];
+
+	memset(msgs, 0, sizeof(msgs));
+
+	for (unsigned i = 0; i < _count; i++) {
+		iov[i].iov_base = &_buf[_offset[i]];
+		iov[i].iov_len = packet_len(i);
+		msgs[i].msg_hdr.msg_name = (void *)addr;
+		msgs[i].msg_hdr.msg_namelen = addr_len;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (sent < _count) {
+		int ret = sendmmsg(fd, &msgs[sent], _count - sent, 0);
+
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (ret <= 0) {
+			break;
+		}
+
+		for (int i = 0; i < ret; i++) {
+			sent_bytes += msgs[sent + i].msg_len;
+		}
+
+		sent += ret;
+	}
+
+#else
+
+	for (; sent < _count; sent++) {
+		ssize_t ret = sendto(fd, packet(sent), packet_len(sent), 0, addr, addr_len);
+
+		if (ret < 0) {
+			break;
+		}
+
+		sent_bytes += ret;
+	}
+
+#endif /* __PX4_LINUX */
+
+	return (sent == 0 && _count > 0) ? -1 : sent_bytes;
+}
+
+void
+MavlinkTxBatch::clear()
+{
+	_count = 0;
+	_write_pos = 0;
+	_offset[0] = 0;
+	_packet_open = false;
+	_packet_failed = false;
+	_first_time = 0;
+}
+
+#endif /* __PX4_POSIX */
@@ -0,0 +1,122 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file mavlink_tx_batch.h
+ * Transmit batch collecting the MAVLink packets of one main loop iteration,
+ * so that they can be handed to the OS with a single system call.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <drivers/drv_hrt.h>
+
+#include "mavlink_bridge_header.h"
+
+class MavlinkTxBatch
+{
+public:
+	static constexpr unsigned MAX_PACKETS = 16;
+
+	MavlinkTxBatch() = default;
+	~MavlinkTxBatch() = default;
+
+	/**
+	 * Start a new packet. Its bytes are added with append() and committed with end_packet().
+	 *
+	 * @param t time the packet was generated, used for the flush deadline
+	 */
+	void begin_packet(const hrt_abstime &t);
+
+	/**
+	 * Append bytes to the packet started by begin_packet()
+	 *
+	 * @return false if the bytes do not fit, the packet is then dropped by end_packet()
+	 */
+	bool append(const uint8_t *buf, unsigned len);
+
+	/**
+	 * Commit the current packet. Empty or truncated packets are discarded.
+	 */
+	void end_packet();
+
+	/**
+	 * Send every committed packet as its own datagram to addr.
+	 * Uses sendmmsg() where available and a sendto() per packet otherwise.
+	 *
+	 * @return number of bytes sent or -1 if nothing could be sent
+	 */
+	int send_datagrams(int fd, const struct sockaddr *addr, socklen_t addr_len);
+
+	/**
+	 * Drop all packets, including a partially assembled one
+	 */
+	void clear();
+
+	bool empty() const { return _count == 0; }
+	bool full() const { return _count >= MAX_PACKETS; }
+	unsigned count() const { return _count; }
+
+	/** bytes of all committed packets, stored back to back starting at data() */
+	unsigned bytes() const { return _offset[_count]; }
+	const uint8_t *data() const { return _buf; }
+
+	/** bytes() plus the bytes of the packet being assembled */
+	unsigned queued_bytes() const { return _write_pos; }
+
+	/** time the oldest committed packet was generated */
+	hrt_abstime first_time() const { return _first_time; }
+
+	const uint8_t *packet(unsigned i) const { return &_buf[_offset[i]]; }
+	unsigned packet_len(unsigned i) const { return _offset[i + 1] - _offset[i]; }
+
+private:
+	uint8_t _buf[MAX_PACKETS * MAVLINK_MAX_PACKET_LEN] {};
+
+	/* packet i occupies [_offset[i], _offset[i + 1]) */
+	uint16_t _offset[MAX_PACKETS + 1] {};
+
+	unsigned _count{0};		///< number of committed packets
+	unsigned _write_pos{0};		///< end of the packet being assembled
+	bool _packet_open{false};
+	bool _packet_failed{false};
+	hrt_abstime _first_time{0};
+	hrt_abstime _packet_time{0};
+
+	/* prevent copying */
+	MavlinkTxBatch(const MavlinkTxBatch &) = delete;
+	MavlinkTxBatch &operator=(const MavlinkTxBatch &) = delete;
+};
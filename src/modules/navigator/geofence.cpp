@@ -57,6 +57,8 @@ Geofence::Geofence(Navigator *navigator) :
 	_navigator(navigator),
 	_sub_airdata(ORB_ID(vehicle_air_data))
 {
+	pthread_mutex_init(&_fence_mutex, nullptr);
+
 	// we assume there's no concurrent fence update on startup
 	_updateFence();
 }
@@ -66,6 +68,10 @@ Geofence::~Geofence()
 	if (_polygons) {
 		delete[](_polygons);
 	}
+
+	freeCompiledFence();
+
+	pthread_mutex_destroy(&_fence_mutex);
 }
 
 void Geofence::updateFence()
@@ -79,7 +85,11 @@ void Geofence::updateFence()
 		return;
 	}
 
+	// no check can use the fence while it is rebuilt and the old arrays are freed
+	pthread_mutex_lock(&_fence_mutex);
 	_updateFence();
+	pthread_mutex_unlock(&_fence_mutex);
+
 	dm_unlock(DM_KEY_FENCE_POINTS);
 }
 
@@ -145,6 +155,7 @@ void Geofence::_updateFence()
 
 				if (!_polygons) {
 					_num_polygons = 0;
+					freeCompiledFence();
 					PX4_ERR("alloc failed");
 					return;
 				}
@@ -175,6 +186,186 @@ void Geofence::_updateFence()
 
 	}
 
+	compileFence();
+}
+
+void Geofence::freeCompiledFence()
+{
+	delete[] _vertices;
+	_vertices = nullptr;
+	delete[] _band_start;
+	_band_start = nullptr;
+	delete[] _band_edges;
+	_band_edges = nullptr;
+}
+
+int Geofence::band(const PolygonInfo &polygon, float y)
+{
+	const int index = (int)((y - polygon.min_y) * polygon.band_scale);
+
+	if (index < 0) {
+		return 0;
+	}
+
+	return index < polygon.num_bands ? index : polygon.num_bands - 1;
+}
+
+void Geofence::compileFence()
+{
+	freeCompiledFence();
+
+	if (_num_polygons == 0) {
+		return;
+	}
+
+	int num_vertices = 0;
+	int num_band_starts = 0;
+
+	for (int polygon_idx = 0; polygon_idx < _num_polygons; ++polygon_idx) {
+		PolygonInfo &polygon = _polygons[polygon_idx];
+		const bool is_circle = polygon.fence_type == NAV_CMD_FENCE_CIRCLE_INCLUSION
+				       || polygon.fence_type == NAV_CMD_FENCE_CIRCLE_EXCLUSION;
+
+		polygon.valid = false;
+		polygon.vertex_index = num_vertices;
+		polygon.band_index = num_band_starts;
+		polygon.num_bands = 0;
+
+		if (is_circle) {
+			num_vertices += 1;
+
+		} else {
+			// about one edge per band for convex polygons
+			polygon.num_bands = polygon.vertex_count;
+			num_vertices += polygon.vertex_count;
+			num_band_starts += polygon.num_bands + 1;
+		}
+	}
+
+	_vertices = new Vertex[num_vertices];
+	_band_start = new uint16_t[num_band_starts > 0 ? num_band_starts : 1];
+
+	if (!_vertices || !_band_start) {
+		PX4_ERR("alloc failed");
+		freeCompiledFence();
+		_num_polygons = 0;
+		return;
+	}
+
+	// read and project all vertices, using the first one as reference
+	bool have_reference = false;
+
+	for (int polygon_idx = 0; polygon_idx < _num_polygons; ++polygon_idx) {
+		PolygonInfo &polygon = _polygons[polygon_idx];
+		const bool is_circle = polygon.num_bands == 0;
+		const int vertex_count = is_circle ? 1 : polygon.vertex_count;
+
+		polygon.valid = true;
+
+		// read the vertices in blocks, with one dataman request each
+		static constexpr int READ_BLOCK_SIZE = 8;
+		mission_fence_point_s points[READ_BLOCK_SIZE];
+
+		for (int i = 0; i < vertex_count; ++i) {
+			const int block_index = i % READ_BLOCK_SIZE;
+
+			if (block_index == 0) {
+				const int count = (vertex_count - i < READ_BLOCK_SIZE) ? vertex_count - i : READ_BLOCK_SIZE;
+
+				if (dm_read_range(DM_KEY_FENCE_POINTS, polygon.dataman_index + i, count, points,
+						  sizeof(mission_fence_point_s)) != count) {
+					PX4_ERR("dm_read_range failed");
+					polygon.valid = false;
+					break;
+				}
+			}
+
+			const mission_fence_point_s &point = points[block_index];
+
+			if (point.frame != NAV_FRAME_GLOBAL && point.frame != NAV_FRAME_GLOBAL_INT
+			    && point.frame != NAV_FRAME_GLOBAL_RELATIVE_ALT
+			    && point.frame != NAV_FRAME_GLOBAL_RELATIVE_ALT_INT) {
+				// TODO: handle different frames
+				PX4_ERR("Frame type %i not supported", (int)point.frame);
+				polygon.valid = false;
+				break;
+			}
+
+			if (!have_reference) {
+				map_projection_init(&_projection_reference, point.lat, point.lon);
+				have_reference = true;
+			}
+
+			Vertex &vertex = _vertices[polygon.vertex_index + i];
+			map_projection_project(&_projection_reference, point.lat, point.lon, &vertex.x, &vertex.y);
+		}
+
+		if (!polygon.valid || is_circle) {
+			continue;
+		}
+
+		const Vertex *vertices = &_vertices[polygon.vertex_index];
+		polygon.min_x = polygon.max_x = vertices[0].x;
+		polygon.min_y = polygon.max_y = vertices[0].y;
+
+		for (int i = 1; i < vertex_count; ++i) {
+			polygon.min_x = fminf(polygon.min_x, vertices[i].x);
+			polygon.max_x = fmaxf(polygon.max_x, vertices[i].x);
+			polygon.min_y = fminf(polygon.min_y, vertices[i].y);
+			polygon.max_y = fmaxf(polygon.max_y, vertices[i].y);
+		}
+
+		const float height = polygon.max_y - polygon.min_y;
+		polygon.band_scale = height > FLT_EPSILON ? polygon.num_bands / height : 0.f;
+	}
+
+	// band index: count the edges overlapping each band, then fill in the edges.
+	// This is quadratic in the vertex count, but only done once per fence update.
+	int num_band_edges = 0;
+
+	for (int pass = 0; pass < 2; ++pass) {
+		num_band_edges = 0;
+
+		for (int polygon_idx = 0; polygon_idx < _num_polygons; ++polygon_idx) {
+			const PolygonInfo &polygon = _polygons[polygon_idx];
+
+			if (polygon.num_bands == 0) {
+				continue;
+			}
+
+			const Vertex *vertices = &_vertices[polygon.vertex_index];
+			uint16_t *band_start = &_band_start[polygon.band_index];
+			const unsigned edge_count = polygon.valid ? polygon.vertex_count : 0; // invalid: empty bands
+
+			for (int b = 0; b < polygon.num_bands; ++b) {
+				band_start[b] = num_band_edges;
+
+				for (unsigned i = 0, j = edge_count - 1; i < edge_count; j = i++) {
+					if (band(polygon, fminf(vertices[i].y, vertices[j].y)) <= b
+					    && band(polygon, fmaxf(vertices[i].y, vertices[j].y)) >= b) {
+						if (pass == 1) {
+							_band_edges[num_band_edges] = i;
+						}
+
+						++num_band_edges;
+					}
+				}
+			}
+
+			band_start[polygon.num_bands] = num_band_edges;
+		}
+
+		if (pass == 0) {
+			_band_edges = new uint8_t[num_band_edges > 0 ? num_band_edges : 1];
+
+			if (!_band_edges) {
+				PX4_ERR("alloc failed");
+				freeCompiledFence();
+				_num_polygons = 0;
+				return;
+			}
+		}
+	}
 }
 
 bool Geofence::checkAll(const struct vehicle_global_position_s &global_position)
@@ -280,22 +471,40 @@ bool Geofence::checkAll(double lat, double lon, float altitude)
 
 bool Geofence::checkPolygons(double lat, double lon, float altitude)
 {
-	// the following uses dm_read, so first we try to lock all items. If that fails, it (most likely) means
-	// the data is currently being updated (via a mavlink geofence transfer), and we do not check for a violation now
-	if (dm_trylock(DM_KEY_FENCE_POINTS) != 0) {
-		return true;
-	}
+	// Hold the fence for the whole check. Taking the dataman lock afterwards only uses dm_trylock(), so this
+	// does not invert the lock order of updateFence().
+	pthread_mutex_lock(&_fence_mutex);
+	const bool inside = _checkPolygons(lat, lon, altitude);
+	pthread_mutex_unlock(&_fence_mutex);
 
-	// we got the lock, now check if the fence data got updated
-	mission_stats_entry_s stats;
-	int ret = dm_read(DM_KEY_FENCE_POINTS, 0, &stats, sizeof(mission_stats_entry_s));
+	return inside;
+}
+
+bool Geofence::_checkPolygons(double lat, double lon, float altitude)
+{
+	// dm_generation() changes with every write of fence data and can be polled without going through dataman.
+	// Only then we check the update counter, which requires the lock.
+	const unsigned dm_generation_current = dm_generation(DM_KEY_FENCE_POINTS);
+
+	if (dm_generation_current != _dm_generation) {
+		// If the lock cannot be taken, it (most likely) means the data is currently being updated (via a
+		// mavlink geofence transfer), and we do not check for a violation now
+		if (dm_trylock(DM_KEY_FENCE_POINTS) != 0) {
+			return true;
+		}
+
+		mission_stats_entry_s stats;
+		int ret = dm_read(DM_KEY_FENCE_POINTS, 0, &stats, sizeof(mission_stats_entry_s));
 
-	if (ret == sizeof(mission_stats_entry_s) && _update_counter != stats.update_counter) {
-		_updateFence();
+		if (ret == sizeof(mission_stats_entry_s) && _update_counter != stats.update_counter) {
+			_updateFence();
+		}
+
+		dm_unlock(DM_KEY_FENCE_POINTS);
+		_dm_generation = dm_generation_current;
 	}
 
 	if (isEmpty()) {
-		dm_unlock(DM_KEY_FENCE_POINTS);
 		/* Empty fence -> accept all points */
 		return true;
 	}
@@ -303,11 +512,13 @@ bool Geofence::checkPolygons(double lat, double lon, float altitude)
 	/* Vertical check */
 	if (_altitude_max > _altitude_min) { // only enable vertical check if configured properly
 		if (altitude > _altitude_max || altitude < _altitude_min) {
-			dm_unlock(DM_KEY_FENCE_POINTS);
 			return false;
 		}
 	}
 
+	float x = 0.f;
+	float y = 0.f;
+	map_projection_project(&_projection_reference, lat, lon, &x, &y);
 
 	/* Horizontal check: iterate all polygons & circles */
 	bool outside_exclusion = true;
@@ -316,7 +527,7 @@ bool Geofence::checkPolygons(double lat, double lon, float altitude)
 
 	for (int polygon_idx = 0; polygon_idx < _num_polygons; ++polygon_idx) {
 		if (_polygons[polygon_idx].fence_type == NAV_CMD_FENCE_CIRCLE_INCLUSION) {
-			bool inside = insideCircle(_polygons[polygon_idx], lat, lon, altitude);
+			bool inside = insideCircle(_polygons[polygon_idx], x, y);
 
 			if (inside) {
 				inside_inclusion = true;
@@ -325,14 +536,14 @@ bool Geofence::checkPolygons(double lat, double lon, float altitude)
 			had_inclusion_areas = true;
 
 		} else if (_polygons[polygon_idx].fence_type == NAV_CMD_FENCE_CIRCLE_EXCLUSION) {
-			bool inside = insideCircle(_polygons[polygon_idx], lat, lon, altitude);
+			bool inside = insideCircle(_polygons[polygon_idx], x, y);
 
 			if (inside) {
 				outside_exclusion = false;
 			}
 
 		} else { // it's a polygon
-			bool inside = insidePolygon(_polygons[polygon_idx], lat, lon, altitude);
+			bool inside = insidePolygon(_polygons[polygon_idx], x, y);
 
 			if (_polygons[polygon_idx].fence_type == NAV_CMD_FENCE_POLYGON_VERTEX_INCLUSION) {
 				if (inside) {
@@ -349,46 +560,34 @@ bool Geofence::checkPolygons(double lat, double lon, float altitude)
 		}
 	}
 
-	dm_unlock(DM_KEY_FENCE_POINTS);
-
 	return (!had_inclusion_areas || inside_inclusion) && outside_exclusion;
 }
 
-bool Geofence::insidePolygon(const PolygonInfo &polygon, double lat, double lon, float altitude)
+bool Geofence::insidePolygon(const PolygonInfo &polygon, float x, float y) const
 {
+	if (!polygon.valid || x < polygon.min_x || x > polygon.max_x || y < polygon.min_y || y > polygon.max_y) {
+		return false;
+	}
 
 	/* Adaptation of algorithm originally presented as
 	 * PNPOLY - Point Inclusion in Polygon Test
 	 * W. Randolph Franklin (WRF)
 	 * Only supports non-complex polygons (not self intersecting)
+	 * Only the edges overlapping the band of the point can cross the ray.
 	 */
 
-	mission_fence_point_s temp_vertex_i;
-	mission_fence_point_s temp_vertex_j;
+	const Vertex *vertices = &_vertices[polygon.vertex_index];
+	const int b = band(polygon, y);
 	bool c = false;
 
-	for (unsigned i = 0, j = polygon.vertex_count - 1; i < polygon.vertex_count; j = i++) {
-		if (dm_read(DM_KEY_FENCE_POINTS, polygon.dataman_index + i, &temp_vertex_i,
-			    sizeof(mission_fence_point_s)) != sizeof(mission_fence_point_s)) {
-			break;
-		}
-
-		if (dm_read(DM_KEY_FENCE_POINTS, polygon.dataman_index + j, &temp_vertex_j,
-			    sizeof(mission_fence_point_s)) != sizeof(mission_fence_point_s)) {
-			break;
-		}
-
-		if (temp_vertex_i.frame != NAV_FRAME_GLOBAL && temp_vertex_i.frame != NAV_FRAME_GLOBAL_INT
-		    && temp_vertex_i.frame != NAV_FRAME_GLOBAL_RELATIVE_ALT
-		    && temp_vertex_i.frame != NAV_FRAME_GLOBAL_RELATIVE_ALT_INT) {
-			// TODO: handle different frames
-			PX4_ERR("Frame type %i not supported", (int)temp_vertex_i.frame);
-			break;
-		}
+	for (int k = _band_start[polygon.band_index + b]; k < _band_start[polygon.band_index + b + 1]; ++k) {
+		const int i = _band_edges[k];
+		const int j = i == 0 ? polygon.vertex_count - 1 : i - 1;
+		const Vertex &vertex_i = vertices[i];
+		const Vertex &vertex_j = vertices[j];
 
-		if (((double)temp_vertex_i.lon >= lon) != ((double)temp_vertex_j.lon >= lon) &&
-		    (lat <= (double)(temp_vertex_j.lat - temp_vertex_i.lat) * (lon - (double)temp_vertex_i.lon) /
-		     (double)(temp_vertex_j.lon - temp_vertex_i.lon) + (double)temp_vertex_i.lat)) {
+		if ((vertex_i.y >= y) != (vertex_j.y >= y) &&
+		    (x <= (vertex_j.x - vertex_i.x) * (y - vertex_i.y) / (vertex_j.y - vertex_i.y) + vertex_i.x)) {
 			c = !c;
 		}
 	}
@@ -396,34 +595,16 @@ bool Geofence::insidePolygon(const PolygonInfo &polygon, double lat, double lon,
 	return c;
 }
 
-bool Geofence::insideCircle(const PolygonInfo &polygon, double lat, double lon, float altitude)
+bool Geofence::insideCircle(const PolygonInfo &polygon, float x, float y) const
 {
-
-	mission_fence_point_s circle_point;
-
-	if (dm_read(DM_KEY_FENCE_POINTS, polygon.dataman_index, &circle_point,
-		    sizeof(mission_fence_point_s)) != sizeof(mission_fence_point_s)) {
-		PX4_ERR("dm_read failed");
-		return false;
-	}
-
-	if (circle_point.frame != NAV_FRAME_GLOBAL && circle_point.frame != NAV_FRAME_GLOBAL_INT
-	    && circle_point.frame != NAV_FRAME_GLOBAL_RELATIVE_ALT
-	    && circle_point.frame != NAV_FRAME_GLOBAL_RELATIVE_ALT_INT) {
-		// TODO: handle different frames
-		PX4_ERR("Frame type %i not supported", (int)circle_point.frame);
+	if (!polygon.valid) {
 		return false;
 	}
 
-	if (!map_projection_initialized(&_projection_reference)) {
-		map_projection_init(&_projection_reference, lat, lon);
-	}
-
-	float x1, y1, x2, y2;
-	map_projection_project(&_projection_reference, lat, lon, &x1, &y1);
-	map_projection_project(&_projection_reference, circle_point.lat, circle_point.lon, &x2, &y2);
-	float dx = x1 - x2, dy = y1 - y2;
-	return dx * dx + dy * dy < circle_point.circle_radius * circle_point.circle_radius;
+	const Vertex &center = _vertices[polygon.vertex_index];
+	const float dx = x - center.x;
+	const float dy = y - center.y;
+	return dx * dx + dy * dy < polygon.circle_radius * polygon.circle_radius;
 }
 
 bool
@@ -531,15 +712,22 @@ Geofence::loadFromFile(const char *filename)
 		mavlink_log_info(_navigator->get_mavlink_log_pub(), "Geofence imported");
 		rc = PX4_OK;
 
-		/* do a second pass, now that we know the number of vertices */
-		for (int seq = 1; seq <= pointCounter; ++seq) {
-			mission_fence_point_s mission_fence_point;
+		/* do a second pass, now that we know the number of vertices (in blocks, with one dataman request each) */
+		static constexpr int READ_BLOCK_SIZE = 8;
+		mission_fence_point_s points[READ_BLOCK_SIZE];
 
-			if (dm_read(DM_KEY_FENCE_POINTS, seq, &mission_fence_point, sizeof(mission_fence_point_s)) ==
-			    sizeof(mission_fence_point_s)) {
-				mission_fence_point.vertex_count = pointCounter;
-				dm_write(DM_KEY_FENCE_POINTS, seq, DM_PERSIST_POWER_ON_RESET, &mission_fence_point,
-					 sizeof(mission_fence_point_s));
+		for (int seq = 1; seq <= pointCounter; seq += READ_BLOCK_SIZE) {
+			const int count = (pointCounter + 1 - seq < READ_BLOCK_SIZE) ? pointCounter + 1 - seq : READ_BLOCK_SIZE;
+			const ssize_t num_read = dm_read_range(DM_KEY_FENCE_POINTS, seq, count, points,
+							       sizeof(mission_fence_point_s));
+
+			for (int i = 0; i < num_read; ++i) {
+				points[i].vertex_count = pointCounter;
+			}
+
+			if (num_read > 0) {
+				dm_write_range(DM_KEY_FENCE_POINTS, seq, num_read, DM_PERSIST_POWER_ON_RESET, points,
+					       sizeof(mission_fence_point_s));
 			}
 		}
 
@@ -580,6 +768,8 @@ void Geofence::printStatus()
 	int num_inclusion_polygons = 0, num_exclusion_polygons = 0, total_num_vertices = 0;
 	int num_inclusion_circles = 0, num_exclusion_circles = 0;
 
+	pthread_mutex_lock(&_fence_mutex);
+
 	for (int i = 0; i < _num_polygons; ++i) {
 		total_num_vertices += _polygons[i].vertex_count;
 
@@ -600,6 +790,8 @@ void Geofence::printStatus()
 		}
 	}
 
+	pthread_mutex_unlock(&_fence_mutex);
+
 	PX4_INFO("Geofence: %i inclusion, %i exclusion polygons, %i inclusion, %i exclusion circles, %i total vertices",
 		 num_inclusion_polygons, num_exclusion_polygons, num_inclusion_circles, num_exclusion_circles,
 		 total_num_vertices);
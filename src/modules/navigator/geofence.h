@@ -41,6 +41,7 @@
 #pragma once
 
 #include <cfloat>
+#include <pthread.h>
 
 #include <px4_module_params.h>
 #include <drivers/drv_hrt.h>
@@ -151,12 +152,44 @@ private:
 			uint16_t vertex_count;
 			float circle_radius;
 		};
+
+		// compiled data, @see compileFence()
+		bool valid; ///< false if the vertices could not be read or use an unsupported frame
+		uint16_t vertex_index; ///< first vertex in _vertices (the center for a circle)
+		uint16_t band_index; ///< first entry in _band_start (polygons only)
+		uint16_t num_bands;
+		float band_scale; ///< bands per meter along y
+		float min_x, max_x, min_y, max_y; ///< bounding box [m]
 	};
 	PolygonInfo *_polygons{nullptr};
 	int _num_polygons{0};
 
+	/** fence vertex projected to the local frame */
+	struct Vertex {
+		float x; ///< north [m]
+		float y; ///< east [m]
+	};
+
+	/*
+	 * Compiled fence: the vertices are read from dataman once and projected. Each polygon is split into
+	 * num_bands horizontal bands (equal slices of its y extent), and each band lists the edges overlapping it.
+	 * The crossing test for a point then only visits the edges of a single band.
+	 */
+	Vertex *_vertices{nullptr};
+	uint16_t *_band_start{nullptr}; ///< per polygon num_bands + 1 entries: range of the band in _band_edges
+	uint8_t *_band_edges{nullptr}; ///< start vertex of an edge, relative to the polygon
+
 	map_projection_reference_s _projection_reference = {}; ///< reference to convert (lon, lat) to local [m]
 
+	/**
+	 * Protects _polygons and the compiled fence. A check reads them for its whole duration, while
+	 * updateFence() can replace them from another thread (e.g. the navigator fencefile command).
+	 * Lock order: the dataman fence lock before this mutex.
+	 */
+	pthread_mutex_t _fence_mutex;
+
+	unsigned _dm_generation{0}; ///< dm_generation() of the fence points when the update counter was last checked
+
 	DEFINE_PARAMETERS(
 		(ParamInt<px4::params::GF_ACTION>) _param_action,
 		(ParamInt<px4::params::GF_ALTMODE>) _param_altitude_mode,
@@ -172,10 +205,22 @@ private:
 	uint16_t _update_counter{0}; ///< dataman update counter: if it does not match, we polygon data was updated
 
 	/**
-	 * implementation of updateFence(), but without locking
+	 * implementation of updateFence(), but without locking: the caller holds the dataman fence lock and
+	 * _fence_mutex (except in the constructor)
 	 */
 	void _updateFence();
 
+	/**
+	 * read and project the vertices of all polygons and circles and build the band index.
+	 * Must be called with the dataman fence lock held.
+	 */
+	void compileFence();
+
+	void freeCompiledFence();
+
+	/** @return band of a polygon containing y */
+	static int band(const PolygonInfo &polygon, float y);
+
 	/**
 	 * Check if a point passes the Geofence test.
 	 * This takes all polygons and minimum & maximum altitude into account
@@ -188,6 +233,11 @@ private:
 	 */
 	bool checkPolygons(double lat, double lon, float altitude);
 
+	/**
+	 * implementation of checkPolygons(), called with _fence_mutex held
+	 */
+	bool _checkPolygons(double lat, double lon, float altitude);
+
 	/**
 	 * Check if a point passes the Geofence test.
 	 * In addition to checkPolygons(), this takes all additional parameters into account.
@@ -201,14 +251,16 @@ private:
 
 	/**
 	 * Check if a single point is within a polygon
+	 * @param x, y point in the local frame of _projection_reference
 	 * @return true if within polygon
 	 */
-	bool insidePolygon(const PolygonInfo &polygon, double lat, double lon, float altitude);
+	bool insidePolygon(const PolygonInfo &polygon, float x, float y) const;
 
 	/**
 	 * Check if a single point is within a circle
 	 * @param polygon must be a circle!
+	 * @param x, y point in the local frame of _projection_reference
 	 * @return true if within polygon the circle
 	 */
-	bool insideCircle(const PolygonInfo &polygon, double lat, double lon, float altitude);
+	bool insideCircle(const PolygonInfo &polygon, float x, float y) const;
 };
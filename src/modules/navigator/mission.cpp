@@ -54,6 +54,7 @@
 #include <systemlib/mavlink_log.h>
 #include <systemlib/err.h>
 #include <lib/ecl/geo/geo.h>
+#include <lib/mathlib/mathlib.h>
 #include <navigator/navigation.h>
 #include <uORB/uORB.h>
 #include <uORB/topics/mission.h>
@@ -378,6 +379,44 @@ Mission::set_execution_mode(const uint8_t mode)
 	}
 }
 
+template<typename F>
+bool
+Mission::for_each_mission_item(dm_item_t dm_item, size_t start, size_t count, bool reverse, F f)
+{
+	if (count == 0) {
+		return true;
+	}
+
+	mission_item_s *items = new mission_item_s[READ_CHUNK_SIZE];
+
+	if (items == nullptr) {
+		return false;
+	}
+
+	bool read_ok = true;
+	bool done = false;
+
+	for (size_t visited = 0; visited < count && !done; ) {
+		const size_t num = math::min((size_t)READ_CHUNK_SIZE, count - visited);
+		const size_t chunk_start = reverse ? start + count - visited - num : start + visited;
+
+		if (dm_read_range(dm_item, chunk_start, num, items, sizeof(mission_item_s)) != (ssize_t)num) {
+			read_ok = false;
+			break;
+		}
+
+		for (size_t i = 0; i < num && !done; i++) {
+			const size_t offset = reverse ? num - 1 - i : i;
+			done = f(items[offset], chunk_start + offset);
+		}
+
+		visited += num;
+	}
+
+	delete[] items;
+	return read_ok;
+}
+
 bool
 Mission::find_offboard_land_start()
 {
@@ -389,16 +428,10 @@ Mission::find_offboard_land_start()
 
 	const dm_item_t dm_current = (dm_item_t)_offboard_mission.dataman_id;
 
-	for (size_t i = 0; i < _offboard_mission.count; i++) {
-		struct mission_item_s missionitem = {};
-		const ssize_t len = sizeof(missionitem);
-
-		if (dm_read(dm_current, i, &missionitem, len) != len) {
-			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-			PX4_ERR("dataman read failure");
-			break;
-		}
+	_land_start_available = false;
 
+	const bool read_ok = for_each_mission_item(dm_current, 0, _offboard_mission.count, false,
+	[this](const mission_item_s & missionitem, size_t i) {
 		if ((missionitem.nav_cmd == NAV_CMD_DO_LAND_START) ||
 		    ((missionitem.nav_cmd == NAV_CMD_VTOL_LAND) && _navigator->get_vstatus()->is_vtol) ||
 		    (missionitem.nav_cmd == NAV_CMD_LAND)) {
@@ -406,10 +439,16 @@ Mission::find_offboard_land_start()
 			_land_start_index = i;
 			return true;
 		}
+
+		return false;
+	});
+
+	if (!read_ok) {
+		/* not supposed to happen unless the datamanager can't access the SD card, etc. */
+		PX4_ERR("dataman read failure");
 	}
 
-	_land_start_available = false;
-	return false;
+	return _land_start_available;
 }
 
 bool
@@ -534,25 +573,26 @@ Mission::advance_mission()
 		case mission_result_s::MISSION_EXECUTION_MODE_REVERSE: {
 				// find next position item in reverse order
 				dm_item_t dm_current = (dm_item_t)(_offboard_mission.dataman_id);
+				const size_t num_before = math::max(_current_offboard_mission_index, (int32_t)0);
+				int32_t next_index = -1;
 
-				for (int32_t i = _current_offboard_mission_index - 1; i >= 0; i--) {
-					struct mission_item_s missionitem = {};
-					const ssize_t len = sizeof(missionitem);
-
-					if (dm_read(dm_current, i, &missionitem, len) != len) {
-						/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-						PX4_ERR("dataman read failure");
-						break;
-					}
-
+				const bool read_ok = for_each_mission_item(dm_current, 0, num_before, true,
+				[&](const mission_item_s & missionitem, size_t i) {
 					if (item_contains_position(missionitem)) {
-						_current_offboard_mission_index = i;
-						return;
+						next_index = i;
+						return true;
 					}
+
+					return false;
+				});
+
+				if (!read_ok) {
+					/* not supposed to happen unless the datamanager can't access the SD card */
+					PX4_ERR("dataman read failure");
 				}
 
-				// finished flying back the mission
-				_current_offboard_mission_index = -1;
+				// -1 when finished flying back the mission
+				_current_offboard_mission_index = next_index;
 				break;
 			}
 
@@ -1636,24 +1676,26 @@ Mission::reset_offboard_mission(struct mission_s &mission)
 			/* reset jump counters */
 			if (mission.count > 0) {
 				const dm_item_t dm_current = (dm_item_t)mission.dataman_id;
+				bool write_failed = false;
 
-				for (unsigned index = 0; index < mission.count; index++) {
-					struct mission_item_s item;
-					const ssize_t len = sizeof(struct mission_item_s);
-
-					if (dm_read(dm_current, index, &item, len) != len) {
-						PX4_WARN("could not read mission item during reset");
-						break;
-					}
-
-					if (item.nav_cmd == NAV_CMD_DO_JUMP) {
+				const bool read_ok = for_each_mission_item(dm_current, 0, mission.count, false,
+				[dm_current, &write_failed](const mission_item_s & missionitem, size_t index) {
+					if (missionitem.nav_cmd == NAV_CMD_DO_JUMP) {
+						struct mission_item_s item = missionitem;
+						const ssize_t len = sizeof(struct mission_item_s);
 						item.do_jump_current_count = 0;
 
 						if (dm_write(dm_current, index, DM_PERSIST_POWER_ON_RESET, &item, len) != len) {
 							PX4_WARN("could not save mission item during reset");
-							break;
+							write_failed = true;
 						}
 					}
+
+					return write_failed;
+				});
+
+				if (!read_ok) {
+					PX4_WARN("could not read mission item during reset");
 				}
 			}
 
@@ -1708,16 +1750,8 @@ Mission::index_closest_mission_item() const
 
 	dm_item_t dm_current = (dm_item_t)(_offboard_mission.dataman_id);
 
-	for (size_t i = 0; i < _offboard_mission.count; i++) {
-		struct mission_item_s missionitem = {};
-		const ssize_t len = sizeof(missionitem);
-
-		if (dm_read(dm_current, i, &missionitem, len) != len) {
-			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-			PX4_ERR("dataman read failure");
-			break;
-		}
-
+	const bool read_ok = for_each_mission_item(dm_current, 0, _offboard_mission.count, false,
+	[&](const mission_item_s & missionitem, size_t i) {
 		if (item_contains_position(missionitem)) {
 			// do not consider land waypoints for a fw
 			if (!((missionitem.nav_cmd == NAV_CMD_LAND) &&
@@ -1736,6 +1770,13 @@ Mission::index_closest_mission_item() const
 				}
 			}
 		}
+
+		return false;
+	});
+
+	if (!read_ok) {
+		/* not supposed to happen unless the datamanager can't access the SD card, etc. */
+		PX4_ERR("dataman read failure");
 	}
 
 	// for mission reverse also consider the home position
@@ -241,6 +241,16 @@ private:
 	 */
 	int32_t index_closest_mission_item() const;
 
+	/**
+	 * Call f(item, index) for count consecutive mission items starting at index start, in descending order if
+	 * reverse is set. The items are read from the dataman in chunks. Iteration stops once f returns true.
+	 * @return false if the items could not be read
+	 */
+	template<typename F>
+	static bool for_each_mission_item(dm_item_t dm_item, size_t start, size_t count, bool reverse, F f);
+
+	static constexpr size_t READ_CHUNK_SIZE = 32;	/**< mission items read from the dataman in one request */
+
 	bool position_setpoint_equal(const position_setpoint_s *p1, const position_setpoint_s *p2) const;
 
 	DEFINE_PARAMETERS(
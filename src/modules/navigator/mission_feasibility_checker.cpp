@@ -44,6 +44,7 @@
 #include "mission_block.h"
 #include "navigator.h"
 
+#include <drivers/drv_hrt.h>
 #include <drivers/drv_pwm_output.h>
 #include <lib/ecl/geo/geo.h>
 #include <lib/mathlib/mathlib.h>
@@ -52,523 +53,669 @@
 #include <uORB/Subscription.hpp>
 #include <uORB/topics/position_controller_landing_status.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 bool
 MissionFeasibilityChecker::checkMissionFeasible(const mission_s &mission,
 		float max_distance_to_1st_waypoint, float max_distance_between_waypoints,
 		bool land_start_req)
 {
-	bool failed = false;
-	bool warned = false;
+	reset();
 
-	// first check if we have a valid position
-	const bool home_valid = _navigator->home_position_valid();
-	const bool home_alt_valid = _navigator->home_alt_valid();
+	_home_valid = _navigator->home_position_valid();
+	_home_alt_valid = _navigator->home_alt_valid();
+	_home_alt = _navigator->get_home_position()->alt;
+	_max_distance_to_1st_waypoint = max_distance_to_1st_waypoint;
+	_max_distance_between_waypoints = max_distance_between_waypoints;
+	_land_start_req = land_start_req;
 
-	if (!home_alt_valid) {
-		failed = true;
-		warned = true;
-		mavlink_log_info(_navigator->get_mavlink_log_pub(), "Not yet ready for mission, no position lock.");
+	// VTOL always respects rotary wing feasibility
+	_rotary_wing = _navigator->get_vstatus()->is_rotary_wing || _navigator->get_vstatus()->is_vtol;
+	_takeoff_acceptance_radius = _rotary_wing ? _navigator->get_altitude_acceptance_radius() :
+				     _navigator->get_default_acceptance_radius();
 
-	} else {
-		failed = failed || !checkDistanceToFirstWaypoint(mission, max_distance_to_1st_waypoint);
+	// first check if we have a valid position
+	if (!_home_alt_valid) {
+		mavlink_log_info(_navigator->get_mavlink_log_pub(), "Not yet ready for mission, no position lock.");
+		return false;
 	}
 
-	const float home_alt = _navigator->get_home_position()->alt;
-
-	// check if all mission item commands are supported
-	failed = failed || !checkMissionItemValidity(mission);
-	failed = failed || !checkDistancesBetweenWaypoints(mission, max_distance_between_waypoints);
-	failed = failed || !checkGeofence(mission, home_alt, home_valid);
-	failed = failed || !checkHomePositionAltitude(mission, home_alt, home_alt_valid, warned);
+	if (_benchmark_fd < 0 && _navigator->get_geofence().isHomeRequired() && !_home_valid) {
+		_geofence.issue = Issue::GeofenceHomeRequired;
+	}
 
-	// VTOL always respects rotary wing feasibility
-	if (_navigator->get_vstatus()->is_rotary_wing || _navigator->get_vstatus()->is_vtol) {
-		failed = failed || !checkRotarywing(mission, home_alt, home_alt_valid);
+	// items[0] holds the last item of the previous chunk
+	mission_item_s *items = new mission_item_s[READ_CHUNK_SIZE + 1];
 
-	} else {
-		failed = failed || !checkFixedwing(mission, home_alt, home_alt_valid, land_start_req);
+	if (items == nullptr) {
+		mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: out of memory");
+		return false;
 	}
 
-	return !failed;
-}
+	bool read_failed = false;
 
-bool
-MissionFeasibilityChecker::checkRotarywing(const mission_s &mission, float home_alt, bool home_alt_valid)
-{
-	for (size_t i = 0; i < mission.count; i++) {
-		struct mission_item_s missionitem = {};
-		const ssize_t len = sizeof(struct mission_item_s);
+	for (size_t start = 0; start < mission.count && !concluded(); start += READ_CHUNK_SIZE) {
+		const size_t count = math::min((size_t)READ_CHUNK_SIZE, mission.count - start);
 
-		if (dm_read((dm_item_t)mission.dataman_id, i, &missionitem, len) != len) {
-			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-			return false;
+		if (!readItems(mission, start, &items[1], count)) {
+			read_failed = true;
+			break;
 		}
 
-		// look for a takeoff waypoint
-		if (missionitem.nav_cmd == NAV_CMD_TAKEOFF) {
-			// make sure that the altitude of the waypoint is at least one meter larger than the altitude acceptance radius
-			// this makes sure that the takeoff waypoint is not reached before we are at least one meter in the air
-			const float takeoff_alt = missionitem.altitude_is_relative ? missionitem.altitude : missionitem.altitude - home_alt;
+		for (size_t i = 0; i < count; i++) {
+			checkItem(items[i + 1], (start + i > 0) ? &items[i] : nullptr, start + i);
+		}
 
-			// check if we should use default acceptance radius
-			float acceptance_radius = _navigator->get_altitude_acceptance_radius();
+		items[0] = items[count];
+	}
 
-			// if a specific acceptance radius has been defined, use that one instead
-			if (missionitem.acceptance_radius > NAV_EPSILON_POSITION) {
-				acceptance_radius = missionitem.acceptance_radius;
-			}
+	delete[] items;
 
-			if (takeoff_alt - 1.0f < acceptance_radius) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: Takeoff altitude too low!");
-				return false;
-			}
-		}
+	if (read_failed) {
+		// not supposed to happen unless the datamanager can't access the SD card, etc.
+		mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: Cannot access SD card");
+		return false;
+	}
+
+	if (!_rotary_wing) {
+		checkFixedWingLandingEnd();
+	}
+
+	// report in the order of the checks, stopping at the first failure
+	bool failed = !report(_first_waypoint);
+	failed = failed || !report(_validity);
+	failed = failed || !report(_distances);
+	failed = failed || !report(_geofence);
+	failed = failed || !report(_home_altitude, false);
+
+	if (_rotary_wing) {
+		failed = failed || !report(_takeoff);
+
+	} else if (!failed) {
+		/* issue feedback to the user for both fixed wing checks */
+		const bool takeoff_passed = report(_takeoff);
+		const bool landing_passed = report(_landing);
+		failed = !(takeoff_passed && landing_passed);
 	}
 
-	// all checks have passed
-	return true;
+	return !failed;
+}
+
+void
+MissionFeasibilityChecker::reset()
+{
+	_first_waypoint = {};
+	_validity = {};
+	_distances = {};
+	_geofence = {};
+	_home_altitude = {};
+	_takeoff = {};
+	_landing = {};
+
+	_first_waypoint_done = false;
+	_have_last_position = false;
+	_land_start_found = false;
+	_do_land_start_index = 0;
+	_landing_approach_index = 0;
+	_landing_valid = false;
 }
 
 bool
-MissionFeasibilityChecker::checkFixedwing(const mission_s &mission, float home_alt, bool home_alt_valid,
-		bool land_start_req)
+MissionFeasibilityChecker::readItems(const mission_s &mission, size_t start, mission_item_s *items, size_t count)
 {
-	/* Perform checks and issue feedback to the user for all checks */
-	bool resTakeoff = checkFixedWingTakeoff(mission, home_alt, home_alt_valid);
-	bool resLanding = checkFixedWingLanding(mission, land_start_req);
+	if (_benchmark_fd >= 0) {
+		const ssize_t len = count * sizeof(mission_item_s);
+		return lseek(_benchmark_fd, start * sizeof(mission_item_s), SEEK_SET) >= 0
+		       && ::read(_benchmark_fd, items, len) == len;
+	}
 
-	/* Mission is only marked as feasible if all checks return true */
-	return (resTakeoff && resLanding);
+	return dm_read_range((dm_item_t)mission.dataman_id, start, count, items, sizeof(mission_item_s)) == (ssize_t)count;
 }
 
 bool
-MissionFeasibilityChecker::checkGeofence(const mission_s &mission, float home_alt, bool home_valid)
+MissionFeasibilityChecker::concluded() const
 {
-	if (_navigator->get_geofence().isHomeRequired() && !home_valid) {
-		mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Geofence requires valid home position");
-		return false;
+	if (_first_waypoint.issue != Issue::None) {
+		return true;
 	}
 
-	/* Check if all mission items are inside the geofence (if we have a valid geofence) */
-	if (_navigator->get_geofence().valid()) {
-		for (size_t i = 0; i < mission.count; i++) {
-			struct mission_item_s missionitem = {};
-			const ssize_t len = sizeof(missionitem);
-
-			if (dm_read((dm_item_t)mission.dataman_id, i, &missionitem, len) != len) {
-				/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-				return false;
-			}
+	const bool first_waypoint_done = _first_waypoint_done || _max_distance_to_1st_waypoint <= 0.0f;
+	return first_waypoint_done && _validity.issue != Issue::None;
+}
 
-			if (missionitem.altitude_is_relative && !home_valid) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Geofence requires valid home position");
-				return false;
-			}
+void
+MissionFeasibilityChecker::checkItem(const mission_item_s &item, const mission_item_s *previous, size_t index)
+{
+	checkDistanceToFirstWaypoint(item, index);
+	checkMissionItemValidity(item, index);
+	checkDistancesBetweenWaypoints(item, index);
+	checkGeofence(item, index);
+	checkHomePositionAltitude(item, index);
+	checkTakeoff(item, index);
+
+	if (!_rotary_wing) {
+		checkFixedWingLanding(item, previous, index);
+	}
+}
 
-			// Geofence function checks against home altitude amsl
-			missionitem.altitude = missionitem.altitude_is_relative ? missionitem.altitude + home_alt : missionitem.altitude;
+void
+MissionFeasibilityChecker::checkTakeoff(const mission_item_s &item, size_t index)
+{
+	// look for a takeoff waypoint
+	if (_takeoff.issue != Issue::None || item.nav_cmd != NAV_CMD_TAKEOFF) {
+		return;
+	}
 
-			if (MissionBlock::item_contains_position(missionitem) && !_navigator->get_geofence().check(missionitem)) {
+	// make sure that the altitude of the waypoint is at least one meter larger than the acceptance radius
+	// this makes sure that the takeoff waypoint is not reached before we are at least one meter in the air
+	const float takeoff_alt = item.altitude_is_relative ? item.altitude : item.altitude - _home_alt;
 
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Geofence violation for waypoint %zu", i + 1);
-				return false;
-			}
-		}
+	// if a specific acceptance radius has been defined, use that one instead of the default
+	float acceptance_radius = _takeoff_acceptance_radius;
+
+	if (item.acceptance_radius > NAV_EPSILON_POSITION) {
+		acceptance_radius = item.acceptance_radius;
 	}
 
-	return true;
+	if (takeoff_alt - 1.0f < acceptance_radius) {
+		_takeoff.issue = Issue::TakeoffTooLow;
+		_takeoff.index = index;
+	}
 }
 
-bool
-MissionFeasibilityChecker::checkHomePositionAltitude(const mission_s &mission, float home_alt, bool home_alt_valid,
-		bool throw_error)
+void
+MissionFeasibilityChecker::checkGeofence(const mission_item_s &item, size_t index)
 {
-	/* Check if all waypoints are above the home altitude */
-	for (size_t i = 0; i < mission.count; i++) {
-		struct mission_item_s missionitem = {};
-		const ssize_t len = sizeof(struct mission_item_s);
-
-		if (dm_read((dm_item_t)mission.dataman_id, i, &missionitem, len) != len) {
-			_navigator->get_mission_result()->warning = true;
-			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-			return false;
+	/* Check if all mission items are inside the geofence (if we have a valid geofence) */
+	if (_geofence.issue != Issue::None || _benchmark_fd >= 0 || !_navigator->get_geofence().valid()) {
+		return;
+	}
+
+	if (item.altitude_is_relative && !_home_valid) {
+		_geofence.issue = Issue::GeofenceHomeRequired;
+		_geofence.index = index;
+		return;
+	}
+
+	if (MissionBlock::item_contains_position(item)) {
+		// Geofence function checks against home altitude amsl
+		mission_item_s item_amsl = item;
+		item_amsl.altitude = item.altitude_is_relative ? item.altitude + _home_alt : item.altitude;
+
+		if (!_navigator->get_geofence().check(item_amsl)) {
+			_geofence.issue = Issue::GeofenceViolation;
+			_geofence.index = index;
 		}
+	}
+}
 
-		/* reject relative alt without home set */
-		if (missionitem.altitude_is_relative && !home_alt_valid && MissionBlock::item_contains_position(missionitem)) {
+void
+MissionFeasibilityChecker::checkHomePositionAltitude(const mission_item_s &item, size_t index)
+{
+	/* Check if all waypoints are above the home altitude, stop at the first one that is not */
+	if (_home_altitude.issue != Issue::None || !MissionBlock::item_contains_position(item)) {
+		return;
+	}
 
-			_navigator->get_mission_result()->warning = true;
+	/* reject relative alt without home set */
+	if (item.altitude_is_relative && !_home_alt_valid) {
+		_home_altitude.issue = Issue::RelativeAltitudeWithoutHome;
+		_home_altitude.index = index;
+		return;
+	}
 
-			if (throw_error) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: No home pos, WP %zu uses rel alt", i + 1);
-				return false;
+	/* calculate the global waypoint altitude */
+	const float wp_alt = item.altitude_is_relative ? item.altitude + _home_alt : item.altitude;
 
-			} else	{
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Warning: No home pos, WP %zu uses rel alt", i + 1);
-				return true;
-			}
-		}
+	if (_home_alt > wp_alt) {
+		_home_altitude.issue = Issue::BelowHome;
+		_home_altitude.index = index;
+	}
+}
 
-		/* calculate the global waypoint altitude */
-		float wp_alt = (missionitem.altitude_is_relative) ? missionitem.altitude + home_alt : missionitem.altitude;
+void
+MissionFeasibilityChecker::checkMissionItemValidity(const mission_item_s &item, size_t index)
+{
+	if (_validity.issue != Issue::None) {
+		return;
+	}
 
-		if ((home_alt > wp_alt) && MissionBlock::item_contains_position(missionitem)) {
+	// do not allow mission if we find unsupported item
+	if (item.nav_cmd != NAV_CMD_IDLE &&
+	    item.nav_cmd != NAV_CMD_WAYPOINT &&
+	    item.nav_cmd != NAV_CMD_LOITER_UNLIMITED &&
+	    item.nav_cmd != NAV_CMD_LOITER_TIME_LIMIT &&
+	    item.nav_cmd != NAV_CMD_RETURN_TO_LAUNCH &&
+	    item.nav_cmd != NAV_CMD_LAND &&
+	    item.nav_cmd != NAV_CMD_TAKEOFF &&
+	    item.nav_cmd != NAV_CMD_LOITER_TO_ALT &&
+	    item.nav_cmd != NAV_CMD_VTOL_TAKEOFF &&
+	    item.nav_cmd != NAV_CMD_VTOL_LAND &&
+	    item.nav_cmd != NAV_CMD_DELAY &&
+	    item.nav_cmd != NAV_CMD_DO_JUMP &&
+	    item.nav_cmd != NAV_CMD_DO_CHANGE_SPEED &&
+	    item.nav_cmd != NAV_CMD_DO_SET_HOME &&
+	    item.nav_cmd != NAV_CMD_DO_SET_SERVO &&
+	    item.nav_cmd != NAV_CMD_DO_LAND_START &&
+	    item.nav_cmd != NAV_CMD_DO_TRIGGER_CONTROL &&
+	    item.nav_cmd != NAV_CMD_DO_DIGICAM_CONTROL &&
+	    item.nav_cmd != NAV_CMD_IMAGE_START_CAPTURE &&
+	    item.nav_cmd != NAV_CMD_IMAGE_STOP_CAPTURE &&
+	    item.nav_cmd != NAV_CMD_VIDEO_START_CAPTURE &&
+	    item.nav_cmd != NAV_CMD_VIDEO_STOP_CAPTURE &&
+	    item.nav_cmd != NAV_CMD_DO_MOUNT_CONFIGURE &&
+	    item.nav_cmd != NAV_CMD_DO_MOUNT_CONTROL &&
+	    item.nav_cmd != NAV_CMD_DO_SET_ROI &&
+	    item.nav_cmd != NAV_CMD_DO_SET_ROI_LOCATION &&
+	    item.nav_cmd != NAV_CMD_DO_SET_ROI_WPNEXT_OFFSET &&
+	    item.nav_cmd != NAV_CMD_DO_SET_ROI_NONE &&
+	    item.nav_cmd != NAV_CMD_DO_SET_CAM_TRIGG_DIST &&
+	    item.nav_cmd != NAV_CMD_DO_SET_CAM_TRIGG_INTERVAL &&
+	    item.nav_cmd != NAV_CMD_SET_CAMERA_MODE &&
+	    item.nav_cmd != NAV_CMD_DO_VTOL_TRANSITION) {
+
+		_validity.issue = Issue::UnsupportedCommand;
+		_validity.index = index;
+		_validity.value[0] = item.nav_cmd;
+		return;
+	}
 
-			_navigator->get_mission_result()->warning = true;
+	/* Check non navigation item */
+	if (item.nav_cmd == NAV_CMD_DO_SET_SERVO) {
 
-			if (throw_error) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: Waypoint %zu below home", i + 1);
-				return false;
+		/* check actuator number */
+		if (item.params[0] < 0 || item.params[0] > 5) {
+			_validity.issue = Issue::ActuatorNumber;
+			_validity.index = index;
+			_validity.value[0] = (int)item.params[0];
+			return;
+		}
 
-			} else	{
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Warning: Waypoint %zu below home", i + 1);
-				return true;
-			}
+		/* check actuator value */
+		if (item.params[1] < -PWM_DEFAULT_MAX || item.params[1] > PWM_DEFAULT_MAX) {
+			_validity.issue = Issue::ActuatorValue;
+			_validity.index = index;
+			_validity.value[0] = (int)item.params[1];
+			return;
 		}
 	}
 
-	return true;
+	// check if the mission starts with a land command while the vehicle is landed
+	if ((index == 0) && item.nav_cmd == NAV_CMD_LAND && _navigator->get_land_detected()->landed) {
+		_validity.issue = Issue::StartsWithLanding;
+		_validity.index = index;
+	}
 }
 
-bool
-MissionFeasibilityChecker::checkMissionItemValidity(const mission_s &mission)
+void
+MissionFeasibilityChecker::checkFixedWingLanding(const mission_item_s &item, const mission_item_s *previous,
+		size_t index)
 {
-	// do not allow mission if we find unsupported item
-	for (size_t i = 0; i < mission.count; i++) {
-		struct mission_item_s missionitem;
-		const ssize_t len = sizeof(struct mission_item_s);
-
-		if (dm_read((dm_item_t)mission.dataman_id, i, &missionitem, len) != len) {
-			// not supposed to happen unless the datamanager can't access the SD card, etc.
-			mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: Cannot access SD card");
-			return false;
-		}
+	/* Go through all mission items and search for a landing waypoint
+	 * if landing waypoint is found: the previous waypoint is checked to be at a feasible distance and altitude given the landing slope */
 
-		// check if we find unsupported items and reject mission if so
-		if (missionitem.nav_cmd != NAV_CMD_IDLE &&
-		    missionitem.nav_cmd != NAV_CMD_WAYPOINT &&
-		    missionitem.nav_cmd != NAV_CMD_LOITER_UNLIMITED &&
-		    missionitem.nav_cmd != NAV_CMD_LOITER_TIME_LIMIT &&
-		    missionitem.nav_cmd != NAV_CMD_RETURN_TO_LAUNCH &&
-		    missionitem.nav_cmd != NAV_CMD_LAND &&
-		    missionitem.nav_cmd != NAV_CMD_TAKEOFF &&
-		    missionitem.nav_cmd != NAV_CMD_LOITER_TO_ALT &&
-		    missionitem.nav_cmd != NAV_CMD_VTOL_TAKEOFF &&
-		    missionitem.nav_cmd != NAV_CMD_VTOL_LAND &&
-		    missionitem.nav_cmd != NAV_CMD_DELAY &&
-		    missionitem.nav_cmd != NAV_CMD_DO_JUMP &&
-		    missionitem.nav_cmd != NAV_CMD_DO_CHANGE_SPEED &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_HOME &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_SERVO &&
-		    missionitem.nav_cmd != NAV_CMD_DO_LAND_START &&
-		    missionitem.nav_cmd != NAV_CMD_DO_TRIGGER_CONTROL &&
-		    missionitem.nav_cmd != NAV_CMD_DO_DIGICAM_CONTROL &&
-		    missionitem.nav_cmd != NAV_CMD_IMAGE_START_CAPTURE &&
-		    missionitem.nav_cmd != NAV_CMD_IMAGE_STOP_CAPTURE &&
-		    missionitem.nav_cmd != NAV_CMD_VIDEO_START_CAPTURE &&
-		    missionitem.nav_cmd != NAV_CMD_VIDEO_STOP_CAPTURE &&
-		    missionitem.nav_cmd != NAV_CMD_DO_MOUNT_CONFIGURE &&
-		    missionitem.nav_cmd != NAV_CMD_DO_MOUNT_CONTROL &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_ROI &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_ROI_LOCATION &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_ROI_WPNEXT_OFFSET &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_ROI_NONE &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_CAM_TRIGG_DIST &&
-		    missionitem.nav_cmd != NAV_CMD_DO_SET_CAM_TRIGG_INTERVAL &&
-		    missionitem.nav_cmd != NAV_CMD_SET_CAMERA_MODE &&
-		    missionitem.nav_cmd != NAV_CMD_DO_VTOL_TRANSITION) {
-
-			mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: item %i: unsupported cmd: %d", (int)(i + 1),
-					     (int)missionitem.nav_cmd);
-			return false;
+	if (_landing.issue != Issue::None) {
+		return;
+	}
+
+	// if DO_LAND_START found then require valid landing AFTER
+	if (item.nav_cmd == NAV_CMD_DO_LAND_START) {
+		if (_land_start_found) {
+			_landing.issue = Issue::MultipleLandStart;
+			_landing.index = index;
+			return;
+
+		} else {
+			_land_start_found = true;
+			_do_land_start_index = index;
 		}
+	}
 
-		/* Check non navigation item */
-		if (missionitem.nav_cmd == NAV_CMD_DO_SET_SERVO) {
+	if (item.nav_cmd != NAV_CMD_LAND) {
+		return;
+	}
 
-			/* check actuator number */
-			if (missionitem.params[0] < 0 || missionitem.params[0] > 5) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Actuator number %d is out of bounds 0..5",
-						     (int)missionitem.params[0]);
-				return false;
-			}
+	_landing.index = index;
 
-			/* check actuator value */
-			if (missionitem.params[1] < -PWM_DEFAULT_MAX || missionitem.params[1] > PWM_DEFAULT_MAX) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(),
-						     "Actuator value %d is out of bounds -PWM_DEFAULT_MAX..PWM_DEFAULT_MAX", (int)missionitem.params[1]);
-				return false;
-			}
-		}
+	if (previous == nullptr) {
+		_landing.issue = Issue::StartsWithLand;
+		return;
+	}
 
-		// check if the mission starts with a land command while the vehicle is landed
-		if ((i == 0) && missionitem.nav_cmd == NAV_CMD_LAND && _navigator->get_land_detected()->landed) {
+	_landing_approach_index = index - 1;
 
-			mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: starts with landing");
-			return false;
-		}
+	if (!MissionBlock::item_contains_position(*previous)) {
+		// mission item before land doesn't have a position
+		_landing.issue = Issue::NeedLandingApproach;
+		return;
 	}
 
-	return true;
-}
+	uORB::Subscription<position_controller_landing_status_s> landing_status{ORB_ID(position_controller_landing_status)};
+	landing_status.forcedUpdate();
 
-bool
-MissionFeasibilityChecker::checkFixedWingTakeoff(const mission_s &mission, float home_alt, bool home_alt_valid)
-{
-	for (size_t i = 0; i < mission.count; i++) {
-		struct mission_item_s missionitem = {};
-		const ssize_t len = sizeof(struct mission_item_s);
+	const bool landing_status_valid = (landing_status.get().timestamp > 0);
+	const float wp_distance = get_distance_to_next_waypoint(previous->lat, previous->lon, item.lat, item.lon);
 
-		if (dm_read((dm_item_t)mission.dataman_id, i, &missionitem, len) != len) {
-			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-			return false;
-		}
+	if (landing_status_valid && (wp_distance > landing_status.get().flare_length)) {
+		/* Last wp is before flare region */
 
-		// look for a takeoff waypoint
-		if (missionitem.nav_cmd == NAV_CMD_TAKEOFF) {
-			// make sure that the altitude of the waypoint is at least one meter larger than the acceptance radius
-			// this makes sure that the takeoff waypoint is not reached before we are at least one meter in the air
+		const float delta_altitude = item.altitude - previous->altitude;
 
-			float takeoff_alt = missionitem.altitude_is_relative
-					    ? missionitem.altitude
-					    : missionitem.altitude - home_alt;
+		if (delta_altitude < 0) {
 
-			// check if we should use default acceptance radius
-			float acceptance_radius = _navigator->get_default_acceptance_radius();
+			const float horizontal_slope_displacement = landing_status.get().horizontal_slope_displacement;
+			const float slope_angle_rad = landing_status.get().slope_angle_rad;
+			const float slope_alt_req = Landingslope::getLandingSlopeAbsoluteAltitude(wp_distance, item.altitude,
+						    horizontal_slope_displacement, slope_angle_rad);
 
-			if (missionitem.acceptance_radius > NAV_EPSILON_POSITION) {
-				acceptance_radius = missionitem.acceptance_radius;
-			}
+			if (previous->altitude > slope_alt_req + 1.0f) {
+				/* Landing waypoint is above altitude of slope at the given waypoint distance (with small tolerance for floating point discrepancies) */
+				const float wp_distance_req = Landingslope::getLandingSlopeWPDistance(previous->altitude,
+							      item.altitude, horizontal_slope_displacement, slope_angle_rad);
 
-			if (takeoff_alt - 1.0f < acceptance_radius) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: Takeoff altitude too low!");
-				return false;
+				_landing.issue = Issue::LandingApproach;
+				_landing.value[0] = (int)ceilf(slope_alt_req - previous->altitude);
+				_landing.value[1] = (int)ceilf(wp_distance_req - wp_distance);
+				return;
 			}
+
+		} else {
+			/* Landing waypoint is above last waypoint */
+			_landing.issue = Issue::LandingAboveLastWaypoint;
+			return;
 		}
+
+	} else {
+		/* Last wp is in flare region */
+		_landing.issue = Issue::LandingWithinFlare;
+		return;
 	}
 
-	// all checks have passed
-	return true;
+	_landing_valid = true;
 }
 
-bool
-MissionFeasibilityChecker::checkFixedWingLanding(const mission_s &mission, bool land_start_req)
+void
+MissionFeasibilityChecker::checkFixedWingLandingEnd()
 {
-	/* Go through all mission items and search for a landing waypoint
-	 * if landing waypoint is found: the previous waypoint is checked to be at a feasible distance and altitude given the landing slope */
+	if (_landing.issue != Issue::None) {
+		return;
+	}
 
-	bool landing_valid = false;
+	if (_land_start_req && !_land_start_found) {
+		_landing.issue = Issue::LandStartRequired;
 
-	bool land_start_found = false;
-	size_t do_land_start_index = 0;
-	size_t landing_approach_index = 0;
+	} else if (_land_start_found && (!_landing_valid || (_do_land_start_index > _landing_approach_index))) {
+		_landing.issue = Issue::InvalidLandStart;
+	}
 
-	for (size_t i = 0; i < mission.count; i++) {
-		struct mission_item_s missionitem;
-		const ssize_t len = sizeof(missionitem);
+	/* No landing waypoints or no waypoints */
+}
 
-		if (dm_read((dm_item_t)mission.dataman_id, i, &missionitem, len) != len) {
-			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-			return false;
-		}
+void
+MissionFeasibilityChecker::checkDistanceToFirstWaypoint(const mission_item_s &item, size_t index)
+{
+	if (_max_distance_to_1st_waypoint <= 0.0f) {
+		/* param not set, check is ok */
+		return;
+	}
 
-		// if DO_LAND_START found then require valid landing AFTER
-		if (missionitem.nav_cmd == NAV_CMD_DO_LAND_START) {
-			if (land_start_found) {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: more than one land start.");
-				return false;
+	/* check only the first item with valid lat/lon */
+	if (_first_waypoint_done || !MissionBlock::item_contains_position(item)) {
+		return;
+	}
 
-			} else {
-				land_start_found = true;
-				do_land_start_index = i;
-			}
-		}
+	_first_waypoint_done = true;
 
-		if (missionitem.nav_cmd == NAV_CMD_LAND) {
-			mission_item_s missionitem_previous {};
+	/* check distance from current position to item */
+	const float dist_to_1wp = get_distance_to_next_waypoint(item.lat, item.lon,
+				  _navigator->get_home_position()->lat, _navigator->get_home_position()->lon);
 
-			if (i > 0) {
-				landing_approach_index = i - 1;
+	if (dist_to_1wp >= _max_distance_to_1st_waypoint) {
+		/* item is too far from home */
+		_first_waypoint.issue = Issue::FirstWaypointTooFar;
+		_first_waypoint.index = index;
+		_first_waypoint.value[0] = (int)dist_to_1wp;
+		_first_waypoint.value[1] = (int)_max_distance_to_1st_waypoint;
+	}
+}
 
-				if (dm_read((dm_item_t)mission.dataman_id, landing_approach_index, &missionitem_previous, len) != len) {
-					/* not supposed to happen unless the datamanager can't access the SD card, etc. */
-					return false;
-				}
+void
+MissionFeasibilityChecker::checkDistancesBetweenWaypoints(const mission_item_s &item, size_t index)
+{
+	if (_max_distance_between_waypoints <= 0.0f) {
+		/* param not set, check is ok */
+		return;
+	}
 
-				if (MissionBlock::item_contains_position(missionitem_previous)) {
+	/* check only items with valid lat/lon */
+	if (_distances.issue != Issue::None || !MissionBlock::item_contains_position(item)) {
+		return;
+	}
 
-					uORB::Subscription<position_controller_landing_status_s> landing_status{ORB_ID(position_controller_landing_status)};
-					landing_status.forcedUpdate();
+	/* Compare it to last waypoint if already available. */
+	if (_have_last_position) {
+		const float dist_between_waypoints = get_distance_to_next_waypoint(item.lat, item.lon, _last_lat, _last_lon);
 
-					const bool landing_status_valid = (landing_status.get().timestamp > 0);
-					const float wp_distance = get_distance_to_next_waypoint(missionitem_previous.lat, missionitem_previous.lon,
-								  missionitem.lat, missionitem.lon);
+		if (dist_between_waypoints > _max_distance_between_waypoints) {
+			_distances.issue = Issue::WaypointsTooFar;
+			_distances.index = index;
+			_distances.value[0] = (int)dist_between_waypoints;
+			_distances.value[1] = (int)_max_distance_between_waypoints;
+			return;
+		}
+	}
 
-					if (landing_status_valid && (wp_distance > landing_status.get().flare_length)) {
-						/* Last wp is before flare region */
+	_last_lat = item.lat;
+	_last_lon = item.lon;
+	_have_last_position = true;
+}
 
-						const float delta_altitude = missionitem.altitude - missionitem_previous.altitude;
+bool
+MissionFeasibilityChecker::report(const Finding &finding, bool throw_error)
+{
+	orb_advert_t *mavlink_log_pub = _navigator->get_mavlink_log_pub();
+	const size_t wp = finding.index + 1;
 
-						if (delta_altitude < 0) {
+	switch (finding.issue) {
+	case Issue::None:
+		return true;
 
-							const float horizontal_slope_displacement = landing_status.get().horizontal_slope_displacement;
-							const float slope_angle_rad = landing_status.get().slope_angle_rad;
-							const float slope_alt_req = Landingslope::getLandingSlopeAbsoluteAltitude(wp_distance, missionitem.altitude,
-										    horizontal_slope_displacement, slope_angle_rad);
+	case Issue::FirstWaypointTooFar:
+		mavlink_log_critical(mavlink_log_pub, "First waypoint too far away: %d meters, %d max.",
+				     finding.value[0], finding.value[1]);
+		_navigator->get_mission_result()->warning = true;
+		break;
 
-							if (missionitem_previous.altitude > slope_alt_req + 1.0f) {
-								/* Landing waypoint is above altitude of slope at the given waypoint distance (with small tolerance for floating point discrepancies) */
-								mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: adjust landing approach.");
+	case Issue::UnsupportedCommand:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: item %i: unsupported cmd: %d", (int)wp, finding.value[0]);
+		break;
 
-								const float wp_distance_req = Landingslope::getLandingSlopeWPDistance(missionitem_previous.altitude,
-											      missionitem.altitude, horizontal_slope_displacement, slope_angle_rad);
+	case Issue::ActuatorNumber:
+		mavlink_log_critical(mavlink_log_pub, "Actuator number %d is out of bounds 0..5", finding.value[0]);
+		break;
 
-								mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Move down %d m or move further away by %d m.",
-										     (int)ceilf(slope_alt_req - missionitem_previous.altitude),
-										     (int)ceilf(wp_distance_req - wp_distance));
+	case Issue::ActuatorValue:
+		mavlink_log_critical(mavlink_log_pub, "Actuator value %d is out of bounds -PWM_DEFAULT_MAX..PWM_DEFAULT_MAX",
+				     finding.value[0]);
+		break;
 
-								return false;
-							}
+	case Issue::StartsWithLanding:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: starts with landing");
+		break;
 
-						} else {
-							/* Landing waypoint is above last waypoint */
-							mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: landing above last waypoint.");
-							return false;
-						}
+	case Issue::WaypointsTooFar:
+		mavlink_log_critical(mavlink_log_pub, "Distance between waypoints too far: %d meters, %d max.",
+				     finding.value[0], finding.value[1]);
+		_navigator->get_mission_result()->warning = true;
+		break;
 
-					} else {
-						/* Last wp is in flare region */
-						mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: waypoint within landing flare.");
-						return false;
-					}
+	case Issue::GeofenceHomeRequired:
+		mavlink_log_critical(mavlink_log_pub, "Geofence requires valid home position");
+		break;
 
-					landing_valid = true;
+	case Issue::GeofenceViolation:
+		mavlink_log_critical(mavlink_log_pub, "Geofence violation for waypoint %zu", wp);
+		break;
 
-				} else {
-					// mission item before land doesn't have a position
-					mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: need landing approach.");
-					return false;
-				}
+	case Issue::RelativeAltitudeWithoutHome:
+		_navigator->get_mission_result()->warning = true;
 
-			} else {
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: starts with land waypoint.");
-				return false;
-			}
+		if (!throw_error) {
+			mavlink_log_critical(mavlink_log_pub, "Warning: No home pos, WP %zu uses rel alt", wp);
+			return true;
 		}
-	}
 
-	if (land_start_req && !land_start_found) {
-		mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: land start required.");
-		return false;
-	}
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: No home pos, WP %zu uses rel alt", wp);
+		break;
 
-	if (land_start_found && (!landing_valid || (do_land_start_index > landing_approach_index))) {
-		mavlink_log_critical(_navigator->get_mavlink_log_pub(), "Mission rejected: invalid land start.");
-		return false;
-	}
+	case Issue::BelowHome:
+		_navigator->get_mission_result()->warning = true;
 
-	/* No landing waypoints or no waypoints */
-	return true;
-}
+		if (!throw_error) {
+			mavlink_log_critical(mavlink_log_pub, "Warning: Waypoint %zu below home", wp);
+			return true;
+		}
 
-bool
-MissionFeasibilityChecker::checkDistanceToFirstWaypoint(const mission_s &mission, float max_distance)
-{
-	if (max_distance <= 0.0f) {
-		/* param not set, check is ok */
-		return true;
-	}
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: Waypoint %zu below home", wp);
+		break;
 
-	/* find first waypoint (with lat/lon) item in datamanager */
-	for (size_t i = 0; i < mission.count; i++) {
+	case Issue::TakeoffTooLow:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: Takeoff altitude too low!");
+		break;
 
-		struct mission_item_s mission_item {};
+	case Issue::MultipleLandStart:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: more than one land start.");
+		break;
 
-		if (!(dm_read((dm_item_t)mission.dataman_id, i, &mission_item, sizeof(mission_item_s)) == sizeof(mission_item_s))) {
-			/* error reading, mission is invalid */
-			mavlink_log_info(_navigator->get_mavlink_log_pub(), "Error reading offboard mission.");
-			return false;
-		}
+	case Issue::LandingApproach:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: adjust landing approach.");
+		mavlink_log_critical(mavlink_log_pub, "Move down %d m or move further away by %d m.",
+				     finding.value[0], finding.value[1]);
+		break;
 
-		/* check only items with valid lat/lon */
-		if (!MissionBlock::item_contains_position(mission_item)) {
-			continue;
-		}
+	case Issue::LandingAboveLastWaypoint:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: landing above last waypoint.");
+		break;
 
-		/* check distance from current position to item */
-		float dist_to_1wp = get_distance_to_next_waypoint(
-					    mission_item.lat, mission_item.lon,
-					    _navigator->get_home_position()->lat, _navigator->get_home_position()->lon);
+	case Issue::LandingWithinFlare:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: waypoint within landing flare.");
+		break;
 
-		if (dist_to_1wp < max_distance) {
+	case Issue::NeedLandingApproach:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: need landing approach.");
+		break;
 
-			return true;
+	case Issue::StartsWithLand:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: starts with land waypoint.");
+		break;
 
-		} else {
-			/* item is too far from home */
-			mavlink_log_critical(_navigator->get_mavlink_log_pub(),
-					     "First waypoint too far away: %d meters, %d max.",
-					     (int)dist_to_1wp, (int)max_distance);
+	case Issue::LandStartRequired:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: land start required.");
+		break;
 
-			_navigator->get_mission_result()->warning = true;
-			return false;
-		}
+	case Issue::InvalidLandStart:
+		mavlink_log_critical(mavlink_log_pub, "Mission rejected: invalid land start.");
+		break;
 	}
 
-	/* no waypoints found in mission, then we will not fly far away */
-	return true;
+	return false;
 }
 
-bool
-MissionFeasibilityChecker::checkDistancesBetweenWaypoints(const mission_s &mission, float max_distance)
+int
+MissionFeasibilityChecker::benchmark(unsigned num_items, unsigned iterations)
 {
-	if (max_distance <= 0.0f) {
-		/* param not set, check is ok */
-		return true;
+	if (num_items < 2 || num_items > NUM_MISSIONS_SUPPORTED || iterations == 0) {
+		PX4_ERR("invalid number of items (2..%u)", (unsigned)NUM_MISSIONS_SUPPORTED);
+		return -1;
 	}
 
-	double last_lat = (double)NAN;
-	double last_lon = (double)NAN;
+	double lat = 47.397742;
+	double lon = 8.545594;
 
-	/* Go through all waypoints */
-	for (size_t i = 0; i < mission.count; i++) {
+	if (_navigator->home_position_valid()) {
+		lat = _navigator->get_home_position()->lat;
+		lon = _navigator->get_home_position()->lon;
+	}
 
-		struct mission_item_s mission_item {};
+	// use a scratch file instead of dataman, so that no mission slot can be overwritten
+	static constexpr const char *scratch_file = PX4_STORAGEDIR "/feasibility_benchmark.tmp";
+	mission_item_s *items = new mission_item_s[READ_CHUNK_SIZE];
 
-		if (!(dm_read((dm_item_t)mission.dataman_id, i, &mission_item, sizeof(mission_item_s)) == sizeof(mission_item_s))) {
-			/* error reading, mission is invalid */
-			mavlink_log_info(_navigator->get_mavlink_log_pub(), "Error reading offboard mission.");
-			return false;
-		}
+	if (items == nullptr) {
+		PX4_ERR("alloc failed");
+		return -1;
+	}
+
+	_benchmark_fd = ::open(scratch_file, O_CREAT | O_RDWR | O_TRUNC, PX4_O_MODE_666);
+
+	if (_benchmark_fd < 0) {
+		PX4_ERR("cannot create %s", scratch_file);
+		delete[] items;
+		return -1;
+	}
 
-		/* check only items with valid lat/lon */
-		if (!MissionBlock::item_contains_position(mission_item)) {
-			continue;
+	int ret = 0;
+
+	// survey pattern: takeoff, lines of 10 waypoints 20 m apart, land
+	for (unsigned i = 0; i < num_items && ret == 0; i++) {
+		mission_item_s &item = items[i % READ_CHUNK_SIZE];
+		item = {};
+		item.nav_cmd = (i == 0) ? NAV_CMD_TAKEOFF : ((i == num_items - 1) ? NAV_CMD_LAND : NAV_CMD_WAYPOINT);
+		item.frame = NAV_FRAME_GLOBAL_RELATIVE_ALT;
+		item.altitude_is_relative = true;
+		item.altitude = 50.f;
+		item.autocontinue = true;
+		item.origin = ORIGIN_ONBOARD;
+
+		const unsigned line = i / 10;
+		const unsigned column = (line % 2) ? 9 - i % 10 : i % 10;
+		add_vector_to_global_position(lat, lon, line * 20.f, column * 20.f, &item.lat, &item.lon);
+
+		// write out full chunks and the remainder
+		if ((i + 1) % READ_CHUNK_SIZE == 0 || i == num_items - 1) {
+			const unsigned chunk_start = i - i % READ_CHUNK_SIZE;
+			const ssize_t len = (i + 1 - chunk_start) * sizeof(mission_item_s);
+
+			if (::write(_benchmark_fd, items, len) != len) {
+				PX4_ERR("write to %s failed", scratch_file);
+				ret = -1;
+			}
 		}
+	}
 
-		/* Compare it to last waypoint if already available. */
-		if (PX4_ISFINITE(last_lat) && PX4_ISFINITE(last_lon)) {
+	delete[] items;
 
-			/* check distance from current position to item */
-			const float dist_between_waypoints = get_distance_to_next_waypoint(
-					mission_item.lat, mission_item.lon,
-					last_lat, last_lon);
+	mission_s mission{};
+	mission.count = num_items;
 
-			if (dist_between_waypoints > max_distance) {
-				/* item is too far from home */
-				mavlink_log_critical(_navigator->get_mavlink_log_pub(),
-						     "Distance between waypoints too far: %d meters, %d max.",
-						     (int)dist_between_waypoints, (int)max_distance);
+	hrt_abstime elapsed_total = 0;
+	hrt_abstime elapsed_max = 0;
+	bool feasible = false;
 
-				_navigator->get_mission_result()->warning = true;
-				return false;
-			}
-		}
+	for (unsigned i = 0; i < iterations && ret == 0; i++) {
+		const hrt_abstime start = hrt_absolute_time();
+		feasible = checkMissionFeasible(mission, 0.f, 0.f, false);
+		const hrt_abstime elapsed = hrt_elapsed_time(&start);
+		elapsed_total += elapsed;
+		elapsed_max = math::max(elapsed_max, elapsed);
+	}
+
+	::close(_benchmark_fd);
+	_benchmark_fd = -1;
+	unlink(scratch_file);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	PX4_INFO("%u items: %.2f ms avg, %.2f ms max (%u runs, feasible: %s)", num_items,
+		 (double)(elapsed_total / iterations) * 1e-3, (double)elapsed_max * 1e-3, iterations, feasible ? "yes" : "no");
 
-		last_lat = mission_item.lat;
-		last_lon = mission_item.lon;
+	if (!_home_alt_valid) {
+		PX4_WARN("no home altitude: the checks were skipped");
 	}
 
-	/* We ran through all waypoints and have not found any distances between waypoints that are too far. */
-	return true;
+	PX4_INFO("geofence check not included");
+	return 0;
 }
@@ -44,31 +44,120 @@
 #include <dataman/dataman.h>
 #include <uORB/topics/mission.h>
 
+#include "navigation.h"
+
 class Geofence;
 class Navigator;
 
+/**
+ * All checks run in a single pass over the mission: the items are read from dataman in chunks, with one range
+ * request each, and each item is passed to all checks. A check stops at the first problem it finds, and the
+ * problems are reported after the pass, in the order of the checks (only the first failing check is reported,
+ * except for the fixed wing takeoff and landing checks).
+ */
 class MissionFeasibilityChecker
 {
 private:
 	Navigator *_navigator{nullptr};
 
-	/* Checks for all airframes */
-	bool checkGeofence(const mission_s &mission, float home_alt, bool home_valid);
+	/** number of mission items read from dataman at once */
+	static constexpr int READ_CHUNK_SIZE = 32;
+
+	enum class Issue : uint8_t {
+		None = 0,
+		FirstWaypointTooFar,		///< value: distance, max distance [m]
+		UnsupportedCommand,		///< value: nav_cmd
+		ActuatorNumber,			///< value: actuator number
+		ActuatorValue,			///< value: actuator value
+		StartsWithLanding,
+		WaypointsTooFar,		///< value: distance, max distance [m]
+		GeofenceHomeRequired,
+		GeofenceViolation,
+		RelativeAltitudeWithoutHome,
+		BelowHome,
+		TakeoffTooLow,
+		MultipleLandStart,
+		LandingApproach,		///< value: altitude [m] and distance [m] to move the approach waypoint
+		LandingAboveLastWaypoint,
+		LandingWithinFlare,
+		NeedLandingApproach,
+		StartsWithLand,
+		LandStartRequired,
+		InvalidLandStart,
+	};
+
+	/** first problem found by a check */
+	struct Finding {
+		Issue issue{Issue::None};
+		size_t index{0};	///< mission item index
+		int value[2] {};
+	};
+
+	/* inputs of the current check */
+	float _home_alt{0.f};
+	bool _home_valid{false};
+	bool _home_alt_valid{false};
+	bool _rotary_wing{false};
+	bool _land_start_req{false};
+	float _max_distance_to_1st_waypoint{0.f};
+	float _max_distance_between_waypoints{0.f};
+	float _takeoff_acceptance_radius{0.f};
+
+	/* results */
+	Finding _first_waypoint;
+	Finding _validity;
+	Finding _distances;
+	Finding _geofence;
+	Finding _home_altitude;
+	Finding _takeoff;
+	Finding _landing;
+
+	/* state carried from one item to the next */
+	bool _first_waypoint_done{false};
+	double _last_lat{0.};
+	double _last_lon{0.};
+	bool _have_last_position{false};
+	bool _land_start_found{false};
+	size_t _do_land_start_index{0};
+	size_t _landing_approach_index{0};
+	bool _landing_valid{false};
 
-	bool checkHomePositionAltitude(const mission_s &mission, float home_alt, bool home_alt_valid, bool throw_error);
+	int _benchmark_fd{-1}; ///< benchmark only: items are read from this scratch file, the geofence is not checked
 
-	bool checkMissionItemValidity(const mission_s &mission);
+	void reset();
 
-	bool checkDistanceToFirstWaypoint(const mission_s &mission, float max_distance);
-	bool checkDistancesBetweenWaypoints(const mission_s &mission, float max_distance);
+	/**
+	 * read a block of consecutive mission items
+	 * @return true on success
+	 */
+	bool readItems(const mission_s &mission, size_t start, mission_item_s *items, size_t count);
+
+	/** run all checks on an item. previous is nullptr for the first item */
+	void checkItem(const mission_item_s &item, const mission_item_s *previous, size_t index);
+
+	/**
+	 * @return true if the remaining items cannot change the result anymore: the first check to be reported failed
+	 */
+	bool concluded() const;
+
+	/* Checks for all airframes */
+	void checkGeofence(const mission_item_s &item, size_t index);
+	void checkHomePositionAltitude(const mission_item_s &item, size_t index);
+	void checkMissionItemValidity(const mission_item_s &item, size_t index);
+	void checkDistanceToFirstWaypoint(const mission_item_s &item, size_t index);
+	void checkDistancesBetweenWaypoints(const mission_item_s &item, size_t index);
+	void checkTakeoff(const mission_item_s &item, size_t index);
 
 	/* Checks specific to fixedwing airframes */
-	bool checkFixedwing(const mission_s &mission, float home_alt, bool home_alt_valid, bool land_start_req);
-	bool checkFixedWingTakeoff(const mission_s &mission, float home_alt, bool home_alt_valid);
-	bool checkFixedWingLanding(const mission_s &mission, bool land_start_req);
+	void checkFixedWingLanding(const mission_item_s &item, const mission_item_s *previous, size_t index);
+	void checkFixedWingLandingEnd();
 
-	/* Checks specific to rotarywing airframes */
-	bool checkRotarywing(const mission_s &mission, float home_alt, bool home_alt_valid);
+	/**
+	 * report a finding to the user
+	 * @param throw_error false to only warn (used for the home altitude check)
+	 * @return true if the check passed
+	 */
+	bool report(const Finding &finding, bool throw_error = true);
 
 public:
 	MissionFeasibilityChecker(Navigator *navigator) : _navigator(navigator) {}
@@ -84,5 +173,10 @@ public:
 				  float max_distance_to_1st_waypoint, float max_distance_between_waypoints,
 				  bool land_start_req);
 
+	/**
+	 * Write a survey mission with num_items items to a scratch file, and time the check of it.
+	 * Dataman and the geofence state are not touched, the geofence check is not part of the timing.
+	 * @return 0 on success
+	 */
+	int benchmark(unsigned num_items, unsigned iterations);
 };
-
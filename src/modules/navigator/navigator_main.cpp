@@ -1206,6 +1206,9 @@ controller.
 	PRINT_MODULE_USAGE_COMMAND("start");
 	PRINT_MODULE_USAGE_COMMAND_DESCR("fencefile", "load a geofence file from SD card, stored at etc/geofence.txt");
 	PRINT_MODULE_USAGE_COMMAND_DESCR("fake_traffic", "publishes 3 fake transponder_report_s uORB messages");
+	PRINT_MODULE_USAGE_COMMAND_DESCR("feasibility_benchmark",
+					 "time the mission feasibility check on a synthetic survey (without geofence)");
+	PRINT_MODULE_USAGE_ARG("<num_items>", "Number of mission items (default 1000)", true);
 	PRINT_MODULE_USAGE_DEFAULT_COMMANDS();
 
 	return 0;
@@ -1227,6 +1230,11 @@ int Navigator::custom_command(int argc, char *argv[])
 		get_instance()->fake_traffic("LX55", 1000, 0, 0, 100.0f, 90.0f, 0.001f);
 		get_instance()->fake_traffic("LX20", 15000, 1.0f, -1.0f, 280.0f, 90.0f, 0.001f);
 		return 0;
+
+	} else if (!strcmp(argv[0], "feasibility_benchmark")) {
+		const unsigned num_items = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000;
+		MissionFeasibilityChecker checker(get_instance());
+		return checker.benchmark(num_items, 10) == 0 ? 0 : 1;
 	}
 
 	return print_usage("unknown command");
@@ -1248,8 +1256,9 @@ Navigator::publish_mission_result()
 		orb_publish(ORB_ID(mission_result), _mission_result_pub, &_mission_result);
 
 	} else {
-		/* advertise and publish */
-		_mission_result_pub = orb_advertise(ORB_ID(mission_result), &_mission_result);
+		/* advertise and publish, navigator is the only publisher: readers can access it in place */
+		_mission_result_pub = orb_advertise_multi_single_writer(ORB_ID(mission_result), &_mission_result, nullptr,
+				      ORB_PRIO_DEFAULT, 1);
 	}
 
 	/* reset some of the flags */
@@ -88,8 +88,10 @@ public:
 	 * Tell the replay module that we want to use replay mode.
 	 * After that, only 'replay start' must be executed (typically the last step after startup).
 	 * @param file_name file name of the used log replay file. Will be copied.
+	 * A compressed log (.ulz) is decompressed to a temporary .ulg file first.
+	 * @return 0 on success, <0 if the log could not be decompressed
 	 */
-	static void setupReplayFile(const char *file_name);
+	static int setupReplayFile(const char *file_name);
 
 	static bool isSetup() { return _replay_file; }
 
@@ -262,6 +264,14 @@ private:
 
 	void setUserParams(const char *filename);
 
+	/**
+	 * Decompress a compressed ULog container (@see ULOG_COMPRESSED_MAGIC)
+	 * @param file_name input file
+	 * @param decompressed_file_name output file, set if the input is compressed
+	 * @return 1 if the file was decompressed, 0 if it is not compressed, <0 on error
+	 */
+	static int decompressLogFile(const char *file_name, std::string &decompressed_file_name);
+
 	static char *_replay_file;
 };
 
@@ -58,6 +58,7 @@
 #include <string>
 
 #include <logger/messages.h>
+#include <lz4/lz4.h>
 
 // for ekf2 replay
 #include <uORB/topics/airspeed.h>
@@ -124,13 +125,108 @@ Replay::~Replay()
 	_subscriptions.clear();
 }
 
-void Replay::setupReplayFile(const char *file_name)
+int Replay::setupReplayFile(const char *file_name)
 {
 	if (_replay_file) {
 		free(_replay_file);
+		_replay_file = nullptr;
 	}
 
-	_replay_file = strdup(file_name);
+	// the replay seeks back and forth in the file, so compressed logs are decompressed upfront
+	string decompressed_file_name;
+	int ret = decompressLogFile(file_name, decompressed_file_name);
+
+	if (ret < 0) {
+		PX4_ERR("Failed to decompress %s", file_name);
+		return ret;
+	}
+
+	if (ret > 0) {
+		PX4_INFO("decompressed log file to %s", decompressed_file_name.c_str());
+		_replay_file = strdup(decompressed_file_name.c_str());
+
+	} else {
+		_replay_file = strdup(file_name);
+	}
+
+	return 0;
+}
+
+int Replay::decompressLogFile(const char *file_name, std::string &decompressed_file_name)
+{
+	ifstream in(file_name, ios::in | ios::binary);
+	const uint8_t compressed_magic[ULOG_COMPRESSED_MAGIC_LEN] = ULOG_COMPRESSED_MAGIC;
+	uint8_t magic[ULOG_COMPRESSED_MAGIC_LEN];
+
+	if (!in.read((char *)magic, sizeof(magic)) || memcmp(magic, compressed_magic, sizeof(magic)) != 0) {
+		return 0;
+	}
+
+	// log001.ulz -> log001_decompressed.ulg
+	decompressed_file_name = file_name;
+	size_t extension = decompressed_file_name.rfind(".ulz");
+
+	if (extension != string::npos) {
+		decompressed_file_name.erase(extension);
+	}
+
+	decompressed_file_name += "_decompressed.ulg";
+
+	ofstream out(decompressed_file_name, ios::out | ios::binary | ios::trunc);
+
+	if (!out.is_open()) {
+		PX4_ERR("Failed to open %s", decompressed_file_name.c_str());
+		return -1;
+	}
+
+	uint8_t data[ULOG_COMPRESSED_BLOCK_MAX];
+	uint8_t raw[ULOG_COMPRESSED_BLOCK_MAX];
+	ulog_compressed_block_s block;
+	bool ok = true;
+
+	while (in.read((char *)&block, sizeof(block))) {
+		if (block.raw_size > ULOG_COMPRESSED_BLOCK_MAX || block.data_size > block.raw_size) {
+			PX4_ERR("Invalid compressed block header");
+			ok = false;
+			break;
+		}
+
+		if (!in.read((char *)data, block.data_size)) {
+			// the file ends in the middle of a block (e.g. a power loss), keep what we have
+			PX4_WARN("Compressed log is truncated");
+			break;
+		}
+
+		if (block.data_size == block.raw_size) {
+			out.write((const char *)data, block.raw_size);
+
+		} else {
+			int n = lz4::decompress(data, block.data_size, raw, sizeof(raw));
+
+			if (n != block.raw_size) {
+				PX4_ERR("Failed to decompress block");
+				ok = false;
+				break;
+			}
+
+			out.write((const char *)raw, n);
+		}
+	}
+
+	out.close();
+
+	if (ok && out.fail()) {
+		PX4_ERR("Failed to write %s", decompressed_file_name.c_str());
+		ok = false;
+	}
+
+	if (!ok) {
+		// do not leave a partial log behind, it could be picked up by a later replay
+		remove(decompressed_file_name.c_str());
+		return -1;
+	}
+
+	return 1;
 }
 
 
@@ -1252,7 +1348,10 @@ int replay_main(int argc, char *argv[])
 
 	if (logfile && !Replay::isSetup()) {
 		PX4_INFO("using replay log file: %s", logfile);
-		Replay::setupReplayFile(logfile);
+
+		if (Replay::setupReplayFile(logfile) != 0) {
+			return 1;
+		}
 	}
 
 	return Replay::main(argc, argv);
@@ -0,0 +1,289 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_log_deferred.cpp
+ * MAVLink text logging for time critical code paths.
+ */
+
+#include "mavlink_log_deferred.h"
+
+#include <px4_log.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <uORB/topics/mavlink_log.h>
+
+#define MAVLINK_LOG_QUEUE_SIZE 5
+
+namespace mavlink_log_deferred
+{
+
+/* list of all registered rings. Only locked on (un)registration and while draining */
+static Ring *_rings = nullptr;
+static pthread_mutex_t _rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+Ring::Ring()
+{
+	pthread_mutex_lock(&_rings_mutex);
+	next = _rings;
+	_rings = this;
+	pthread_mutex_unlock(&_rings_mutex);
+}
+
+Ring::~Ring()
+{
+	pthread_mutex_lock(&_rings_mutex);
+
+	for (Ring **ring = &_rings; *ring != nullptr; ring = &(*ring)->next) {
+		if (*ring == this) {
+			*ring = next;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&_rings_mutex);
+}
+
+bool Ring::pop(Record &record)
+{
+	const uint32_t tail = _tail.load();
+
+	if (tail == _head.load()) {
+		return false;
+	}
+
+	record = _records[tail & (RING_SIZE - 1)];
+
+	// release the slot to the producer
+	_tail.store(tail + 1);
+	return true;
+}
+
+static bool is_integer_conversion(char c)
+{
+	return strchr("diouxXc", c) != nullptr;
+}
+
+int format(const Record &record, char *buf, int buf_len)
+{
+	if (buf_len <= 0) {
+		return 0;
+	}
+
+	const char *fmt = record.site->fmt;
+	int len = 0;
+	int arg = 0;
+
+	while (*fmt != '\0' && len < buf_len - 1) {
+		if (*fmt != '%') {
+			buf[len++] = *fmt++;
+			continue;
+		}
+
+		if (fmt[1] == '%') {
+			buf[len++] = '%';
+			fmt += 2;
+			continue;
+		}
+
+		// extract the conversion specification. The length modifiers are dropped and replaced
+		// according to the stored argument type, so that e.g. '%d' with an int64 argument works.
+		const char *spec_start = fmt;
+		char spec[16];
+		int spec_len = 0;
+		spec[spec_len++] = *fmt++;
+
+		while (*fmt != '\0' && !is_conversion(*fmt)) {
+			if (strchr("hlLqjzt", *fmt) == nullptr && spec_len < (int)sizeof(spec) - 4) {
+				spec[spec_len++] = *fmt;
+			}
+
+			++fmt;
+		}
+
+		if (*fmt == '\0') {
+			break;
+		}
+
+		const char conversion = *fmt++;
+
+		if (arg >= record.num_args || strchr("spn", conversion) != nullptr) {
+			// missing argument or a conversion which needs a pointer: keep the format string literally
+			while (spec_start < fmt && len < buf_len - 1) {
+				buf[len++] = *spec_start++;
+			}
+
+			continue;
+		}
+
+		int ret;
+
+		if (is_integer_conversion(conversion)) {
+			if (conversion != 'c') {
+				spec[spec_len++] = 'l';
+				spec[spec_len++] = 'l';
+			}
+
+			spec[spec_len++] = conversion;
+			spec[spec_len] = '\0';
+
+			long long value;
+
+			switch (record.types[arg]) {
+			case ArgType::INT64: value = record.args[arg].i; break;
+
+			case ArgType::UINT64: value = (long long)record.args[arg].u; break;
+
+			default: value = (long long)record.args[arg].d; break;
+			}
+
+			ret = (conversion == 'c') ? snprintf(buf + len, buf_len - len, spec, (int)value) :
+			      snprintf(buf + len, buf_len - len, spec, value);
+
+		} else {
+			spec[spec_len++] = conversion;
+			spec[spec_len] = '\0';
+
+			double value;
+
+			switch (record.types[arg]) {
+			case ArgType::INT64: value = (double)record.args[arg].i; break;
+
+			case ArgType::UINT64: value = (double)record.args[arg].u; break;
+
+			default: value = record.args[arg].d; break;
+			}
+
+			ret = snprintf(buf + len, buf_len - len, spec, value);
+		}
+
+		++arg;
+
+		if (ret > 0) {
+			len += ret;
+
+			if (len > buf_len - 1) {
+				len = buf_len - 1;
+			}
+		}
+	}
+
+	buf[len] = '\0';
+	return len;
+}
+
+/**
+ * Token bucket per call site.
+ * @return true if the message may be published
+ */
+static bool rate_limit(CallSite &site, hrt_abstime now)
+{
+	if (site.last_refill == 0) {
+		site.tokens = site.burst;
+
+	} else {
+		site.tokens += site.rate * (now - site.last_refill) * 1e-6f;
+
+		if (site.tokens > site.burst) {
+			site.tokens = site.burst;
+		}
+	}
+
+	site.last_refill = now;
+
+	if (site.tokens >= 1.f) {
+		site.tokens -= 1.f;
+		return true;
+	}
+
+	return false;
+}
+
+int drain(orb_advert_t *mavlink_log_pub)
+{
+	if (mavlink_log_pub == nullptr) {
+		return 0;
+	}
+
+	int published = 0;
+	const hrt_abstime now = hrt_absolute_time();
+
+	pthread_mutex_lock(&_rings_mutex);
+
+	for (Ring *ring = _rings; ring != nullptr; ring = ring->next) {
+		Record record;
+
+		while (ring->pop(record)) {
+			// the call site state is only modified here, on the draining thread
+			CallSite &site = *record.site;
+
+			if (!rate_limit(site, now)) {
+				++site.suppressed;
+				continue;
+			}
+
+			mavlink_log_s log_msg{};
+			log_msg.timestamp = record.timestamp;
+			log_msg.severity = site.severity;
+
+			char *text = (char *)log_msg.text;
+			int len = format(record, text, sizeof(log_msg.text));
+
+			if (site.suppressed > 0) {
+				snprintf(text + len, sizeof(log_msg.text) - len, " (+%u)", (unsigned)site.suppressed);
+				site.suppressed = 0;
+			}
+
+			if (site.severity <= _MSG_PRIO_WARNING) {
+				PX4_WARN("%s", text);
+			}
+
+			if (*mavlink_log_pub != nullptr) {
+				orb_publish(ORB_ID(mavlink_log), *mavlink_log_pub, &log_msg);
+
+			} else {
+				*mavlink_log_pub = orb_advertise_queue(ORB_ID(mavlink_log), &log_msg, MAVLINK_LOG_QUEUE_SIZE);
+			}
+
+			++published;
+		}
+	}
+
+	pthread_mutex_unlock(&_rings_mutex);
+
+	return published;
+}
+
+} /* namespace mavlink_log_deferred */
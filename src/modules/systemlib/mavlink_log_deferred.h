@@ -0,0 +1,281 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_log_deferred.h
+ * MAVLink text logging for time critical code paths.
+ *
+ * mavlink_vasprintf() formats the string and publishes a mavlink_log topic in
+ * the context of the caller, which is too expensive for a controller running
+ * at several hundred Hz. The deferred variant only stores a reference to the
+ * call site (which holds the format string) and the raw binary arguments into
+ * a lock-free single-producer/single-consumer ring owned by the calling thread.
+ * Formatting, rate limiting and publication are done later by
+ * mavlink_log_deferred::drain(), which is called from the mavlink main loop.
+ *
+ * Usage:
+ *
+ *   mavlink_log_deferred::Ring _log_ring; // one per producing thread, e.g. a class member
+ *   ...
+ *   mavlink_log_critical_deferred(&_log_ring, "thr_cmd:%.5f", (double)thrust_cmd);
+ *
+ * Only numerical arguments are supported (no strings), since the arguments
+ * are only formatted after the call returned. Pointer arguments and format
+ * strings with %s, %p or %n conversions are rejected at compile time.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include <drivers/drv_hrt.h>
+#include <px4_atomic.h>
+
+#include "mavlink_log.h"
+
+namespace mavlink_log_deferred
+{
+
+static constexpr int MAX_ARGS = 6;	///< maximum number of arguments per message
+static constexpr int RING_SIZE = 16;	///< number of queued messages per ring, must be a power of 2
+
+/** @return true if c ends a conversion specification */
+constexpr bool is_conversion(char c)
+{
+	return c == 'd' || c == 'i' || c == 'o' || c == 'u' || c == 'x' || c == 'X' || c == 'c'
+	       || c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G' || c == 'a' || c == 'A'
+	       || c == 's' || c == 'p' || c == 'n';
+}
+
+/**
+ * Check a format string for conversions which need a pointer argument (%s, %p, %n).
+ * These cannot be deferred, as the pointer might not be valid anymore when the message is formatted.
+ * @param in_spec true while inside a conversion specification
+ */
+constexpr bool has_pointer_conversion(const char *fmt, bool in_spec = false)
+{
+	return *fmt == '\0' ? false :
+	       !in_spec ? (*fmt != '%' ? has_pointer_conversion(fmt + 1) :
+			   fmt[1] == '%' ? has_pointer_conversion(fmt + 2) : has_pointer_conversion(fmt + 1, true)) :
+	       (*fmt == 's' || *fmt == 'p' || *fmt == 'n') ? true :
+	       has_pointer_conversion(fmt + 1, !is_conversion(*fmt));
+}
+
+/**
+ * Static, per call site state. Created by the logging macros, so that each
+ * call site has its own format string (format id) and its own token bucket.
+ */
+struct CallSite {
+	const char *fmt;
+	uint8_t severity;
+	float rate;			///< average number of messages per second that are published
+	float burst;			///< maximum number of messages published in a burst
+
+	/* state below is only accessed from the draining thread */
+	float tokens;
+	hrt_abstime last_refill;
+	uint32_t suppressed;
+};
+
+enum class ArgType : uint8_t {
+	INT64 = 0,
+	UINT64,
+	DOUBLE
+};
+
+struct Record {
+	CallSite *site;
+	hrt_abstime timestamp;
+	uint8_t num_args;
+	ArgType types[MAX_ARGS];
+	union {
+		int64_t i;
+		uint64_t u;
+		double d;
+	} args[MAX_ARGS];
+};
+
+/**
+ * Single producer/single consumer ring of unformatted messages. The producer
+ * is the thread owning the ring, the consumer is drain().
+ * The ring registers itself on construction, which is not real-time safe and
+ * should be done during initialization of the owning module.
+ */
+class Ring
+{
+public:
+	Ring();
+	~Ring();
+
+	Ring(const Ring &) = delete;
+	Ring &operator=(const Ring &) = delete;
+
+	/**
+	 * Queue a message. Real-time safe: no locking, no formatting, no syscalls.
+	 * @return false if the ring is full (the message is dropped and counted)
+	 */
+	template<typename... Args>
+	bool push(CallSite *site, Args... args)
+	{
+		static_assert(sizeof...(Args) <= MAX_ARGS, "too many arguments for deferred mavlink log");
+
+		const uint32_t head = _head.load();
+
+		if (head - _tail.load() >= RING_SIZE) {
+			_dropped.fetch_add(1);
+			return false;
+		}
+
+		Record &record = _records[head & (RING_SIZE - 1)];
+		record.site = site;
+		record.timestamp = hrt_absolute_time();
+		record.num_args = 0;
+		encode(record, args...);
+
+		// publish the record to the consumer
+		_head.store(head + 1);
+		return true;
+	}
+
+	/**
+	 * Pop the oldest record. Must only be called from the consumer.
+	 * @return false if the ring is empty
+	 */
+	bool pop(Record &record);
+
+	uint32_t dropped() const { return _dropped.load(); }
+
+	Ring *next{nullptr};	///< intrusive list of registered rings
+
+private:
+	static void encode(Record &record) { (void)record; }
+
+	template<typename T, typename... Args>
+	static void encode(Record &record, T value, Args... args)
+	{
+		encode_one(record, value);
+		encode(record, args...);
+	}
+
+	template<typename T>
+	static void encode_one(Record &record, T *value)
+	{
+		static_assert(sizeof(T) == 0, "deferred mavlink log does not support pointer/string arguments");
+	}
+
+	static void encode_one(Record &record, double value) { record.types[record.num_args] = ArgType::DOUBLE; record.args[record.num_args++].d = value; }
+	static void encode_one(Record &record, float value) { encode_one(record, (double)value); }
+	static void encode_one(Record &record, long long value) { record.types[record.num_args] = ArgType::INT64; record.args[record.num_args++].i = value; }
+	static void encode_one(Record &record, unsigned long long value) { record.types[record.num_args] = ArgType::UINT64; record.args[record.num_args++].u = value; }
+	static void encode_one(Record &record, long value) { encode_one(record, (long long)value); }
+	static void encode_one(Record &record, unsigned long value) { encode_one(record, (unsigned long long)value); }
+	static void encode_one(Record &record, int value) { encode_one(record, (long long)value); }
+	static void encode_one(Record &record, unsigned value) { encode_one(record, (unsigned long long)value); }
+	static void encode_one(Record &record, short value) { encode_one(record, (long long)value); }
+	static void encode_one(Record &record, unsigned short value) { encode_one(record, (unsigned long long)value); }
+	static void encode_one(Record &record, char value) { encode_one(record, (long long)value); }
+	static void encode_one(Record &record, signed char value) { encode_one(record, (long long)value); }
+	static void encode_one(Record &record, unsigned char value) { encode_one(record, (unsigned long long)value); }
+	static void encode_one(Record &record, bool value) { encode_one(record, (long long)value); }
+
+	Record _records[RING_SIZE];
+
+	px4::atomic<uint32_t> _head{0};	///< written by the producer
+	px4::atomic<uint32_t> _tail{0};	///< written by the consumer
+	px4::atomic<uint32_t> _dropped{0};
+};
+
+/**
+ * Format a record into a string buffer.
+ * @return number of characters written (excluding the terminating 0)
+ */
+int format(const Record &record, char *buf, int buf_len);
+
+/**
+ * Format, rate limit and publish all queued messages of all registered rings.
+ * To be called periodically from a single, non time critical thread.
+ * @param mavlink_log_pub uORB advert of the draining thread
+ * @return number of published messages
+ */
+int drain(orb_advert_t *mavlink_log_pub);
+
+} /* namespace mavlink_log_deferred */
+
+/* default token bucket of the deferred logging macros: 1 message/s, bursts of up to 3 messages */
+#define _MAVLINK_LOG_DEFERRED_RATE	1.0f
+#define _MAVLINK_LOG_DEFERRED_BURST	3.0f
+
+/**
+ * Queue a mavlink message from a time critical context with an explicit rate limit.
+ *
+ * @param _ring		Pointer to the mavlink_log_deferred::Ring of the calling thread;
+ * @param _severity	One of the _MSG_PRIO_* levels;
+ * @param _rate		Maximum average rate of published messages of this call site [Hz];
+ * @param _text		The format string;
+ */
+#define mavlink_log_deferred_rate(_ring, _severity, _rate, _text, ...) \
+	do { \
+		static_assert(!mavlink_log_deferred::has_pointer_conversion(_text), \
+			      "deferred mavlink log does not support %s, %p or %n conversions"); \
+		static mavlink_log_deferred::CallSite _mavlink_log_site{_text, _severity, _rate, _MAVLINK_LOG_DEFERRED_BURST, _MAVLINK_LOG_DEFERRED_BURST, 0, 0}; \
+		(_ring)->push(&_mavlink_log_site, ##__VA_ARGS__); \
+	} while(0)
+
+/**
+ * Queue a mavlink info message from a time critical context (not printed to console).
+ *
+ * @param _ring		Pointer to the mavlink_log_deferred::Ring of the calling thread;
+ * @param _text		The format string;
+ */
+#define mavlink_log_info_deferred(_ring, _text, ...) \
+	mavlink_log_deferred_rate(_ring, _MSG_PRIO_INFO, _MAVLINK_LOG_DEFERRED_RATE, _text, ##__VA_ARGS__)
+
+/**
+ * Queue a mavlink warning message from a time critical context (printed to console when published).
+ *
+ * @param _ring		Pointer to the mavlink_log_deferred::Ring of the calling thread;
+ * @param _text		The format string;
+ */
+#define mavlink_log_warning_deferred(_ring, _text, ...) \
+	mavlink_log_deferred_rate(_ring, _MSG_PRIO_WARNING, _MAVLINK_LOG_DEFERRED_RATE, _text, ##__VA_ARGS__)
+
+/**
+ * Queue a mavlink critical message from a time critical context (printed to console when published).
+ *
+ * @param _ring		Pointer to the mavlink_log_deferred::Ring of the calling thread;
+ * @param _text		The format string;
+ */
+#define mavlink_log_critical_deferred(_ring, _text, ...) \
+	mavlink_log_deferred_rate(_ring, _MSG_PRIO_CRITICAL, _MAVLINK_LOG_DEFERRED_RATE, _text, ##__VA_ARGS__)
@@ -37,7 +37,11 @@
  */
 
 #include "Subscription.hpp"
+#include "uORBDeviceNode.hpp"
+
+#include <drivers/drv_orb_dev.h>
 #include <px4_defines.h>
+#include <px4_posix.h>
 
 namespace uORB
 {
@@ -89,6 +93,29 @@ bool SubscriptionBase::update(void *data)
 	return orb_updated;
 }
 
+const void *SubscriptionBase::borrowBegin(unsigned &generation)
+{
+	if (_node == nullptr) {
+		uintptr_t node = 0;
+		uintptr_t subscriber = 0;
+
+		if (px4_ioctl(_handle, ORBIOCGADVERTISER, (unsigned long)&node) != PX4_OK
+		    || px4_ioctl(_handle, ORBIOCGSUBSCRIBER, (unsigned long)&subscriber) != PX4_OK) {
+			return nullptr;
+		}
+
+		_node = (void *)node;
+		_subscriber = (void *)subscriber;
+	}
+
+	return ((DeviceNode *)_node)->borrow_begin(_subscriber, generation);
+}
+
+bool SubscriptionBase::borrowEnd(unsigned generation)
+{
+	return ((DeviceNode *)_node)->borrow_end(_subscriber, generation);
+}
+
 SubscriptionBase::~SubscriptionBase()
 {
 	if (orb_unsubscribe(_handle) != PX4_OK) {
@@ -89,11 +89,27 @@ public:
 	unsigned getInstance() const { return _instance; }
 
 protected:
+	/**
+	 * Start a zero-copy read of the next message (@see uORB::DeviceNode::borrow_begin()).
+	 * @return the message inside the topic buffer, or nullptr if the publisher does not
+	 * 	use the single-writer mode
+	 */
+	const void *borrowBegin(unsigned &generation);
+
+	/**
+	 * @return true if the borrowed message was not overwritten while it was read
+	 */
+	bool borrowEnd(unsigned generation);
+
 	const struct orb_metadata *_meta;
 
 	unsigned _instance;
 
 	int _handle{-1};
+
+private:
+	void *_node{nullptr}; ///< DeviceNode, resolved on the first borrow
+	void *_subscriber{nullptr};
 };
 
 /**
@@ -182,6 +198,39 @@ public:
 		return orb_copy(_meta, _handle, &_data) == PX4_OK;
 	}
 
+	/**
+	 * Read the latest message without copying it into this subscription.
+	 *
+	 * If the publisher uses the single-writer mode, reader is called on the message
+	 * in the topic buffer. If the message was overwritten meanwhile, or in locked mode,
+	 * it falls back to a copy and reader is called (again) on get(). Thus reader must
+	 * only extract values and not act on them.
+	 *
+	 * @param reader callable taking a const T &
+	 * @return true if a message was read
+	 */
+	template<typename F>
+	bool borrow(F reader)
+	{
+		unsigned generation = 0;
+		const T *msg = (const T *)borrowBegin(generation);
+
+		if (msg != nullptr) {
+			reader(*msg);
+
+			if (borrowEnd(generation)) {
+				return true;
+			}
+		}
+
+		if (forcedUpdate()) {
+			reader(_data);
+			return true;
+		}
+
+		return false;
+	}
+
 	/*
 	 * This function gets the T struct data
 	 * */
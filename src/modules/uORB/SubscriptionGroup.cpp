@@ -0,0 +1,110 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file SubscriptionGroup.cpp
+ *
+ */
+
+#include "SubscriptionGroup.hpp"
+#include "uORBDeviceNode.hpp"
+
+#include <drivers/drv_orb_dev.h>
+#include <px4_posix.h>
+
+namespace uORB
+{
+
+SubscriptionGroup::~SubscriptionGroup()
+{
+	clear();
+}
+
+void SubscriptionGroup::clear()
+{
+	for (int i = 0; i < _count; ++i) {
+		orb_unsubscribe(_handles[i]);
+	}
+
+	_count = 0;
+}
+
+int SubscriptionGroup::add(const struct orb_metadata *meta, void *buffer, unsigned instance)
+{
+	if (_count >= MAX_MEMBERS || meta == nullptr || buffer == nullptr) {
+		return -1;
+	}
+
+	const int handle = (instance > 0) ? orb_subscribe_multi(meta, instance) : orb_subscribe(meta);
+
+	if (handle < 0) {
+		PX4_ERR("%s sub failed", meta->o_name);
+		return -1;
+	}
+
+	uintptr_t node = 0;
+	uintptr_t subscriber = 0;
+
+	if (px4_ioctl(handle, ORBIOCGADVERTISER, (unsigned long)&node) != PX4_OK
+	    || px4_ioctl(handle, ORBIOCGSUBSCRIBER, (unsigned long)&subscriber) != PX4_OK) {
+		PX4_ERR("%s group add failed", meta->o_name);
+		orb_unsubscribe(handle);
+		return -1;
+	}
+
+	const int index = _count++;
+	_handles[index] = handle;
+	_metas[index] = meta;
+	_nodes[index] = (DeviceNode *)node;
+	_subscribers[index] = (void *)subscriber;
+	_buffers[index] = buffer;
+
+	return index;
+}
+
+uint32_t SubscriptionGroup::update(uint32_t mask)
+{
+	return DeviceNode::copy_updated(_nodes, _subscribers, _buffers, _count, mask);
+}
+
+bool SubscriptionGroup::copy(int index)
+{
+	if (index < 0 || index >= _count) {
+		return false;
+	}
+
+	return orb_copy(_metas[index], _handles[index], _buffers[index]) == PX4_OK;
+}
+
+} // namespace uORB
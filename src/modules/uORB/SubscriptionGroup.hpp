@@ -0,0 +1,129 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file SubscriptionGroup.hpp
+ *
+ * A set of subscriptions that are checked and copied together.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <uORB/uORB.h>
+#include <px4_defines.h>
+
+namespace uORB
+{
+
+class DeviceNode;
+
+/**
+ * Group of subscriptions that is updated in one call.
+ *
+ * update() reports which members of the group were published since the last
+ * call and copies the updated ones into their buffers. This replaces a
+ * sequence of orb_check() + orb_copy() syscall pairs with a single pass over
+ * the DeviceNodes.
+ *
+ * Usage:
+ *
+ *   uORB::SubscriptionGroup group;
+ *   const int att = group.add(ORB_ID(vehicle_attitude), &_v_att);
+ *   ...
+ *   const uint32_t updated = group.update();
+ *   if (updated & group.bit(att)) { ... }
+ */
+class __EXPORT SubscriptionGroup
+{
+public:
+	static constexpr int MAX_MEMBERS = 32;
+
+	SubscriptionGroup() = default;
+	~SubscriptionGroup();
+
+	// no copy, assignment, move, move assignment
+	SubscriptionGroup(const SubscriptionGroup &) = delete;
+	SubscriptionGroup &operator=(const SubscriptionGroup &) = delete;
+	SubscriptionGroup(SubscriptionGroup &&) = delete;
+	SubscriptionGroup &operator=(SubscriptionGroup &&) = delete;
+
+	/**
+	 * Subscribe to a topic and add it to the group.
+	 * @param meta topic
+	 * @param buffer destination of the topic data (must be of size meta->o_size and outlive the group)
+	 * @param instance multi-instance index
+	 * @return member index (>= 0) or -1 on error
+	 */
+	int add(const struct orb_metadata *meta, void *buffer, unsigned instance = 0);
+
+	/**
+	 * Unsubscribe all members. On NuttX this must be called from the task that added them.
+	 */
+	void clear();
+
+	/**
+	 * Check all (or a subset of the) members and copy the updated ones into their buffers.
+	 * @param mask bitmask of the members to check (see bit())
+	 * @return bitmask of the members that were updated
+	 */
+	uint32_t update(uint32_t mask = 0xffffffffu);
+
+	/**
+	 * Copy a member unconditionally (e.g. to initialize it).
+	 * @return true on success
+	 */
+	bool copy(int index);
+
+	/**
+	 * @return the subscription handle of a member, e.g. to poll on it
+	 */
+	int handle(int index) const { return (index >= 0 && index < _count) ? _handles[index] : -1; }
+
+	static uint32_t bit(int index) { return (index >= 0 && index < MAX_MEMBERS) ? (1u << index) : 0u; }
+
+	int count() const { return _count; }
+
+private:
+	int _count{0};
+
+	int _handles[MAX_MEMBERS] {};
+	const orb_metadata *_metas[MAX_MEMBERS] {};
+	DeviceNode *_nodes[MAX_MEMBERS] {};
+	void *_subscribers[MAX_MEMBERS] {};
+	void *_buffers[MAX_MEMBERS] {};
+};
+
+} // namespace uORB
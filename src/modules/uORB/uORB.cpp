@@ -62,6 +62,12 @@ orb_advert_t orb_advertise_multi_queue(const struct orb_metadata *meta, const vo
 	return uORB::Manager::get_instance()->orb_advertise_multi(meta, data, instance, priority, queue_size);
 }
 
+orb_advert_t orb_advertise_multi_single_writer(const struct orb_metadata *meta, const void *data, int *instance,
+		int priority, unsigned int queue_size)
+{
+	return uORB::Manager::get_instance()->orb_advertise_multi(meta, data, instance, priority, queue_size, true);
+}
+
 int orb_unadvertise(orb_advert_t handle)
 {
 	return uORB::Manager::get_instance()->orb_unadvertise(handle);
@@ -156,6 +156,13 @@ extern orb_advert_t orb_advertise_multi(const struct orb_metadata *meta, const v
 extern orb_advert_t orb_advertise_multi_queue(const struct orb_metadata *meta, const void *data, int *instance,
 		int priority, unsigned int queue_size) __EXPORT;
 
+/**
+ * Advertise as the only publisher of a topic instance, in lockless mode.
+ * @see uORB::Manager::orb_advertise_multi()
+ */
+extern orb_advert_t orb_advertise_multi_single_writer(const struct orb_metadata *meta, const void *data, int *instance,
+		int priority, unsigned int queue_size) __EXPORT;
+
 /**
  * @see uORB::Manager::orb_unadvertise()
  */
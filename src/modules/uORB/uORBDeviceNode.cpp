@@ -154,6 +154,10 @@ uORB::DeviceNode::close(cdev::file_t *filp)
 				hrt_cancel(&sd->update_interval->update_call);
 			}
 
+			if (sd == _update_flag_owner) {
+				set_update_flag_owner(sd, nullptr);
+			}
+
 			remove_internal_subscriber();
 
 			delete sd;
@@ -179,11 +183,27 @@ uORB::DeviceNode::read(cdev::file_t *filp, char *buffer, size_t buflen)
 		return -EIO;
 	}
 
+	if (_single_writer) {
+		/* the copy is validated against the generation instead of locking */
+		copy_lockless(sd, buffer);
+		return _meta->o_size;
+	}
+
 	/*
 	 * Perform an atomic copy & state update
 	 */
 	ATOMIC_ENTER;
 
+	copy_locked(sd, buffer);
+
+	ATOMIC_LEAVE;
+
+	return _meta->o_size;
+}
+
+void
+uORB::DeviceNode::copy_locked(SubscriberData *sd, void *buffer)
+{
 	if (_generation > sd->generation + _queue_size) {
 		/* Reader is too far behind: some messages are lost */
 		_lost_messages += _generation - (sd->generation + _queue_size);
@@ -212,9 +232,157 @@ uORB::DeviceNode::read(cdev::file_t *filp, char *buffer, size_t buflen)
 	 */
 	sd->set_update_reported(false);
 
-	ATOMIC_LEAVE;
+	rearm_update_flag(sd);
+}
 
-	return _meta->o_size;
+void
+uORB::DeviceNode::copy_lockless(SubscriberData *sd, void *buffer)
+{
+	/*
+	 * The ring has one more slot than the queue size: the writer fills the slot after the
+	 * newest message, which is not readable until the generation is incremented. A slot
+	 * can only be overwritten while we copy it if the writer laps us, in which case we
+	 * retry with a newer message.
+	 */
+	const unsigned slots = _queue_size + 1u;
+
+	for (;;) {
+		const unsigned generation = __atomic_load_n(&_generation, __ATOMIC_ACQUIRE);
+		unsigned sd_generation = sd->generation;
+
+		if (generation == 0) {
+			/* allocated but not yet published */
+			return;
+		}
+
+		if (generation > sd_generation + _queue_size) {
+			/* Reader is too far behind: some messages are lost */
+			__atomic_fetch_add(&_lost_messages, generation - (sd_generation + _queue_size), __ATOMIC_RELAXED);
+			sd_generation = generation - _queue_size;
+		}
+
+		if (generation == sd_generation) {
+			/* The subscriber already read the latest message, but nothing new was published yet.
+			 * Return the previous message
+			 */
+			--sd_generation;
+		}
+
+		if (nullptr != buffer) {
+			memcpy(buffer, _data + (_meta->o_size * (sd_generation % slots)), _meta->o_size);
+
+			/* order the copy before re-checking the generation */
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+			if (__atomic_load_n(&_generation, __ATOMIC_RELAXED) > sd_generation + _queue_size) {
+				/* the slot was reused during the copy */
+				continue;
+			}
+		}
+
+		sd->generation = sd_generation + 1;
+		break;
+	}
+
+	sd->set_update_reported(false);
+
+	rearm_update_flag(sd);
+}
+
+const void *
+uORB::DeviceNode::borrow_begin(void *subscriber, unsigned &generation) const
+{
+	const SubscriberData *sd = (const SubscriberData *)subscriber;
+
+	if (!_single_writer || sd == nullptr) {
+		return nullptr;
+	}
+
+	const unsigned last_generation = __atomic_load_n(&_generation, __ATOMIC_ACQUIRE);
+
+	if (last_generation == 0) {
+		return nullptr;
+	}
+
+	/* same selection as copy_lockless() */
+	generation = sd->generation;
+
+	if (last_generation > generation + _queue_size) {
+		generation = last_generation - _queue_size;
+	}
+
+	if (last_generation == generation) {
+		--generation;
+	}
+
+	return _data + (_meta->o_size * (generation % data_slots()));
+}
+
+bool
+uORB::DeviceNode::borrow_end(void *subscriber, unsigned generation)
+{
+	SubscriberData *sd = (SubscriberData *)subscriber;
+
+	/* order the reads of the message before re-checking the generation */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	if (__atomic_load_n(&_generation, __ATOMIC_RELAXED) > generation + _queue_size) {
+		/* the slot was reused while it was read */
+		return false;
+	}
+
+	if (generation > sd->generation) {
+		__atomic_fetch_add(&_lost_messages, generation - sd->generation, __ATOMIC_RELAXED);
+	}
+
+	sd->generation = generation + 1;
+	sd->set_update_reported(false);
+
+	rearm_update_flag(sd);
+
+	return true;
+}
+
+uint32_t
+uORB::DeviceNode::copy_updated(DeviceNode *const *nodes, void *const *subscribers, void *const *buffers, int count,
+			       uint32_t mask)
+{
+	uint32_t updated = 0;
+
+	for (int i = 0; i < count; ++i) {
+		if (!(mask & (1u << i)) || nodes[i] == nullptr) {
+			continue;
+		}
+
+		DeviceNode *node = nodes[i];
+		SubscriberData *sd = (SubscriberData *)subscribers[i];
+
+		/* lock each member on its own, so that interrupts are only held off for a single copy */
+#ifdef __PX4_NUTTX
+		irqstate_t flags = px4_enter_critical_section();
+#else
+		node->lock();
+#endif
+
+		if (node->appears_updated(sd)) {
+			if (node->_single_writer) {
+				node->copy_lockless(sd, buffers[i]);
+
+			} else {
+				node->copy_locked(sd, buffers[i]);
+			}
+
+			updated |= (1u << i);
+		}
+
+#ifdef __PX4_NUTTX
+		px4_leave_critical_section(flags);
+#else
+		node->unlock();
+#endif
+	}
+
+	return updated;
 }
 
 ssize_t
@@ -238,7 +406,7 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 
 			/* re-check size */
 			if (nullptr == _data) {
-				_data = new uint8_t[_meta->o_size * _queue_size];
+				_data = new uint8_t[_meta->o_size * data_slots()];
 			}
 
 			unlock();
@@ -249,7 +417,7 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 
 		/* re-check size */
 		if (nullptr == _data) {
-			_data = new uint8_t[_meta->o_size * _queue_size];
+			_data = new uint8_t[_meta->o_size * data_slots()];
 		}
 
 		unlock();
@@ -266,6 +434,15 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 		return -EIO;
 	}
 
+	if (_single_writer) {
+		write_lockless(buffer);
+
+		/* notify any poll waiters */
+		poll_notify(POLLIN);
+
+		return _meta->o_size;
+	}
+
 	/* Perform an atomic copy. */
 	ATOMIC_ENTER;
 	memcpy(_data + (_meta->o_size * (_generation % _queue_size)), buffer, _meta->o_size);
@@ -277,6 +454,8 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 
 	_published = true;
 
+	set_update_flag();
+
 	ATOMIC_LEAVE;
 
 	/* notify any poll waiters */
@@ -285,6 +464,102 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 	return _meta->o_size;
 }
 
+void
+uORB::DeviceNode::write_lockless(const char *buffer)
+{
+	const unsigned generation = _generation;
+
+	/* order the previous generation update before overwriting the next slot */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(_data + (_meta->o_size * (generation % data_slots())), buffer, _meta->o_size);
+
+	set_last_update(hrt_absolute_time());
+
+	/* make the message visible to readers */
+	__atomic_store_n(&_generation, generation + 1, __ATOMIC_RELEASE);
+
+	_published = true;
+
+	/*
+	 * The flag word and mask change together under the lock when the owner registers or closes.
+	 * Only take the lock if there is an owner: one registering after this check sees the new
+	 * generation in set_update_flag_owner() and sets the flag itself.
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&_update_flag_word, __ATOMIC_RELAXED) != nullptr) {
+		ATOMIC_ENTER;
+		set_update_flag();
+		ATOMIC_LEAVE;
+	}
+}
+
+void
+uORB::DeviceNode::set_last_update(hrt_abstime now)
+{
+#ifdef __PX4_NUTTX
+	/* a 64 bit store is not atomic, but a critical section does not block on NuttX */
+	ATOMIC_ENTER;
+	_last_update = now;
+	ATOMIC_LEAVE;
+#else
+	__atomic_store_n(&_last_update, now, __ATOMIC_RELAXED);
+#endif
+}
+
+int
+uORB::DeviceNode::set_single_writer()
+{
+	lock();
+
+	/* the data layout differs, so this is only possible as long as nobody published yet */
+	const int ret = (_single_writer || _data == nullptr) ? PX4_OK : PX4_ERROR;
+
+	if (ret == PX4_OK) {
+		_single_writer = true;
+	}
+
+	unlock();
+
+	return ret;
+}
+
+int
+uORB::DeviceNode::set_update_flag_owner(SubscriberData *sd, const orb_update_flag *flag)
+{
+	int ret = PX4_OK;
+
+	ATOMIC_ENTER;
+
+	if (flag == nullptr || flag->word == nullptr) {
+		if (sd == _update_flag_owner) {
+			__atomic_store_n(&_update_flag_word, nullptr, __ATOMIC_RELAXED);
+			_update_flag_mask = 0;
+			_update_flag_owner = nullptr;
+		}
+
+	} else if (_update_flag_owner != nullptr && _update_flag_owner != sd) {
+		ret = -EBUSY;
+
+	} else {
+		_update_flag_mask = flag->mask;
+		_update_flag_owner = sd;
+		__atomic_store_n(&_update_flag_word, flag->word, __ATOMIC_RELAXED);
+
+		/* there might be unread messages already (pairs with the fence in write_lockless()) */
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+		if (_data != nullptr && sd->generation < __atomic_load_n(&_generation, __ATOMIC_RELAXED)) {
+			set_update_flag();
+		}
+	}
+
+	ATOMIC_LEAVE;
+
+	return ret;
+}
+
 int
 uORB::DeviceNode::ioctl(cdev::file_t *filp, int cmd, unsigned long arg)
 {
@@ -293,7 +568,12 @@ uORB::DeviceNode::ioctl(cdev::file_t *filp, int cmd, unsigned long arg)
 	switch (cmd) {
 	case ORBIOCLASTUPDATE: {
 			ATOMIC_ENTER;
+#ifdef __PX4_NUTTX
 			*(hrt_abstime *)arg = _last_update;
+#else
+			/* in single-writer mode the publisher does not take the lock */
+			*(hrt_abstime *)arg = __atomic_load_n(&_last_update, __ATOMIC_RELAXED);
+#endif
 			ATOMIC_LEAVE;
 			return PX4_OK;
 		}
@@ -373,6 +653,21 @@ uORB::DeviceNode::ioctl(cdev::file_t *filp, int cmd, unsigned long arg)
 
 		return OK;
 
+	case ORBIOCSETSINGLEWRITER:
+		return set_single_writer();
+
+	case ORBIOCSETUPDATEFLAG:
+		if (sd == nullptr) {
+			return -EINVAL;
+		}
+
+		return set_update_flag_owner(sd, (const orb_update_flag *)arg);
+
+	case ORBIOCGSUBSCRIBER:
+		*(uintptr_t *)arg = (uintptr_t)sd;
+
+		return (sd != nullptr) ? OK : -EINVAL;
+
 	default:
 		/* give it to the superclass */
 		return CDev::ioctl(filp, cmd, arg);
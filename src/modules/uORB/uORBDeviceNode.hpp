@@ -106,6 +106,37 @@ public:
 	 */
 	int ioctl(cdev::file_t *filp, int cmd, unsigned long arg) override;
 
+	/**
+	 * Batched equivalent of orb_check() followed by orb_copy() for several subscriptions,
+	 * without going through the file descriptor layer. Each node is locked once (a
+	 * critical section per node on NuttX), so interrupt latency is bounded by a single copy.
+	 * @param nodes DeviceNode of each subscription (ORBIOCGADVERTISER)
+	 * @param subscribers opaque subscriber handle of each subscription (ORBIOCGSUBSCRIBER)
+	 * @param buffers destination buffer of each subscription (o_size bytes)
+	 * @param count number of subscriptions (max 32)
+	 * @param mask bitmask of the subscriptions to check
+	 * @return bitmask of the subscriptions that were updated and copied
+	 */
+	static uint32_t copy_updated(DeviceNode *const *nodes, void *const *subscribers, void *const *buffers, int count,
+				     uint32_t mask);
+
+	/**
+	 * Zero-copy read: get the next message of a subscriber in place, inside the data ring.
+	 * This is only possible in single-writer mode, and the message must be validated with
+	 * borrow_end() after reading it.
+	 * @param subscriber opaque subscriber handle (ORBIOCGSUBSCRIBER)
+	 * @param generation set to the generation of the returned message
+	 * @return the message, or nullptr if not available (nothing published or locked mode)
+	 */
+	const void *borrow_begin(void *subscriber, unsigned &generation) const;
+
+	/**
+	 * Finish a zero-copy read.
+	 * @return true if the message was not overwritten while it was read. It then counts as
+	 *         read for the subscriber, like after orb_copy().
+	 */
+	bool borrow_end(void *subscriber, unsigned generation);
+
 	/**
 	 * Method to publish a data to this node.
 	 */
@@ -178,6 +209,21 @@ public:
 	 */
 	bool print_statistics(bool reset);
 
+	/**
+	 * Switch to lockless single-writer mode, for high-rate topics with exactly one publisher.
+	 *
+	 * The publisher then writes without taking the node lock, and readers copy without it:
+	 * the ring gets one spare slot so that the slot being written is never readable, and
+	 * readers re-check the generation after copying to detect when they were lapped.
+	 * Waking up poll waiters still takes the lock.
+	 * The caller must guarantee that there is only one publisher. This can only be done as
+	 * long as nobody published yet (like update_queue_size()).
+	 * @return PX4_OK on success
+	 */
+	int set_single_writer();
+
+	bool is_single_writer() const { return _single_writer; }
+
 	uint8_t get_queue_size() const { return _queue_size; }
 
 	int8_t subscriber_count() const { return _subscriber_count; }
@@ -229,6 +275,12 @@ private:
 	volatile unsigned   _generation{0};  /**< object generation count */
 	uint8_t   _priority;  /**< priority of the topic */
 	bool _published{false};  /**< has ever data been published */
+	bool _single_writer{false}; /**< lockless mode (@see set_single_writer()) */
+
+	/* update notification (ORBIOCSETUPDATEFLAG) */
+	uint32_t *_update_flag_word{nullptr};
+	uint32_t _update_flag_mask{0};
+	SubscriberData *_update_flag_owner{nullptr};
 	uint8_t _queue_size; /**< maximum number of elements in the queue */
 	int8_t _subscriber_count{0};
 
@@ -263,4 +315,55 @@ private:
 	 */
 	bool      appears_updated(SubscriberData *sd);
 
+	/**
+	 * Copy the next message for a subscriber and update its generation.
+	 *
+	 * Lock must already be held when calling this (ATOMIC_ENTER).
+	 *
+	 * @param sd    The subscriber for whom to copy.
+	 * @param buffer    Destination buffer, may be nullptr.
+	 */
+	void      copy_locked(SubscriberData *sd, void *buffer);
+
+	/**
+	 * Single-writer mode equivalent of copy_locked(), without lock.
+	 */
+	void      copy_lockless(SubscriberData *sd, void *buffer);
+
+	/**
+	 * Publish in single-writer mode: write the next slot, then increment the generation.
+	 */
+	void      write_lockless(const char *buffer);
+
+	void      set_last_update(hrt_abstime now);
+
+	/**
+	 * Set the registered update flag bits (if any).
+	 */
+	inline void set_update_flag()
+	{
+		uint32_t *word = _update_flag_word;
+
+		if (word != nullptr) {
+			__atomic_fetch_or(word, _update_flag_mask, __ATOMIC_RELAXED);
+		}
+	}
+
+	/**
+	 * After a copy: keep the update flag set while the owner has unread messages in the queue.
+	 */
+	inline void rearm_update_flag(const SubscriberData *sd)
+	{
+		if (sd == _update_flag_owner && sd->generation < _generation) {
+			set_update_flag();
+		}
+	}
+
+	int       set_update_flag_owner(SubscriberData *sd, const orb_update_flag *flag);
+
+	/**
+	 * Number of messages the data buffer holds. The single-writer mode needs a spare slot.
+	 */
+	unsigned  data_slots() const { return _single_writer ? _queue_size + 1u : _queue_size; }
+
 };
@@ -157,7 +157,7 @@ int uORB::Manager::orb_exists(const struct orb_metadata *meta, int instance)
 }
 
 orb_advert_t uORB::Manager::orb_advertise_multi(const struct orb_metadata *meta, const void *data, int *instance,
-		int priority, unsigned int queue_size)
+		int priority, unsigned int queue_size, bool single_writer)
 {
 #ifdef ORB_USE_PUBLISHER_RULES
 
@@ -200,6 +200,11 @@ orb_advert_t uORB::Manager::orb_advertise_multi(const struct orb_metadata *meta,
 		PX4_WARN("orb_advertise_multi: failed to set queue size");
 	}
 
+	/* Same for the lockless mode: a re-advertised instance keeps the locked mode. */
+	if (single_writer && px4_ioctl(fd, ORBIOCSETSINGLEWRITER, 0) < 0) {
+		PX4_DEBUG("%s: already published, keeping locked mode", meta->o_name);
+	}
+
 	/* get the advertiser handle and close the node */
 	orb_advert_t advertiser;
 
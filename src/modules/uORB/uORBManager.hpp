@@ -149,6 +149,10 @@ public:
 	 *      and handle different priorities (@see orb_priority()).
 	 * @param queue_size  Maximum number of buffered elements. If this is 1, no queuing is
 	 *      used.
+	 * @param single_writer  If true, the caller guarantees that it is the only publisher of
+	 *      this instance, and the topic is switched to lockless mode: publishing and copying
+	 *      do not take the node lock (@see uORB::DeviceNode::set_single_writer()).
+	 *      If the instance was already published before, this is ignored.
 	 * @return    PX4_ERROR on error, otherwise returns a handle
 	 *      that can be used to publish to the topic.
 	 *      If the topic in question is not known (due to an
@@ -156,7 +160,7 @@ public:
 	 *      this function will return -1 and set errno to ENOENT.
 	 */
 	orb_advert_t orb_advertise_multi(const struct orb_metadata *meta, const void *data, int *instance,
-					 int priority, unsigned int queue_size = 1);
+					 int priority, unsigned int queue_size = 1, bool single_writer = false);
 
 	/**
 	 * Unadvertise a topic.
@@ -0,0 +1,143 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+* @file aero_table.cpp
+*
+*/
+
+#include "aero_table.h"
+
+#include <px4_defines.h>
+#include <px4_log.h>
+
+#include <crc32.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+AeroTable::~AeroTable()
+{
+	unmap();
+}
+
+void AeroTable::unmap()
+{
+	if (_map != nullptr) {
+#ifndef __PX4_NUTTX
+		// on NuttX the mapping points into the XIP ROMFS image and does not need to be released
+		munmap(_map, _map_size);
+#endif
+		_map = nullptr;
+		_map_size = 0;
+	}
+}
+
+int AeroTable::load(const char *path)
+{
+	int fd = ::open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return -errno;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(header_s)) {
+		::close(fd);
+		return -EINVAL;
+	}
+
+	const size_t size = st.st_size;
+	void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+	// the mapping stays valid after closing the file
+	::close(fd);
+
+	if (map == MAP_FAILED) {
+		PX4_ERR("mmap %s failed (%i)", path, errno);
+		return -errno;
+	}
+
+	const header_s *header = (const header_s *)map;
+	const size_t data_size = (size_t)header->num_curves * header->num_points * sizeof(float);
+	const uint8_t *data = (const uint8_t *)map + sizeof(header_s);
+
+	int ret = 0;
+
+	if (memcmp(header->magic, "CLTB", sizeof(header->magic)) != 0 || header->version != VERSION) {
+		PX4_ERR("%s: invalid header", path);
+		ret = -EINVAL;
+
+	} else if (header->num_curves == 0 || header->num_points < 2 || !(header->x_step > 0.f)
+		   || size < sizeof(header_s) + data_size) {
+		PX4_ERR("%s: invalid size", path);
+		ret = -EINVAL;
+
+	} else if (crc32part(data, data_size, 0) != header->crc) {
+		PX4_ERR("%s: crc mismatch", path);
+		ret = -EINVAL;
+	}
+
+	if (ret != 0) {
+#ifndef __PX4_NUTTX
+		munmap(map, size);
+#endif
+		return ret;
+	}
+
+	unmap();
+	_map = map;
+	_map_size = size;
+	_data = (const float *)data;
+	_num_curves = header->num_curves;
+	_num_points = header->num_points;
+	_x_min = header->x_min;
+	_x_step_inv = 1.f / header->x_step;
+
+	return 0;
+}
+
+void AeroTable::set_builtin(const float *data, uint16_t num_curves, uint16_t num_points, float x_min, float x_step)
+{
+	unmap();
+	_data = data;
+	_num_curves = num_curves;
+	_num_points = num_points;
+	_x_min = x_min;
+	_x_step_inv = 1.f / x_step;
+}
@@ -0,0 +1,135 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+* @file aero_table.h
+*
+* Read-only aerodynamic coefficient tables (e.g. CL(alpha) lift curves) on a
+* uniform grid. The tables are generated offline with
+* Tools/px_generate_cl_table.py and memory-mapped at startup: on POSIX the file
+* is mapped read-only, on NuttX the ROMFS image is execute-in-place, so the
+* mapping points directly into flash. Selecting a curve only returns a pointer,
+* nothing is copied.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class AeroTable
+{
+public:
+	static constexpr uint16_t VERSION = 1;
+
+	struct __attribute__((packed)) header_s {
+		char magic[4];		///< "CLTB"
+		uint16_t version;
+		uint16_t num_curves;
+		uint16_t num_points;	///< points per curve
+		uint16_t reserved;
+		float x_min;		///< grid value of the first point
+		float x_step;		///< grid spacing
+		uint32_t crc;		///< crc32part() of the curve data
+	};
+
+	AeroTable() = default;
+	~AeroTable();
+
+	AeroTable(const AeroTable &) = delete;
+	AeroTable &operator=(const AeroTable &) = delete;
+
+	/**
+	 * Map a table file generated by Tools/px_generate_cl_table.py.
+	 * @return 0 on success, <0 on error (the previous table is kept)
+	 */
+	int load(const char *path);
+
+	/**
+	 * Use a table compiled into the firmware (e.g. as fallback if no file is present).
+	 * @param data num_curves * num_points values, must outlive this object
+	 */
+	void set_builtin(const float *data, uint16_t num_curves, uint16_t num_points, float x_min, float x_step);
+
+	bool valid() const { return _data != nullptr; }
+	bool is_mapped() const { return _map != nullptr; }
+	int num_curves() const { return _num_curves; }
+	int num_points() const { return _num_points; }
+
+	/**
+	 * @return pointer to the requested curve, or nullptr if out of range
+	 */
+	const float *curve(int index) const
+	{
+		if (_data == nullptr || index < 0 || index >= _num_curves) {
+			return nullptr;
+		}
+
+		return _data + index * _num_points;
+	}
+
+	/**
+	 * Linear interpolation on the uniform grid (O(1)). x is clamped to the table range.
+	 */
+	float interpolate(const float *curve, float x) const
+	{
+		float pos = (x - _x_min) * _x_step_inv;
+
+		if (!(pos > 0.f)) { // also catches NaN
+			return curve[0];
+		}
+
+		const int i = (int)pos;
+
+		if (i >= _num_points - 1) {
+			return curve[_num_points - 1];
+		}
+
+		const float frac = pos - (float)i;
+		return curve[i] + frac * (curve[i + 1] - curve[i]);
+	}
+
+private:
+	void unmap();
+
+	const float *_data{nullptr};
+	int _num_curves{0};
+	int _num_points{0};
+	float _x_min{0.f};
+	float _x_step_inv{1.f};
+
+	void *_map{nullptr};	///< mapping of the loaded file, nullptr for builtin tables
+	size_t _map_size{0};
+};
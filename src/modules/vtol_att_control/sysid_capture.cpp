@@ -0,0 +1,401 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+* @file sysid_capture.cpp
+*
+* Full-rate capture of the sweep experiments into a separate ULog file.
+*
+*/
+
+#include "sysid_capture.h"
+
+#include <drivers/drv_hrt.h>
+#include <logger/messages.h>
+#include <px4_log.h>
+#include <px4_posix.h>
+#include <px4_tasks.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+constexpr const char *SysidCapture::FORMAT;
+constexpr const char *SysidCapture::CAPTURE_DIR;
+
+static constexpr uint16_t MSG_ID = 0;
+static constexpr size_t DATA_MSG_SIZE = sizeof(ulog_message_data_header_s) + sizeof(SysidCapture::sample_s);
+
+SysidCapture::~SysidCapture()
+{
+	if (_thread != 0) {
+		// a running capture is finished first
+		if (capturing()) {
+			update(false, sample_s{});
+		}
+
+		_exit_requested.store(true);
+		px4_sem_post(&_wakeup);
+		pthread_join(_thread, nullptr);
+		px4_sem_destroy(&_wakeup);
+	}
+
+	delete[] _ring;
+	delete[] _write_buffer;
+}
+
+int SysidCapture::init()
+{
+	if (_ring != nullptr) {
+		return 0;
+	}
+
+	_ring = new sample_s[RING_SIZE];
+	_write_buffer = new uint8_t[WRITE_BATCH * DATA_MSG_SIZE];
+
+	if (_ring == nullptr || _write_buffer == nullptr) {
+		delete[] _ring;
+		delete[] _write_buffer;
+		_ring = nullptr;
+		_write_buffer = nullptr;
+		return -ENOMEM;
+	}
+
+	px4_sem_init(&_wakeup, 0, 0);
+	/* _wakeup use case is a signal */
+	px4_sem_setprotocol(&_wakeup, SEM_PRIO_NONE);
+
+	pthread_attr_t thr_attr;
+	pthread_attr_init(&thr_attr);
+
+	sched_param param;
+	/* low priority, as this is expensive disk I/O */
+	param.sched_priority = SCHED_PRIORITY_DEFAULT - 40;
+	(void)pthread_attr_setschedparam(&thr_attr, &param);
+
+	pthread_attr_setstacksize(&thr_attr, PX4_STACK_ADJUSTED(1300));
+
+	int ret = pthread_create(&_thread, &thr_attr, &SysidCapture::writer_helper, this);
+	pthread_attr_destroy(&thr_attr);
+
+	if (ret != 0) {
+		_thread = 0;
+		px4_sem_destroy(&_wakeup);
+		delete[] _ring;
+		delete[] _write_buffer;
+		_ring = nullptr;
+		_write_buffer = nullptr;
+		return -ret;
+	}
+
+	return 0;
+}
+
+void SysidCapture::update(bool active, const sample_s &sample)
+{
+	if (_thread == 0) {
+		return;
+	}
+
+	if (!active && _capturing) {
+		_capturing = false;
+
+		if (_end_pending) {
+			// none of the samples of this capture got into the ring, count them in the previous one
+			_end_dropped += _capture_dropped;
+
+		} else {
+			_end_pending = true;
+			_end_dropped = _capture_dropped;
+		}
+	}
+
+	if (_end_pending) {
+		sample_s end{};
+		end.timestamp = _end_dropped;
+		end.sweep_type = END_MARKER;
+		_end_pending = !push(end);
+	}
+
+	if (active && !_capturing) {
+		// if the previous capture is still being written out, this one is queued behind it
+		_capturing = true;
+		_capture_dropped = 0;
+		_wakeup_pending = true;
+	}
+
+	if (_capturing) {
+		// the samples must not get ahead of the end marker of the previous capture
+		if (_end_pending || !push(sample)) {
+			++_capture_dropped;
+		}
+	}
+
+	// wake up the writer after pushing, it goes back to sleep if it finds the ring empty
+	if (_wakeup_pending && _head.load() != _tail.load()) {
+		_wakeup_pending = false;
+		px4_sem_post(&_wakeup);
+	}
+}
+
+bool SysidCapture::push(const sample_s &sample)
+{
+	const uint32_t head = _head.load();
+
+	if (head - _tail.load() >= RING_SIZE) {
+		return false;
+	}
+
+	_ring[head & (RING_SIZE - 1)] = sample;
+
+	// publish the sample to the writer
+	_head.store(head + 1);
+	return true;
+}
+
+void *SysidCapture::writer_helper(void *context)
+{
+	px4_prctl(PR_SET_NAME, "sysid_capture", px4_getpid());
+
+	reinterpret_cast<SysidCapture *>(context)->writer_run();
+	return nullptr;
+}
+
+void SysidCapture::writer_run()
+{
+	while (true) {
+		// read the flag before draining, so that the last samples are not missed
+		const bool exit_requested = _exit_requested.load();
+
+		drain();
+
+		if (exit_requested) {
+			break;
+		}
+
+		if (_in_capture) {
+			px4_usleep(WRITE_INTERVAL_US);
+
+		} else {
+			while (px4_sem_wait(&_wakeup) != 0) {}
+		}
+	}
+
+	// the end marker did not fit into the ring
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+}
+
+void SysidCapture::start_file()
+{
+	_fd = open_file();
+
+	if (_fd >= 0 && !write_header()) {
+		PX4_ERR("sysid capture: header write failed (%i)", errno);
+		::close(_fd);
+		_fd = -1;
+	}
+
+	if (_fd < 0) {
+		PX4_ERR("sysid capture: sweep not recorded");
+	}
+}
+
+void SysidCapture::finish_file(uint32_t dropped)
+{
+	if (_fd >= 0) {
+		write_info_uint32("sysid_dropped_samples", dropped);
+		::close(_fd);
+		_fd = -1;
+	}
+
+	if (dropped > 0) {
+		PX4_WARN("sysid capture: %u samples dropped", (unsigned)dropped);
+	}
+}
+
+int SysidCapture::open_file()
+{
+	// the log root is normally created by the logger, but we might be first
+	mkdir(PX4_STORAGEDIR "/log", S_IRWXU | S_IRWXG | S_IRWXO);
+	int ret = mkdir(CAPTURE_DIR, S_IRWXU | S_IRWXG | S_IRWXO);
+
+	if (ret != 0 && errno != EEXIST) {
+		PX4_ERR("sysid capture: failed creating %s (%i)", CAPTURE_DIR, errno);
+		return -1;
+	}
+
+	char file_name[64];
+
+	for (unsigned index = 1; index <= 999; ++index) {
+		snprintf(file_name, sizeof(file_name), "%s/sweep%03u.ulg", CAPTURE_DIR, index);
+		struct stat buffer;
+
+		if (stat(file_name, &buffer) != 0) {
+			int fd = ::open(file_name, O_CREAT | O_WRONLY, PX4_O_MODE_666);
+
+			if (fd < 0) {
+				PX4_ERR("sysid capture: can't open %s (%i)", file_name, errno);
+
+			} else {
+				PX4_INFO("sysid capture: %s", file_name);
+			}
+
+			return fd;
+		}
+	}
+
+	PX4_ERR("sysid capture: too many files in %s", CAPTURE_DIR);
+	return -1;
+}
+
+bool SysidCapture::write_header()
+{
+	ulog_file_header_s header = {};
+	header.magic[0] = 'U';
+	header.magic[1] = 'L';
+	header.magic[2] = 'o';
+	header.magic[3] = 'g';
+	header.magic[4] = 0x01;
+	header.magic[5] = 0x12;
+	header.magic[6] = 0x35;
+	header.magic[7] = 0x01; //file version 1
+	header.timestamp = hrt_absolute_time();
+
+	// the Flags message MUST be written right after the ulog header
+	ulog_message_flag_bits_s flag_bits{};
+	flag_bits.msg_size = sizeof(flag_bits) - ULOG_MSG_HEADER_LEN;
+	flag_bits.msg_type = static_cast<uint8_t>(ULogMessageType::FLAG_BITS);
+
+	if (::write(_fd, &header, sizeof(header)) != sizeof(header)
+	    || ::write(_fd, &flag_bits, sizeof(flag_bits)) != sizeof(flag_bits)) {
+		return false;
+	}
+
+	// format definition and subscription, reuse the data write buffer
+	ulog_message_header_s *format_msg = reinterpret_cast<ulog_message_header_s *>(_write_buffer);
+	const size_t format_len = strlen(FORMAT);
+	format_msg->msg_size = format_len;
+	format_msg->msg_type = static_cast<uint8_t>(ULogMessageType::FORMAT);
+	memcpy(_write_buffer + ULOG_MSG_HEADER_LEN, FORMAT, format_len);
+	const ssize_t format_msg_size = ULOG_MSG_HEADER_LEN + format_len;
+
+	if (::write(_fd, _write_buffer, format_msg_size) != format_msg_size) {
+		return false;
+	}
+
+	ulog_message_add_logged_s add_msg;
+	const size_t name_len = strchr(FORMAT, ':') - FORMAT;
+	memcpy(add_msg.message_name, FORMAT, name_len);
+	add_msg.multi_id = 0;
+	add_msg.msg_id = MSG_ID;
+	add_msg.msg_size = sizeof(add_msg) - sizeof(add_msg.message_name) - ULOG_MSG_HEADER_LEN + name_len;
+	const ssize_t add_msg_size = add_msg.msg_size + ULOG_MSG_HEADER_LEN;
+
+	return ::write(_fd, &add_msg, add_msg_size) == add_msg_size;
+}
+
+bool SysidCapture::write_info_uint32(const char *name, uint32_t value)
+{
+	ulog_message_info_header_s msg = {};
+	uint8_t *buffer = reinterpret_cast<uint8_t *>(&msg);
+	msg.msg_type = static_cast<uint8_t>(ULogMessageType::INFO);
+	msg.key_len = snprintf(msg.key, sizeof(msg.key), "uint32_t %s", name);
+	size_t msg_size = sizeof(msg) - sizeof(msg.key) + msg.key_len;
+	memcpy(&buffer[msg_size], &value, sizeof(value));
+	msg_size += sizeof(value);
+	msg.msg_size = msg_size - ULOG_MSG_HEADER_LEN;
+
+	return ::write(_fd, buffer, msg_size) == (ssize_t)msg_size;
+}
+
+void SysidCapture::drain()
+{
+	const uint32_t head = _head.load();
+	uint32_t tail = _tail.load();
+	int num_samples = 0;
+
+	while (tail != head) {
+		const sample_s &sample = _ring[tail & (RING_SIZE - 1)];
+
+		if (!_in_capture) {
+			start_file();
+			_in_capture = true;
+		}
+
+		if (sample.sweep_type == END_MARKER) {
+			write_batch(num_samples);
+			num_samples = 0;
+			finish_file((uint32_t)sample.timestamp);
+			_in_capture = false;
+
+		} else if (_fd >= 0) {
+			// without a file the samples are discarded, so that the producer does not count them as dropped
+			uint8_t *ptr = _write_buffer + num_samples * DATA_MSG_SIZE;
+			ulog_message_data_header_s data_header;
+			data_header.msg_size = DATA_MSG_SIZE - ULOG_MSG_HEADER_LEN;
+			data_header.msg_id = MSG_ID;
+			memcpy(ptr, &data_header, sizeof(data_header));
+			memcpy(ptr + sizeof(data_header), &sample, sizeof(sample_s));
+
+			if (++num_samples == WRITE_BATCH) {
+				write_batch(num_samples);
+				num_samples = 0;
+			}
+		}
+
+		// copied, release the slot to the producer
+		_tail.store(++tail);
+	}
+
+	write_batch(num_samples);
+}
+
+void SysidCapture::write_batch(int num_samples)
+{
+	if (num_samples == 0 || _fd < 0) {
+		return;
+	}
+
+	const ssize_t size = num_samples * DATA_MSG_SIZE;
+
+	if (::write(_fd, _write_buffer, size) != size) {
+		PX4_ERR("sysid capture: write failed (%i)", errno);
+		::close(_fd);
+		_fd = -1;
+	}
+}
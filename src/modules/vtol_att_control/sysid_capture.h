@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+* @file sysid_capture.h
+*
+* Full-rate capture of the sweep (system identification) experiments.
+*
+* While a sweep is running, the control loop records one fixed-schema sample per
+* cycle into a preallocated single-producer/single-consumer ring. A low priority
+* writer thread, created once by init() and woken through a semaphore when a
+* capture starts, drains the ring into a separate ULog file
+* (PX4_STORAGEDIR/log/sysid/sweepNNN.ulg), so no samples are lost to the
+* logger's topic intervals and the main log is not burdened.
+* The end of a capture is marked in the ring itself, so a sweep which starts
+* while the previous one is still being written out is queued behind it and
+* recorded into the next file.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include <px4_atomic.h>
+#include <px4_defines.h>
+#include <px4_sem.h>
+
+class SysidCapture
+{
+public:
+	/** one sample per control cycle. The layout must match FORMAT. */
+	struct __attribute__((packed)) sample_s {
+		uint64_t timestamp;
+		float gyro[3];		///< body rates [rad/s]
+		float control_in[4];	///< roll, pitch, yaw, thrust from the mc controller
+		float control[4];	///< roll, pitch, yaw, thrust sent to the mixer (incl. sweep input)
+		float sweep_input;
+		uint8_t sweep_type;	///< VT_SWEEP_TYPE
+	};
+
+	static constexpr int RING_SIZE = 512;	///< number of buffered samples (~2s at 250Hz), must be a power of 2
+
+	SysidCapture() = default;
+	~SysidCapture();
+
+	SysidCapture(const SysidCapture &) = delete;
+	SysidCapture &operator=(const SysidCapture &) = delete;
+
+	/**
+	 * Allocate the buffers and start the writer thread. Not real-time safe, call this outside
+	 * of the control loop, from the task that destroys the object.
+	 * @return 0 on success, <0 on error
+	 */
+	int init();
+
+	bool initialized() const { return _ring != nullptr; }
+
+	/**
+	 * Call every control cycle while active or capturing(). A capture file is started when
+	 * active becomes true and finished when it becomes false. Real-time safe: it only pushes
+	 * into the ring and wakes up the writer thread.
+	 */
+	void update(bool active, const sample_s &sample);
+
+	/** a capture is running or its end could not be queued yet */
+	bool capturing() const { return _capturing || _end_pending; }
+
+	/** number of samples dropped in the current/last capture because the ring was full */
+	uint32_t dropped() const { return _capture_dropped; }
+
+private:
+	static constexpr const char *FORMAT = "sysid_capture:uint64_t timestamp;float[3] gyro;float[4] control_in;"
+					      "float[4] control;float sweep_input;uint8_t sweep_type;";
+	static constexpr const char *CAPTURE_DIR = PX4_STORAGEDIR "/log/sysid";
+	static constexpr int WRITE_BATCH = 32;	///< samples per file write
+	static constexpr unsigned WRITE_INTERVAL_US = 20000;
+
+	/** sweep_type of the ring entry which ends a capture. Its timestamp holds the number of dropped samples. */
+	static constexpr uint8_t END_MARKER = UINT8_MAX;
+
+	/** @return false if the ring is full */
+	bool push(const sample_s &sample);
+
+	static void *writer_helper(void *context);
+	void writer_run();
+
+	void start_file();
+	void finish_file(uint32_t dropped);
+	int open_file();
+	bool write_header();
+	bool write_info_uint32(const char *name, uint32_t value);
+
+	/** write out all entries currently in the ring, starting and finishing the files at the end markers */
+	void drain();
+
+	/** write num_samples from the write buffer to the file */
+	void write_batch(int num_samples);
+
+	sample_s *_ring{nullptr};
+	uint8_t *_write_buffer{nullptr};
+
+	px4::atomic<uint32_t> _head{0};	///< written by the producer (control loop)
+	px4::atomic<uint32_t> _tail{0};	///< written by the consumer (writer thread)
+	px4::atomic_bool _exit_requested{false};
+
+	// producer (control loop) state
+	bool _capturing{false};
+	bool _end_pending{false};			///< the end marker did not fit into the ring yet
+	bool _wakeup_pending{false};			///< a capture started, the writer has not been woken up yet
+	uint32_t _capture_dropped{0};
+	uint32_t _end_dropped{0};			///< dropped samples of the capture ended by the pending marker
+
+	// consumer (writer thread) state
+	bool _in_capture{false};			///< samples of a capture are being written, until its end marker
+
+	px4_sem_t _wakeup;				///< posted when a capture starts or on exit
+	pthread_t _thread{0};
+	int _fd{-1};
+};
@@ -68,8 +68,9 @@
 #define VERT_CONTROL_MODE  (CONTROL_POS) // modes: CONTROL_POS, CONTROL_VEL, CONTROL_VEL_WITHOUT_ACC
 
 #define CTRL_FREQ (250.0f)
+#define FREQUENCY_RESPONSE_INTERVAL 200000	// [us] publication interval of the sweep frequency response
 
-static  orb_advert_t mavlink_log_pub = nullptr;
+#define CL_TABLE_FILE PX4_ROOTFSDIR "/etc/aero/cl_sysid.bin"
 
 using namespace matrix;
 
@@ -86,6 +87,24 @@ Tailsitter::Tailsitter(VtolAttitudeControl *attc) :
 
 	_params_handles_tailsitter.sys_ident_input    = param_find("SYS_IDENT_INPUT");
 	_params_handles_tailsitter.sys_ident_num      = param_find("SYS_IDENT_NUM");
+	_params_handles_tailsitter.sweep_signal[0]    = param_find("VT_SWP_SIG_R");
+	_params_handles_tailsitter.sweep_signal[1]    = param_find("VT_SWP_SIG_P");
+	_params_handles_tailsitter.sweep_signal[2]    = param_find("VT_SWP_SIG_Y");
+	_params_handles_tailsitter.sweep_signal[3]    = param_find("VT_SWP_SIG_T");
+	_params_handles_tailsitter.sweep_f_min        = param_find("VT_SWP_FMIN");
+	_params_handles_tailsitter.sweep_f_max        = param_find("VT_SWP_FMAX");
+	_params_handles_tailsitter.sweep_duration     = param_find("VT_SWP_TIME");
+	_params_handles_tailsitter.sweep_f_sine       = param_find("VT_SWP_FSINE");
+	_params_handles_tailsitter.sweep_pulse_width  = param_find("VT_SWP_PW");
+
+	/* lift curves: use the identified curves from the ROMFS table if present, the compiled-in ones otherwise */
+	_cl_table.set_builtin(&CL_SYS_ID[0][0], sizeof(CL_SYS_ID) / sizeof(CL_SYS_ID[0]), NUM_CL_POINTS + 1, 0.0f, 1.0f);
+
+	if (_cl_table.load(CL_TABLE_FILE) != 0) {
+		PX4_WARN("no lift curve table %s, using builtin curves", CL_TABLE_FILE);
+	}
+
+	_CL_Degree = _cl_table.curve(0);
 }
 
 void Tailsitter::PID_Initialize(){
@@ -115,18 +134,37 @@ void Tailsitter::parameters_update()
 	param_get(_params_handles_tailsitter.sys_ident_num, &v);
 	_params_tailsitter.sys_ident_num = v;
 
-	/* update the CL points */
-	int iden_num = 0;
-	if ((_params_tailsitter.sys_ident_num >= 9) && (_params_tailsitter.sys_ident_num >= 0)) {
-		iden_num = _params_tailsitter.sys_ident_num;
+	/* select the CL curve, this only updates a pointer into the (mapped) table */
+	const float *cl_curve = _cl_table.curve(_params_tailsitter.sys_ident_num);
+
+	_CL_Degree = (cl_curve != nullptr) ? cl_curve : _cl_table.curve(0);
+
+	for (int i = 0; i < 4; i++) {
+		param_get(_params_handles_tailsitter.sweep_signal[i], &_params_tailsitter.sweep_signal[i]);
 	}
 
-	memcpy(_CL_Degree, CL_SYS_ID[iden_num], sizeof(_CL_Degree));
+	param_get(_params_handles_tailsitter.sweep_f_min, &_params_tailsitter.sweep_f_min);
+	param_get(_params_handles_tailsitter.sweep_f_max, &_params_tailsitter.sweep_f_max);
+	param_get(_params_handles_tailsitter.sweep_duration, &_params_tailsitter.sweep_duration);
+	param_get(_params_handles_tailsitter.sweep_f_sine, &_params_tailsitter.sweep_f_sine);
+	param_get(_params_handles_tailsitter.sweep_pulse_width, &_params_tailsitter.sweep_pulse_width);
+
+	/* the capture buffers are only allocated if sweeps are configured */
+	if (_params->vt_sweep_capture && _params->vt_sweep_type != NO_SWEEP && !_sysid_capture.initialized()) {
+		if (_sysid_capture.init() != 0) {
+			PX4_ERR("sysid capture: alloc failed");
+		}
+	}
 
 	//mavlink_log_critical(&mavlink_log_pub, "sys_ident_cl_point:%.5f inttest:%d", (double)(_CL_Degree[19]), int(16.99f * 1));
 
 }
 
+float Tailsitter::get_CL(float aoa)
+{
+	return _cl_table.interpolate(_CL_Degree, RAD_TO_DEG(aoa));
+}
+
 void Tailsitter::update_vtol_state()
 {
 	/* simple logic using a two way switch to perform transitions.
@@ -445,8 +483,8 @@ float Tailsitter::control_altitude(float time_since_trans_start, float alt_cmd,
 	_vtol_vehicle_status->thrust_cmd   = thrust_cmd;
 	_vtol_vehicle_status->ticks_since_trans ++;
 
-	/* send back command and feedback data */
-	mavlink_log_critical(&mavlink_log_pub, "thr_cmd:%.5f", (double)(thrust_cmd));
+	/* send back command and feedback data, formatted and rate limited outside of the control loop */
+	mavlink_log_deferred_rate(&_mavlink_log_ring, _MSG_PRIO_CRITICAL, 5.0f, "thr_cmd:%.5f", (double)(thrust_cmd));
 
 	return (-1.0f * thrust_cmd);
 }
@@ -730,17 +768,123 @@ void Tailsitter::update_fw_state()
 	VtolType::update_fw_state();
 }
 
+void Tailsitter::start_sweep()
+{
+	int axis;
+	_sweep_control_index = -1;
+
+	switch (_params->vt_sweep_type) {
+	case ROLL_RATE:
+		axis = 0;
+		_sweep_control_index = actuator_controls_s::INDEX_ROLL;
+		break;
+
+	case PITCH_RATE:
+		axis = 1;
+		_sweep_control_index = actuator_controls_s::INDEX_PITCH;
+		break;
+
+	case YAW_RATE:
+		axis = 2;
+		_sweep_control_index = actuator_controls_s::INDEX_YAW;
+		break;
+
+	case THRUST:
+		axis = 3;
+		_sweep_control_index = actuator_controls_s::INDEX_THROTTLE;
+		break;
+
+	default:
+		return;
+	}
+
+	excitation::Config config;
+	config.type = static_cast<excitation::Type>(_params_tailsitter.sweep_signal[axis]);
+	config.amplitude = _params->vt_sweep_amp;
+	config.f_min = _params_tailsitter.sweep_f_min;
+	config.f_max = _params_tailsitter.sweep_f_max;
+	config.duration = _params_tailsitter.sweep_duration;
+	config.pulse_width = _params_tailsitter.sweep_pulse_width;
+	config.sample_rate = CTRL_FREQ;
+
+	if (config.type == excitation::Type::Sine) {
+		config.f_min = _params_tailsitter.sweep_f_sine;
+		config.duration = 0.f;
+	}
+
+	if (_sweep_generator.configure(config) != 0) {
+		mavlink_log_critical_deferred(&_mavlink_log_ring, "Sweep: invalid signal config for axis %d", axis);
+		_sweep_control_index = -1;
+		return;
+	}
+
+	// a sine only excites a single frequency, other signals are evaluated over the sweep range
+	frequency_response::Config estimator_config;
+	estimator_config.f_min = config.f_min;
+	estimator_config.f_max = config.type == excitation::Type::Sine ? config.f_min : config.f_max;
+	estimator_config.num_bins = config.type == excitation::Type::Sine ? 1 : frequency_response::Estimator::MAX_BINS;
+	estimator_config.sample_rate = CTRL_FREQ;
+
+	if (_frequency_response.configure(estimator_config) != 0) {
+		mavlink_log_warning_deferred(&_mavlink_log_ring, "Sweep: frequency response estimator config failed");
+	}
+
+	_frequency_response_last_publish = hrt_absolute_time();
+}
+
+float Tailsitter::sweep_response() const
+{
+	switch (_sweep_control_index) {
+	case actuator_controls_s::INDEX_ROLL:
+		return _v_att->rollspeed;
+
+	case actuator_controls_s::INDEX_PITCH:
+		return _v_att->pitchspeed;
+
+	case actuator_controls_s::INDEX_YAW:
+		return _v_att->yawspeed;
+
+	case actuator_controls_s::INDEX_THROTTLE:
+		return _sensor_acc->x;
+
+	default:
+		return 0.0f;
+	}
+}
+
+void Tailsitter::publish_frequency_response()
+{
+	static_assert(frequency_response::Estimator::MAX_BINS <= frequency_response_s::NUM_BINS, "too many bins");
+
+	frequency_response_s response{};
+	response.timestamp = hrt_absolute_time();
+	response.sweep_type = _params->vt_sweep_type;
+	response.num_bins = _frequency_response.num_bins();
+
+	for (int i = 0; i < response.num_bins; i++) {
+		frequency_response::Result result;
+		_frequency_response.get(i, result);
+
+		response.frequency[i] = result.frequency;
+		response.gain[i] = result.gain;
+		response.phase[i] = result.phase;
+		response.coherence[i] = result.coherence;
+		response.input_power[i] = result.input_power;
+		response.blocks[i] = result.blocks;
+	}
+
+	orb_publish_auto(ORB_ID(frequency_response), &_frequency_response_pub, &response, nullptr, ORB_PRIO_DEFAULT);
+	_frequency_response_last_publish = response.timestamp;
+}
+
 /**
 * Write data to actuator output topic.
 */
 void Tailsitter::fill_actuator_outputs()
 {
-	float time_since_sweep = 0.0f;
-	float sweep_signal_phase = 0.0f;
 	float sweep_signal = 0.0f;
-	float sweep_min_frequency = 0.5f * 6.2831f;
-	float sweep_max_frequency = 80.0f * 6.2831f ;
-	float overall_time = 150.0f;
+	const bool sweep_active = _vtol_mode == ROTARY_WING && _params->vt_sweep_type != NO_SWEEP
+				  && _attc->is_sweep_requested();
 	//float time_since_trans_start = (float)(hrt_absolute_time() - _vtol_schedule.f_trans_start_t) * 1e-6f;
 
 	_actuators_out_0->timestamp = hrt_absolute_time();
@@ -760,45 +904,28 @@ void Tailsitter::fill_actuator_outputs()
 		_actuators_out_1->control[actuator_controls_s::INDEX_PITCH] = 0.0f;
 
 		/* Used for sweep experiment's input signal */
-		if(_attc->is_sweep_requested()) {
-			switch (_params->vt_sweep_type){
-			case NO_SWEEP:
-				break;
-			case PITCH_RATE:
-				time_since_sweep = (float)(hrt_absolute_time() - _vtol_schedule.sweep_start) * 1e-6f;
-				// Exponantial Chirp
-				sweep_signal_phase = 8.0f * 6.2831f * time_since_sweep;//sweep_min_frequency * time_since_sweep + 0.0187f * (sweep_max_frequency - sweep_min_frequency) * (overall_time / 4.0f * powf(2.7183f, (4.0f * time_since_sweep / overall_time)) - time_since_sweep);
-				// Linear Chirp
-				//sweep_signal_phase = sweep_min_frequency * time_since_sweep + 0.5f * (sweep_max_frequency - sweep_min_frequency) * (time_since_sweep * time_since_sweep / overall_time);
-				sweep_signal = (float)(_params->vt_sweep_amp) * sinf(sweep_signal_phase);
-				_actuators_out_0->sweep_input = sweep_signal;
-				_actuators_out_0->control[actuator_controls_s::INDEX_PITCH] = _actuators_mc_in->control[actuator_controls_s::INDEX_PITCH] + sweep_signal;
-				break;
-		    case ROLL_RATE:
-		    		time_since_sweep = (float)(hrt_absolute_time() - _vtol_schedule.sweep_start) * 1e-6f;
-		    		// Exponantial Chirp
-				sweep_signal_phase = 8.0f * 6.2831f * time_since_sweep;//sweep_min_frequency * time_since_sweep + 0.0187f * (sweep_max_frequency - sweep_min_frequency) * (overall_time / 4.0f * powf(2.7183f, (4.0f * time_since_sweep / overall_time)) - time_since_sweep);
-				// Linear Chirp
-				// sweep_signal_phase = sweep_min_frequency  * time_since_sweep + 0.5f * (sweep_max_frequency - sweep_min_frequency) * (time_since_sweep * time_since_sweep / overall_time);
-				sweep_signal = (float)(_params->vt_sweep_amp) * sinf(sweep_signal_phase);
-				_actuators_out_0->sweep_input = sweep_signal;
-				_actuators_out_0->control[actuator_controls_s::INDEX_ROLL] = _actuators_mc_in->control[actuator_controls_s::INDEX_ROLL] + sweep_signal;
-				break;
-			case THRUST:
-				time_since_sweep = (float)(hrt_absolute_time() - _vtol_schedule.sweep_start) * 1e-6f;
-		    	// Exponantial Chirp
-				sweep_signal_phase = sweep_min_frequency * time_since_sweep + 0.0187f * (sweep_max_frequency - sweep_min_frequency) * (overall_time / 4.0f * powf(2.7183f, (4.0f * time_since_sweep / overall_time)) - time_since_sweep);
-				// Linear Chirp
-				// sweep_signal_phase = sweep_min_frequency  * time_since_sweep + 0.5f * (sweep_max_frequency - sweep_min_frequency) * (time_since_sweep * time_since_sweep / overall_time);
-				sweep_signal = (float)(_params->vt_sweep_amp) * sinf(sweep_signal_phase);
+		if (sweep_active) {
+			if (!_sweep_started) {
+				start_sweep();
+				_sweep_started = true;
+			}
+
+			if (_sweep_control_index >= 0) {
+				sweep_signal = _sweep_generator.next();
 				_actuators_out_0->sweep_input = sweep_signal;
-				_actuators_out_0->control[actuator_controls_s::INDEX_THROTTLE] = _actuators_mc_in->control[actuator_controls_s::INDEX_THROTTLE] + sweep_signal;
-				break;
+				_actuators_out_0->control[_sweep_control_index] += sweep_signal;
+
+				// stop the estimate once the signal is over, the remaining response is only noise
+				if (!_sweep_generator.finished()) {
+					_frequency_response.update(sweep_signal, sweep_response());
+				}
+
+				if (hrt_elapsed_time(&_frequency_response_last_publish) > FREQUENCY_RESPONSE_INTERVAL) {
+					publish_frequency_response();
+				}
 			}
-		} else {
-			/* record the start time */
-			_vtol_schedule.sweep_start = hrt_absolute_time();
 		}
+
 		break;
 
 	case FIXED_WING:
@@ -834,4 +961,34 @@ void Tailsitter::fill_actuator_outputs()
 		_actuators_out_1->control[actuator_controls_s::INDEX_ROLL] = -_actuators_fw_in->control[actuator_controls_s::INDEX_ROLL];	// roll elevon
 		_actuators_out_1->control[actuator_controls_s::INDEX_PITCH] = -_actuators_fw_in->control[actuator_controls_s::INDEX_PITCH];	// pitch elevon
 	}
+
+	/* the sweep ends when it is no longer requested or we leave MC mode, a new request starts it again */
+	if (_sweep_started && !sweep_active) {
+		if (_sweep_control_index >= 0) {
+			// final estimate of the experiment
+			publish_frequency_response();
+		}
+
+		_sweep_started = false;
+	}
+
+	/* full-rate capture of the sweep experiment, the file is closed when the sweep ends or we leave MC mode */
+	if (_sysid_capture.initialized()) {
+		if (sweep_active || _sysid_capture.capturing()) {
+			SysidCapture::sample_s sample;
+			sample.timestamp = _actuators_out_0->timestamp;
+			sample.gyro[0] = _v_att->rollspeed;
+			sample.gyro[1] = _v_att->pitchspeed;
+			sample.gyro[2] = _v_att->yawspeed;
+
+			for (int i = 0; i < 4; i++) {
+				sample.control_in[i] = _actuators_mc_in->control[i];
+				sample.control[i] = _actuators_out_0->control[i];
+			}
+
+			sample.sweep_input = sweep_signal;
+			sample.sweep_type = _params->vt_sweep_type;
+			_sysid_capture.update(sweep_active, sample);
+		}
+	}
 }
@@ -44,14 +44,20 @@
 
 #include "vtol_type.h"
 #include "ILC_DATA.h"
+#include "aero_table.h"
+#include "sysid_capture.h"
+#include <excitation/Excitation.hpp>
+#include <frequency_response/FrequencyResponse.hpp>
 #include "euler_zxy.h"
 #include "Quaternion_zxy.hpp"
 #include <perf/perf_counter.h>  /** is it necsacery? **/
 #include <parameters/param.h>
+#include <systemlib/mavlink_log_deferred.h>
 #include <drivers/drv_hrt.h>
 #include <matrix/matrix/math.hpp>
 #include <mathlib/math/EulerFromQuat.hpp>
 #include <mathlib/math/filter/LowPassFilter2p.hpp>
+#include <uORB/topics/frequency_response.h>
 #include <uORB/topics/vehicle_local_position.h>
 
 class Tailsitter : public VtolType
@@ -86,6 +92,12 @@ public:
 	virtual float calc_roll_b_trans(float dt);
 	bool is_ground_speed_satisfied();
 
+	/**
+	 * Lift coefficient of the curve selected by SYS_IDENT_NUM.
+	 * @param aoa angle of attack [rad]
+	 */
+	float get_CL(float aoa);
+
 private:
 
 	struct {
@@ -93,6 +105,12 @@ private:
 		float fw_pitch_sp_offset;
 		float sys_ident_input;
 		int   sys_ident_num;
+		int32_t sweep_signal[4];	/**< excitation::Type per sweep axis (roll, pitch, yaw, thrust) */
+		float sweep_f_min;
+		float sweep_f_max;
+		float sweep_duration;
+		float sweep_f_sine;
+		float sweep_pulse_width;
 	} _params_tailsitter{};	
 
 	struct {
@@ -100,6 +118,12 @@ private:
 		param_t fw_pitch_sp_offset;
 		param_t sys_ident_input;
 		param_t sys_ident_num;
+		param_t sweep_signal[4];
+		param_t sweep_f_min;
+		param_t sweep_f_max;
+		param_t sweep_duration;
+		param_t sweep_f_sine;
+		param_t sweep_pulse_width;
 	} _params_handles_tailsitter{};
 
 	enum vtol_mode 
@@ -137,7 +161,6 @@ private:
 		vtol_mode   flight_mode;	    /**< vtol flight mode, defined by enum vtol_mode */
 		float       ctrl_out_trans_end; /**< MC controller output at the end of front transition */
 		hrt_abstime fw_start;           /**< absoulte time at which fw mode started, this time will be used to smooth the controller output */
-		hrt_abstime sweep_start;
 		hrt_abstime _trans_start_t;	/**< absoulte time at which front transition started */
 		bool 	    vz_mission_finished = false;
 	} _vtol_schedule;
@@ -185,7 +208,27 @@ private:
 	float _trans_start_yaw;
 	float _trans_start_pitch;
 	float _trans_start_roll;
-	float _CL_Degree[NUM_CL_POINTS+1];
+	AeroTable _cl_table;		/**< CL(alpha) curves, 1 deg grid */
+	const float *_CL_Degree{nullptr};	/**< curve selected by SYS_IDENT_NUM, points into _cl_table */
+
+	mavlink_log_deferred::Ring _mavlink_log_ring;	/**< queue for mavlink messages sent from the control loop */
+	SysidCapture _sysid_capture;			/**< full-rate recording of the sweep experiments */
+	excitation::Generator _sweep_generator;
+	int _sweep_control_index{-1};			/**< actuator_controls index the sweep is added to, -1 if the setup failed */
+	bool _sweep_started{false};
+
+	frequency_response::Estimator _frequency_response;	/**< onboard estimate of the response to the sweep */
+	orb_advert_t _frequency_response_pub{nullptr};
+	hrt_abstime _frequency_response_last_publish{0};
+
+	/** set up the excitation signal for the axis selected by VT_SWEEP_TYPE */
+	void start_sweep();
+
+	/** measured response of the swept axis: body rate, or body x acceleration for thrust */
+	float sweep_response() const;
+
+	void publish_frequency_response();
+
 	float _target_alt;
 	float _yaw;
 	float _pitch;
@@ -51,7 +51,8 @@
 
 namespace VTOL_att_control
 {
-VtolAttitudeControl *g_control;
+VtolAttitudeControl *volatile g_control;
+int g_control_task = -1;	//task handle for VTOL attitude controller
 }
 
 /**
@@ -92,6 +93,7 @@ VtolAttitudeControl::VtolAttitudeControl()
 	_params_handles.fw_motors_off = param_find("VT_FW_MOT_OFFID");
 	_params_handles.vt_sweep_type = param_find("VT_SWEEP_TYPE");
 	_params_handles.vt_sweep_amp = param_find("VT_SWEEP_AMP");
+	_params_handles.vt_sweep_capture = param_find("VT_SWEEP_CAPT");
 	_params_handles.vt_vz_control_kp = param_find("VT_VZ_CONTROL_KP");
 	_params_handles.vt_vz_control_ki = param_find("VT_VZ_CONTROL_KI");
 	_params_handles.vt_vz_control_kd = param_find("VT_VZ_CONTROL_KD");
@@ -140,267 +142,33 @@ VtolAttitudeControl::VtolAttitudeControl()
 */
 VtolAttitudeControl::~VtolAttitudeControl()
 {
-	if (_control_task != -1) {
-		/* task wakes up every 100ms or so at the longest */
-		_task_should_exit = true;
-
-		/* wait for a second for the task to quit at our request */
-		unsigned i = 0;
-
-		do {
-			/* wait 20ms */
-			px4_usleep(20000);
-
-			/* if we have given up, kill it */
-			if (++i > 50) {
-				px4_task_delete(_control_task);
-				break;
-			}
-		} while (_control_task != -1);
-	}
-
 	// free memory used by instances of base class VtolType
 	if (_vtol_type != nullptr) {
 		delete _vtol_type;
 	}
-
-	VTOL_att_control::g_control = nullptr;
-}
-
-/**
-* Check for changes in vehicle control mode.
-*/
-void VtolAttitudeControl::vehicle_control_mode_poll()
-{
-	bool updated;
-
-	/* Check if vehicle control mode has changed */
-	orb_check(_v_control_mode_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(vehicle_control_mode), _v_control_mode_sub, &_v_control_mode);
-	}
-}
-
-/**
-* Check for changes in manual inputs.
-*/
-void VtolAttitudeControl::vehicle_manual_poll()
-{
-	bool updated;
-
-	/* get pilots inputs */
-	orb_check(_manual_control_sp_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(manual_control_setpoint), _manual_control_sp_sub, &_manual_control_sp);
-	}
-}
-
-/**
-* Check for inputs from mc attitude controller.
-*/
-void VtolAttitudeControl::actuator_controls_mc_poll()
-{
-	bool updated;
-	orb_check(_actuator_inputs_mc, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(actuator_controls_virtual_mc), _actuator_inputs_mc, &_actuators_mc_in);
-	}
-}
-
-/**
-* Check for inputs from fw attitude controller.
-*/
-void VtolAttitudeControl::actuator_controls_fw_poll()
-{
-	bool updated;
-	orb_check(_actuator_inputs_fw, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(actuator_controls_virtual_fw), _actuator_inputs_fw, &_actuators_fw_in);
-	}
-}
-
-/**
-* Check for airspeed updates.
-*/
-void
-VtolAttitudeControl::vehicle_airspeed_poll()
-{
-	bool updated;
-	orb_check(_airspeed_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(airspeed), _airspeed_sub, &_airspeed);
-	}
-}
-
-/**
-* Check for attitude update.
-*/
-void
-VtolAttitudeControl::vehicle_attitude_poll()
-{
-	/* check if there is a new setpoint */
-	bool updated;
-	orb_check(_v_att_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(vehicle_attitude), _v_att_sub, &_v_att);
-	}
 }
 
 /**
-* Check for sensor updates.
+* Add all input topics to the subscription group.
 */
-void
-VtolAttitudeControl::vehicle_local_pos_poll()
+void VtolAttitudeControl::subscriptions_init()
 {
-	bool updated;
-	/* Check if parameters have changed */
-	orb_check(_local_pos_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(vehicle_local_position), _local_pos_sub, &_local_pos);
-	}
-
-}
-
-/**
-* Check for setpoint updates.
-*/
-void
-VtolAttitudeControl::sensor_acc_poll()
-{
-	bool updated;
-	/* Check if parameters have changed */
-	orb_check(_sensor_acc_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(sensor_accel), _sensor_acc_sub, &_sensor_acc);
-	}
-
-}
-
-/**
-* Check for setpoint updates.
-*/
-void
-VtolAttitudeControl::vehicle_local_pos_sp_poll()
-{
-	bool updated;
-	/* Check if parameters have changed */
-	orb_check(_local_pos_sp_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(vehicle_local_position_setpoint), _local_pos_sp_sub, &_local_pos_sp);
-	}
-
-}
-
-/**
-* Check for position setpoint updates.
-*/
-void
-VtolAttitudeControl::pos_sp_triplet_poll()
-{
-	bool updated;
-	/* Check if parameters have changed */
-	orb_check(_pos_sp_triplet_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(position_setpoint_triplet), _pos_sp_triplet_sub, &_pos_sp_triplet);
-	}
-
-}
-
-/**
-* Check for mc virtual attitude setpoint updates.
-*/
-void
-VtolAttitudeControl::mc_virtual_att_sp_poll()
-{
-	bool updated;
-
-	orb_check(_mc_virtual_att_sp_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(mc_virtual_attitude_setpoint), _mc_virtual_att_sp_sub, &_mc_virtual_att_sp);
-	}
-}
-
-/**
-* Check for fw virtual attitude setpoint updates.
-*/
-void
-VtolAttitudeControl::fw_virtual_att_sp_poll()
-{
-	bool updated;
-
-	orb_check(_fw_virtual_att_sp_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(fw_virtual_attitude_setpoint), _fw_virtual_att_sp_sub, &_fw_virtual_att_sp);
-	}
-}
-
-/**
-* Check for command updates.
-*/
-void
-VtolAttitudeControl::vehicle_cmd_poll()
-{
-	bool updated;
-	orb_check(_vehicle_cmd_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(vehicle_command), _vehicle_cmd_sub, &_vehicle_cmd);
-		handle_command();
-	}
-}
-
-/**
-* Check for TECS status updates.
-*/
-void
-VtolAttitudeControl::tecs_status_poll()
-{
-	bool updated;
-
-	orb_check(_tecs_status_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(tecs_status), _tecs_status_sub, &_tecs_status);
-	}
-}
-
-/**
-* Check for land detector updates.
-*/
-void
-VtolAttitudeControl::land_detected_poll()
-{
-	bool updated;
-
-	orb_check(_land_detected_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(vehicle_land_detected), _land_detected_sub, &_land_detected);
-	}
-}
-
-void
-VtolAttitudeControl::mission_result_poll()
-{
-	bool updated;
-
-	orb_check(_mission_result_sub, &updated);
-
-	if (updated) {
-		orb_copy(ORB_ID(mission_result), _mission_result_sub, &_mission_result);
-	}
+	_sub_idx.mc_virtual_att_sp = _sub_group.add(ORB_ID(mc_virtual_attitude_setpoint), &_mc_virtual_att_sp);
+	_sub_idx.fw_virtual_att_sp = _sub_group.add(ORB_ID(fw_virtual_attitude_setpoint), &_fw_virtual_att_sp);
+	_sub_idx.v_att             = _sub_group.add(ORB_ID(vehicle_attitude), &_v_att);
+	_sub_idx.v_control_mode    = _sub_group.add(ORB_ID(vehicle_control_mode), &_v_control_mode);
+	_sub_idx.manual_control_sp = _sub_group.add(ORB_ID(manual_control_setpoint), &_manual_control_sp);
+	_sub_idx.local_pos         = _sub_group.add(ORB_ID(vehicle_local_position), &_local_pos);
+	_sub_idx.sensor_acc        = _sub_group.add(ORB_ID(sensor_accel), &_sensor_acc);
+	_sub_idx.local_pos_sp      = _sub_group.add(ORB_ID(vehicle_local_position_setpoint), &_local_pos_sp);
+	_sub_idx.pos_sp_triplet    = _sub_group.add(ORB_ID(position_setpoint_triplet), &_pos_sp_triplet);
+	_sub_idx.airspeed          = _sub_group.add(ORB_ID(airspeed), &_airspeed);
+	_sub_idx.vehicle_cmd       = _sub_group.add(ORB_ID(vehicle_command), &_vehicle_cmd);
+	_sub_idx.tecs_status       = _sub_group.add(ORB_ID(tecs_status), &_tecs_status);
+	_sub_idx.land_detected     = _sub_group.add(ORB_ID(vehicle_land_detected), &_land_detected);
+
+	_sub_idx.actuator_inputs_mc = _sub_group.add(ORB_ID(actuator_controls_virtual_mc), &_actuators_mc_in);
+	_sub_idx.actuator_inputs_fw = _sub_group.add(ORB_ID(actuator_controls_virtual_fw), &_actuators_fw_in);
 }
 
 /**
@@ -541,6 +309,9 @@ VtolAttitudeControl::parameters_update()
 
 	param_get(_params_handles.vt_sweep_amp, &_params.vt_sweep_amp);
 
+	param_get(_params_handles.vt_sweep_capture, &l);
+	_params.vt_sweep_capture = (l == 1);
+
 	param_get(_params_handles.vt_vz_control_kp, &_params.vt_vz_control_kp);
 
 	param_get(_params_handles.vt_vz_control_ki, &_params.vt_vz_control_ki);
@@ -637,7 +408,24 @@ VtolAttitudeControl::parameters_update()
 int
 VtolAttitudeControl::task_main_trampoline(int argc, char *argv[])
 {
-	VTOL_att_control::g_control->task_main();
+	/* create the controller in its own task: on NuttX uORB handles are per task, and the
+	 * subscription members subscribe on construction and unsubscribe on destruction */
+	VtolAttitudeControl *control = new VtolAttitudeControl;
+
+	if (control == nullptr) {
+		PX4_ERR("alloc failed");
+		VTOL_att_control::g_control_task = -1;
+		return 1;
+	}
+
+	VTOL_att_control::g_control = control;
+
+	control->task_main();
+
+	VTOL_att_control::g_control = nullptr;
+	delete control;
+
+	VTOL_att_control::g_control_task = -1;
 	return 0;
 }
 
@@ -646,25 +434,12 @@ void VtolAttitudeControl::task_main()
 	fflush(stdout);
 
 	/* do subscriptions */
-	_v_att_sp_sub          = orb_subscribe(ORB_ID(vehicle_attitude_setpoint));
-	_mc_virtual_att_sp_sub = orb_subscribe(ORB_ID(mc_virtual_attitude_setpoint));
-	_fw_virtual_att_sp_sub = orb_subscribe(ORB_ID(fw_virtual_attitude_setpoint));
-	_v_att_sub             = orb_subscribe(ORB_ID(vehicle_attitude));
-	_v_control_mode_sub    = orb_subscribe(ORB_ID(vehicle_control_mode));
+	subscriptions_init();
 	_params_sub            = orb_subscribe(ORB_ID(parameter_update));
-	_manual_control_sp_sub = orb_subscribe(ORB_ID(manual_control_setpoint));
-	_local_pos_sub         = orb_subscribe(ORB_ID(vehicle_local_position));
-	_sensor_acc_sub        = orb_subscribe(ORB_ID(sensor_accel));
-	_local_pos_sp_sub      = orb_subscribe(ORB_ID(vehicle_local_position_setpoint));
-	_pos_sp_triplet_sub    = orb_subscribe(ORB_ID(position_setpoint_triplet));
-	_airspeed_sub          = orb_subscribe(ORB_ID(airspeed));
-	_vehicle_cmd_sub	   = orb_subscribe(ORB_ID(vehicle_command));
-	_tecs_status_sub       = orb_subscribe(ORB_ID(tecs_status));
-	_land_detected_sub     = orb_subscribe(ORB_ID(vehicle_land_detected));
-	_mission_result_sub    = orb_subscribe(ORB_ID(mission_result));
-
-	_actuator_inputs_mc    = orb_subscribe(ORB_ID(actuator_controls_virtual_mc));
-	_actuator_inputs_fw    = orb_subscribe(ORB_ID(actuator_controls_virtual_fw));
+
+	/* the virtual attitude setpoints are only needed depending on the mode, after the state machine update */
+	const uint32_t virtual_att_sp_mask = uORB::SubscriptionGroup::bit(_sub_idx.mc_virtual_att_sp) |
+					     uORB::SubscriptionGroup::bit(_sub_idx.fw_virtual_att_sp);
 
 	parameters_update();  // initialize parameter cache
 
@@ -672,7 +447,7 @@ void VtolAttitudeControl::task_main()
 
 	/* wakeup source*/
 	px4_pollfd_struct_t fds[1] = {};
-	fds[0].fd     = _actuator_inputs_mc;
+	fds[0].fd     = _sub_group.handle(_sub_idx.actuator_inputs_mc);
 	fds[0].events = POLLIN;
 
 	while (!_task_should_exit) {
@@ -694,11 +469,11 @@ void VtolAttitudeControl::task_main()
 		case TRANSITION_TO_FW:
 		case TRANSITION_TO_MC:
 		case ROTARY_WING:
-			fds[0].fd = _actuator_inputs_mc;
+			fds[0].fd = _sub_group.handle(_sub_idx.actuator_inputs_mc);
 			break;
 
 		case FIXED_WING:
-			fds[0].fd = _actuator_inputs_fw;
+			fds[0].fd = _sub_group.handle(_sub_idx.actuator_inputs_fw);
 			break;
 		}
 
@@ -718,20 +493,20 @@ void VtolAttitudeControl::task_main()
 			continue;
 		}
 
-		vehicle_control_mode_poll();
-		vehicle_manual_poll();
-		vehicle_attitude_poll();
-		vehicle_local_pos_poll();
-		vehicle_local_pos_sp_poll();
-		sensor_acc_poll();
-		mission_result_poll();
-		pos_sp_triplet_poll();
-		vehicle_airspeed_poll();
-		vehicle_cmd_poll();
-		tecs_status_poll();
-		land_detected_poll();
-		actuator_controls_fw_poll();
-		actuator_controls_mc_poll();
+		/* check and copy all inputs in one pass */
+		const uint32_t updated = _sub_group.update(~virtual_att_sp_mask);
+
+		if (updated & uORB::SubscriptionGroup::bit(_sub_idx.vehicle_cmd)) {
+			handle_command();
+		}
+
+		/* the tailsitter system identification only needs the current mission item */
+		if (_mission_result_sub.updated()) {
+			_mission_result_sub.borrow([this](const mission_result_s & mission_result) {
+				_mission_result.seq_current = mission_result.seq_current;
+				_mission_result.instance_count = mission_result.instance_count;
+			});
+		}
 
 		// update the vtol state machine which decides which mode we are in
 		_vtol_type->update_vtol_state();
@@ -755,7 +530,7 @@ void VtolAttitudeControl::task_main()
 		// check in which mode we are in and call mode specific functions
 		if (_vtol_type->get_mode() == ROTARY_WING) {
 
-			mc_virtual_att_sp_poll();
+			_sub_group.update(uORB::SubscriptionGroup::bit(_sub_idx.mc_virtual_att_sp));
 
 			// vehicle is in rotary wing mode
 			_vtol_vehicle_status.vtol_in_rw_mode = true;
@@ -766,8 +541,7 @@ void VtolAttitudeControl::task_main()
 			_vtol_type->update_mc_state();
 
 		} else if (_vtol_type->get_mode() == FIXED_WING) {
-			mc_virtual_att_sp_poll();
-			fw_virtual_att_sp_poll();
+			_sub_group.update(virtual_att_sp_mask);
 
 			// vehicle is in fw mode
 			_vtol_vehicle_status.vtol_in_rw_mode = false;
@@ -779,8 +553,7 @@ void VtolAttitudeControl::task_main()
 
 		} else if (_vtol_type->get_mode() == TRANSITION_TO_MC || _vtol_type->get_mode() == TRANSITION_TO_FW) {
 
-			mc_virtual_att_sp_poll();
-			fw_virtual_att_sp_poll();
+			_sub_group.update(virtual_att_sp_mask);
 
 			// vehicle is doing a transition
 			_vtol_vehicle_status.vtol_in_trans_mode = true;
@@ -834,26 +607,52 @@ void VtolAttitudeControl::task_main()
 		}
 	}
 
+	orb_unsubscribe(_params_sub);
+
 	PX4_WARN("exit");
-	_control_task = -1;
 }
 
 int
 VtolAttitudeControl::start()
 {
-	/* start the task */
-	_control_task = px4_task_spawn_cmd("vtol_att_control",
-					   SCHED_DEFAULT,
-					   SCHED_PRIORITY_ATTITUDE_CONTROL + 1,
-					   1230,
-					   (px4_main_t)&VtolAttitudeControl::task_main_trampoline,
-					   nullptr);
-
-	if (_control_task < 0) {
+	/* start the task, it creates the controller. The stack includes the constructor (parameter lookups and
+	 * the VtolType construction), which used to run on the stack of the calling task. */
+	const int task = px4_task_spawn_cmd("vtol_att_control",
+					    SCHED_DEFAULT,
+					    SCHED_PRIORITY_ATTITUDE_CONTROL + 1,
+					    1500,
+					    (px4_main_t)&VtolAttitudeControl::task_main_trampoline,
+					    nullptr);
+
+	if (task < 0) {
 		PX4_WARN("task start failed");
 		return -errno;
 	}
 
+	VTOL_att_control::g_control_task = task;
+
+	/* wait for up to a second for the controller to exist, so that status and stop see it */
+	for (unsigned i = 0; i < 50 && VTOL_att_control::g_control == nullptr; i++) {
+		/* the task has already given up, e.g. on a failed allocation */
+		if (VTOL_att_control::g_control_task == -1) {
+			return PX4_ERROR;
+		}
+
+		px4_usleep(20000);
+	}
+
+	if (VTOL_att_control::g_control == nullptr) {
+		/* do not leave a task behind which could still come up after the failure has been reported */
+		PX4_ERR("controller not created, stopping the task");
+		px4_task_delete(task);
+		VTOL_att_control::g_control_task = -1;
+
+		/* it might have created the controller just before it was deleted */
+		delete VTOL_att_control::g_control;
+		VTOL_att_control::g_control = nullptr;
+		return PX4_ERROR;
+	}
+
 	return OK;
 }
 
@@ -867,21 +666,12 @@ int vtol_att_control_main(int argc, char *argv[])
 
 	if (!strcmp(argv[1], "start")) {
 
-		if (VTOL_att_control::g_control != nullptr) {
+		if (VTOL_att_control::g_control_task != -1) {
 			PX4_WARN("already running");
 			return 0;
 		}
 
-		VTOL_att_control::g_control = new VtolAttitudeControl;
-
-		if (VTOL_att_control::g_control == nullptr) {
-			PX4_WARN("alloc failed");
-			return 1;
-		}
-
-		if (OK != VTOL_att_control::g_control->start()) {
-			delete VTOL_att_control::g_control;
-			VTOL_att_control::g_control = nullptr;
+		if (OK != VtolAttitudeControl::start()) {
 			PX4_WARN("start failed");
 			return 1;
 		}
@@ -895,8 +685,27 @@ int vtol_att_control_main(int argc, char *argv[])
 			return 0;
 		}
 
-		delete VTOL_att_control::g_control;
-		VTOL_att_control::g_control = nullptr;
+		/* task wakes up every 100ms or so at the longest, it deletes the controller on exit */
+		VTOL_att_control::g_control->request_stop();
+
+		/* wait for a second for the task to quit at our request */
+		unsigned i = 0;
+
+		while (VTOL_att_control::g_control != nullptr) {
+			/* wait 20ms */
+			px4_usleep(20000);
+
+			/* if we have given up, kill it and free the controller it can no longer delete */
+			if (++i > 50) {
+				PX4_WARN("timeout, forcing stop");
+				px4_task_delete(VTOL_att_control::g_control_task);
+				VTOL_att_control::g_control_task = -1;
+				delete VTOL_att_control::g_control;
+				VTOL_att_control::g_control = nullptr;
+				break;
+			}
+		}
+
 		return 0;
 	}
 
@@ -61,6 +61,8 @@
 #include <mathlib/mathlib.h>
 #include <matrix/math.hpp>
 #include <parameters/param.h>
+#include <uORB/Subscription.hpp>
+#include <uORB/SubscriptionGroup.hpp>
 
 #include <uORB/topics/actuator_controls.h>
 #include <uORB/topics/airspeed.h>
@@ -95,7 +97,8 @@ public:
 	VtolAttitudeControl();
 	~VtolAttitudeControl();
 
-	int start();	/* start the task and return OK on success */
+	static int start();	/* start the task and return OK on success */
+	void request_stop() { _task_should_exit = true; }
 	bool is_fixed_wing_requested();
 	bool is_sweep_requested();
 	void abort_front_transition(const char *reason);
@@ -124,28 +127,32 @@ public:
 
 private:
 //******************flags & handlers******************************************************
-	bool	_task_should_exit{false};
-	int	_control_task{-1};		//task handle for VTOL attitude controller
-
-	/* handlers for subscriptions */
-	int	_actuator_inputs_fw{-1};	//topic on which the fw_att_controller publishes actuator inputs
-	int	_actuator_inputs_mc{-1};	//topic on which the mc_att_controller publishes actuator inputs
-	int	_airspeed_sub{-1};			// airspeed subscription
-	int	_fw_virtual_att_sp_sub{-1};
-	int	_land_detected_sub{-1};
-	int	_local_pos_sp_sub{-1};			// setpoint subscription
-	int	_local_pos_sub{-1};			// sensor subscription
-	int _sensor_acc_sub{-1};
-	int	_manual_control_sp_sub{-1};	//manual control setpoint subscription
-	int	_mc_virtual_att_sp_sub{-1};
+	volatile bool	_task_should_exit{false};
+
+	/* subscriptions: all input topics are checked and copied in one pass per cycle through _sub_group */
+	uORB::SubscriptionGroup _sub_group;
+
+	struct {
+		int	actuator_inputs_fw{-1};	//topic on which the fw_att_controller publishes actuator inputs
+		int	actuator_inputs_mc{-1};	//topic on which the mc_att_controller publishes actuator inputs
+		int	airspeed{-1};			// airspeed subscription
+		int	fw_virtual_att_sp{-1};
+		int	land_detected{-1};
+		int	local_pos_sp{-1};		// setpoint subscription
+		int	local_pos{-1};			// sensor subscription
+		int	sensor_acc{-1};
+		int	manual_control_sp{-1};	//manual control setpoint subscription
+		int	mc_virtual_att_sp{-1};
+		int	pos_sp_triplet{-1};		// local position setpoint subscription
+		int	tecs_status{-1};
+		int	v_att{-1};			//vehicle attitude subscription
+		int	v_control_mode{-1};		//vehicle control mode subscription
+		int	vehicle_cmd{-1};
+	} _sub_idx;
+
 	int	_params_sub{-1};			//parameter updates subscription
-	int	_pos_sp_triplet_sub{-1};			// local position setpoint subscription
-	int	_tecs_status_sub{-1};
-	int	_v_att_sp_sub{-1};			//vehicle attitude setpoint subscription
-	int	_v_att_sub{-1};				//vehicle attitude subscription
-	int	_v_control_mode_sub{-1};	//vehicle control mode subscription
-	int	_vehicle_cmd_sub{-1};
-	int _mission_result_sub{-1};
+
+	uORB::Subscription<mission_result_s>	_mission_result_sub{ORB_ID(mission_result)};	// read in place
 
 	//handlers for publishers
 	orb_advert_t	_actuators_0_pub{nullptr};		//input for the mixer (roll,pitch,yaw,thrust)
@@ -211,6 +218,7 @@ private:
 		param_t fw_motors_off;
 		param_t vt_sweep_type;
 		param_t vt_sweep_amp;
+		param_t vt_sweep_capture;
 		param_t vt_vz_control_kp;
 		param_t vt_vz_control_ki;
 		param_t vt_vz_control_kd;
@@ -249,24 +257,9 @@ private:
 //*****************Member functions***********************************************************************
 
 	void 		task_main();	//main task
-	static int	task_main_trampoline(int argc, char *argv[]);	//Shim for calling task_main from task_create.
-
-	void		land_detected_poll();
-	void		tecs_status_poll();
-	void		vehicle_attitude_poll();  //Check for attitude updates.
-	void		vehicle_cmd_poll();
-	void		vehicle_control_mode_poll();	//Check for changes in vehicle control mode.
-	void		vehicle_manual_poll();			//Check for changes in manual inputs.
-	void 		actuator_controls_fw_poll();	//Check for changes in fw_attitude_control output
-	void 		actuator_controls_mc_poll();	//Check for changes in mc_attitude_control output
-	void 		fw_virtual_att_sp_poll();
-	void 		mc_virtual_att_sp_poll();
-	void 		pos_sp_triplet_poll();		// Check for changes in position setpoint values
-	void 		vehicle_airspeed_poll();		// Check for changes in airspeed
-	void 		vehicle_local_pos_poll();		// Check for changes in sensor values
-	void 		vehicle_local_pos_sp_poll();		// Check for changes in setpoint values
-	void        sensor_acc_poll();
-	void        mission_result_poll();
+	static int	task_main_trampoline(int argc, char *argv[]);	//Creates the controller and runs task_main
+
+	void		subscriptions_init();		//Add all input topics to _sub_group
 
 	int 		parameters_update();			//Update local parameter cache
 
@@ -99,12 +99,15 @@ PARAM_DEFINE_INT32(VT_ELEV_MC_LOCK, 1);
 /**
  * Choose the channel put in the sweep signal
  *
- * 0: no sweep signal
- * 1: pitch rate
- * 2: roll rate
- * 3: yaw rate
+ * The excitation signal of each channel is set with VT_SWP_SIG_R/P/Y/T.
  *
- * @boolean
+ * @value 0 No sweep signal
+ * @value 1 Pitch rate
+ * @value 2 Roll rate
+ * @value 3 Yaw rate
+ * @value 4 Thrust
+ * @min 0
+ * @max 4
  * @group VTOL Attitude Control
  */
 PARAM_DEFINE_INT32(VT_SWEEP_TYPE, 0);
@@ -118,6 +121,145 @@ PARAM_DEFINE_INT32(VT_SWEEP_TYPE, 0);
  */
 PARAM_DEFINE_FLOAT(VT_SWEEP_AMP, 0.2f);
 
+/**
+ * Capture sweep experiments at full rate
+ *
+ * If set to 1, gyro, actuator and sweep input data is recorded every control
+ * cycle while a sweep is running, and written to a separate log file
+ * (log/sysid/sweepNNN.ulg). Requires about 30kB of RAM if VT_SWEEP_TYPE is set.
+ *
+ * @boolean
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_INT32(VT_SWEEP_CAPT, 1);
+
+/**
+ * Sweep signal for the roll rate axis
+ *
+ * Excitation signal used if VT_SWEEP_TYPE is set to roll rate.
+ * The chirp and multisine frequencies are set with VT_SWP_FMIN and VT_SWP_FMAX.
+ *
+ * @value 0 Sine (VT_SWP_FSINE)
+ * @value 1 Linear chirp
+ * @value 2 Exponential chirp
+ * @value 3 Multisine
+ * @value 4 Doublet
+ * @value 5 3-2-1-1
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_INT32(VT_SWP_SIG_R, 0);
+
+/**
+ * Sweep signal for the pitch rate axis
+ *
+ * Excitation signal used if VT_SWEEP_TYPE is set to pitch rate.
+ *
+ * @value 0 Sine (VT_SWP_FSINE)
+ * @value 1 Linear chirp
+ * @value 2 Exponential chirp
+ * @value 3 Multisine
+ * @value 4 Doublet
+ * @value 5 3-2-1-1
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_INT32(VT_SWP_SIG_P, 0);
+
+/**
+ * Sweep signal for the yaw rate axis
+ *
+ * Excitation signal used if VT_SWEEP_TYPE is set to yaw rate.
+ *
+ * @value 0 Sine (VT_SWP_FSINE)
+ * @value 1 Linear chirp
+ * @value 2 Exponential chirp
+ * @value 3 Multisine
+ * @value 4 Doublet
+ * @value 5 3-2-1-1
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_INT32(VT_SWP_SIG_Y, 0);
+
+/**
+ * Sweep signal for the thrust axis
+ *
+ * Excitation signal used if VT_SWEEP_TYPE is set to thrust.
+ *
+ * @value 0 Sine (VT_SWP_FSINE)
+ * @value 1 Linear chirp
+ * @value 2 Exponential chirp
+ * @value 3 Multisine
+ * @value 4 Doublet
+ * @value 5 3-2-1-1
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_INT32(VT_SWP_SIG_T, 2);
+
+/**
+ * Sweep start frequency
+ *
+ * Start frequency of chirps and lowest frequency of the multisine.
+ *
+ * @unit Hz
+ * @min 0.05
+ * @max 100
+ * @decimal 2
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_FLOAT(VT_SWP_FMIN, 0.5f);
+
+/**
+ * Sweep end frequency
+ *
+ * End frequency of chirps and highest frequency of the multisine.
+ * Limited to 40% of the control rate to avoid aliasing.
+ *
+ * @unit Hz
+ * @min 0.05
+ * @max 100
+ * @decimal 2
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_FLOAT(VT_SWP_FMAX, 80.0f);
+
+/**
+ * Sweep duration
+ *
+ * Duration of chirps and multisines. The signal stops afterwards.
+ *
+ * @unit s
+ * @min 1
+ * @max 600
+ * @decimal 1
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_FLOAT(VT_SWP_TIME, 150.0f);
+
+/**
+ * Sweep sine frequency
+ *
+ * Frequency of the constant sine excitation.
+ *
+ * @unit Hz
+ * @min 0.05
+ * @max 100
+ * @decimal 2
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_FLOAT(VT_SWP_FSINE, 8.0f);
+
+/**
+ * Sweep pulse width
+ *
+ * Base pulse width of the doublet and 3-2-1-1 signals.
+ *
+ * @unit s
+ * @min 0.02
+ * @max 5
+ * @decimal 2
+ * @group VTOL Attitude Control
+ */
+PARAM_DEFINE_FLOAT(VT_SWP_PW, 0.5f);
+
 /*
 * The parameters of the vertical velocity controller
 * Kp 
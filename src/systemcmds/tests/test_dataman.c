@@ -156,6 +156,68 @@ fail:
 	return -1;
 }
 
+static int
+test_dataman_range(void)
+{
+	const size_t item_size = sizeof(struct mission_item_s);
+	uint8_t *items = (uint8_t *)malloc(NUM_MISSIONS_TEST * item_size);
+	uint8_t *read_items = (uint8_t *)malloc(NUM_MISSIONS_TEST * item_size);
+	int result = -1;
+
+	if (items == NULL || read_items == NULL) {
+		PX4_ERR("alloc failed");
+		goto out;
+	}
+
+	for (unsigned i = 0; i < NUM_MISSIONS_TEST * item_size; i++) {
+		items[i] = (uint8_t)(i * 7 + i / item_size);
+	}
+
+	/* out of bounds ranges are rejected */
+	if (dm_write_range(DM_KEY_WAYPOINTS_OFFBOARD_1, DM_KEY_WAYPOINTS_OFFBOARD_1_MAX - 1, 2,
+			   DM_PERSIST_IN_FLIGHT_RESET, items, item_size) >= 0 ||
+	    dm_read_range(DM_KEY_NUM_KEYS, 0, 1, read_items, item_size) >= 0) {
+		PX4_ERR("range out of bounds not rejected");
+		goto out;
+	}
+
+	/* write all but the last item, which is empty after the power-on restart above */
+	if (dm_write_range(DM_KEY_WAYPOINTS_OFFBOARD_1, 0, NUM_MISSIONS_TEST - 1, DM_PERSIST_IN_FLIGHT_RESET, items,
+			   item_size) != NUM_MISSIONS_TEST - 1) {
+		PX4_ERR("range write failed");
+		goto out;
+	}
+
+	/* the range read stops at the empty item */
+	if (dm_read_range(DM_KEY_WAYPOINTS_OFFBOARD_1, 0, NUM_MISSIONS_TEST, read_items, item_size) !=
+	    NUM_MISSIONS_TEST - 1) {
+		PX4_ERR("range read failed");
+		goto out;
+	}
+
+	if (memcmp(items, read_items, (NUM_MISSIONS_TEST - 1) * item_size) != 0) {
+		PX4_ERR("range read data verification failed");
+		goto out;
+	}
+
+	/* range writes are compatible with single item reads */
+	for (unsigned i = 0; i < NUM_MISSIONS_TEST - 1; i++) {
+		if (dm_read(DM_KEY_WAYPOINTS_OFFBOARD_1, i, read_items, item_size) != (ssize_t)item_size ||
+		    memcmp(&items[i * item_size], read_items, item_size) != 0) {
+			PX4_ERR("single read of range write failed, index %d", i);
+			goto out;
+		}
+	}
+
+	result = 0;
+
+out:
+	free(items);
+	free(read_items);
+	dm_clear(DM_KEY_WAYPOINTS_OFFBOARD_1);
+	return result;
+}
+
 int test_dataman(int argc, char *argv[])
 {
 	int i = 0;
@@ -233,5 +295,5 @@ int test_dataman(int argc, char *argv[])
 		}
 	}
 
-	return 0;
+	return test_dataman_range();
 }
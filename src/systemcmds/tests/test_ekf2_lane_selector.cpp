@@ -0,0 +1,191 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file test_ekf2_lane_selector.cpp
+ * Tests for the selection of the published ekf2 estimator lane.
+ */
+
+#include <unit_test.h>
+
+#include <math.h>
+
+#include <ekf2/LaneSelector.hpp>
+
+class Ekf2LaneSelectorTest : public UnitTest
+{
+public:
+	virtual bool run_tests();
+
+private:
+	bool initialTest();
+	bool hysteresisTest();
+	bool intervalTest();
+	bool failureTest();
+	bool unhealthyTest();
+
+	/** run num_updates estimator updates of 4 ms with constant test ratios and health */
+	uint8_t run(LaneSelector &selector, const float (&ratio)[3], const bool (&healthy)[3], unsigned num_updates)
+	{
+		uint8_t selected = selector.selected();
+
+		for (unsigned i = 0; i < num_updates; i++) {
+			for (uint8_t lane = 0; lane < 3; lane++) {
+				selector.update(lane, ratio[lane], healthy[lane]);
+			}
+
+			_now += 4_ms;
+			selected = selector.select(3, _now, HYSTERESIS);
+		}
+
+		return selected;
+	}
+
+	static constexpr float HYSTERESIS{0.3f};
+
+	hrt_abstime _now{0};
+};
+
+bool Ekf2LaneSelectorTest::run_tests()
+{
+	ut_run_test(initialTest);
+	ut_run_test(hysteresisTest);
+	ut_run_test(intervalTest);
+	ut_run_test(failureTest);
+	ut_run_test(unhealthyTest);
+
+	return (_tests_failed == 0);
+}
+
+bool Ekf2LaneSelectorTest::initialTest()
+{
+	LaneSelector selector;
+	_now = 20_s;
+
+	// all lanes equal, the first one stays selected
+	ut_compare("first lane selected", run(selector, {0.2f, 0.2f, 0.2f}, {true, true, true}, 1000), 0);
+	ut_compare("no switch", selector.switch_count(), 0);
+
+	// lanes which did not update keep their filtered test ratio
+	selector.update(1, NAN, true);
+	ut_assert("test ratio kept", fabsf(selector.test_ratio(1) - 0.2f) < 0.01f);
+	return true;
+}
+
+bool Ekf2LaneSelectorTest::hysteresisTest()
+{
+	LaneSelector selector;
+	_now = 20_s;
+
+	// a better lane which does not improve by the hysteresis is not selected
+	ut_compare("small improvement", run(selector, {0.5f, 0.3f, 0.6f}, {true, true, true}, 5000), 0);
+
+	// once the filtered test ratio has dropped by more than the hysteresis the better lane is selected
+	ut_compare("large improvement", run(selector, {0.7f, 0.3f, 0.6f}, {true, true, true}, 5000), 1);
+	ut_compare("one switch", selector.switch_count(), 1);
+
+	// the previous lane has to become better by the hysteresis again
+	ut_compare("switch back hysteresis", run(selector, {0.2f, 0.3f, 0.6f}, {true, true, true}, 5000), 1);
+	ut_compare("still one switch", selector.switch_count(), 1);
+	return true;
+}
+
+bool Ekf2LaneSelectorTest::intervalTest()
+{
+	LaneSelector selector;
+	_now = 20_s;
+
+	while (selector.selected() == 0) {
+		ut_assert("switch to better lane", _now < 25_s);
+		run(selector, {0.9f, 0.1f, 0.9f}, {true, true, true}, 1);
+	}
+
+	ut_compare("better lane", selector.selected(), 1);
+	const hrt_abstime switch_time = _now;
+
+	// a healthy lane is not left for a better one within the switch interval
+	ut_compare("better lane within interval", run(selector, {0.9f, 0.9f, 0.0f}, {true, true, true}, 1000), 1);
+	ut_assert("filtered ratio converged", selector.test_ratio(1) - selector.test_ratio(2) > HYSTERESIS);
+	ut_assert("within interval", _now - switch_time < LaneSelector::SWITCH_INTERVAL_MIN);
+
+	while (_now + 4_ms - switch_time <= LaneSelector::SWITCH_INTERVAL_MIN) {
+		ut_compare("no switch within interval", run(selector, {0.9f, 0.9f, 0.0f}, {true, true, true}, 1), 1);
+	}
+
+	ut_compare("switch after the interval", run(selector, {0.9f, 0.9f, 0.0f}, {true, true, true}, 1), 2);
+	ut_compare("two switches", selector.switch_count(), 2);
+	return true;
+}
+
+bool Ekf2LaneSelectorTest::failureTest()
+{
+	LaneSelector selector;
+	_now = 20_s;
+
+	ut_compare("switch to better lane", run(selector, {0.9f, 0.1f, 0.5f}, {true, true, true}, 1000), 1);
+
+	// a failed lane is left immediately, also within the switch interval and for a lane with a worse test ratio
+	ut_compare("leave failed lane", run(selector, {0.9f, 0.1f, 0.5f}, {true, false, true}, 1), 2);
+	ut_compare("two switches", selector.switch_count(), 2);
+
+	// the failed lane is not selected again while unhealthy, even with the lowest test ratio
+	ut_compare("failed lane not selected", run(selector, {0.9f, 0.0f, 0.5f}, {true, false, true}, 5000), 2);
+	return true;
+}
+
+bool Ekf2LaneSelectorTest::unhealthyTest()
+{
+	LaneSelector selector;
+	_now = 20_s;
+
+	// without a healthy lane the selection does not change
+	ut_compare("no healthy lane", run(selector, {0.9f, 0.1f, 0.1f}, {false, false, false}, 10), 0);
+	ut_compare("no switch", selector.switch_count(), 0);
+
+	// lanes beyond the running ones are never selected
+	selector.reset();
+
+	for (unsigned i = 0; i < 1000; i++) {
+		selector.update(0, 0.9f, false);
+		selector.update(1, 0.9f, true);
+		selector.update(2, 0.0f, true);
+		_now += 4_ms;
+		selector.select(2, _now, HYSTERESIS);
+	}
+
+	ut_compare("only running lanes", selector.selected(), 1);
+	return true;
+}
+
+ut_declare_test_c(test_ekf2_lane_selector, Ekf2LaneSelectorTest)
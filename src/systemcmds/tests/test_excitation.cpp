@@ -0,0 +1,300 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file test_excitation.cpp
+ * Tests for the system identification excitation signal generator.
+ */
+
+#include <unit_test.h>
+
+#include <errno.h>
+#include <math.h>
+
+#include <excitation/Excitation.hpp>
+
+using namespace excitation;
+
+class ExcitationTest : public UnitTest
+{
+public:
+	virtual bool run_tests();
+
+private:
+	bool sineTest();
+	bool linearChirpTest();
+	bool exponentialChirpTest();
+	bool multisineTest();
+	bool pulseTest();
+	bool limitsTest();
+
+	/** compare the generator against the sine of a reference phase (in cycles) */
+	bool compareToPhase(Generator &generator, const double *phase, int num_samples, float amplitude,
+			    float tolerance = 2e-3f);
+};
+
+bool ExcitationTest::run_tests()
+{
+	ut_run_test(sineTest);
+	ut_run_test(linearChirpTest);
+	ut_run_test(exponentialChirpTest);
+	ut_run_test(multisineTest);
+	ut_run_test(pulseTest);
+	ut_run_test(limitsTest);
+
+	return (_tests_failed == 0);
+}
+
+bool ExcitationTest::compareToPhase(Generator &generator, const double *phase, int num_samples, float amplitude,
+				   float tolerance)
+{
+	float max_error = 0.f;
+
+	for (int i = 0; i < num_samples; ++i) {
+		const float expected = amplitude * (float)sin(2.0 * M_PI * phase[i]);
+		max_error = fmaxf(max_error, fabsf(generator.next() - expected));
+	}
+
+	ut_assert("signal deviates from reference", max_error < tolerance * amplitude);
+	return true;
+}
+
+bool ExcitationTest::sineTest()
+{
+	Config config;
+	config.type = Type::Sine;
+	config.amplitude = 0.2f;
+	config.f_min = 8.f;
+	config.duration = 0.f;
+	config.sample_rate = 250.f;
+
+	Generator generator;
+	ut_compare("configure failed", generator.configure(config), 0);
+
+	static constexpr int N = 5000;
+	static double phase[N];
+
+	for (int i = 0; i < N; ++i) {
+		phase[i] = 8.0 * i / 250.0;
+	}
+
+	if (!compareToPhase(generator, phase, N, config.amplitude)) {
+		return false;
+	}
+
+	ut_assert_false(generator.finished());
+	ut_assert("wrong frequency", fabsf(generator.frequency() - 8.f) < 1e-3f);
+	return true;
+}
+
+bool ExcitationTest::linearChirpTest()
+{
+	Config config;
+	config.type = Type::LinearChirp;
+	config.amplitude = 1.f;
+	config.f_min = 0.5f;
+	config.f_max = 80.f;
+	config.duration = 20.f;
+	config.sample_rate = 250.f;
+
+	Generator generator;
+	ut_compare("configure failed", generator.configure(config), 0);
+
+	// discrete phase: sum of the per-sample frequencies
+	static constexpr int N = 5000;
+	static double phase[N];
+	double p = 0.0;
+
+	for (int i = 0; i < N; ++i) {
+		phase[i] = p;
+		const double f = 0.5 + (80.0 - 0.5) * i / N;
+		p += f / 250.0;
+	}
+
+	if (!compareToPhase(generator, phase, N, config.amplitude)) {
+		return false;
+	}
+
+	ut_assert("end frequency", fabsf(generator.frequency() - 80.f) < 0.05f);
+	ut_assert_true(generator.finished());
+	ut_assert("output after end", generator.next() == 0.f);
+	return true;
+}
+
+bool ExcitationTest::exponentialChirpTest()
+{
+	Config config;
+	config.type = Type::ExponentialChirp;
+	config.amplitude = 1.f;
+	config.f_min = 0.5f;
+	config.f_max = 80.f;
+	config.duration = 60.f;
+	config.sample_rate = 250.f;
+
+	Generator generator;
+	ut_compare("configure failed", generator.configure(config), 0);
+
+	static constexpr int N = 15000;
+	static double phase[N];
+	double p = 0.0;
+
+	for (int i = 0; i < N; ++i) {
+		phase[i] = p;
+		const double f = 0.5 + 0.0187 * (80.0 - 0.5) * (exp(4.0 * i / N) - 1.0);
+		p += f / 250.0;
+	}
+
+	// the float recurrence accumulates a small phase error (< 0.001 periods here)
+	if (!compareToPhase(generator, phase, N, config.amplitude, 5e-3f)) {
+		return false;
+	}
+
+	// 0.0187 * (e^4 - 1) is not exactly 1
+	ut_assert("end frequency", fabsf(generator.frequency() - 80.f) < 1.f);
+	return true;
+}
+
+bool ExcitationTest::multisineTest()
+{
+	Config config;
+	config.type = Type::Multisine;
+	config.amplitude = 1.f;
+	config.f_min = 1.f;
+	config.f_max = 40.f;
+	config.duration = 4.f;
+	config.sample_rate = 250.f;
+
+	Generator generator;
+	ut_compare("configure failed", generator.configure(config), 0);
+
+	static constexpr int N = 1000;
+	static float period[N];
+	generator.generate(period, N);
+	ut_assert_true(generator.finished());
+
+	float peak = 0.f;
+	double sum_squares = 0.0;
+
+	for (int i = 0; i < N; ++i) {
+		peak = fmaxf(peak, fabsf(period[i]));
+		sum_squares += (double)(period[i] * period[i]);
+	}
+
+	// same power as a single sine of the configured amplitude, with a bounded crest factor
+	ut_assert("rms", fabsf((float)sqrt(sum_squares / N) - 1.f / sqrtf(2.f)) < 0.02f);
+	ut_less_than("peak too large", peak, 2.f);
+
+	// the frequencies are snapped to full periods within the duration, so a restart continues seamlessly
+	generator.reset();
+	ut_assert("not periodic", fabsf(generator.next() - period[0]) < 1e-6f);
+	return true;
+}
+
+bool ExcitationTest::pulseTest()
+{
+	Config config;
+	config.type = Type::Doublet;
+	config.amplitude = 0.5f;
+	config.pulse_width = 0.1f;
+	config.sample_rate = 250.f;
+
+	Generator generator;
+	ut_compare("configure failed", generator.configure(config), 0);
+
+	float sum = 0.f;
+	int num_samples = 0;
+
+	while (!generator.finished()) {
+		sum += generator.next();
+		++num_samples;
+	}
+
+	ut_compare("doublet length", num_samples, 50);
+	ut_assert("doublet not balanced", fabsf(sum) < 1e-4f);
+
+	config.type = Type::Sequence3211;
+	ut_compare("configure failed", generator.configure(config), 0);
+
+	static const float expected[7] = {0.5f, 0.5f, 0.5f, -0.5f, -0.5f, 0.5f, -0.5f};
+
+	for (int pulse = 0; pulse < 7; ++pulse) {
+		for (int i = 0; i < 25; ++i) {
+			ut_assert("3-2-1-1 pulse", generator.next() == expected[pulse]);
+		}
+	}
+
+	ut_assert_true(generator.finished());
+	return true;
+}
+
+bool ExcitationTest::limitsTest()
+{
+	Config config;
+	config.type = Type::LinearChirp;
+	config.amplitude = 1.f;
+	config.f_min = 1.f;
+	config.f_max = 500.f;
+	config.duration = 2.f;
+	config.sample_rate = 250.f;
+
+	Generator generator;
+	ut_compare("configure failed", generator.configure(config), 0);
+
+	float max_frequency = 0.f;
+
+	while (!generator.finished()) {
+		generator.next();
+		max_frequency = fmaxf(max_frequency, generator.frequency());
+	}
+
+	ut_less_than("frequency not limited", max_frequency, Generator::MAX_FREQUENCY_RATIO * 250.f + 0.01f);
+
+	config.duration = 0.f;
+	ut_compare("chirp without duration", generator.configure(config), -EINVAL);
+	ut_assert("invalid generator output", generator.next() == 0.f);
+
+	config.type = Type::Sine;
+	config.sample_rate = 0.f;
+	ut_compare("zero sample rate", generator.configure(config), -EINVAL);
+
+	// signal types come from a parameter, out of range values must be rejected
+	config.sample_rate = 250.f;
+	config.type = static_cast<Type>(-1);
+	ut_compare("negative signal type", generator.configure(config), -EINVAL);
+	config.type = Type::Count;
+	ut_compare("signal type out of range", generator.configure(config), -EINVAL);
+	return true;
+}
+
+ut_declare_test_c(test_excitation, ExcitationTest)
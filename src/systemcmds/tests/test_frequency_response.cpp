@@ -0,0 +1,243 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file test_frequency_response.cpp
+ * Tests for the streaming frequency response estimator.
+ */
+
+#include <unit_test.h>
+
+#include <errno.h>
+#include <math.h>
+
+#include <excitation/Excitation.hpp>
+#include <frequency_response/FrequencyResponse.hpp>
+
+using namespace frequency_response;
+
+class FrequencyResponseTest : public UnitTest
+{
+public:
+	virtual bool run_tests();
+
+private:
+	bool sineTest();
+	bool chirpTest();
+	bool noiseTest();
+	bool configTest();
+
+	/** first order low-pass y[n] = a * y[n-1] + (1 - a) * u[n] */
+	struct LowPass {
+		explicit LowPass(float a_) : a(a_) {}
+
+		float a;
+		float y{0.f};
+
+		float update(float u) { y = a * y + (1.f - a) * u; return y; }
+
+		void response(float frequency, float sample_rate, float &gain, float &phase) const
+		{
+			// H(z) = (1 - a) / (1 - a z^-1)
+			const float w = 2.f * M_PI_F * frequency / sample_rate;
+			const float re = 1.f - a * cosf(w);
+			const float im = a * sinf(w);
+			gain = (1.f - a) / sqrtf(re * re + im * im);
+			phase = -atan2f(im, re);
+		}
+	};
+
+	/** deterministic uniform noise in [-1, 1] */
+	float noise()
+	{
+		_noise_state = _noise_state * 1664525u + 1013904223u;
+		return (float)(_noise_state >> 8) / (float)(1 << 23) - 1.f;
+	}
+
+	uint32_t _noise_state{1};
+};
+
+bool FrequencyResponseTest::run_tests()
+{
+	ut_run_test(sineTest);
+	ut_run_test(chirpTest);
+	ut_run_test(noiseTest);
+	ut_run_test(configTest);
+
+	return (_tests_failed == 0);
+}
+
+bool FrequencyResponseTest::sineTest()
+{
+	Config config;
+	config.f_min = 1.f;
+	config.f_max = 20.f;
+	config.num_bins = 3;
+	config.sample_rate = 250.f;
+
+	Estimator estimator;
+	ut_compare("configure failed", estimator.configure(config), 0);
+
+	Result result;
+	ut_assert_true(estimator.get(1, result) == false);
+
+	LowPass filter{0.95f};
+	const float frequency = result.frequency;
+	const float w = 2.f * M_PI_F * frequency / config.sample_rate;
+
+	for (int i = 0; i < 5000; ++i) {
+		const float u = 0.3f * sinf(w * i);
+		estimator.update(u, filter.update(u));
+	}
+
+	ut_assert_true(estimator.get(1, result));
+
+	float gain;
+	float phase;
+	filter.response(frequency, config.sample_rate, gain, phase);
+
+	ut_assert("gain", fabsf(result.gain - gain) < 0.02f * gain);
+	ut_assert("phase", fabsf(result.phase - phase) < 0.02f);
+	ut_assert("coherence", result.coherence > 0.99f);
+	ut_assert("input power", fabsf(result.input_power - 0.3f * 0.3f) < 1e-3f);
+	return true;
+}
+
+bool FrequencyResponseTest::chirpTest()
+{
+	excitation::Config sweep;
+	sweep.type = excitation::Type::ExponentialChirp;
+	sweep.amplitude = 0.1f;
+	sweep.f_min = 0.5f;
+	sweep.f_max = 30.f;
+	sweep.duration = 60.f;
+	sweep.sample_rate = 250.f;
+
+	excitation::Generator generator;
+	ut_compare("configure sweep failed", generator.configure(sweep), 0);
+
+	Config config;
+	config.f_min = 1.f;
+	config.f_max = 20.f;
+	config.num_bins = 8;
+	config.sample_rate = sweep.sample_rate;
+
+	Estimator estimator;
+	ut_compare("configure failed", estimator.configure(config), 0);
+
+	LowPass filter{0.9f};
+
+	while (!generator.finished()) {
+		const float u = generator.next();
+		estimator.update(u, filter.update(u) + 0.002f * noise());
+	}
+
+	for (int i = 0; i < estimator.num_bins(); ++i) {
+		Result result;
+		ut_assert_true(estimator.get(i, result));
+
+		float gain;
+		float phase;
+		filter.response(result.frequency, config.sample_rate, gain, phase);
+
+		ut_assert("gain", fabsf(result.gain - gain) < 0.1f * gain);
+		ut_assert("phase", fabsf(result.phase - phase) < 0.05f);
+		ut_assert("coherence", result.coherence > 0.95f);
+	}
+
+	return true;
+}
+
+bool FrequencyResponseTest::noiseTest()
+{
+	Config config;
+	config.f_min = 2.f;
+	config.f_max = 10.f;
+	config.num_bins = 4;
+	config.sample_rate = 250.f;
+
+	Estimator estimator;
+	ut_compare("configure failed", estimator.configure(config), 0);
+
+	// output uncorrelated with the input
+	for (int i = 0; i < 50000; ++i) {
+		const float u = noise();
+		estimator.update(u, noise());
+	}
+
+	for (int i = 0; i < estimator.num_bins(); ++i) {
+		Result result;
+		ut_assert_true(estimator.get(i, result));
+		ut_assert("coherence of uncorrelated signals", result.coherence < 0.2f);
+	}
+
+	return true;
+}
+
+bool FrequencyResponseTest::configTest()
+{
+	Config config;
+	config.f_min = 0.5f;
+	config.f_max = 200.f;
+	config.num_bins = Estimator::MAX_BINS;
+	config.sample_rate = 250.f;
+
+	Estimator estimator;
+	ut_compare("configure failed", estimator.configure(config), 0);
+	ut_compare("bins", estimator.num_bins(), Estimator::MAX_BINS);
+
+	Result first;
+	Result last;
+	estimator.get(0, first);
+	estimator.get(Estimator::MAX_BINS - 1, last);
+
+	ut_assert("lowest frequency", fabsf(first.frequency - 0.5f) < 0.01f);
+	ut_assert("frequency not limited", last.frequency < Estimator::MAX_FREQUENCY_RATIO * 250.f + 1.f);
+	ut_assert_false(estimator.get(Estimator::MAX_BINS, last));
+
+	config.num_bins = Estimator::MAX_BINS + 1;
+	ut_compare("too many bins", estimator.configure(config), -EINVAL);
+	ut_compare("no bins after failure", estimator.num_bins(), 0);
+
+	config.num_bins = 4;
+	config.f_max = 0.1f;
+	ut_compare("f_max < f_min", estimator.configure(config), -EINVAL);
+
+	config.f_max = 10.f;
+	config.forgetting = 0.f;
+	ut_compare("zero forgetting", estimator.configure(config), -EINVAL);
+	return true;
+}
+
+ut_declare_test_c(test_frequency_response, FrequencyResponseTest)
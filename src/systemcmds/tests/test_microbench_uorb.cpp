@@ -42,11 +42,28 @@
 #include <px4_config.h>
 #include <px4_micro_hal.h>
 
+#include <uORB/Subscription.hpp>
 #include <uORB/topics/sensor_accel.h>
 #include <uORB/topics/sensor_gyro.h>
 #include <uORB/topics/vehicle_local_position.h>
 #include <uORB/topics/vehicle_status.h>
 
+#ifdef __PX4_POSIX
+#include <pthread.h>
+#endif
+
+/* benchmark-only topics, sized like a larger sensor message */
+struct microbench_orb_s {
+	uint64_t timestamp;
+	uint32_t seq;
+	uint32_t check[62];
+};
+
+ORB_DEFINE(microbench_orb_locked, struct microbench_orb_s, sizeof(microbench_orb_s),
+	   "MICROBENCH_ORB_LOCKED:uint64_t timestamp;uint32_t seq;uint32_t[62] check;");
+ORB_DEFINE(microbench_orb_single_writer, struct microbench_orb_s, sizeof(microbench_orb_s),
+	   "MICROBENCH_ORB_SINGLE_WRITER:uint64_t timestamp;uint32_t seq;uint32_t[62] check;");
+
 namespace MicroBenchORB
 {
 
@@ -93,6 +110,9 @@ public:
 private:
 
 	bool time_px4_uorb();
+	bool time_px4_uorb_single_writer();
+
+	bool time_publish_copy(const orb_metadata *meta, bool single_writer);
 
 	void reset();
 
@@ -104,6 +124,7 @@ private:
 bool MicroBenchORB::run_tests()
 {
 	ut_run_test(time_px4_uorb);
+	ut_run_test(time_px4_uorb_single_writer);
 
 	return (_tests_failed == 0);
 }
@@ -166,4 +187,150 @@ bool MicroBenchORB::time_px4_uorb()
 	return true;
 }
 
+static void fill(microbench_orb_s &msg, uint32_t seq)
+{
+	msg.timestamp = hrt_absolute_time();
+	msg.seq = seq;
+
+	for (unsigned i = 0; i < sizeof(msg.check) / sizeof(msg.check[0]); i++) {
+		msg.check[i] = seq;
+	}
+}
+
+/* a message is consistent if it was not torn by a concurrent publication */
+static bool consistent(const microbench_orb_s &msg)
+{
+	for (unsigned i = 0; i < sizeof(msg.check) / sizeof(msg.check[0]); i++) {
+		if (msg.check[i] != msg.seq) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#ifdef __PX4_POSIX
+static constexpr int READER_THREADS = 4;
+
+struct ReaderContext {
+	const orb_metadata *meta;
+	int instance;
+	volatile bool *should_exit;
+	perf_counter_t perf;
+	unsigned copies;
+	unsigned torn;
+};
+
+static void *reader_main(void *arg)
+{
+	ReaderContext *ctx = (ReaderContext *)arg;
+	microbench_orb_s msg{};
+
+	int fd = orb_subscribe_multi(ctx->meta, ctx->instance);
+
+	while (!*ctx->should_exit) {
+		perf_begin(ctx->perf);
+		orb_copy(ctx->meta, fd, &msg);
+		perf_end(ctx->perf);
+
+		ctx->copies++;
+
+		if (!consistent(msg)) {
+			ctx->torn++;
+		}
+	}
+
+	orb_unsubscribe(fd);
+
+	return nullptr;
+}
+#endif /* __PX4_POSIX */
+
+bool MicroBenchORB::time_publish_copy(const orb_metadata *meta, bool single_writer)
+{
+	char name[64];
+	microbench_orb_s msg{};
+	fill(msg, 0);
+
+	int instance = 0;
+	orb_advert_t pub = single_writer ? orb_advertise_multi_single_writer(meta, &msg, &instance, ORB_PRIO_DEFAULT, 1) :
+			   orb_advertise_multi_queue(meta, &msg, &instance, ORB_PRIO_DEFAULT, 1);
+	ut_assert_true(pub != nullptr);
+
+	int fd = orb_subscribe_multi(meta, instance);
+	uint32_t seq = 0;
+	int ret = 0;
+
+	snprintf(name, sizeof(name), "orb_publish %s", meta->o_name);
+	PERF(name, ret = orb_publish(meta, pub, &msg), 1000);
+	snprintf(name, sizeof(name), "orb_copy %s", meta->o_name);
+	PERF(name, ret = orb_copy(meta, fd, &msg), 1000);
+	ut_assert_true(ret == PX4_OK);
+
+	/* in place read of a single field, falls back to a copy in locked mode */
+	uORB::Subscription<microbench_orb_s> sub{meta, 0, (unsigned)instance};
+	bool borrowed = false;
+	uint32_t seq_read = 0;
+	snprintf(name, sizeof(name), "borrow %s", meta->o_name);
+	PERF(name, borrowed = sub.borrow([&seq_read](const microbench_orb_s & m) { seq_read = m.seq; }), 1000);
+	ut_assert_true(borrowed && seq_read == msg.seq);
+
+#ifdef __PX4_POSIX
+	/* publish while READER_THREADS threads copy the topic as fast as they can */
+	volatile bool should_exit = false;
+	pthread_t threads[READER_THREADS];
+	ReaderContext readers[READER_THREADS] {};
+
+	for (int i = 0; i < READER_THREADS; i++) {
+		readers[i].meta = meta;
+		readers[i].instance = instance;
+		readers[i].should_exit = &should_exit;
+		readers[i].perf = perf_alloc(PC_ELAPSED, "orb_copy contended");
+		pthread_create(&threads[i], nullptr, reader_main, &readers[i]);
+	}
+
+	snprintf(name, sizeof(name), "orb_publish %s (%d readers)", meta->o_name, READER_THREADS);
+	perf_counter_t perf_pub = perf_alloc(PC_ELAPSED, name);
+
+	for (int i = 0; i < 10000; i++) {
+		fill(msg, ++seq);
+
+		perf_begin(perf_pub);
+		orb_publish(meta, pub, &msg);
+		perf_end(perf_pub);
+	}
+
+	should_exit = true;
+	unsigned copies = 0;
+	unsigned torn = 0;
+
+	for (int i = 0; i < READER_THREADS; i++) {
+		pthread_join(threads[i], nullptr);
+		perf_print_counter(readers[i].perf);
+		perf_free(readers[i].perf);
+		copies += readers[i].copies;
+		torn += readers[i].torn;
+	}
+
+	perf_print_counter(perf_pub);
+	perf_free(perf_pub);
+
+	PX4_INFO("%s: %u copies, %u inconsistent", meta->o_name, copies, torn);
+	ut_assert_true(torn == 0);
+#endif /* __PX4_POSIX */
+
+	orb_unsubscribe(fd);
+	orb_unadvertise(pub);
+
+	return true;
+}
+
+bool MicroBenchORB::time_px4_uorb_single_writer()
+{
+	bool ret = time_publish_copy(ORB_ID(microbench_orb_locked), false);
+	ret = ret && time_publish_copy(ORB_ID(microbench_orb_single_writer), true);
+
+	return ret;
+}
+
 } // namespace MicroBenchORB
@@ -106,8 +106,11 @@ const struct {
 	{"bson",		test_bson,	0},
 	{"conv",		test_conv, 0},
 	{"dataman",		test_dataman, OPT_NOJIGTEST | OPT_NOALLTEST},
+	{"ekf2_lane_selector",	test_ekf2_lane_selector,	0},
+	{"excitation",		test_excitation,	0},
 	{"file2",		test_file2,	OPT_NOJIGTEST},
 	{"float",		test_float,	0},
+	{"frequency_response",	test_frequency_response,	0},
 	{"hott_telemetry",	test_hott_telemetry,	OPT_NOJIGTEST | OPT_NOALLTEST},
 	{"hrt",			test_hrt,	OPT_NOJIGTEST | OPT_NOALLTEST},
 	{"int",			test_int,	0},
@@ -59,9 +59,12 @@ extern int	test_bezierQuad(int argc, char *argv[]);
 extern int	test_bson(int argc, char *argv[]);
 extern int	test_conv(int argc, char *argv[]);
 extern int	test_dataman(int argc, char *argv[]);
+extern int	test_ekf2_lane_selector(int argc, char *argv[]);
+extern int	test_excitation(int argc, char *argv[]);
 extern int	test_file(int argc, char *argv[]);
 extern int	test_file2(int argc, char *argv[]);
 extern int	test_float(int argc, char *argv[]);
+extern int	test_frequency_response(int argc, char *argv[]);
 extern int	test_hott_telemetry(int argc, char *argv[]);
 extern int	test_hrt(int argc, char *argv[]);
 extern int	test_int(int argc, char *argv[]);